@@ -0,0 +1,1067 @@
+/*
+ * Copyright 2013, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Benchmark
+ *
+ * Renders a set of synthetic reference scenes, or scene files given on the
+ * command line, without user interface. For each scene the time spent in
+ * scene creation, image loading, BVH building, other scene updates and path
+ * tracing is reported, along with per sample times and rays per second, as one
+ * JSON object per line. Results can be compared against a previous run to
+ * catch performance regressions. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "camera.h"
+#include "device.h"
+#include "graph.h"
+#include "image.h"
+#include "light.h"
+#include "mesh.h"
+#include "nodes.h"
+#include "object.h"
+#include "scene.h"
+#include "session.h"
+#include "shader.h"
+
+#include "util_args.h"
+#include "util_foreach.h"
+#include "util_function.h"
+#include "util_hash.h"
+#include "util_math.h"
+#include "util_path.h"
+#include "util_progress.h"
+#include "util_stats.h"
+#include "util_string.h"
+#include "util_thread.h"
+#include "util_time.h"
+#include "util_transform.h"
+
+#include "cycles_xml.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Options */
+
+struct BenchmarkOptions {
+	SceneParams scene_params;
+	SessionParams session_params;
+	int width, height;
+	float scale;
+	vector<string> scenes;
+	string output_path;
+	string baseline_path;
+	float tolerance;
+	float min_time;
+	bool quiet;
+} options;
+
+/* Results */
+
+struct BenchmarkResult {
+	string scene;
+	string device;
+	vector<pair<string, double> > values;
+
+	void set(const string& key, double value)
+	{
+		for(size_t i = 0; i < values.size(); i++) {
+			if(values[i].first == key) {
+				values[i].second = value;
+				return;
+			}
+		}
+
+		values.push_back(pair<string, double>(key, value));
+	}
+
+	bool get(const string& key, double& value) const
+	{
+		for(size_t i = 0; i < values.size(); i++) {
+			if(values[i].first == key) {
+				value = values[i].second;
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+/* Phase Timer
+ *
+ * Attached to the session progress, maps status messages to benchmark phases
+ * and accumulates the time spent in each of them. While path tracing, every
+ * change of the sample number is recorded to get per sample times. */
+
+class BenchmarkTimer {
+public:
+	BenchmarkTimer(Progress *progress_)
+	: progress(progress_)
+	{
+		phase = "";
+		phase_start = time_dt();
+		render_end = 0.0;
+	}
+
+	void update()
+	{
+		string status, substatus;
+		progress->get_status(status, substatus);
+
+		thread_scoped_lock lock(mutex);
+
+		double now = time_dt();
+		string new_phase = phase_from_status(status);
+
+		if(new_phase != phase) {
+			if(phase != "")
+				phase_times[phase] += now - phase_start;
+			if(phase == "render")
+				render_end = now;
+
+			phase = new_phase;
+			phase_start = now;
+		}
+
+		if(phase == "render" && substatus != sample_substatus) {
+			sample_starts.push_back(now);
+			sample_substatus = substatus;
+		}
+	}
+
+	void finish()
+	{
+		thread_scoped_lock lock(mutex);
+
+		double now = time_dt();
+
+		if(phase != "")
+			phase_times[phase] += now - phase_start;
+		if(phase == "render")
+			render_end = now;
+
+		phase = "";
+	}
+
+	double phase_time(const string& name)
+	{
+		map<string, double>::iterator it = phase_times.find(name);
+		return (it != phase_times.end())? it->second: 0.0;
+	}
+
+	void sample_times(double& tmin, double& tavg, double& tmax)
+	{
+		tmin = 0.0;
+		tavg = 0.0;
+		tmax = 0.0;
+
+		if(sample_starts.size() == 0)
+			return;
+
+		tmin = FLT_MAX;
+
+		for(size_t i = 0; i < sample_starts.size(); i++) {
+			/* the last sample ends when rendering ends */
+			double end = (i + 1 < sample_starts.size())? sample_starts[i + 1]: render_end;
+			double t = max(end - sample_starts[i], 0.0);
+
+			tmin = min(tmin, t);
+			tmax = max(tmax, t);
+			tavg += t;
+		}
+
+		tavg /= sample_starts.size();
+	}
+
+protected:
+	static string phase_from_status(const string& status)
+	{
+		if(status == "Updating Images")
+			return "image_load";
+		else if(string_startswith(status, "Updating Scene BVH") || string_startswith(status, "Updating Mesh BVH"))
+			return "bvh_build";
+		else if(string_startswith(status, "Updating"))
+			return "scene_update";
+		else if(string_startswith(status, "Loading render kernels"))
+			return "kernel_load";
+		else if(status == "Rendering")
+			return "render";
+
+		return "other";
+	}
+
+	Progress *progress;
+	thread_mutex mutex;
+
+	string phase;
+	double phase_start;
+	map<string, double> phase_times;
+
+	string sample_substatus;
+	vector<double> sample_starts;
+	double render_end;
+};
+
+/* Synthetic Scenes */
+
+struct BenchmarkImage {
+	string name;
+	int width, height;
+	uint seed;
+};
+
+static vector<BenchmarkImage*> benchmark_images;
+
+static void benchmark_image_info(const string& name, void *data, bool& is_float, int& width, int& height, int& channels)
+{
+	BenchmarkImage *image = (BenchmarkImage*)data;
+
+	is_float = false;
+	width = image->width;
+	height = image->height;
+	channels = 4;
+}
+
+static bool benchmark_image_pixels(const string& name, void *data, unsigned char *pixels)
+{
+	BenchmarkImage *image = (BenchmarkImage*)data;
+
+	/* checker pattern with per pixel noise, so texture lookups can't be cached trivially */
+	for(int y = 0; y < image->height; y++) {
+		for(int x = 0; x < image->width; x++) {
+			uint h = hash_int_2d(x + image->seed, y);
+			int checker = ((x >> 5) ^ (y >> 5)) & 1;
+			unsigned char *p = pixels + ((size_t)y*image->width + x)*4;
+
+			p[0] = (checker? 200: 40) + (h & 31);
+			p[1] = (checker? 160: 60) + ((h >> 8) & 31);
+			p[2] = (checker? 80: 120) + ((h >> 16) & 31);
+			p[3] = 255;
+		}
+	}
+
+	return true;
+}
+
+static bool benchmark_image_float_pixels(const string& name, void *data, float *pixels)
+{
+	return false;
+}
+
+static int benchmark_add_shader(Scene *scene, const char *name, ShaderGraph *graph)
+{
+	Shader *shader = new Shader();
+	shader->name = name;
+	shader->graph = graph;
+	scene->shaders.push_back(shader);
+
+	return scene->shaders.size() - 1;
+}
+
+static int benchmark_diffuse_shader(Scene *scene, float3 color)
+{
+	ShaderGraph *graph = new ShaderGraph();
+
+	ShaderNode *closure = graph->add(new DiffuseBsdfNode());
+	closure->input("Color")->value = color;
+
+	graph->connect(closure->output("BSDF"), graph->output()->input("Surface"));
+
+	return benchmark_add_shader(scene, "diffuse", graph);
+}
+
+static int benchmark_emission_shader(Scene *scene, float strength)
+{
+	ShaderGraph *graph = new ShaderGraph();
+
+	ShaderNode *closure = graph->add(new EmissionNode());
+	closure->input("Color")->value = make_float3(1.0f, 1.0f, 1.0f);
+	closure->input("Strength")->value.x = strength;
+
+	graph->connect(closure->output("Emission"), graph->output()->input("Surface"));
+
+	return benchmark_add_shader(scene, "emission", graph);
+}
+
+static int benchmark_image_shader(Scene *scene, int width, int height)
+{
+	BenchmarkImage *image = new BenchmarkImage();
+	image->name = string_printf("benchmark_image_%d", (int)benchmark_images.size());
+	image->width = width;
+	image->height = height;
+	image->seed = hash_int(benchmark_images.size());
+	benchmark_images.push_back(image);
+
+	ShaderGraph *graph = new ShaderGraph();
+
+	ShaderNode *texco = graph->add(new TextureCoordinateNode());
+
+	ImageTextureNode *tex = new ImageTextureNode();
+	tex->image_manager = scene->image_manager;
+	tex->filename = image->name;
+	tex->builtin_data = image;
+	graph->add(tex);
+
+	ShaderNode *closure = graph->add(new DiffuseBsdfNode());
+
+	graph->connect(texco->output("Generated"), tex->input("Vector"));
+	graph->connect(tex->output("Color"), closure->input("Color"));
+	graph->connect(closure->output("BSDF"), graph->output()->input("Surface"));
+
+	return benchmark_add_shader(scene, "image", graph);
+}
+
+static Mesh *benchmark_add_mesh(Scene *scene, int shader)
+{
+	Mesh *mesh = new Mesh();
+	mesh->used_shaders.push_back(shader);
+	scene->meshes.push_back(mesh);
+
+	return mesh;
+}
+
+static void benchmark_add_object(Scene *scene, Mesh *mesh, const Transform& tfm)
+{
+	Object *object = new Object();
+	object->mesh = mesh;
+	object->tfm = tfm;
+	scene->objects.push_back(object);
+}
+
+/* grid in the xy plane facing the camera, optionally with a wavy height field */
+static void benchmark_mesh_grid(Mesh *mesh, int res, float size, float amplitude, float z)
+{
+	int first = mesh->verts.size();
+
+	mesh->reserve(first + (res+1)*(res+1), mesh->triangles.size() + res*res*2,
+		mesh->curves.size(), mesh->curve_keys.size());
+
+	for(int j = 0; j <= res; j++) {
+		for(int i = 0; i <= res; i++) {
+			float u = (float)i/(float)res;
+			float v = (float)j/(float)res;
+			float h = amplitude*sinf(u*M_PI_F*16.0f)*cosf(v*M_PI_F*16.0f);
+
+			mesh->verts.push_back(make_float3((u - 0.5f)*size, (v - 0.5f)*size, z + h));
+		}
+	}
+
+	for(int j = 0; j < res; j++) {
+		for(int i = 0; i < res; i++) {
+			int v0 = first + j*(res+1) + i;
+			int v1 = v0 + 1;
+			int v2 = v0 + res + 1;
+			int v3 = v2 + 1;
+
+			mesh->add_triangle(v0, v1, v3, 0, true);
+			mesh->add_triangle(v0, v3, v2, 0, true);
+		}
+	}
+}
+
+static void benchmark_mesh_sphere(Mesh *mesh, float radius, int segments, int rings)
+{
+	int first = mesh->verts.size();
+
+	mesh->reserve(first + (segments+1)*(rings+1), mesh->triangles.size() + segments*rings*2,
+		mesh->curves.size(), mesh->curve_keys.size());
+
+	for(int j = 0; j <= rings; j++) {
+		float theta = M_PI_F*(float)j/(float)rings;
+
+		for(int i = 0; i <= segments; i++) {
+			float phi = 2.0f*M_PI_F*(float)i/(float)segments;
+
+			mesh->verts.push_back(radius*make_float3(sinf(theta)*cosf(phi), sinf(theta)*sinf(phi), cosf(theta)));
+		}
+	}
+
+	for(int j = 0; j < rings; j++) {
+		for(int i = 0; i < segments; i++) {
+			int v0 = first + j*(segments+1) + i;
+			int v1 = v0 + 1;
+			int v2 = v0 + segments + 1;
+			int v3 = v2 + 1;
+
+			mesh->add_triangle(v0, v2, v3, 0, true);
+			mesh->add_triangle(v0, v3, v1, 0, true);
+		}
+	}
+}
+
+static void benchmark_add_light(Scene *scene, float3 co, float size, int shader)
+{
+	Light *light = new Light();
+	light->type = LIGHT_POINT;
+	light->co = co;
+	light->size = size;
+	light->shader = shader;
+	scene->lights.push_back(light);
+}
+
+static void benchmark_camera(Scene *scene, int width, int height, float distance)
+{
+	Camera *cam = scene->camera;
+
+	cam->width = width;
+	cam->height = height;
+
+	float aspect = (float)width/(float)height;
+
+	if(width >= height) {
+		cam->viewplane.left = -aspect;
+		cam->viewplane.right = aspect;
+		cam->viewplane.bottom = -1.0f;
+		cam->viewplane.top = 1.0f;
+	}
+	else {
+		cam->viewplane.left = -1.0f;
+		cam->viewplane.right = 1.0f;
+		cam->viewplane.bottom = -1.0f/aspect;
+		cam->viewplane.top = 1.0f/aspect;
+	}
+
+	/* camera looks along +z towards the origin */
+	cam->matrix = transform_translate(make_float3(0.0f, 0.0f, -distance));
+
+	cam->need_update = true;
+	cam->update();
+}
+
+static int benchmark_scaled(int n, float power = 1.0f)
+{
+	return max((int)(n*powf(options.scale, power)), 1);
+}
+
+static void scene_dense_mesh(Scene *scene)
+{
+	int shader = benchmark_diffuse_shader(scene, make_float3(0.8f, 0.8f, 0.8f));
+	int res = benchmark_scaled(724, 0.5f);
+
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+	benchmark_mesh_grid(mesh, res, 4.0f, 0.05f, 0.0f);
+	benchmark_add_object(scene, mesh, transform_identity());
+
+	benchmark_add_light(scene, make_float3(-1.0f, 1.0f, -2.0f), 0.25f, benchmark_emission_shader(scene, 200.0f));
+}
+
+static void scene_hair(Scene *scene)
+{
+	int shader = benchmark_diffuse_shader(scene, make_float3(0.5f, 0.35f, 0.2f));
+	int res = benchmark_scaled(256, 0.5f);
+	const int num_keys = 8;
+
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+	benchmark_mesh_grid(mesh, 1, 4.0f, 0.0f, 0.0f);
+
+	mesh->reserve(mesh->verts.size(), mesh->triangles.size(), res*res, res*res*num_keys);
+
+	/* strands growing from the plane towards the camera, with some curl */
+	for(int j = 0; j < res; j++) {
+		for(int i = 0; i < res; i++) {
+			uint h = hash_int_2d(i, j);
+			float jx = (float)(h & 0xffff)/65535.0f - 0.5f;
+			float jy = (float)(h >> 16)/65535.0f - 0.5f;
+			float3 root = make_float3((((float)i + 0.5f + jx)/res - 0.5f)*4.0f, (((float)j + 0.5f + jy)/res - 0.5f)*4.0f, 0.0f);
+			int first_key = mesh->curve_keys.size();
+
+			for(int k = 0; k < num_keys; k++) {
+				float t = (float)k/(float)(num_keys - 1);
+				float3 co = root + make_float3(0.05f*t*sinf(t*6.0f + jx*10.0f), 0.05f*t*cosf(t*6.0f + jy*10.0f), -0.3f*t);
+
+				mesh->add_curve_key(co, 0.005f*(1.0f - 0.8f*t));
+			}
+
+			mesh->add_curve(first_key, num_keys, 0);
+		}
+	}
+
+	benchmark_add_object(scene, mesh, transform_identity());
+
+	benchmark_add_light(scene, make_float3(-1.0f, 1.0f, -2.0f), 0.25f, benchmark_emission_shader(scene, 200.0f));
+}
+
+static void scene_many_lights(Scene *scene)
+{
+	int shader = benchmark_diffuse_shader(scene, make_float3(0.8f, 0.8f, 0.8f));
+	int res = benchmark_scaled(16, 0.5f);
+
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+	benchmark_mesh_grid(mesh, 64, 4.0f, 0.02f, 0.0f);
+	benchmark_add_object(scene, mesh, transform_identity());
+
+	int light_shader = benchmark_emission_shader(scene, 2000.0f/(res*res));
+
+	for(int j = 0; j < res; j++) {
+		for(int i = 0; i < res; i++) {
+			float3 co = make_float3(((i + 0.5f)/res - 0.5f)*4.0f, ((j + 0.5f)/res - 0.5f)*4.0f, -0.3f);
+			benchmark_add_light(scene, co, 0.02f, light_shader);
+		}
+	}
+}
+
+static void scene_many_instances(Scene *scene)
+{
+	int shader = benchmark_diffuse_shader(scene, make_float3(0.8f, 0.3f, 0.3f));
+	int res = benchmark_scaled(16, 1.0f/3.0f);
+
+	Mesh *ground = benchmark_add_mesh(scene, benchmark_diffuse_shader(scene, make_float3(0.8f, 0.8f, 0.8f)));
+	benchmark_mesh_grid(ground, 1, 8.0f, 0.0f, 1.0f);
+	benchmark_add_object(scene, ground, transform_identity());
+
+	/* one mesh shared by all instances */
+	Mesh *mesh = benchmark_add_mesh(scene, shader);
+	benchmark_mesh_sphere(mesh, 1.0f, 48, 24);
+
+	float spacing = 3.0f/res;
+
+	for(int k = 0; k < res; k++) {
+		for(int j = 0; j < res; j++) {
+			for(int i = 0; i < res; i++) {
+				float3 co = make_float3((i + 0.5f)*spacing - 1.5f, (j + 0.5f)*spacing - 1.5f, (k + 0.5f)*spacing - 1.5f);
+				float radius = 0.35f*spacing;
+				Transform tfm = transform_translate(co)*transform_scale(make_float3(radius, radius, radius));
+
+				benchmark_add_object(scene, mesh, tfm);
+			}
+		}
+	}
+
+	benchmark_add_light(scene, make_float3(-2.0f, 2.0f, -3.0f), 0.5f, benchmark_emission_shader(scene, 500.0f));
+}
+
+static void scene_heavy_textures(Scene *scene)
+{
+	int num_images = benchmark_scaled(16);
+	int grid = (int)ceilf(sqrtf((float)num_images));
+	float size = 4.0f/grid;
+
+	for(int n = 0; n < num_images; n++) {
+		int i = n % grid;
+		int j = n / grid;
+
+		Mesh *mesh = benchmark_add_mesh(scene, benchmark_image_shader(scene, 2048, 2048));
+		benchmark_mesh_grid(mesh, 8, size*0.95f, 0.0f, 0.0f);
+
+		Transform tfm = transform_translate(make_float3((i + 0.5f)*size - 2.0f, (j + 0.5f)*size - 2.0f, 0.0f));
+		benchmark_add_object(scene, mesh, tfm);
+	}
+
+	benchmark_add_light(scene, make_float3(0.0f, 0.0f, -2.0f), 0.25f, benchmark_emission_shader(scene, 200.0f));
+}
+
+typedef void (*BenchmarkSceneFunc)(Scene *scene);
+
+static struct BenchmarkScene {
+	const char *name;
+	BenchmarkSceneFunc func;
+} benchmark_scenes[] = {
+	{"dense_mesh", scene_dense_mesh},
+	{"hair", scene_hair},
+	{"many_lights", scene_many_lights},
+	{"many_instances", scene_many_instances},
+	{"heavy_textures", scene_heavy_textures},
+	{NULL, NULL}};
+
+static BenchmarkSceneFunc benchmark_scene_find(const string& name)
+{
+	for(int i = 0; benchmark_scenes[i].name; i++)
+		if(name == benchmark_scenes[i].name)
+			return benchmark_scenes[i].func;
+
+	return NULL;
+}
+
+/* Run */
+
+static bool benchmark_run(const string& name, BenchmarkResult& result)
+{
+	BenchmarkSceneFunc func = benchmark_scene_find(name);
+
+	if(!func && !path_exists(name)) {
+		fprintf(stderr, "Unknown scene: %s\n", name.c_str());
+		return false;
+	}
+
+	/* create scene */
+	double scene_start = time_dt();
+
+	Scene *scene = new Scene(options.scene_params, options.session_params.device);
+
+	scene->image_manager->builtin_image_info_cb = function_bind(&benchmark_image_info, _1, _2, _3, _4, _5, _6);
+	scene->image_manager->builtin_image_pixels_cb = function_bind(&benchmark_image_pixels, _1, _2, _3);
+	scene->image_manager->builtin_image_float_pixels_cb = function_bind(&benchmark_image_float_pixels, _1, _2, _3);
+
+	int width = options.width;
+	int height = options.height;
+
+	if(func) {
+		/* synthetic scenes have no size of their own */
+		if(width == 0 || height == 0) {
+			width = 640;
+			height = 360;
+		}
+
+		func(scene);
+		benchmark_camera(scene, width, height, 4.0f);
+	}
+	else {
+		xml_read_file(scene, name.c_str());
+
+		if(width == 0 || height == 0) {
+			width = scene->camera->width;
+			height = scene->camera->height;
+		}
+		else {
+			scene->camera->width = width;
+			scene->camera->height = height;
+			scene->camera->need_update = true;
+		}
+	}
+
+	double scene_create_time = time_dt() - scene_start;
+
+	/* render */
+	Session *session = new Session(options.session_params);
+	BenchmarkTimer timer(&session->progress);
+
+	BufferParams buffer_params;
+	buffer_params.width = width;
+	buffer_params.height = height;
+	buffer_params.full_width = width;
+	buffer_params.full_height = height;
+
+	session->reset(buffer_params, options.session_params.samples);
+	session->scene = scene;
+	session->progress.set_update_callback(function_bind(&BenchmarkTimer::update, &timer));
+
+	double render_start = time_dt();
+
+	session->start();
+	session->wait();
+
+	timer.finish();
+
+	double total_time = time_dt() - render_start + scene_create_time;
+
+	ShaderManager *shader_manager = session->scene->shader_manager;
+	int graph_nodes = shader_manager->num_graph_nodes;
+	int graph_nodes_optimized = shader_manager->num_graph_nodes_optimized;
+	int svm_nodes = shader_manager->num_svm_nodes;
+
+	/* counted by the CPU kernels only */
+	RayStats rays = session->stats.rays;
+
+	/* session frees the scene */
+	delete session;
+
+	foreach(BenchmarkImage *image, benchmark_images)
+		delete image;
+	benchmark_images.clear();
+
+	/* gather results */
+	int samples = options.session_params.samples;
+	double render_time = timer.phase_time("render");
+	double sample_min, sample_avg, sample_max;
+
+	timer.sample_times(sample_min, sample_avg, sample_max);
+
+	result.scene = (func)? name: path_filename(name);
+	result.device = options.session_params.device.description;
+
+	result.set("width", width);
+	result.set("height", height);
+	result.set("samples", samples);
+	result.set("scene_create_time", scene_create_time);
+	result.set("kernel_load_time", timer.phase_time("kernel_load"));
+	result.set("image_load_time", timer.phase_time("image_load"));
+	result.set("bvh_build_time", timer.phase_time("bvh_build"));
+	result.set("scene_update_time", timer.phase_time("scene_update"));
+	result.set("render_time", render_time);
+	result.set("total_time", total_time);
+	result.set("sample_time_min", sample_min);
+	result.set("sample_time_avg", sample_avg);
+	result.set("sample_time_max", sample_max);
+
+	/* one camera path per pixel and sample, fewer when adaptive sampling stops early */
+	double paths = (double)width*(double)height*(double)samples;
+	result.set("paths_per_second", (render_time > 0.0)? paths/render_time: 0.0);
+
+	if(rays.num_camera_rays) {
+		double num_rays = (double)(rays.num_camera_rays + rays.num_bounce_rays + rays.num_shadow_rays);
+
+		result.set("rays_per_second", (render_time > 0.0)? num_rays/render_time: 0.0);
+		result.set("camera_rays", (double)rays.num_camera_rays);
+		result.set("bounce_rays", (double)rays.num_bounce_rays);
+		result.set("shadow_rays", (double)rays.num_shadow_rays);
+	}
+
+	result.set("shader_graph_nodes", graph_nodes);
+	result.set("shader_graph_nodes_optimized", graph_nodes_optimized);
+	result.set("svm_nodes", svm_nodes);
+
+	return true;
+}
+
+/* JSON */
+
+static string benchmark_json_escape(const string& str)
+{
+	string result;
+
+	foreach(char c, str) {
+		if(c == '"' || c == '\\')
+			result += '\\';
+		result += c;
+	}
+
+	return result;
+}
+
+static string benchmark_json_line(const BenchmarkResult& result)
+{
+	string line = string_printf("{\"scene\": \"%s\", \"device\": \"%s\"",
+		benchmark_json_escape(result.scene).c_str(), benchmark_json_escape(result.device).c_str());
+
+	for(size_t i = 0; i < result.values.size(); i++)
+		line += string_printf(", \"%s\": %.6g", result.values[i].first.c_str(), result.values[i].second);
+
+	line += "}";
+
+	return line;
+}
+
+/* only parses the flat objects written above */
+static bool benchmark_json_parse(const string& line, BenchmarkResult& result)
+{
+	const char *p = line.c_str();
+
+	while((p = strchr(p, '"'))) {
+		const char *key_end = strchr(p + 1, '"');
+		if(!key_end)
+			return false;
+
+		string key(p + 1, key_end);
+
+		p = key_end + 1;
+		while(*p == ' ' || *p == ':')
+			p++;
+
+		if(*p == '"') {
+			string value;
+
+			for(p++; *p && *p != '"'; p++) {
+				if(*p == '\\' && p[1])
+					p++;
+				value += *p;
+			}
+
+			if(*p != '"')
+				return false;
+			p++;
+
+			if(key == "scene")
+				result.scene = value;
+			else if(key == "device")
+				result.device = value;
+		}
+		else {
+			char *end;
+			double value = strtod(p, &end);
+
+			if(end == p)
+				return false;
+
+			result.set(key, value);
+			p = end;
+		}
+	}
+
+	return result.scene != "";
+}
+
+static bool benchmark_read_baseline(const string& filepath, vector<BenchmarkResult>& results)
+{
+	FILE *f = fopen(filepath.c_str(), "r");
+
+	if(!f)
+		return false;
+
+	char buf[4096];
+
+	while(fgets(buf, sizeof(buf), f)) {
+		BenchmarkResult result;
+
+		if(benchmark_json_parse(buf, result))
+			results.push_back(result);
+	}
+
+	fclose(f);
+
+	return true;
+}
+
+/* Regressions */
+
+static int benchmark_compare(const BenchmarkResult& result, const vector<BenchmarkResult>& baseline)
+{
+	const BenchmarkResult *base = NULL;
+
+	foreach(const BenchmarkResult& b, baseline) {
+		if(b.scene == result.scene && b.device == result.device) {
+			base = &b;
+			break;
+		}
+	}
+
+	if(!base)
+		return 0;
+
+	int regressions = 0;
+	double rays_per_second;
+
+	for(size_t i = 0; i < result.values.size(); i++) {
+		const string& key = result.values[i].first;
+		double value = result.values[i].second, base_value;
+
+		if(!base->get(key, base_value))
+			continue;
+
+		bool regressed = false;
+
+		if(string_endswith(key, "_time")) {
+			/* skip short phases, they are dominated by noise */
+			if(max(value, base_value) < options.min_time)
+				continue;
+
+			regressed = value > base_value*(1.0 + options.tolerance);
+		}
+		else if(key == "rays_per_second")
+			regressed = value < base_value*(1.0 - options.tolerance);
+		else if(key == "paths_per_second" &&
+		        !(result.get("rays_per_second", rays_per_second) && base->get("rays_per_second", rays_per_second)))
+		{
+			/* rays are only compared when both runs counted them */
+			regressed = value < base_value*(1.0 - options.tolerance);
+		}
+
+		if(regressed) {
+			fprintf(stderr, "Regression in %s %s: %.6g -> %.6g (%+.1f%%)\n",
+				result.scene.c_str(), key.c_str(), base_value, value,
+				(base_value != 0.0)? 100.0*(value - base_value)/base_value: 0.0);
+			regressions++;
+		}
+	}
+
+	return regressions;
+}
+
+/* Options */
+
+static int files_parse(int argc, const char *argv[])
+{
+	for(int i = 0; i < argc; i++)
+		options.scenes.push_back(argv[i]);
+
+	return 0;
+}
+
+static void options_parse(int argc, const char **argv)
+{
+	options.width = 0;
+	options.height = 0;
+	options.scale = 1.0f;
+	options.tolerance = 0.1f;
+	options.min_time = 0.05f;
+	options.quiet = false;
+	options.session_params.samples = 16;
+
+	/* device names */
+	string device_names = "";
+	string devicename = "cpu";
+	string cache_path = "";
+	bool list = false;
+
+	vector<DeviceType>& types = Device::available_types();
+
+	foreach(DeviceType type, types) {
+		if(device_names != "")
+			device_names += ", ";
+
+		device_names += Device::string_from_type(type);
+	}
+
+	string scene_names = "";
+
+	for(int i = 0; benchmark_scenes[i].name; i++) {
+		if(scene_names != "")
+			scene_names += ", ";
+
+		scene_names += benchmark_scenes[i].name;
+	}
+
+	/* parse options */
+	ArgParse ap;
+	bool help = false;
+
+	ap.options ("Usage: cycles_benchmark [options] [scene ...]",
+		"%*", files_parse, "",
+		"--device %s", &devicename, ("Devices to use: " + device_names).c_str(),
+		"--samples %d", &options.session_params.samples, "Number of samples to render",
+		"--threads %d", &options.session_params.threads, "CPU Rendering Threads",
+		"--width  %d", &options.width, "Image width in pixel, defaults to the size from a scene file, or 640 for synthetic scenes",
+		"--height %d", &options.height, "Image height in pixel, defaults to the size from a scene file, or 360 for synthetic scenes",
+		"--scale %f", &options.scale, "Scale factor for the complexity of the synthetic scenes",
+		"--bvh-cache", &options.scene_params.use_bvh_cache, "Cache BVH and geometry on disk between runs",
+		"--bvh-spatial-split", &options.scene_params.use_bvh_spatial_split, "Build the BVH with spatial splits",
+		"--cache-path %s", &cache_path, "Directory to store the BVH cache in",
+		"--ray-packets", &options.scene_params.use_ray_packets, "Trace camera rays of neighboring pixels and direct light shadow rays together",
+		"--output %s", &options.output_path, "File to append JSON results to, instead of standard output",
+		"--baseline %s", &options.baseline_path, "JSON results of a previous run to compare against",
+		"--tolerance %f", &options.tolerance, "Relative slowdown that counts as regression",
+		"--min-time %f", &options.min_time, "Ignore timings shorter than this many seconds in comparisons",
+		"--quiet", &options.quiet, "Don't print progress messages",
+		"--list-devices", &list, "List information about all available devices",
+		"--help", &help, "Print help message",
+		NULL);
+
+	if(ap.parse(argc, argv) < 0) {
+		fprintf(stderr, "%s\n", ap.geterror().c_str());
+		ap.usage();
+		exit(EXIT_FAILURE);
+	}
+	else if(list) {
+		vector<DeviceInfo>& devices = Device::available_devices();
+		printf("Devices:\n");
+
+		foreach(DeviceInfo& info, devices) {
+			printf("    %s%s\n",
+				info.description.c_str(),
+				(info.display_device)? " (display)": "");
+		}
+
+		exit(EXIT_SUCCESS);
+	}
+	else if(help) {
+		ap.usage();
+		printf("\nScenes are names of synthetic scenes (%s) or XML files, all synthetic scenes by default.\n",
+			scene_names.c_str());
+		exit(EXIT_SUCCESS);
+	}
+
+	if(cache_path != "")
+		path_init("", cache_path);
+
+	if(options.scenes.size() == 0)
+		for(int i = 0; benchmark_scenes[i].name; i++)
+			options.scenes.push_back(benchmark_scenes[i].name);
+
+	/* render full frame samples one after the other, for per sample timings */
+	options.session_params.background = true;
+	options.session_params.progressive = true;
+
+	/* find matching device */
+	DeviceType device_type = Device::type_from_string(devicename.c_str());
+	vector<DeviceInfo>& devices = Device::available_devices();
+	bool device_available = false;
+
+	foreach(DeviceInfo& device, devices) {
+		if(device_type == device.type) {
+			options.session_params.device = device;
+			device_available = true;
+			break;
+		}
+	}
+
+	/* handle invalid configurations */
+	if(options.session_params.device.type == DEVICE_NONE || !device_available) {
+		fprintf(stderr, "Unknown device: %s\n", devicename.c_str());
+		exit(EXIT_FAILURE);
+	}
+	else if(options.session_params.samples <= 0) {
+		fprintf(stderr, "Invalid number of samples: %d\n", options.session_params.samples);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.width < 0 || options.height < 0) {
+		fprintf(stderr, "Invalid resolution: %dx%d\n", options.width, options.height);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.scale <= 0.0f) {
+		fprintf(stderr, "Invalid scale: %f\n", options.scale);
+		exit(EXIT_FAILURE);
+	}
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+	path_init();
+
+	options_parse(argc, argv);
+
+	vector<BenchmarkResult> baseline;
+
+	if(options.baseline_path != "" && !benchmark_read_baseline(options.baseline_path, baseline)) {
+		fprintf(stderr, "Failed to read baseline: %s\n", options.baseline_path.c_str());
+		return EXIT_FAILURE;
+	}
+
+	FILE *output = stdout;
+
+	if(options.output_path != "") {
+		output = fopen(options.output_path.c_str(), "a");
+
+		if(!output) {
+			fprintf(stderr, "Failed to open output file: %s\n", options.output_path.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	int regressions = 0;
+	bool failed = false;
+
+	foreach(const string& name, options.scenes) {
+		if(!options.quiet)
+			fprintf(stderr, "Rendering %s...\n", name.c_str());
+
+		BenchmarkResult result;
+
+		if(!benchmark_run(name, result)) {
+			failed = true;
+			continue;
+		}
+
+		fprintf(output, "%s\n", benchmark_json_line(result).c_str());
+		fflush(output);
+
+		regressions += benchmark_compare(result, baseline);
+	}
+
+	if(output != stdout)
+		fclose(output);
+
+	if(regressions && !options.quiet)
+		fprintf(stderr, "%d regression(s) found\n", regressions);
+
+	return (failed || regressions)? EXIT_FAILURE: EXIT_SUCCESS;
+}
@@ -19,6 +19,7 @@
 #include <stdio.h>
 
 #include "device.h"
+#include "device_network.h"
 
 #include "util_args.h"
 #include "util_foreach.h"
@@ -36,6 +37,7 @@ int main(int argc, const char **argv)
 	/* device types */
 	string devicelist = "";
 	string devicename = "cpu";
+	int port = SERVER_PORT;
 	bool list = false;
 
 	vector<DeviceType>& types = Device::available_types();
@@ -52,6 +54,7 @@ int main(int argc, const char **argv)
 
 	ap.options ("Usage: cycles_server [options]",
 		"--device %s", &devicename, ("Devices to use: " + devicelist).c_str(),
+		"--port %d", &port, "Port to listen on, to run multiple servers on one machine",
 		"--list-devices", &list, "List information about all available devices",
 		NULL);
 
@@ -92,7 +95,7 @@ int main(int argc, const char **argv)
 		Stats stats;
 		Device *device = Device::create(device_info, stats);
 		printf("Cycles Server with device: %s\n", device->info.description.c_str());
-		device->server_run();
+		device->server_run(port);
 		delete device;
 	}
 
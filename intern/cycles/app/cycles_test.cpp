@@ -21,10 +21,12 @@
 #include "buffers.h"
 #include "camera.h"
 #include "device.h"
+#include "film.h"
 #include "scene.h"
 #include "session.h"
 
 #include "util_args.h"
+#include "util_cache.h"
 #include "util_foreach.h"
 #include "util_function.h"
 #include "util_path.h"
@@ -45,6 +47,7 @@ struct Options {
 	SceneParams scene_params;
 	SessionParams session_params;
 	bool quiet;
+	bool debug_passes;
 } options;
 
 static void session_print(const string& str)
@@ -83,6 +86,14 @@ static void session_print_status()
 	session_print(status);
 }
 
+static void session_debug_passes_add(vector<Pass>& passes)
+{
+	Pass::add(PASS_DEBUG_BVH_TRAVERSAL_STEPS, passes);
+	Pass::add(PASS_DEBUG_BVH_INTERSECTIONS, passes);
+	Pass::add(PASS_DEBUG_RAY_BOUNCES, passes);
+	Pass::add(PASS_DEBUG_RENDER_TIME, passes);
+}
+
 static BufferParams& session_buffer_params()
 {
 	static BufferParams buffer_params;
@@ -91,11 +102,19 @@ static BufferParams& session_buffer_params()
 	buffer_params.full_width = options.width;
 	buffer_params.full_height = options.height;
 
+	if(options.debug_passes)
+		session_debug_passes_add(buffer_params.passes);
+
 	return buffer_params;
 }
 
 static void session_init()
 {
+	if(options.debug_passes) {
+		session_debug_passes_add(options.scene->film->passes);
+		options.scene->film->tag_update(options.scene);
+	}
+
 	options.session = new Session(options.session_params);
 	options.session->reset(session_buffer_params(), options.session_params.samples);
 	options.session->scene = options.scene;
@@ -204,10 +223,14 @@ static void options_parse(int argc, const char **argv)
 	options.filepath = "";
 	options.session = NULL;
 	options.quiet = false;
+	options.debug_passes = false;
 
 	/* device names */
 	string device_names = "";
 	string devicename = "cpu";
+	string cache_path = "";
+	int cache_size = 0;
+	string servers = "";
 	bool list = false;
 
 	vector<DeviceType>& types = Device::available_types();
@@ -234,12 +257,20 @@ static void options_parse(int argc, const char **argv)
 	ap.options ("Usage: cycles_test [options] file.xml",
 		"%*", files_parse, "",
 		"--device %s", &devicename, ("Devices to use: " + device_names).c_str(),
+#ifdef WITH_NETWORK
+		"--servers %s", &servers, "Comma separated list of host[:port] render servers for the network device",
+#endif
 		"--shadingsys %s", &ssname, "Shading system to use: svm, osl",
 		"--background", &options.session_params.background, "Render in background, without user interface",
 		"--quiet", &options.quiet, "In background mode, don't print progress messages",
 		"--samples %d", &options.session_params.samples, "Number of samples to render",
-		"--output %s", &options.session_params.output_path, "File path to write output image",
+		"--output %s", &options.session_params.output_path, "File path to write output image, in background mode tiles are written to a multilayer EXR as they finish",
 		"--threads %d", &options.session_params.threads, "CPU Rendering Threads",
+		"--bvh-cache", &options.scene_params.use_bvh_cache, "Cache BVH and geometry on disk between runs",
+		"--cache-path %s", &cache_path, "Directory to store the BVH cache in",
+		"--cache-size %d", &cache_size, "Remove least recently used BVH cache files beyond this size in MB, 0 keeps all",
+		"--ray-packets", &options.scene_params.use_ray_packets, "Trace camera rays of neighboring pixels and direct light shadow rays together",
+		"--debug-passes", &options.debug_passes, "Render BVH traversal, bounce and tile time passes, needs a WITH_CYCLES_DEBUG build",
 		"--width  %d", &options.width, "Window width in pixel",
 		"--height %d", &options.height, "Window height in pixel",
 		"--list-devices", &list, "List information about all available devices",
@@ -268,6 +299,12 @@ static void options_parse(int argc, const char **argv)
 		exit(EXIT_SUCCESS);
 	}
 
+	if(cache_path != "")
+		path_init("", cache_path);
+
+	if(cache_size > 0)
+		Cache::global.max_size = (size_t)cache_size*1024*1024;
+
 	if(ssname == "osl")
 		options.scene_params.shadingsystem = SceneParams::OSL;
 	else if(ssname == "svm")
@@ -290,6 +327,12 @@ static void options_parse(int argc, const char **argv)
 		}
 	}
 
+#ifdef WITH_NETWORK
+	/* render on the given servers */
+	if(device_type == DEVICE_NETWORK && servers != "")
+		options.session_params.device = Device::network_info(servers);
+#endif
+
 	/* handle invalid configurations */
 	if(options.session_params.device.type == DEVICE_NONE || !device_available) {
 		fprintf(stderr, "Unknown device: %s\n", devicename.c_str());
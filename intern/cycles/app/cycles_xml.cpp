@@ -256,6 +256,7 @@ static void xml_read_integrator(const XMLReadState& state, pugi::xml_node node)
 	Integrator *integrator = state.scene->integrator;
 	
 	xml_read_bool(&integrator->progressive, node, "progressive");
+	xml_read_bool(&integrator->use_light_tree, node, "use_light_tree");
 	
 	if(!integrator->progressive) {
 		xml_read_int(&integrator->diffuse_samples, node, "diffuse_samples");
@@ -669,11 +670,11 @@ static void xml_read_mesh(const XMLReadState& state, pugi::xml_node node)
 
 	if(xml_equal_string(node, "subdivision", "catmull-clark")) {
 		/* create subd mesh */
-		SubdMesh sdmesh;
+		SubdMesh *sdmesh = new SubdMesh();
 
 		/* create subd vertices */
 		for(size_t i = 0; i < P.size(); i++)
-			sdmesh.add_vert(P[i]);
+			sdmesh->add_vert(P[i]);
 
 		/* create subd faces */
 		int index_offset = 0;
@@ -685,7 +686,7 @@ static void xml_read_mesh(const XMLReadState& state, pugi::xml_node node)
 				int v2 = verts[index_offset + 2];
 				int v3 = verts[index_offset + 3];
 
-				sdmesh.add_face(v0, v1, v2, v3);
+				sdmesh->add_face(v0, v1, v2, v3);
 			}
 			else {
 				for(int j = 0; j < nverts[i]-2; j++) {
@@ -693,7 +694,7 @@ static void xml_read_mesh(const XMLReadState& state, pugi::xml_node node)
 					int v1 = verts[index_offset + j + 1];
 					int v2 = verts[index_offset + j + 2];
 
-					sdmesh.add_face(v0, v1, v2);
+					sdmesh->add_face(v0, v1, v2);
 				}
 			}
 
@@ -701,15 +702,29 @@ static void xml_read_mesh(const XMLReadState& state, pugi::xml_node node)
 		}
 
 		/* finalize subd mesh */
-		sdmesh.link_boundary();
+		sdmesh->link_boundary();
+
+		float dicing_rate = state.dicing_rate;
+		bool adaptive = false;
+
+		xml_read_float(&dicing_rate, node, "dicing_rate");
+		xml_read_bool(&adaptive, node, "adaptive");
+
+		if(adaptive) {
+			/* tessellated on scene update, with the dicing rate in pixels */
+			mesh->subd_mesh = sdmesh;
+			mesh->subd_dicing_rate = dicing_rate;
+			mesh->subd_adaptive = true;
+			mesh->subd_shader = shader;
+			mesh->subd_smooth = smooth;
+			return;
+		}
 
 		/* subdivide */
 		DiagSplit dsplit;
-		//dsplit.camera = state.scene->camera;
-		//dsplit.dicing_rate = 5.0f;
-		dsplit.dicing_rate = state.dicing_rate;
-		xml_read_float(&dsplit.dicing_rate, node, "dicing_rate");
-		sdmesh.tessellate(&dsplit, false, mesh, shader, smooth);
+		dsplit.dicing_rate = dicing_rate;
+		sdmesh->tessellate(&dsplit, false, mesh, shader, smooth);
+		delete sdmesh;
 	}
 	else {
 		/* create vertices */
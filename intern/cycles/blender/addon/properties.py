@@ -138,6 +138,12 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 description="Use progressive sampling of lighting",
                 default=True,
                 )
+        cls.use_light_tree = BoolProperty(
+                name="Light Tree",
+                description="Sample lights using a tree built over all emitters, "
+                            "reduces noise in scenes with many lights (CPU progressive rendering only)",
+                default=False,
+                )
 
         cls.samples = IntProperty(
                 name="Samples",
@@ -204,6 +210,19 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 min=1, max=10000,
                 default=1,
                 )
+        cls.adaptive_threshold = FloatProperty(
+                name="Noise Threshold",
+                description="Stop sampling a tile once the relative noise of all its pixels is below this value, "
+                            "0 disables adaptive sampling (final CPU renders without progressive refine only)",
+                min=0.0, max=1.0,
+                default=0.0,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Min Samples",
+                description="Number of samples to render in every tile before adaptive sampling may stop it",
+                min=1, max=2147483647,
+                default=16,
+                )
 
         cls.no_caustics = BoolProperty(
                 name="No Caustics",
@@ -359,11 +378,41 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 description="Use BVH spatial splits: longer builder time, faster render",
                 default=False,
                 )
+        cls.debug_use_qbvh = BoolProperty(
+                name="Use QBVH",
+                description="Use BVH with 4 children per node, traversed with SIMD instructions "
+                            "on CPUs that support SSE2",
+                default=True,
+                )
+        cls.debug_use_ray_packets = BoolProperty(
+                name="Use Ray Packets",
+                description="Trace camera rays of neighboring pixels and shadow rays to all lights together, requires QBVH",
+                default=False,
+                )
         cls.use_cache = BoolProperty(
                 name="Cache BVH",
                 description="Cache last built BVH to disk for faster re-render if no geometry changed",
                 default=False,
                 )
+        cls.use_texture_cache = BoolProperty(
+                name="Texture Cache",
+                description="Read image textures on demand in tiles and mipmap levels, "
+                            "instead of loading them fully before rendering (CPU only)",
+                default=False,
+                )
+        cls.texture_cache_memory = IntProperty(
+                name="Cache Memory",
+                description="Maximum memory in megabytes used by the texture cache",
+                min=64, max=1048576,
+                default=4096,
+                )
+        cls.subdivision_cache_memory = IntProperty(
+                name="Subdivision Cache",
+                description="Maximum memory in megabytes used to keep diced subdivision surfaces "
+                            "for faster updates when the camera moves",
+                min=0, max=1048576,
+                default=256,
+                )
         cls.tile_order = EnumProperty(
                 name="Tile Order",
                 description="Tile order for rendering",
@@ -617,6 +666,12 @@ class CyclesMeshSettings(bpy.types.PropertyGroup):
                 description="Subdivide mesh for rendering",
                 default=False,
                 )
+        cls.use_adaptive_subdivision = BoolProperty(
+                name="Adaptive",
+                description="Use the dicing rate in pixels as seen from the camera, "
+                            "instead of in object space",
+                default=False,
+                )
         cls.dicing_rate = FloatProperty(
                 name="Dicing Rate",
                 description="",
@@ -59,6 +59,7 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
         sub = col.column()
         sub.active = (device_type == 'NONE' or cscene.device == 'CPU')
         sub.prop(cscene, "progressive")
+        sub.prop(cscene, "use_light_tree")
 
         sub = col.column(align=True)
         sub.prop(cscene, "seed")
@@ -84,6 +85,11 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
             sub.prop(cscene, "ao_samples", text="AO")
             sub.prop(cscene, "mesh_light_samples", text="Mesh Light")
 
+        row = layout.row(align=True)
+        row.active = not cscene.use_progressive_refine
+        row.prop(cscene, "adaptive_threshold")
+        row.prop(cscene, "adaptive_min_samples")
+
 
 class CyclesRender_PT_light_paths(CyclesButtonsPanel, Panel):
     bl_label = "Light Paths"
@@ -222,6 +228,8 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
         sub.label(text="Acceleration structure:")
         sub.prop(cscene, "debug_bvh_type", text="")
         sub.prop(cscene, "debug_use_spatial_splits")
+        sub.prop(cscene, "debug_use_qbvh")
+        sub.prop(cscene, "debug_use_ray_packets")
         sub.prop(cscene, "use_cache")
 
         sub = col.column(align=True)
@@ -232,6 +240,17 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
         sub.label(text="Final Render:")
         sub.prop(rd, "use_persistent_data", text="Persistent Images")
 
+        sub = col.column(align=True)
+        sub.label(text="Textures:")
+        sub.prop(cscene, "use_texture_cache")
+        subsub = sub.column()
+        subsub.active = cscene.use_texture_cache
+        subsub.prop(cscene, "texture_cache_memory")
+
+        sub = col.column(align=True)
+        sub.label(text="Subdivision:")
+        sub.prop(cscene, "subdivision_cache_memory", text="Cache Memory")
+
 
 class CyclesRender_PT_layers(CyclesButtonsPanel, Panel):
     bl_label = "Layers"
@@ -449,6 +468,7 @@ class Cycles_PT_mesh_displacement(CyclesButtonsPanel, Panel):
 
         layout.prop(cdata, "displacement_method", text="Method")
         layout.prop(cdata, "use_subdivision")
+        layout.prop(cdata, "use_adaptive_subdivision")
         layout.prop(cdata, "dicing_rate")
 
 
@@ -25,10 +25,9 @@
 #include "blender_util.h"
 
 #include "subd_mesh.h"
-#include "subd_patch.h"
-#include "subd_split.h"
 
 #include "util_foreach.h"
+#include "util_md5.h"
 
 #include "mikktspace.h"
 
@@ -343,13 +342,13 @@ static void create_mesh(Scene *scene, Mesh *mesh, BL::Mesh b_mesh, const vector<
 static void create_subd_mesh(Mesh *mesh, BL::Mesh b_mesh, PointerRNA *cmesh, const vector<uint>& used_shaders)
 {
 	/* create subd mesh */
-	SubdMesh sdmesh;
+	SubdMesh *sdmesh = new SubdMesh();
 
 	/* create vertices */
 	BL::Mesh::vertices_iterator v;
 
 	for(b_mesh.vertices.begin(v); v != b_mesh.vertices.end(); ++v)
-		sdmesh.add_vert(get_float3(v->co()));
+		sdmesh->add_vert(get_float3(v->co()));
 
 	/* create faces */
 	BL::Mesh::tessfaces_iterator f;
@@ -360,24 +359,147 @@ static void create_subd_mesh(Mesh *mesh, BL::Mesh b_mesh, PointerRNA *cmesh, con
 		//int shader = used_shaders[f->material_index()];
 
 		if(n == 4)
-			sdmesh.add_face(vi[0], vi[1], vi[2], vi[3]);
+			sdmesh->add_face(vi[0], vi[1], vi[2], vi[3]);
 #if 0
 		else
-			sdmesh.add_face(vi[0], vi[1], vi[2]);
+			sdmesh->add_face(vi[0], vi[1], vi[2]);
 #endif
 	}
 
 	/* finalize subd mesh */
-	sdmesh.link_boundary();
+	sdmesh->link_boundary();
+
+	/* tessellated on scene update, when the camera is known */
+	mesh->subd_mesh = sdmesh;
+	mesh->subd_dicing_rate = RNA_float_get(cmesh, "dicing_rate");
+	mesh->subd_adaptive = RNA_boolean_get(cmesh, "use_adaptive_subdivision");
+	mesh->subd_shader = used_shaders[0];
+	mesh->subd_smooth = true;
+}
+
+/* Content Hash
+ *
+ * Used to find meshes with identical content, so they can be instanced. Only
+ * x, y and z of float3 are hashed, the fourth component is not initialized. */
+
+template<typename T> static void md5_append_vector(MD5Hash& md5, const vector<T>& data)
+{
+	int size = data.size();
+	md5.append((const uint8_t*)&size, sizeof(size));
+
+	if(size)
+		md5.append((const uint8_t*)&data[0], sizeof(T)*size);
+}
+
+static void md5_append_float3(MD5Hash& md5, const float3 *data, size_t size)
+{
+	vector<float> packed(size*3);
+
+	for(size_t i = 0; i < size; i++) {
+		packed[i*3+0] = data[i].x;
+		packed[i*3+1] = data[i].y;
+		packed[i*3+2] = data[i].z;
+	}
+
+	md5_append_vector(md5, packed);
+}
+
+static void md5_append_attributes(MD5Hash& md5, const AttributeSet& attributes)
+{
+	foreach(const Attribute& attr, attributes.attributes) {
+		int header[3] = {attr.std, attr.element, (attr.type == TypeDesc::TypeFloat)};
 
-	/* subdivide */
-	DiagSplit dsplit;
-	dsplit.camera = NULL;
-	dsplit.dicing_rate = RNA_float_get(cmesh, "dicing_rate");
+		md5.append((const uint8_t*)attr.name.c_str(), attr.name.length());
+		md5.append((const uint8_t*)header, sizeof(header));
+
+		if(attr.type == TypeDesc::TypeFloat)
+			md5_append_vector(md5, attr.buffer);
+		else
+			md5_append_float3(md5, attr.data_float3(), attr.buffer.size()/sizeof(float3));
+	}
+}
+
+static void mesh_hash_triangles(MD5Hash& md5, Mesh *mesh)
+{
+	vector<uint8_t> smooth(mesh->smooth.begin(), mesh->smooth.end());
+
+	md5_append_float3(md5, (mesh->verts.size())? &mesh->verts[0]: NULL, mesh->verts.size());
+	md5_append_vector(md5, mesh->triangles);
+	md5_append_vector(md5, mesh->shader);
+	md5_append_vector(md5, smooth);
+	md5_append_vector(md5, mesh->used_shaders);
+	md5_append_attributes(md5, mesh->attributes);
+}
+
+static void mesh_hash_curves(MD5Hash& md5, Mesh *mesh)
+{
+	vector<float> keys(mesh->curve_keys.size()*4);
+
+	for(size_t i = 0; i < mesh->curve_keys.size(); i++) {
+		keys[i*4+0] = mesh->curve_keys[i].co.x;
+		keys[i*4+1] = mesh->curve_keys[i].co.y;
+		keys[i*4+2] = mesh->curve_keys[i].co.z;
+		keys[i*4+3] = mesh->curve_keys[i].radius;
+	}
+
+	/* curve padding is not initialized */
+	vector<int> curves(mesh->curves.size()*3);
+
+	for(size_t i = 0; i < mesh->curves.size(); i++) {
+		curves[i*3+0] = mesh->curves[i].first_key;
+		curves[i*3+1] = mesh->curves[i].num_keys;
+		curves[i*3+2] = mesh->curves[i].shader;
+	}
 
-	sdmesh.tessellate(&dsplit, false, mesh, used_shaders[0], true);
+	md5_append_vector(md5, keys);
+	md5_append_vector(md5, curves);
+	md5_append_attributes(md5, mesh->curve_attributes);
+	md5.append((const uint8_t*)&mesh->displacement_method, sizeof(mesh->displacement_method));
 }
 
+/* Mesh Sync Task
+ *
+ * Conversion of a derived mesh to a cycles mesh, run in parallel for all
+ * meshes in the scene. Only reads the blender mesh and writes to its own
+ * cycles mesh, everything else is done in sync_mesh_finish. */
+
+#define MESH_SYNC_MAX_PENDING 256
+
+struct BlenderSync::MeshSyncTask {
+	MeshSyncTask(Mesh *mesh_, BL::Mesh b_mesh_, BL::Object b_ob_, bool object_updated_)
+	: mesh(mesh_), b_mesh(b_mesh_), b_ob(b_ob_), object_updated(object_updated_),
+	  scene(NULL), cmesh(PointerRNA_NULL), subdivision(false), instance(false)
+	{
+	}
+
+	void run()
+	{
+		if(subdivision)
+			create_subd_mesh(mesh, b_mesh, &cmesh, mesh->used_shaders);
+		else
+			create_mesh(scene, mesh, b_mesh, mesh->used_shaders);
+
+		if(instance)
+			mesh_hash_triangles(md5, mesh);
+	}
+
+	Mesh *mesh;
+	BL::Mesh b_mesh;
+	BL::Object b_ob;
+	bool object_updated;
+
+	Scene *scene;
+	PointerRNA cmesh;
+	bool subdivision;
+
+	/* automatic instancing, hair is added to the hash after conversion */
+	bool instance;
+	MD5Hash md5;
+
+	vector<Mesh::Triangle> oldtriangle;
+	vector<Mesh::CurveKey> oldcurve_keys;
+};
+
 /* Sync */
 
 Mesh *BlenderSync::sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tris)
@@ -410,7 +532,7 @@ Mesh *BlenderSync::sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tri
 
 	if(!mesh_map.sync(&mesh, key)) {
 		/* if transform was applied to mesh, need full update */
-		if(object_updated && mesh->transform_applied);
+		if(object_updated && find_mesh_instance(mesh)->transform_applied);
 		/* test if shaders changed, these can be object level so mesh
 		 * does not get tagged for recalc */
 		else if(mesh->used_shaders != used_shaders);
@@ -432,36 +554,43 @@ Mesh *BlenderSync::sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tri
 	if(mesh_synced.find(mesh) != mesh_synced.end())
 		return mesh;
 	
+	/* other meshes are instancing the content of this mesh, leave it to them
+	 * and sync into new mesh */
+	mesh_instance.erase(mesh);
+
+	if(mesh_instanced.find(mesh) != mesh_instanced.end())
+		mesh = mesh_map.detach(key.ptr.id.data);
+
 	mesh_synced.insert(mesh);
 
-	/* create derived mesh */
+	/* create derived mesh, this uses blender kernel functions that are not
+	 * thread safe, so only the conversion itself runs in a task */
 	BL::Mesh b_mesh = object_to_mesh(b_data, b_ob, b_scene, true, !preview);
 	PointerRNA cmesh = RNA_pointer_get(&b_ob_data.ptr, "cycles");
 
-	vector<Mesh::Triangle> oldtriangle = mesh->triangles;
+	MeshSyncTask *task = new MeshSyncTask(mesh, b_mesh, b_ob, object_updated);
+
+	task->oldtriangle = mesh->triangles;
 	
 	/* compares curve_keys rather than strands in order to handle quick hair adjustsments in dynamic BVH - other methods could probably do this better*/
-	vector<Mesh::CurveKey> oldcurve_keys = mesh->curve_keys;
+	task->oldcurve_keys = mesh->curve_keys;
 
 	mesh->clear();
 	mesh->used_shaders = used_shaders;
 	mesh->name = ustring(b_ob_data.name().c_str());
 
-	if(b_mesh) {
-		if(!(hide_tris && experimental && is_cpu)) {
-			if(cmesh.data && experimental && RNA_boolean_get(&cmesh, "use_subdivision"))
-				create_subd_mesh(mesh, b_mesh, &cmesh, used_shaders);
-			else
-				create_mesh(scene, mesh, b_mesh, used_shaders);
-		}
-
-		if(experimental && is_cpu)
-			sync_curves(mesh, b_mesh, b_ob, object_updated);
+	if(b_mesh && !(hide_tris && experimental && is_cpu)) {
+		task->scene = scene;
+		task->cmesh = cmesh;
+		task->subdivision = (cmesh.data && experimental && RNA_boolean_get(&cmesh, "use_subdivision"));
+		/* deformation motion is stored on the mesh, so it can't be shared */
+		task->instance = !task->subdivision && (scene->need_motion() != Scene::MOTION_PASS);
 
-		/* free derived mesh */
-		b_data.meshes.remove(b_mesh);
+		mesh_pool.push(function_bind(&MeshSyncTask::run, task));
 	}
 
+	mesh_sync_tasks.push_back(task);
+
 	/* displacement method */
 	if(cmesh.data) {
 		int method = RNA_enum_get(&cmesh, "displacement_method");
@@ -474,26 +603,155 @@ Mesh *BlenderSync::sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tri
 			mesh->displacement_method = Mesh::DISPLACE_BOTH;
 	}
 
-	/* tag update */
-	bool rebuild = false;
+	/* tag update, rebuild is decided once the conversion is done */
+	mesh->tag_update(scene, false);
+
+	/* limit the number of derived meshes kept in memory */
+	if(mesh_sync_tasks.size() >= MESH_SYNC_MAX_PENDING)
+		sync_mesh_finish();
 
-	if(oldtriangle.size() != mesh->triangles.size())
-		rebuild = true;
-	else if(oldtriangle.size()) {
-		if(memcmp(&oldtriangle[0], &mesh->triangles[0], sizeof(Mesh::Triangle)*oldtriangle.size()) != 0)
+	return mesh;
+}
+
+void BlenderSync::sync_mesh_finish()
+{
+	if(mesh_sync_tasks.size() == 0)
+		return;
+
+	mesh_pool.wait_work();
+
+	foreach(MeshSyncTask *task, mesh_sync_tasks) {
+		Mesh *mesh = task->mesh;
+
+		if(task->b_mesh) {
+			/* hair may add triangles, so this must run after the conversion */
+			if(experimental && is_cpu)
+				sync_curves(mesh, task->b_mesh, task->b_ob, task->object_updated);
+
+			/* free derived mesh */
+			b_data.meshes.remove(task->b_mesh);
+		}
+
+		/* tag update */
+		bool rebuild = false;
+		vector<Mesh::Triangle>& oldtriangle = task->oldtriangle;
+		vector<Mesh::CurveKey>& oldcurve_keys = task->oldcurve_keys;
+
+		if(oldtriangle.size() != mesh->triangles.size())
 			rebuild = true;
-	}
+		else if(oldtriangle.size()) {
+			if(memcmp(&oldtriangle[0], &mesh->triangles[0], sizeof(Mesh::Triangle)*oldtriangle.size()) != 0)
+				rebuild = true;
+		}
 
-	if(oldcurve_keys.size() != mesh->curve_keys.size())
-		rebuild = true;
-	else if(oldcurve_keys.size()) {
-		if(memcmp(&oldcurve_keys[0], &mesh->curve_keys[0], sizeof(Mesh::CurveKey)*oldcurve_keys.size()) != 0)
+		if(oldcurve_keys.size() != mesh->curve_keys.size())
 			rebuild = true;
+		else if(oldcurve_keys.size()) {
+			if(memcmp(&oldcurve_keys[0], &mesh->curve_keys[0], sizeof(Mesh::CurveKey)*oldcurve_keys.size()) != 0)
+				rebuild = true;
+		}
+
+		if(rebuild)
+			mesh->tag_update(scene, true);
+
+		if(task->instance)
+			mesh_hash_curves(task->md5, mesh);
 	}
-	
-	mesh->tag_update(scene, rebuild);
 
-	return mesh;
+	/* forget previous content of the synced meshes, before looking for
+	 * meshes with the same content */
+	foreach(MeshSyncTask *task, mesh_sync_tasks) {
+		map<Mesh*, string>::iterator it = mesh_content_hash.find(task->mesh);
+
+		if(it != mesh_content_hash.end()) {
+			if(mesh_content[it->second] == task->mesh)
+				mesh_content.erase(it->second);
+			mesh_content_hash.erase(it);
+		}
+	}
+
+	foreach(MeshSyncTask *task, mesh_sync_tasks) {
+		Mesh *mesh = task->mesh;
+
+		if(task->instance && mesh->verts.size() + mesh->curve_keys.size() > 0) {
+			string hash = task->md5.get_hex();
+			map<string, Mesh*>::iterator it = mesh_content.find(hash);
+
+			/* meshes with transform applied no longer have the original content */
+			if(it != mesh_content.end() && it->second != mesh && !it->second->transform_applied) {
+				/* free data and instance the existing mesh */
+				vector<uint> used_shaders = mesh->used_shaders;
+
+				mesh->clear();
+				mesh->used_shaders = used_shaders;
+				mesh->tag_update(scene, true);
+
+				mesh_instance[mesh] = it->second;
+				mesh_instanced.insert(it->second);
+			}
+			else {
+				mesh_content[hash] = mesh;
+				mesh_content_hash[mesh] = hash;
+			}
+		}
+
+		delete task;
+	}
+
+	mesh_sync_tasks.clear();
+}
+
+Mesh *BlenderSync::find_mesh_instance(Mesh *mesh)
+{
+	map<Mesh*, Mesh*>::iterator it = mesh_instance.find(mesh);
+	return (it != mesh_instance.end())? it->second: mesh;
+}
+
+void BlenderSync::sync_mesh_instances()
+{
+	/* objects of meshes that were found to be duplicates in this sync still
+	 * use them, and instanced meshes are only in use through objects */
+	foreach(Object *object, scene->objects) {
+		if(!object->mesh)
+			continue;
+
+		Mesh *mesh = find_mesh_instance(object->mesh);
+
+		if(mesh != object->mesh) {
+			object->mesh = mesh;
+			scene->object_manager->tag_update(scene);
+		}
+
+		mesh_map.used(mesh);
+	}
+}
+
+void BlenderSync::sync_mesh_instances_cleanup()
+{
+	/* remove references to deleted meshes */
+	set<Mesh*> meshes(scene->meshes.begin(), scene->meshes.end());
+
+	for(map<Mesh*, Mesh*>::iterator it = mesh_instance.begin(); it != mesh_instance.end(); ) {
+		if(meshes.find(it->first) == meshes.end() || meshes.find(it->second) == meshes.end())
+			mesh_instance.erase(it++);
+		else
+			++it;
+	}
+
+	for(map<Mesh*, string>::iterator it = mesh_content_hash.begin(); it != mesh_content_hash.end(); ) {
+		if(meshes.find(it->first) == meshes.end()) {
+			if(mesh_content[it->second] == it->first)
+				mesh_content.erase(it->second);
+			mesh_content_hash.erase(it++);
+		}
+		else
+			++it;
+	}
+
+	mesh_instanced.clear();
+
+	for(map<Mesh*, Mesh*>::iterator it = mesh_instance.begin(); it != mesh_instance.end(); it++)
+		mesh_instanced.insert(it->second);
 }
 
 void BlenderSync::sync_mesh_motion(BL::Object b_ob, Mesh *mesh, int motion)
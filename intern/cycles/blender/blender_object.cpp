@@ -248,7 +248,7 @@ Object *BlenderSync::sync_object(BL::Object b_parent, int persistent_id[OBJECT_P
 	bool use_holdout = (layer_flag & render_layer.holdout_layer) != 0;
 	
 	/* mesh sync */
-	object->mesh = sync_mesh(b_ob, object_updated, hide_tris);
+	object->mesh = find_mesh_instance(sync_mesh(b_ob, object_updated, hide_tris));
 
 	/* sspecial case not tracked by object update flags */
 	if(use_holdout != object->use_holdout) {
@@ -439,6 +439,13 @@ void BlenderSync::sync_objects(BL::SpaceView3D b_v3d, int motion)
 		}
 	}
 
+	/* wait for mesh conversion tasks, also on cancel to free derived meshes */
+	if(!motion) {
+		progress.set_sync_status("Synchronizing meshes");
+		sync_mesh_finish();
+		sync_mesh_instances();
+	}
+
 	progress.set_sync_status("");
 
 	if(!cancel && !motion) {
@@ -449,6 +456,7 @@ void BlenderSync::sync_objects(BL::SpaceView3D b_v3d, int motion)
 			scene->light_manager->tag_update(scene);
 		if(mesh_map.post_sync())
 			scene->mesh_manager->tag_update(scene);
+		sync_mesh_instances_cleanup();
 		if(object_map.post_sync())
 			scene->object_manager->tag_update(scene);
 		if(particle_system_map.post_sync())
@@ -351,6 +351,11 @@ void BlenderSession::render()
 			}
 		}
 
+		/* variance estimate for adaptive sampling */
+		if(session_params.adaptive_threshold > 0.0f && !session_params.progressive_refine &&
+		   session_params.device.type == DEVICE_CPU)
+			Pass::add(PASS_VARIANCE, passes);
+
 		/* free result without merging */
 		end_render_result(b_engine, b_rr, true);
 
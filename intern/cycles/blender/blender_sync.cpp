@@ -198,6 +198,12 @@ void BlenderSync::sync_integrator()
 	integrator->ao_samples = get_int(cscene, "ao_samples");
 	integrator->mesh_light_samples = get_int(cscene, "mesh_light_samples");
 	integrator->progressive = get_boolean(cscene, "progressive");
+	integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
+
+	/* light distribution is built differently with the light tree */
+	if(integrator->use_light_tree != previntegrator.use_light_tree ||
+	   integrator->progressive != previntegrator.progressive)
+		scene->light_manager->tag_update(scene);
 
 	if(integrator->modified(previntegrator))
 		integrator->tag_update(scene);
@@ -305,6 +311,8 @@ SceneParams BlenderSync::get_scene_params(BL::Scene b_scene, bool background)
 		params.bvh_type = (SceneParams::BVHType)RNA_enum_get(&cscene, "debug_bvh_type");
 
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
+	params.use_qbvh = RNA_boolean_get(&cscene, "debug_use_qbvh");
+	params.use_ray_packets = RNA_boolean_get(&cscene, "debug_use_ray_packets");
 	params.use_bvh_cache = (background)? RNA_boolean_get(&cscene, "use_cache"): false;
 
 	if(background && params.shadingsystem != SceneParams::OSL)
@@ -312,6 +320,10 @@ SceneParams BlenderSync::get_scene_params(BL::Scene b_scene, bool background)
 	else
 		params.persistent_data = false;
 
+	params.use_texture_cache = RNA_boolean_get(&cscene, "use_texture_cache");
+	params.texture_cache_memory = RNA_int_get(&cscene, "texture_cache_memory");
+	params.subd_cache_memory = RNA_int_get(&cscene, "subdivision_cache_memory");
+
 	return params;
 }
 
@@ -416,6 +428,10 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine b_engine, BL::Use
 
 	params.progressive_refine = get_boolean(cscene, "use_progressive_refine");
 
+	/* adaptive sampling */
+	params.adaptive_threshold = get_float(cscene, "adaptive_threshold");
+	params.adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
+
 	if(background) {
 		if(params.progressive_refine)
 			params.progressive = true;
@@ -31,6 +31,7 @@
 
 #include "util_map.h"
 #include "util_set.h"
+#include "util_task.h"
 #include "util_transform.h"
 #include "util_vector.h"
 
@@ -82,6 +83,10 @@ private:
 
 	void sync_nodes(Shader *shader, BL::ShaderNodeTree b_ntree);
 	Mesh *sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tris);
+	void sync_mesh_finish();
+	void sync_mesh_instances();
+	void sync_mesh_instances_cleanup();
+	Mesh *find_mesh_instance(Mesh *mesh);
 	void sync_curves(Mesh *mesh, BL::Mesh b_mesh, BL::Object b_ob, bool object_updated);
 	Object *sync_object(BL::Object b_parent, int persistent_id[OBJECT_PERSISTENT_ID_SIZE], BL::DupliObject b_dupli_object, Transform& tfm, uint layer_flag, int motion, bool hide_tris);
 	void sync_light(BL::Object b_parent, int persistent_id[OBJECT_PERSISTENT_ID_SIZE], BL::Object b_ob, Transform& tfm);
@@ -109,6 +114,19 @@ private:
 	id_map<ObjectKey, Light> light_map;
 	id_map<ParticleSystemKey, ParticleSystem> particle_system_map;
 	set<Mesh*> mesh_synced;
+
+	/* meshes are converted in parallel, and finished after the object loop */
+	struct MeshSyncTask;
+	vector<MeshSyncTask*> mesh_sync_tasks;
+	TaskPool mesh_pool;
+
+	/* meshes with the same content as another mesh have their data freed,
+	 * and objects use the other mesh instead */
+	map<Mesh*, Mesh*> mesh_instance;
+	set<Mesh*> mesh_instanced;
+	map<string, Mesh*> mesh_content;
+	map<Mesh*, string> mesh_content_hash;
+
 	void *world_map;
 	bool world_recalc;
 
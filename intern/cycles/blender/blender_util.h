@@ -419,6 +419,19 @@ public:
 		b_map[NULL] = data;
 	}
 
+	T *detach(const K& key)
+	{
+		/* give key new data, the old data stays in the scene for as long as
+		 * it is tagged as used */
+		T *data = new T();
+		scene_data->push_back(data);
+		b_map[key] = data;
+
+		used(data);
+
+		return data;
+	}
+
 	bool post_sync(bool do_delete = true)
 	{
 		/* remove unused data */
@@ -31,6 +31,7 @@
 #include "util_map.h"
 #include "util_progress.h"
 #include "util_system.h"
+#include "util_time.h"
 #include "util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -56,10 +57,16 @@ struct BVHStackEntry
 /* BVH */
 
 BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
-: params(params_), objects(objects_)
+: params(params_), objects(objects_), cache_data(NULL)
 {
 }
 
+BVH::~BVH()
+{
+	/* the packed arrays never free referenced memory, so this can go first */
+	delete cache_data;
+}
+
 BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 {
 	if(params.use_qbvh)
@@ -70,9 +77,13 @@ BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 
 /* Cache */
 
+/* increase when the packed layout changes, so older cache files are not used */
+#define BVH_CACHE_VERSION 2
+
 bool BVH::cache_read(CacheData& key)
 {
 	key.add(system_cpu_bits());
+	key.add(BVH_CACHE_VERSION);
 	key.add(&params, sizeof(params));
 
 	foreach(Object *ob, objects) {
@@ -80,31 +91,60 @@ bool BVH::cache_read(CacheData& key)
 		key.add(ob->mesh->triangles);
 		key.add(ob->mesh->curve_keys);
 		key.add(ob->mesh->curves);
+
+		/* attributes that are packed along with the primitives */
+		Attribute *attr_tangent = ob->mesh->curve_attributes.find(ATTR_STD_CURVE_TANGENT);
+		if(attr_tangent)
+			key.add(attr_tangent->buffer);
 		key.add(&ob->bounds, sizeof(ob->bounds));
 		key.add(&ob->visibility, sizeof(ob->visibility));
 		key.add(&ob->mesh->transform_applied, sizeof(bool));
 	}
 
-	CacheData value;
+	CacheData *value = new CacheData();
 
-	if(Cache::global.lookup(key, value)) {
+	if(Cache::global.lookup(key, *value)) {
 		cache_filename = key.get_filename();
 
-		value.read(pack.root_index);
-		value.read(pack.SAH);
+		/* the packed arrays use the mapped file directly, pages are only
+		 * copied when refitting modifies them */
+		bool ok = value->read(pack.root_index) &&
+		          value->read(pack.SAH) &&
+		          value->read_reference(pack.nodes) &&
+		          value->read_reference(pack.object_node) &&
+		          value->read_reference(pack.tri_woop) &&
+		          value->read_reference(pack.prim_segment) &&
+		          value->read_reference(pack.prim_visibility) &&
+		          value->read_reference(pack.prim_index) &&
+		          value->read_reference(pack.prim_object) &&
+		          value->read_reference(pack.is_leaf);
+
+		/* sanity check array sizes, on mismatch rebuild instead */
+		if(ok) {
+			size_t num_prims = pack.prim_index.size();
+
+			ok = pack.prim_object.size() == num_prims &&
+			     pack.prim_segment.size() == num_prims &&
+			     pack.prim_visibility.size() == num_prims &&
+			     (pack.root_index == -1 || pack.nodes.size() > 0);
+		}
+
+		if(!ok) {
+			fprintf(stderr, "Failed to read BVH from cache, rebuilding.\n");
+			cache_filename = "";
+			pack = PackedBVH();
+			delete value;
+			return false;
+		}
 
-		value.read(pack.nodes);
-		value.read(pack.object_node);
-		value.read(pack.tri_woop);
-		value.read(pack.prim_segment);
-		value.read(pack.prim_visibility);
-		value.read(pack.prim_index);
-		value.read(pack.prim_object);
-		value.read(pack.is_leaf);
+		delete cache_data;
+		cache_data = value;
 
 		return true;
 	}
 
+	delete value;
+
 	return false;
 }
 
@@ -129,24 +169,6 @@ void BVH::cache_write(CacheData& key)
 	cache_filename = key.get_filename();
 }
 
-void BVH::clear_cache_except()
-{
-	set<string> except;
-
-	if(!cache_filename.empty())
-		except.insert(cache_filename);
-
-	foreach(Object *ob, objects) {
-		Mesh *mesh = ob->mesh;
-		BVH *bvh = mesh->bvh;
-
-		if(bvh && !bvh->cache_filename.empty())
-			except.insert(bvh->cache_filename);
-	}
-
-	Cache::global.clear_except("bvh", except);
-}
-
 /* Building */
 
 void BVH::build(Progress& progress)
@@ -171,6 +193,8 @@ void BVH::build(Progress& progress)
 	BVHBuild bvh_build(objects, prim_segment, prim_index, prim_object, params, progress);
 	BVHNode *root = bvh_build.run();
 
+	double pack_start_time = time_dt();
+
 	if(progress.get_cancel()) {
 		if(root) root->deleteSubtree();
 		return;
@@ -209,14 +233,17 @@ void BVH::build(Progress& progress)
 
 	if(progress.get_cancel()) return;
 
+	/* report build time breakdown */
+	double pack_time = time_dt() - pack_start_time;
+
+	progress.set_substatus(string_printf("Built BVH in %.2fs (references %.2fs, nodes %.2fs, packing %.2fs)",
+		bvh_build.references_time + bvh_build.nodes_time + pack_time,
+		bvh_build.references_time, bvh_build.nodes_time, pack_time));
+
 	/* cache write */
 	if(params.use_cache) {
 		progress.set_substatus("Writing BVH cache");
 		cache_write(key);
-
-		/* clear other bvh files from cache */
-		if(params.top_level)
-			clear_cache_except();
 	}
 }
 
@@ -224,10 +251,14 @@ void BVH::build(Progress& progress)
 
 void BVH::refit(Progress& progress)
 {
-	progress.set_substatus("Packing BVH primitives");
-	pack_primitives();
+	/* top level primitives are merged with instances and only change with a
+	 * rebuild, refitting it only updates the bounds of objects */
+	if(!params.top_level) {
+		progress.set_substatus("Packing BVH primitives");
+		pack_primitives();
 
-	if(progress.get_cancel()) return;
+		if(progress.get_cancel()) return;
+	}
 
 	progress.set_substatus("Refitting BVH nodes");
 	refit_nodes();
@@ -522,6 +553,75 @@ void BVH::pack_instances(size_t nodes_size)
 	}
 }
 
+/* Leaf primitive type, leaves are built to contain only one type */
+
+int BVH::leaf_type(const LeafNode *leaf)
+{
+	if(leaf->num_triangles() > 0 && pack.prim_segment[leaf->m_lo] != ~0)
+		return BVH_LEAF_CURVE;
+
+	return BVH_LEAF_TRIANGLE;
+}
+
+/* Refit */
+
+void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
+{
+	/* leaf with a single object instance in the top level BVH */
+	if(start < 0) {
+		start = ~start;
+		end = start + 1;
+	}
+
+	for(int prim = start; prim < end; prim++) {
+		int pidx = pack.prim_index[prim];
+		int tob = pack.prim_object[prim];
+		Object *ob = objects[tob];
+
+		if(pidx == -1) {
+			/* object instance */
+			bbox.grow(ob->bounds);
+		}
+		else {
+			/* primitives */
+			const Mesh *mesh = ob->mesh;
+
+			if(pack.prim_segment[prim] != ~0) {
+				/* curves */
+				int str_offset = (params.top_level)? mesh->curve_offset: 0;
+				int k0 = mesh->curves[pidx - str_offset].first_key + pack.prim_segment[prim]; // XXX!
+				int k1 = k0 + 1;
+
+				float3 p[4];
+				p[0] = mesh->curve_keys[max(k0 - 1,mesh->curves[pidx - str_offset].first_key)].co;
+				p[1] = mesh->curve_keys[k0].co;
+				p[2] = mesh->curve_keys[k1].co;
+				p[3] = mesh->curve_keys[min(k1 + 1,mesh->curves[pidx - str_offset].first_key + mesh->curves[pidx - str_offset].num_keys - 1)].co;
+				float3 lower;
+				float3 upper;
+				curvebounds(&lower.x, &upper.x, p, 0);
+				curvebounds(&lower.y, &upper.y, p, 1);
+				curvebounds(&lower.z, &upper.z, p, 2);
+				float mr = max(mesh->curve_keys[k0].radius,mesh->curve_keys[k1].radius);
+				bbox.grow(lower, mr);
+				bbox.grow(upper, mr);
+			}
+			else {
+				/* triangles */
+				int tri_offset = (params.top_level)? mesh->tri_offset: 0;
+				const int *vidx = mesh->triangles[pidx - tri_offset].v;
+				const float3 *vpos = &mesh->verts[0];
+
+				bbox.grow(vpos[vidx[0]]);
+				bbox.grow(vpos[vidx[1]]);
+				bbox.grow(vpos[vidx[2]]);
+			}
+		}
+
+		visibility |= ob->visibility;
+	}
+}
+
 /* Regular BVH */
 
 RegularBVH::RegularBVH(const BVHParams& params_, const vector<Object*>& objects_)
@@ -535,8 +635,8 @@ void RegularBVH::pack_leaf(const BVHStackEntry& e, const LeafNode *leaf)
 		/* object */
 		pack_node(e.idx, leaf->m_bounds, leaf->m_bounds, ~(leaf->m_lo), 0, leaf->m_visibility, leaf->m_visibility);
 	else
-		/* triangle */
-		pack_node(e.idx, leaf->m_bounds, leaf->m_bounds, leaf->m_lo, leaf->m_hi, leaf->m_visibility, leaf->m_visibility);
+		/* triangles or curves, the second visibility is used for the type */
+		pack_node(e.idx, leaf->m_bounds, leaf->m_bounds, leaf->m_lo, leaf->m_hi, leaf->m_visibility, leaf_type(leaf));
 }
 
 void RegularBVH::pack_inner(const BVHStackEntry& e, const BVHStackEntry& e0, const BVHStackEntry& e1)
@@ -603,8 +703,6 @@ void RegularBVH::pack_nodes(const array<int>& prims, const BVHNode *root)
 
 void RegularBVH::refit_nodes()
 {
-	assert(!params.top_level);
-
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.is_leaf[0])? true: false, bbox, visibility);
@@ -619,55 +717,11 @@ void RegularBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility
 
 	if(leaf) {
 		/* refit leaf node */
-		for(int prim = c0; prim < c1; prim++) {
-			int pidx = pack.prim_index[prim];
-			int tob = pack.prim_object[prim];
-			Object *ob = objects[tob];
-
-			if(pidx == -1) {
-				/* object instance */
-				bbox.grow(ob->bounds);
-			}
-			else {
-				/* primitives */
-				const Mesh *mesh = ob->mesh;
-
-				if(pack.prim_segment[prim] != ~0) {
-					/* curves */
-					int str_offset = (params.top_level)? mesh->curve_offset: 0;
-					int k0 = mesh->curves[pidx - str_offset].first_key + pack.prim_segment[prim]; // XXX!
-					int k1 = k0 + 1;
-
-					float3 p[4];
-					p[0] = mesh->curve_keys[max(k0 - 1,mesh->curves[pidx - str_offset].first_key)].co;
-					p[1] = mesh->curve_keys[k0].co;
-					p[2] = mesh->curve_keys[k1].co;
-					p[3] = mesh->curve_keys[min(k1 + 1,mesh->curves[pidx - str_offset].first_key + mesh->curves[pidx - str_offset].num_keys - 1)].co;
-					float3 lower;
-					float3 upper;
-					curvebounds(&lower.x, &upper.x, p, 0);
-					curvebounds(&lower.y, &upper.y, p, 1);
-					curvebounds(&lower.z, &upper.z, p, 2);
-					float mr = max(mesh->curve_keys[k0].radius,mesh->curve_keys[k1].radius);
-					bbox.grow(lower, mr);
-					bbox.grow(upper, mr);
-				}
-				else {
-					/* triangles */
-					int tri_offset = (params.top_level)? mesh->tri_offset: 0;
-					const int *vidx = mesh->triangles[pidx - tri_offset].v;
-					const float3 *vpos = &mesh->verts[0];
-
-					bbox.grow(vpos[vidx[0]]);
-					bbox.grow(vpos[vidx[1]]);
-					bbox.grow(vpos[vidx[2]]);
-				}
-			}
+		int type = data[3].w;
 
-			visibility |= ob->visibility;
-		}
+		refit_primitives(c0, c1, bbox, visibility);
 
-		pack_node(idx, bbox, bbox, c0, c1, visibility, visibility);
+		pack_node(idx, bbox, bbox, c0, c1, visibility, (c0 < 0)? visibility: type);
 	}
 	else {
 		/* refit inner node, set bbox from children */
@@ -691,8 +745,6 @@ QBVH::QBVH(const BVHParams& params_, const vector<Object*>& objects_)
 : BVH(params_, objects_)
 {
 	params.use_qbvh = true;
-
-	/* todo: use visibility */
 }
 
 void QBVH::pack_leaf(const BVHStackEntry& e, const LeafNode *leaf)
@@ -707,21 +759,37 @@ void QBVH::pack_leaf(const BVHStackEntry& e, const LeafNode *leaf)
 		data[6].y = __int_as_float(0);
 	}
 	else {
-		/* triangle */
+		/* triangles or curves */
 		data[6].x = __int_as_float(leaf->m_lo);
 		data[6].y = __int_as_float(leaf->m_hi);
+		data[6].z = __int_as_float(leaf_type(leaf));
 	}
 
 	memcpy(&pack.nodes[e.idx * BVH_QNODE_SIZE], data, sizeof(float4)*BVH_QNODE_SIZE);
 }
 
 void QBVH::pack_inner(const BVHStackEntry& e, const BVHStackEntry *en, int num)
+{
+	BoundBox bounds[4];
+	int child[4];
+	uint visibility[4];
+
+	for(int i = 0; i < num; i++) {
+		bounds[i] = en[i].node->m_bounds;
+		child[i] = en[i].encodeIdx();
+		visibility[i] = en[i].node->m_visibility;
+	}
+
+	pack_node(e.idx, bounds, child, visibility, num);
+}
+
+void QBVH::pack_node(int idx, const BoundBox *bounds, const int *child, const uint *visibility, int num)
 {
 	float4 data[BVH_QNODE_SIZE];
 
 	for(int i = 0; i < num; i++) {
-		float3 bb_min = en[i].node->m_bounds.min;
-		float3 bb_max = en[i].node->m_bounds.max;
+		float3 bb_min = bounds[i].min;
+		float3 bb_max = bounds[i].max;
 
 		data[0][i] = bb_min.x;
 		data[1][i] = bb_max.x;
@@ -730,11 +798,13 @@ void QBVH::pack_inner(const BVHStackEntry& e, const BVHStackEntry *en, int num)
 		data[4][i] = bb_min.z;
 		data[5][i] = bb_max.z;
 
-		data[6][i] = __int_as_float(en[i].encodeIdx());
-		data[7][i] = 0.0f;
+		data[6][i] = __int_as_float(child[i]);
+		data[7][i] = __uint_as_float(visibility[i]);
 	}
 
 	for(int i = num; i < 4; i++) {
+		/* empty slots have no visibility so traversal always skips them,
+		 * child index 0 is the root and never a valid child */
 		data[0][i] = 0.0f;
 		data[1][i] = 0.0f;
 		data[2][i] = 0.0f;
@@ -744,10 +814,10 @@ void QBVH::pack_inner(const BVHStackEntry& e, const BVHStackEntry *en, int num)
 		data[5][i] = 0.0f;
 
 		data[6][i] = __int_as_float(0);
-		data[7][i] = 0.0f;
+		data[7][i] = __uint_as_float(0);
 	}
 
-	memcpy(&pack.nodes[e.idx * BVH_QNODE_SIZE], data, sizeof(float4)*BVH_QNODE_SIZE);
+	memcpy(&pack.nodes[idx * BVH_QNODE_SIZE], data, sizeof(float4)*BVH_QNODE_SIZE);
 }
 
 /* Quad SIMD Nodes */
@@ -824,7 +894,46 @@ void QBVH::pack_nodes(const array<int>& prims, const BVHNode *root)
 
 void QBVH::refit_nodes()
 {
-	assert(0); /* todo */
+	BoundBox bbox = BoundBox::empty;
+	uint visibility = 0;
+	refit_node(0, (pack.is_leaf[0])? true: false, bbox, visibility);
+}
+
+void QBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
+{
+	int4 *data = &pack.nodes[idx*BVH_QNODE_SIZE];
+
+	if(leaf) {
+		/* refit leaf node, its bounds are stored in the parent */
+		refit_primitives(data[6].x, data[6].y, bbox, visibility);
+	}
+	else {
+		/* refit inner node, set bbox from children */
+		BoundBox child_bbox[4];
+		int child[4];
+		uint child_visibility[4];
+		int num = 0;
+
+		for(int i = 0; i < 4; i++) {
+			int c = data[6][i];
+
+			/* empty slots are at the end */
+			if(c == 0)
+				break;
+
+			child_bbox[i] = BoundBox::empty;
+			child_visibility[i] = 0;
+			child[i] = c;
+
+			refit_node((c < 0)? -c-1: c, (c < 0), child_bbox[i], child_visibility[i]);
+
+			bbox.grow(child_bbox[i]);
+			visibility |= child_visibility[i];
+			num++;
+		}
+
+		pack_node(idx, child_bbox, child, child_visibility, num);
+	}
 }
 
 CCL_NAMESPACE_END
@@ -89,16 +89,17 @@ public:
 	string cache_filename;
 
 	static BVH *create(const BVHParams& params, const vector<Object*>& objects);
-	virtual ~BVH() {}
+	virtual ~BVH();
 
 	void build(Progress& progress);
 	void refit(Progress& progress);
 
-	void clear_cache_except();
-
 protected:
 	BVH(const BVHParams& params, const vector<Object*>& objects);
 
+	/* mapped cache file the packed arrays reference after a cache read */
+	CacheData *cache_data;
+
 	/* cache */
 	bool cache_read(CacheData& key);
 	void cache_write(CacheData& key);
@@ -108,9 +109,15 @@ protected:
 	void pack_triangle(int idx, float4 woop[3]);
 	void pack_curve_segment(int idx, float4 woop[3]);
 
+	/* leaf primitive type */
+	int leaf_type(const LeafNode *leaf);
+
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size);
 
+	/* refit bounds and visibility of a range of primitives */
+	void refit_primitives(int start, int end, BoundBox& bbox, uint& visibility);
+
 	/* for subclasses to implement */
 	virtual void pack_nodes(const array<int>& prims, const BVHNode *root) = 0;
 	virtual void refit_nodes() = 0;
@@ -151,9 +158,11 @@ protected:
 	void pack_nodes(const array<int>& prims, const BVHNode *root);
 	void pack_leaf(const BVHStackEntry& e, const LeafNode *leaf);
 	void pack_inner(const BVHStackEntry& e, const BVHStackEntry *en, int num);
+	void pack_node(int idx, const BoundBox *bounds, const int *child, const uint *visibility, int num);
 
 	/* refit */
 	void refit_nodes();
+	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
 };
 
 CCL_NAMESPACE_END
@@ -23,6 +23,7 @@
 
 #include "util_algorithm.h"
 #include "util_boundbox.h"
+#include "util_task.h"
 #include "util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -59,52 +60,41 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange& job, BVHReference *prims)
 	num_bins = min(size_t(MAX_BINS), size_t(4.0f + 0.05f*size()));
 	scale = rcp(cent_bounds().size()) * make_float3((float)num_bins);
 
-	/* initialize binning counter and bounds */
-	BoundBox bin_bounds[MAX_BINS][4];	/* bounds for every bin in every dimension */
-	int4 bin_count[MAX_BINS];			/* number of primitives mapped to bin */
-
-	for(size_t i = 0; i < num_bins; i++) {
-		bin_count[i] = make_int4(0);
-		bin_bounds[i][0] = bin_bounds[i][1] = bin_bounds[i][2] = BoundBox::empty;
-	}
-
-	/* map geometry to bins, unrolled once */
-	{
-		ssize_t i;
+	/* map geometry to bins, in parallel for the large ranges at the top of the tree */
+	Bins bins;
+	int num_threads = TaskScheduler::num_threads();
 
-		for(i = 0; i < ssize_t(size()) - 1; i += 2) {
-			prefetch_L2(&prims[start() + i + 8]);
+	if(size() >= PARALLEL_BINNING_SIZE && num_threads > 1) {
+		vector<Bins> thread_bins(num_threads);
+		int chunk_size = (size() + num_threads - 1)/num_threads;
+		TaskPool pool;
 
-			/* map even and odd primitive to bin */
-			BVHReference prim0 = prims[start() + i + 0];
-			BVHReference prim1 = prims[start() + i + 1];
+		for(int t = 0; t < num_threads; t++) {
+			int begin = start() + t*chunk_size;
+			int end = min(begin + chunk_size, this->end());
 
-			int4 bin0 = get_bin(prim0.bounds());
-			int4 bin1 = get_bin(prim1.bounds());
+			pool.push(function_bind(&BVHObjectBinning::bin_references, this, prims, begin, end, &thread_bins[t]));
+		}
 
-			/* increase bounds for bins for even primitive */
-			int b00 = extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(prim0.bounds());
-			int b01 = extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(prim0.bounds());
-			int b02 = extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(prim0.bounds());
+		pool.wait_work();
 
-			/* increase bounds of bins for odd primitive */
-			int b10 = extract<0>(bin1); bin_count[b10][0]++; bin_bounds[b10][0].grow(prim1.bounds());
-			int b11 = extract<1>(bin1); bin_count[b11][1]++; bin_bounds[b11][1].grow(prim1.bounds());
-			int b12 = extract<2>(bin1); bin_count[b12][2]++; bin_bounds[b12][2].grow(prim1.bounds());
-		}
+		/* merge bins */
+		bins = thread_bins[0];
 
-		/* for uneven number of primitives */
-		if(i < ssize_t(size())) {
-			/* map primitive to bin */
-			BVHReference prim0 = prims[start() + i];
-			int4 bin0 = get_bin(prim0.bounds());
+		for(int t = 1; t < num_threads; t++) {
+			for(size_t i = 0; i < num_bins; i++) {
+				bins.count[i] = bins.count[i] + thread_bins[t].count[i];
 
-			/* increase bounds of bins */
-			int b00 = extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(prim0.bounds());
-			int b01 = extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(prim0.bounds());
-			int b02 = extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(prim0.bounds());
+				for(int dim = 0; dim < 3; dim++)
+					bins.bounds[i][dim].grow(thread_bins[t].bounds[i][dim]);
+			}
 		}
 	}
+	else
+		bin_references(prims, start(), end(), &bins);
+
+	int4 *bin_count = bins.count;
+	BoundBox (*bin_bounds)[4] = bins.bounds;
 
 	/* sweep from right to left and compute parallel prefix of merged bounds */
 	float4 r_area[MAX_BINS];	/* area of bounds of primitives on the right */
@@ -161,6 +151,54 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange& job, BVHReference *prims)
 	leafSAH	= bounds().half_area() * blocks(size());
 }
 
+void BVHObjectBinning::bin_references(const BVHReference *prims, int begin, int end, Bins *bins) const
+{
+	/* initialize binning counter and bounds */
+	int4 *bin_count = bins->count;
+	BoundBox (*bin_bounds)[4] = bins->bounds;
+
+	for(size_t i = 0; i < num_bins; i++) {
+		bin_count[i] = make_int4(0);
+		bin_bounds[i][0] = bin_bounds[i][1] = bin_bounds[i][2] = BoundBox::empty;
+	}
+
+	/* map geometry to bins, unrolled once */
+	int i;
+
+	for(i = begin; i < end - 1; i += 2) {
+		prefetch_L2(&prims[i + 8]);
+
+		/* map even and odd primitive to bin */
+		BVHReference prim0 = prims[i + 0];
+		BVHReference prim1 = prims[i + 1];
+
+		int4 bin0 = get_bin(prim0.bounds());
+		int4 bin1 = get_bin(prim1.bounds());
+
+		/* increase bounds for bins for even primitive */
+		int b00 = extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(prim0.bounds());
+		int b01 = extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(prim0.bounds());
+		int b02 = extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(prim0.bounds());
+
+		/* increase bounds of bins for odd primitive */
+		int b10 = extract<0>(bin1); bin_count[b10][0]++; bin_bounds[b10][0].grow(prim1.bounds());
+		int b11 = extract<1>(bin1); bin_count[b11][1]++; bin_bounds[b11][1].grow(prim1.bounds());
+		int b12 = extract<2>(bin1); bin_count[b12][2]++; bin_bounds[b12][2].grow(prim1.bounds());
+	}
+
+	/* for uneven number of primitives */
+	if(i < end) {
+		/* map primitive to bin */
+		BVHReference prim0 = prims[i];
+		int4 bin0 = get_bin(prim0.bounds());
+
+		/* increase bounds of bins */
+		int b00 = extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(prim0.bounds());
+		int b01 = extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(prim0.bounds());
+		int b02 = extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(prim0.bounds());
+	}
+}
+
 void BVHObjectBinning::split(BVHReference* prims, BVHObjectBinning& left_o, BVHObjectBinning& right_o) const
 {
 	size_t N = size();
@@ -51,6 +51,17 @@ protected:
 	enum { MAX_BINS = 32 };
 	enum { LOG_BLOCK_SIZE = 2 };
 
+	/* ranges of this size and up are binned with multiple threads */
+	enum { PARALLEL_BINNING_SIZE = 65536 };
+
+	/* bin counts and bounds, computed per thread and then merged */
+	struct Bins {
+		int4 count[MAX_BINS];		/* number of primitives mapped to bin */
+		BoundBox bounds[MAX_BINS][4];	/* bounds for every bin in every dimension */
+	};
+
+	void bin_references(const BVHReference *prims, int begin, int end, Bins *bins) const;
+
 	/* computes the bin numbers for each dimension for a box. */
 	__forceinline int4 get_bin(const BoundBox& box) const
 	{
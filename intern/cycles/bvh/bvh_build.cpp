@@ -26,6 +26,7 @@
 #include "scene.h"
 #include "curves.h"
 
+#include "util_algorithm.h"
 #include "util_debug.h"
 #include "util_foreach.h"
 #include "util_progress.h"
@@ -60,6 +61,8 @@ BVHBuild::BVHBuild(const vector<Object*>& objects_,
   progress_start_time(0.0)
 {
 	spatial_min_overlap = 0.0f;
+	references_time = 0.0;
+	nodes_time = 0.0;
 }
 
 BVHBuild::~BVHBuild()
@@ -188,8 +191,12 @@ BVHNode* BVHBuild::run()
 	BVHRange root;
 
 	/* add references */
+	double start_time = time_dt();
+
 	add_references(root);
 
+	references_time = time_dt() - start_time;
+
 	if(progress.get_cancel())
 		return NULL;
 
@@ -214,6 +221,8 @@ BVHNode* BVHBuild::run()
 	/* build recursively */
 	BVHNode *rootnode;
 
+	start_time = time_dt();
+
 	if(params.use_spatial_split) {
 		/* singlethreaded spatial split build */
 		rootnode = build_node(root, 0);
@@ -225,6 +234,8 @@ BVHNode* BVHBuild::run()
 		task_pool.wait_work();
 	}
 
+	nodes_time = time_dt() - start_time;
+
 	/* delete if we cancelled */
 	if(rootnode) {
 		if(progress.get_cancel()) {
@@ -391,55 +402,83 @@ BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start,
 	}
 }
 
+static bool reference_is_triangle(const BVHReference& ref)
+{
+	return (ref.prim_index() != -1 && ref.prim_segment() == ~0);
+}
+
+static bool reference_is_curve(const BVHReference& ref)
+{
+	return (ref.prim_index() != -1 && ref.prim_segment() != ~0);
+}
+
+BVHNode* BVHBuild::create_primitive_leaf_node(int start, int num)
+{
+	BoundBox bounds = BoundBox::empty;
+	uint visibility = 0;
+
+	for(int i = start; i < start + num; i++) {
+		bounds.grow(references[i].bounds());
+		visibility |= objects[references[i].prim_object()]->visibility;
+	}
+
+	return new LeafNode(bounds, visibility, start, start + num);
+}
+
 BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 {
 	vector<int>& p_segment = prim_segment;
 	vector<int>& p_index = prim_index;
 	vector<int>& p_object = prim_object;
-	BoundBox bounds = BoundBox::empty;
-	int num = 0, ob_num = 0;
-	uint visibility = 0;
 
-	for(int i = 0; i < range.size(); i++) {
-		BVHReference& ref = references[range.start() + i];
+	/* order references as triangles, curve segments and objects. triangles and
+	 * curves get separate leaves, so the kernel can test the type per leaf */
+	BVHReference *begin = &references[range.start()];
+	BVHReference *end = begin + range.size();
+	BVHReference *curves = partition(begin, end, reference_is_triangle);
+	BVHReference *obs = partition(curves, end, reference_is_curve);
 
-		if(ref.prim_index() != -1) {
-			if(range.start() + num == prim_index.size()) {
-				assert(params.use_spatial_split);
+	int num_triangles = curves - begin;
+	int num = obs - begin;
+	int ob_num = end - obs;
 
-				p_segment.push_back(ref.prim_segment());
-				p_index.push_back(ref.prim_index());
-				p_object.push_back(ref.prim_object());
-			}
-			else {
-				p_segment[range.start() + num] = ref.prim_segment();
-				p_index[range.start() + num] = ref.prim_index();
-				p_object[range.start() + num] = ref.prim_object();
-			}
+	for(int i = 0; i < num; i++) {
+		BVHReference& ref = begin[i];
 
-			bounds.grow(ref.bounds());
-			visibility |= objects[ref.prim_object()]->visibility;
-			num++;
+		if(range.start() + i == prim_index.size()) {
+			assert(params.use_spatial_split);
+
+			p_segment.push_back(ref.prim_segment());
+			p_index.push_back(ref.prim_index());
+			p_object.push_back(ref.prim_object());
 		}
 		else {
-			if(ob_num < i)
-				references[range.start() + ob_num] = ref;
-			ob_num++;
+			p_segment[range.start() + i] = ref.prim_segment();
+			p_index[range.start() + i] = ref.prim_index();
+			p_object[range.start() + i] = ref.prim_object();
 		}
 	}
 
 	BVHNode *leaf = NULL;
-	
-	if(num > 0) {
-		leaf = new LeafNode(bounds, visibility, range.start(), range.start() + num);
 
-		if(num == range.size())
-			return leaf;
+	if(num_triangles > 0)
+		leaf = create_primitive_leaf_node(range.start(), num_triangles);
+
+	if(num > num_triangles) {
+		BVHNode *cleaf = create_primitive_leaf_node(range.start() + num_triangles, num - num_triangles);
+
+		if(leaf)
+			leaf = new InnerNode(merge(leaf->m_bounds, cleaf->m_bounds), leaf, cleaf);
+		else
+			leaf = cleaf;
 	}
 
+	if(leaf && ob_num == 0)
+		return leaf;
+
 	/* while there may be multiple triangles in a leaf, for object primitives
 	 * we want there to be the only one, so we keep splitting */
-	const BVHReference *ref = (ob_num)? &references[range.start()]: NULL;
+	const BVHReference *ref = (ob_num)? obs: NULL;
 	BVHNode *oleaf = create_object_leaf_nodes(ref, range.start() + num, ob_num);
 	
 	if(leaf)
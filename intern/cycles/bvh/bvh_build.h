@@ -53,6 +53,10 @@ public:
 
 	BVHNode *run();
 
+	/* build time breakdown in seconds, for progress reporting */
+	double references_time;
+	double nodes_time;
+
 protected:
 	friend class BVHMixedSplit;
 	friend class BVHObjectSplit;
@@ -68,10 +72,12 @@ protected:
 	BVHNode *build_node(const BVHRange& range, int level);
 	BVHNode *build_node(const BVHObjectBinning& range, int level);
 	BVHNode *create_leaf_node(const BVHRange& range);
+	BVHNode *create_primitive_leaf_node(int start, int num);
 	BVHNode *create_object_leaf_nodes(const BVHReference *ref, int start, int num);
 
 	/* threads */
 	enum { THREAD_TASK_SIZE = 4096 };
+	enum { PARALLEL_SPLIT_SIZE = 65536 };
 	void thread_build_node(InnerNode *node, int child, BVHObjectBinning *range, int level);
 	thread_mutex build_mutex;
 
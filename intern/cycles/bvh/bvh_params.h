@@ -54,7 +54,8 @@ public:
 	enum {
 		MAX_DEPTH = 64,
 		MAX_SPATIAL_DEPTH = 48,
-		NUM_SPATIAL_BINS = 32
+		NUM_SPATIAL_BINS = 32,
+		NUM_CURVE_PIECES = 8
 	};
 
 	BVHParams()
@@ -23,6 +23,7 @@
 #include "object.h"
 
 #include "util_algorithm.h"
+#include "util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -31,41 +32,83 @@ CCL_NAMESPACE_BEGIN
 BVHObjectSplit::BVHObjectSplit(BVHBuild *builder, const BVHRange& range, float nodeSAH)
 : sah(FLT_MAX), dim(0), num_left(0), left_bounds(BoundBox::empty), right_bounds(BoundBox::empty)
 {
-	const BVHReference *ref_ptr = &builder->references[range.start()];
-	float min_sah = FLT_MAX;
+	BVHReference *ref_ptr = &builder->references[range.start()];
+
+	if(range.size() >= BVHBuild::PARALLEL_SPLIT_SIZE && TaskScheduler::num_threads() > 1) {
+		/* evaluate dimensions in parallel, sorting copies of the references
+		 * for the second and third dimension */
+		vector<BVHReference> refs[2];
+		vector<BoundBox> right_bounds_buffer[2];
+		BVHObjectSplit splits[3];
+		TaskPool pool;
+
+		/* copy before any task runs, the first dimension sorts ref_ptr in place */
+		for(int i = 0; i < 2; i++) {
+			refs[i].assign(ref_ptr, ref_ptr + range.size());
+			right_bounds_buffer[i].resize(range.size());
+		}
 
-	for(int dim = 0; dim < 3; dim++) {
-		/* sort references */
-		bvh_reference_sort(range.start(), range.end(), &builder->references[0], dim);
+		for(int dim = 0; dim < 3; dim++) {
+			BVHReference *dim_refs = ref_ptr;
+			BoundBox *dim_right_bounds = &builder->spatial_right_bounds[0];
 
-		/* sweep right to left and determine bounds. */
-		BoundBox right_bounds = BoundBox::empty;
+			if(dim > 0) {
+				dim_refs = &refs[dim-1][0];
+				dim_right_bounds = &right_bounds_buffer[dim-1][0];
+			}
 
-		for(int i = range.size() - 1; i > 0; i--) {
-			right_bounds.grow(ref_ptr[i].bounds());
-			builder->spatial_right_bounds[i - 1] = right_bounds;
+			splits[dim].sah = FLT_MAX;
+
+			pool.push(function_bind(&BVHObjectSplit::find_split, &splits[dim],
+				builder, dim_refs, range.size(), dim, nodeSAH, dim_right_bounds));
 		}
 
-		/* sweep left to right and select lowest SAH. */
-		BoundBox left_bounds = BoundBox::empty;
+		pool.wait_work();
 
-		for(int i = 1; i < range.size(); i++) {
-			left_bounds.grow(ref_ptr[i - 1].bounds());
-			right_bounds = builder->spatial_right_bounds[i - 1];
+		/* pick lowest SAH, keeping the references sorted along that dimension */
+		for(int dim = 0; dim < 3; dim++)
+			if(splits[dim].sah < this->sah)
+				*this = splits[dim];
 
-			float sah = nodeSAH +
-				left_bounds.safe_area() * builder->params.triangle_cost(i) +
-				right_bounds.safe_area() * builder->params.triangle_cost(range.size() - i);
+		if(this->dim > 0)
+			memcpy(ref_ptr, &refs[this->dim-1][0], sizeof(BVHReference)*range.size());
+	}
+	else {
+		for(int dim = 0; dim < 3; dim++)
+			find_split(builder, ref_ptr, range.size(), dim, nodeSAH, &builder->spatial_right_bounds[0]);
+	}
+}
 
-			if(sah < min_sah) {
-				min_sah = sah;
+void BVHObjectSplit::find_split(BVHBuild *builder, BVHReference *refs, int num, int dim, float nodeSAH, BoundBox *right_bounds_buffer)
+{
+	/* sort references */
+	bvh_reference_sort(0, num, refs, dim);
 
-				this->sah = sah;
-				this->dim = dim;
-				this->num_left = i;
-				this->left_bounds = left_bounds;
-				this->right_bounds = right_bounds;
-			}
+	/* sweep right to left and determine bounds. */
+	BoundBox right_bounds = BoundBox::empty;
+
+	for(int i = num - 1; i > 0; i--) {
+		right_bounds.grow(refs[i].bounds());
+		right_bounds_buffer[i - 1] = right_bounds;
+	}
+
+	/* sweep left to right and select lowest SAH. */
+	BoundBox left_bounds = BoundBox::empty;
+
+	for(int i = 1; i < num; i++) {
+		left_bounds.grow(refs[i - 1].bounds());
+		right_bounds = right_bounds_buffer[i - 1];
+
+		float sah = nodeSAH +
+			left_bounds.safe_area() * builder->params.triangle_cost(i) +
+			right_bounds.safe_area() * builder->params.triangle_cost(num - i);
+
+		if(sah < this->sah) {
+			this->sah = sah;
+			this->dim = dim;
+			this->num_left = i;
+			this->left_bounds = left_bounds;
+			this->right_bounds = right_bounds;
 		}
 	}
 }
@@ -86,48 +129,48 @@ void BVHObjectSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right, c
 BVHSpatialSplit::BVHSpatialSplit(BVHBuild *builder, const BVHRange& range, float nodeSAH)
 : sah(FLT_MAX), dim(0), pos(0.0f)
 {
-	/* initialize bins. */
+	/* compute bin size. */
 	float3 origin = range.bounds().min;
 	float3 binSize = (range.bounds().max - origin) * (1.0f / (float)BVHParams::NUM_SPATIAL_BINS);
 	float3 invBinSize = 1.0f / binSize;
 
-	for(int dim = 0; dim < 3; dim++) {
-		for(int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
-			BVHSpatialBin& bin = builder->spatial_bins[dim][i];
+	/* chop references into bins, in parallel for large ranges */
+	BVHSpatialBin (*bins)[BVHParams::NUM_SPATIAL_BINS] = builder->spatial_bins;
+	int num_threads = TaskScheduler::num_threads();
 
-			bin.bounds = BoundBox::empty;
-			bin.enter = 0;
-			bin.exit = 0;
-		}
-	}
+	if(range.size() >= BVHBuild::PARALLEL_SPLIT_SIZE && num_threads > 1) {
+		vector<Bins> thread_bins(num_threads);
+		int chunk_size = (range.size() + num_threads - 1)/num_threads;
+		TaskPool pool;
 
-	/* chop references into bins. */
-	for(unsigned int refIdx = range.start(); refIdx < range.end(); refIdx++) {
-		const BVHReference& ref = builder->references[refIdx];
-		float3 firstBinf = (ref.bounds().min - origin) * invBinSize;
-		float3 lastBinf = (ref.bounds().max - origin) * invBinSize;
-		int3 firstBin = make_int3((int)firstBinf.x, (int)firstBinf.y, (int)firstBinf.z);
-		int3 lastBin = make_int3((int)lastBinf.x, (int)lastBinf.y, (int)lastBinf.z);
+		for(int t = 0; t < num_threads; t++) {
+			int begin = range.start() + t*chunk_size;
+			int end = min(begin + chunk_size, range.end());
 
-		firstBin = clamp(firstBin, 0, BVHParams::NUM_SPATIAL_BINS - 1);
-		lastBin = clamp(lastBin, firstBin, BVHParams::NUM_SPATIAL_BINS - 1);
+			pool.push(function_bind(&BVHSpatialSplit::bin_references, this,
+				builder, begin, end, origin, binSize, invBinSize, thread_bins[t].bins));
+		}
 
-		for(int dim = 0; dim < 3; dim++) {
-			BVHReference currRef = ref;
+		pool.wait_work();
 
-			for(int i = firstBin[dim]; i < lastBin[dim]; i++) {
-				BVHReference leftRef, rightRef;
+		/* merge bins */
+		memcpy(bins, thread_bins[0].bins, sizeof(thread_bins[0].bins));
 
-				split_reference(builder, leftRef, rightRef, currRef, dim, origin[dim] + binSize[dim] * (float)(i + 1));
-				builder->spatial_bins[dim][i].bounds.grow(leftRef.bounds());
-				currRef = rightRef;
-			}
+		for(int t = 1; t < num_threads; t++) {
+			for(int dim = 0; dim < 3; dim++) {
+				for(int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
+					BVHSpatialBin& bin = bins[dim][i];
+					const BVHSpatialBin& thread_bin = thread_bins[t].bins[dim][i];
 
-			builder->spatial_bins[dim][lastBin[dim]].bounds.grow(currRef.bounds());
-			builder->spatial_bins[dim][firstBin[dim]].enter++;
-			builder->spatial_bins[dim][lastBin[dim]].exit++;
+					bin.bounds.grow(thread_bin.bounds);
+					bin.enter += thread_bin.enter;
+					bin.exit += thread_bin.exit;
+				}
+			}
 		}
 	}
+	else
+		bin_references(builder, range.start(), range.end(), origin, binSize, invBinSize, bins);
 
 	/* select best split plane. */
 	for(int dim = 0; dim < 3; dim++) {
@@ -135,7 +178,7 @@ BVHSpatialSplit::BVHSpatialSplit(BVHBuild *builder, const BVHRange& range, float
 		BoundBox right_bounds = BoundBox::empty;
 
 		for(int i = BVHParams::NUM_SPATIAL_BINS - 1; i > 0; i--) {
-			right_bounds.grow(builder->spatial_bins[dim][i].bounds);
+			right_bounds.grow(bins[dim][i].bounds);
 			builder->spatial_right_bounds[i - 1] = right_bounds;
 		}
 
@@ -145,9 +188,9 @@ BVHSpatialSplit::BVHSpatialSplit(BVHBuild *builder, const BVHRange& range, float
 		int rightNum = range.size();
 
 		for(int i = 1; i < BVHParams::NUM_SPATIAL_BINS; i++) {
-			left_bounds.grow(builder->spatial_bins[dim][i - 1].bounds);
-			leftNum += builder->spatial_bins[dim][i - 1].enter;
-			rightNum -= builder->spatial_bins[dim][i - 1].exit;
+			left_bounds.grow(bins[dim][i - 1].bounds);
+			leftNum += bins[dim][i - 1].enter;
+			rightNum -= bins[dim][i - 1].exit;
 
 			float sah = nodeSAH +
 				left_bounds.safe_area() * builder->params.triangle_cost(leftNum) +
@@ -162,6 +205,48 @@ BVHSpatialSplit::BVHSpatialSplit(BVHBuild *builder, const BVHRange& range, float
 	}
 }
 
+void BVHSpatialSplit::bin_references(BVHBuild *builder, int begin, int end, float3 origin, float3 binSize, float3 invBinSize, BVHSpatialBin (*bins)[BVHParams::NUM_SPATIAL_BINS])
+{
+	/* initialize bins. */
+	for(int dim = 0; dim < 3; dim++) {
+		for(int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
+			BVHSpatialBin& bin = bins[dim][i];
+
+			bin.bounds = BoundBox::empty;
+			bin.enter = 0;
+			bin.exit = 0;
+		}
+	}
+
+	/* chop references into bins. */
+	for(int refIdx = begin; refIdx < end; refIdx++) {
+		const BVHReference& ref = builder->references[refIdx];
+		float3 firstBinf = (ref.bounds().min - origin) * invBinSize;
+		float3 lastBinf = (ref.bounds().max - origin) * invBinSize;
+		int3 firstBin = make_int3((int)firstBinf.x, (int)firstBinf.y, (int)firstBinf.z);
+		int3 lastBin = make_int3((int)lastBinf.x, (int)lastBinf.y, (int)lastBinf.z);
+
+		firstBin = clamp(firstBin, 0, BVHParams::NUM_SPATIAL_BINS - 1);
+		lastBin = clamp(lastBin, firstBin, BVHParams::NUM_SPATIAL_BINS - 1);
+
+		for(int dim = 0; dim < 3; dim++) {
+			BVHReference currRef = ref;
+
+			for(int i = firstBin[dim]; i < lastBin[dim]; i++) {
+				BVHReference leftRef, rightRef;
+
+				split_reference(builder, leftRef, rightRef, currRef, dim, origin[dim] + binSize[dim] * (float)(i + 1));
+				bins[dim][i].bounds.grow(leftRef.bounds());
+				currRef = rightRef;
+			}
+
+			bins[dim][lastBin[dim]].bounds.grow(currRef.bounds());
+			bins[dim][firstBin[dim]].enter++;
+			bins[dim][lastBin[dim]].exit++;
+		}
+	}
+}
+
 void BVHSpatialSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range)
 {
 	/* Categorize references and compute bounds.
@@ -243,6 +328,50 @@ void BVHSpatialSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right,
 	right = BVHRange(right_bounds, right_start, right_end - right_start);
 }
 
+/* exact bounds of the cardinal curve through p[1] and p[2] in one dimension,
+ * for parameter range t0 to t1, same curve as curvebounds() */
+static void curve_piece_bounds(float *lower, float *upper, const float3 *p, int dim, float t0, float t1)
+{
+	float fc = 0.71f;
+	float c0 = p[1][dim];
+	float c1 = -fc*p[0][dim] + fc*p[2][dim];
+	float c2 = 2.0f*fc*p[0][dim] + (fc - 3.0f)*p[1][dim] + (3.0f - 2.0f*fc)*p[2][dim] - fc*p[3][dim];
+	float c3 = -fc*p[0][dim] + (2.0f - fc)*p[1][dim] + (fc - 2.0f)*p[2][dim] + fc*p[3][dim];
+
+	float ex[4];
+	int num = 0;
+
+	ex[num++] = t0;
+	ex[num++] = t1;
+
+	/* extrema where derivative 3*c3*t^2 + 2*c2*t + c1 is zero */
+	if(c3 != 0.0f) {
+		float discroot = c2*c2 - 3.0f*c3*c1;
+
+		if(discroot >= 0.0f) {
+			discroot = sqrtf(discroot);
+			ex[num++] = (-c2 - discroot)/(3.0f*c3);
+			ex[num++] = (-c2 + discroot)/(3.0f*c3);
+		}
+	}
+	else if(c2 != 0.0f)
+		ex[num++] = -c1/(2.0f*c2);
+
+	*lower = FLT_MAX;
+	*upper = -FLT_MAX;
+
+	for(int i = 0; i < num; i++) {
+		float t = ex[i];
+
+		if(t < t0 || t > t1)
+			continue;
+
+		float v = ((c3*t + c2)*t + c1)*t + c0;
+		*lower = min(*lower, v);
+		*upper = max(*upper, v);
+	}
+}
+
 void BVHSpatialSplit::split_reference(BVHBuild *builder, BVHReference& left, BVHReference& right, const BVHReference& ref, int dim, float pos)
 {
 	/* initialize boundboxes */
@@ -281,33 +410,48 @@ void BVHSpatialSplit::split_reference(BVHBuild *builder, BVHReference& left, BVH
 		}
 	}
 	else {
-		/* curve split: NOTE - Currently ignores curve width and needs to be fixed.*/
-		const int k0 = mesh->curves[ref.prim_index()].first_key + ref.prim_segment();
+		/* curve split: the segment is cut into pieces, each with exact bounds
+		 * for both the cardinal curve and the straight line, as either may be
+		 * used by the kernel, grown by the curve radius */
+		const Mesh::Curve& curve = mesh->curves[ref.prim_index()];
+		const int k0 = curve.first_key + ref.prim_segment();
 		const int k1 = k0 + 1;
-		const float3* v0 = &mesh->curve_keys[k0].co;
-		const float3* v1 = &mesh->curve_keys[k1].co;
 
-		float v0p = (*v0)[dim];
-		float v1p = (*v1)[dim];
-
-		/* insert vertex to the boxes it belongs to. */
-		if(v0p <= pos)
-			left_bounds.grow(*v0);
-
-		if(v0p >= pos)
-			right_bounds.grow(*v0);
-
-		if(v1p <= pos)
-			left_bounds.grow(*v1);
-
-		if(v1p >= pos)
-			right_bounds.grow(*v1);
+		float3 p[4];
+		p[0] = mesh->curve_keys[max(k0 - 1, curve.first_key)].co;
+		p[1] = mesh->curve_keys[k0].co;
+		p[2] = mesh->curve_keys[k1].co;
+		p[3] = mesh->curve_keys[min(k1 + 1, curve.first_key + curve.num_keys - 1)].co;
+
+		float radius = max(mesh->curve_keys[k0].radius, mesh->curve_keys[k1].radius);
+
+		for(int i = 0; i < BVHParams::NUM_CURVE_PIECES; i++) {
+			float t0 = i/(float)BVHParams::NUM_CURVE_PIECES;
+			float t1 = (i + 1)/(float)BVHParams::NUM_CURVE_PIECES;
+			float3 lower, upper;
+
+			curve_piece_bounds(&lower.x, &upper.x, p, 0, t0, t1);
+			curve_piece_bounds(&lower.y, &upper.y, p, 1, t0, t1);
+			curve_piece_bounds(&lower.z, &upper.z, p, 2, t0, t1);
+
+			BoundBox piece = BoundBox::empty;
+			piece.grow(lower, radius);
+			piece.grow(upper, radius);
+			piece.grow(lerp(p[1], p[2], t0), radius);
+			piece.grow(lerp(p[1], p[2], t1), radius);
+
+			/* insert piece into the boxes it overlaps, clipped to the plane */
+			if(piece.min[dim] <= pos) {
+				BoundBox clipped = piece;
+				clipped.max[dim] = min(clipped.max[dim], pos);
+				left_bounds.grow(clipped);
+			}
 
-		/* edge intersects the plane => insert intersection to both boxes. */
-		if((v0p < pos && v1p > pos) || (v0p > pos && v1p < pos)) {
-			float3 t = lerp(*v0, *v1, clamp((pos - v0p) / (v1p - v0p), 0.0f, 1.0f));
-			left_bounds.grow(t);
-			right_bounds.grow(t);
+			if(piece.max[dim] >= pos) {
+				BoundBox clipped = piece;
+				clipped.min[dim] = max(clipped.min[dim], pos);
+				right_bounds.grow(clipped);
+			}
 		}
 	}
 
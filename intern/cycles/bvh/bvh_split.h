@@ -40,6 +40,9 @@ public:
 	BVHObjectSplit(BVHBuild *builder, const BVHRange& range, float nodeSAH);
 
 	void split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range);
+
+protected:
+	void find_split(BVHBuild *builder, BVHReference *refs, int num, int dim, float nodeSAH, BoundBox *right_bounds_buffer);
 };
 
 /* Spatial Split */
@@ -56,6 +59,14 @@ public:
 
 	void split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range);
 	void split_reference(BVHBuild *builder, BVHReference& left, BVHReference& right, const BVHReference& ref, int dim, float pos);
+
+protected:
+	/* bins for all three dimensions, one set per thread for parallel binning */
+	struct Bins {
+		BVHSpatialBin bins[3][BVHParams::NUM_SPATIAL_BINS];
+	};
+
+	void bin_references(BVHBuild *builder, int begin, int end, float3 origin, float3 binSize, float3 invBinSize, BVHSpatialBin (*bins)[BVHParams::NUM_SPATIAL_BINS]);
 };
 
 /* Mixed Object-Spatial Split */
@@ -28,6 +28,7 @@
 #include "util_math.h"
 #include "util_opencl.h"
 #include "util_opengl.h"
+#include "util_string.h"
 #include "util_time.h"
 #include "util_types.h"
 #include "util_vector.h"
@@ -101,7 +102,11 @@ Device *Device::create(DeviceInfo& info, Stats &stats, bool background)
 #endif
 #ifdef WITH_NETWORK
 		case DEVICE_NETWORK:
-			device = device_network_create(info, stats, "127.0.0.1");
+			/* server address is stored in the id of network devices */
+			if(string_startswith(info.id, "NETWORK_"))
+				device = device_network_create(info, stats, info.id.c_str() + strlen("NETWORK_"));
+			else
+				device = device_network_create(info, stats, "127.0.0.1");
 			break;
 #endif
 #ifdef WITH_OPENCL
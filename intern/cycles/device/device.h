@@ -35,6 +35,7 @@ CCL_NAMESPACE_BEGIN
 
 class Progress;
 class RenderTile;
+class TextureCache;
 
 /* Device Types */
 
@@ -56,6 +57,7 @@ public:
 	bool display_device;
 	bool advanced_shading;
 	bool pack_images;
+	bool use_qbvh;
 	vector<DeviceInfo> multi_devices;
 
 	DeviceInfo()
@@ -66,6 +68,7 @@ public:
 		display_device = false;
 		advanced_shading = true;
 		pack_images = false;
+		use_qbvh = false;
 	}
 };
 
@@ -113,6 +116,9 @@ public:
 	/* open shading language, only for CPU device */
 	virtual void *osl_memory() { return NULL; }
 
+	/* on demand image textures, only for CPU device */
+	virtual void set_texture_cache(TextureCache *cache) {}
+
 	/* load/compile kernels, must be called before adding tasks */ 
 	virtual bool load_kernels(bool experimental) { return true; }
 
@@ -127,7 +133,7 @@ public:
 
 #ifdef WITH_NETWORK
 	/* networking */
-	void server_run();
+	void server_run(int port);
 #endif
 
 	/* multi device */
@@ -141,6 +147,11 @@ public:
 	static string string_from_type(DeviceType type);
 	static vector<DeviceType>& available_types();
 	static vector<DeviceInfo>& available_devices();
+
+#ifdef WITH_NETWORK
+	/* device rendering on a comma separated list of host[:port] servers */
+	static DeviceInfo network_info(const string& servers);
+#endif
 };
 
 CCL_NAMESPACE_END
@@ -39,6 +39,7 @@
 #include "util_progress.h"
 #include "util_system.h"
 #include "util_thread.h"
+#include "util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -56,6 +57,7 @@ public:
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
+		kernel_globals.texture_cache = NULL;
 
 		/* do now to avoid thread issues */
 		system_cpu_support_sse2();
@@ -125,6 +127,11 @@ public:
 #endif
 	}
 
+	void set_texture_cache(TextureCache *cache)
+	{
+		kernel_globals.texture_cache = cache;
+	}
+
 	void thread_run(DeviceTask *task)
 	{
 		if(task->type == DeviceTask::PATH_TRACE)
@@ -144,6 +151,65 @@ public:
 		}
 	};
 
+	/* Adaptive sampling: a tile is finished early once the standard error of
+	 * the mean luminance of all its pixels, relative to that mean, is below
+	 * the threshold. Samples that are skipped still count for progress. */
+	bool adaptive_tile_done(KernelGlobals *kg, DeviceTask& task, RenderTile& tile, int end_sample)
+	{
+		KernelFilm *kfilm = &kernel_data.film;
+
+		if(task.adaptive_threshold == 0.0f || !(kfilm->pass_flag & PASS_VARIANCE))
+			return false;
+		if(tile.sample < task.adaptive_min_samples || tile.sample >= end_sample)
+			return false;
+
+		float *render_buffer = (float*)tile.buffer;
+		float inv_sample = 1.0f/(float)tile.sample;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				float *buffer = render_buffer + (tile.offset + x + y*tile.stride)*kfilm->pass_stride;
+				float *combined = buffer + kfilm->pass_combined;
+
+				float mean = linear_rgb_to_gray(make_float3(combined[0], combined[1], combined[2]))*inv_sample;
+				float variance = max(buffer[kfilm->pass_variance]*inv_sample - mean*mean, 0.0f);
+
+				/* clamp mean so near black pixels can converge too */
+				float error = sqrtf(variance*inv_sample)/max(mean, 0.01f);
+
+				if(error > task.adaptive_threshold)
+					return false;
+			}
+		}
+
+		if(task.update_progress_sample)
+			for(int sample = tile.sample; sample < end_sample; sample++)
+				task.update_progress_sample();
+
+		return true;
+	}
+
+#ifdef __KERNEL_DEBUG__
+	void debug_write_render_time(KernelGlobals *kg, RenderTile& tile, double time)
+	{
+		KernelFilm *kfilm = &kernel_data.film;
+
+		if(!(kfilm->pass_flag & PASS_DEBUG_RENDER_TIME))
+			return;
+
+		float *render_buffer = (float*)tile.buffer;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				float *buffer = render_buffer + (tile.offset + x + y*tile.stride)*kfilm->pass_stride;
+				float *render_time = buffer + kfilm->pass_render_time;
+
+				*render_time = (tile.start_sample == 0)? (float)time: *render_time + (float)time;
+			}
+		}
+	}
+#endif
+
 	void thread_path_trace(DeviceTask& task)
 	{
 		if(task_pool.cancelled()) {
@@ -165,7 +231,14 @@ public:
 			int start_sample = tile.start_sample;
 			int end_sample = tile.start_sample + tile.num_samples;
 
+#ifdef __KERNEL_DEBUG__
+			double tile_start_time = time_dt();
+#endif
+
 #ifdef WITH_OPTIMIZED_KERNEL
+			/* trace camera rays of neighbouring pixels together */
+			bool use_ray_packets = kg.__data.bvh.use_ray_packets;
+
 			if(system_cpu_support_sse3()) {
 				for(int sample = start_sample; sample < end_sample; sample++) {
 					if (task.get_cancel() || task_pool.cancelled()) {
@@ -174,15 +247,27 @@ public:
 					}
 
 					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_sse3_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
+						if(use_ray_packets) {
+							for(int x = tile.x; x < tile.x + tile.w; x += RAY_PACKET_SIZE) {
+								int num = min(RAY_PACKET_SIZE, tile.x + tile.w - x);
+								kernel_cpu_sse3_path_trace_packet(&kg, render_buffer, rng_state,
+									sample, x, y, tile.offset, tile.stride, num);
+							}
+						}
+						else {
+							for(int x = tile.x; x < tile.x + tile.w; x++) {
+								kernel_cpu_sse3_path_trace(&kg, render_buffer, rng_state,
+									sample, x, y, tile.offset, tile.stride);
+							}
 						}
 					}
 
 					tile.sample = sample + 1;
 
 					task.update_progress(tile);
+
+					if(adaptive_tile_done(&kg, task, tile, end_sample))
+						break;
 				}
 			}
 			else if(system_cpu_support_sse2()) {
@@ -193,15 +278,27 @@ public:
 					}
 
 					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_sse2_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
+						if(use_ray_packets) {
+							for(int x = tile.x; x < tile.x + tile.w; x += RAY_PACKET_SIZE) {
+								int num = min(RAY_PACKET_SIZE, tile.x + tile.w - x);
+								kernel_cpu_sse2_path_trace_packet(&kg, render_buffer, rng_state,
+									sample, x, y, tile.offset, tile.stride, num);
+							}
+						}
+						else {
+							for(int x = tile.x; x < tile.x + tile.w; x++) {
+								kernel_cpu_sse2_path_trace(&kg, render_buffer, rng_state,
+									sample, x, y, tile.offset, tile.stride);
+							}
 						}
 					}
 
 					tile.sample = sample + 1;
 
 					task.update_progress(tile);
+
+					if(adaptive_tile_done(&kg, task, tile, end_sample))
+						break;
 				}
 			}
 			else
@@ -223,9 +320,16 @@ public:
 					tile.sample = sample + 1;
 
 					task.update_progress(tile);
+
+					if(adaptive_tile_done(&kg, task, tile, end_sample))
+						break;
 				}
 			}
 
+#ifdef __KERNEL_DEBUG__
+			debug_write_render_time(&kg, tile, time_dt() - tile_start_time);
+#endif
+
 			task.release_tile(tile);
 
 			if(task_pool.cancelled()) {
@@ -234,6 +338,8 @@ public:
 			}
 		}
 
+		stats.rays_add(kg.ray_stats);
+
 #ifdef WITH_OSL
 		OSLShader::thread_free(&kg);
 #endif
@@ -343,6 +449,13 @@ void device_cpu_info(vector<DeviceInfo>& devices)
 	info.advanced_shading = true;
 	info.pack_images = false;
 
+	/* 4-wide bvh traversal is only compiled into the sse kernels */
+#ifdef WITH_OPTIMIZED_KERNEL
+	info.use_qbvh = system_cpu_support_sse2();
+#else
+	info.use_qbvh = false;
+#endif
+
 	devices.insert(devices.begin(), info);
 }
 
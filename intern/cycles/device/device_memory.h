@@ -31,6 +31,7 @@
  * to and from. */
 
 #include "util_debug.h"
+#include "util_half.h"
 #include "util_types.h"
 #include "util_vector.h"
 
@@ -48,7 +49,8 @@ enum DataType {
 	TYPE_UCHAR,
 	TYPE_UINT,
 	TYPE_INT,
-	TYPE_FLOAT
+	TYPE_FLOAT,
+	TYPE_HALF
 };
 
 static inline size_t datatype_size(DataType datatype) 
@@ -58,6 +60,7 @@ static inline size_t datatype_size(DataType datatype)
 		case TYPE_FLOAT: return sizeof(float);
 		case TYPE_UINT: return sizeof(uint);
 		case TYPE_INT: return sizeof(int);
+		case TYPE_HALF: return sizeof(half);
 		default: return 0;
 	}
 }
@@ -149,6 +152,11 @@ template<> struct device_type_traits<float4> {
 	static const int num_elements = 4;
 };
 
+template<> struct device_type_traits<half4> {
+	static const DataType data_type = TYPE_HALF;
+	static const int num_elements = 4;
+};
+
 /* Device Memory */
 
 class device_memory
@@ -239,6 +247,11 @@ public:
 		return data.size();
 	}
 
+	T *get_data()
+	{
+		return (T*)data_pointer;
+	}
+
 private:
 	array<T> data;
 	bool referenced;
@@ -21,6 +21,7 @@
 #include "device_network.h"
 
 #include "util_foreach.h"
+#include "util_thread.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -34,14 +35,46 @@ public:
 	device_ptr mem_counter;
 	DeviceTask the_task; /* todo: handle multiple tasks */
 
+	/* tile requests of the server are handled in a separate thread, so that
+	 * multiple network devices in a multi device can render at the same time */
+	thread *task_thread;
+
+	/* every call and its reply hold send_mutex, so messages from the session,
+	 * tile and task threads don't interleave on the socket */
+	thread_mutex send_mutex;
+
+	/* while a task runs, its thread is the only one reading the socket, so a
+	 * mem_copy_from reply requested from another thread is read by the task
+	 * thread into the pending buffer, and the caller is woken up */
+	thread_mutex reply_mutex;
+	thread_condition_variable reply_cond;
+	thread_mutex copy_mutex;
+	bool task_running;
+	bool task_thread_id_set;
+	pthread_t task_thread_id;
+	uint8_t *copy_buffer;
+	size_t copy_size;
+	bool copy_done;
+
 	NetworkDevice(Stats &stats, const char *address)
-	: Device(stats), socket(io_service)
+	: Device(stats), socket(io_service), task_thread(NULL), task_running(false),
+	  task_thread_id_set(false), copy_buffer(NULL), copy_size(0), copy_done(false)
 	{
+		/* address is host or host:port */
+		string host = address;
+		int port = SERVER_PORT;
+		size_t colon = host.rfind(':');
+
+		if(colon != string::npos) {
+			port = atoi(host.c_str() + colon + 1);
+			host = host.substr(0, colon);
+		}
+
 		stringstream portstr;
-		portstr << SERVER_PORT;
+		portstr << port;
 
 		tcp::resolver resolver(io_service);
-		tcp::resolver::query query(address, portstr.str());
+		tcp::resolver::query query(host, portstr.str());
 		tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
 		tcp::resolver::iterator end;
 
@@ -55,17 +88,46 @@ public:
 		if(error)
 			throw boost::system::system_error(error);
 
+		/* small messages for tiles should not wait for more data */
+		socket.set_option(tcp::no_delay(true));
+
 		mem_counter = 0;
+
+		/* verify the server speaks the same protocol */
+		thread_scoped_lock send_lock(send_mutex);
+
+		RPCSend snd(socket, "version");
+		snd.add(NETWORK_PROTOCOL_VERSION);
+		snd.write();
+
+		RPCReceive rcv(socket);
+		int server_version = 0;
+
+		if(rcv.name == "version")
+			rcv.read(server_version);
+
+		if(server_version != NETWORK_PROTOCOL_VERSION) {
+			error_msg = string_printf("Network server at %s uses protocol version %d, expected %d",
+				address, server_version, NETWORK_PROTOCOL_VERSION);
+			fprintf(stderr, "%s\n", error_msg.c_str());
+
+			socket.close();
+		}
 	}
 
 	~NetworkDevice()
 	{
+		task_wait();
+
+		thread_scoped_lock send_lock(send_mutex);
 		RPCSend snd(socket, "stop");
 		snd.write();
 	}
 
 	void mem_alloc(device_memory& mem, MemoryType type)
 	{
+		thread_scoped_lock send_lock(send_mutex);
+
 		mem.device_pointer = ++mem_counter;
 
 		RPCSend snd(socket, "mem_alloc");
@@ -77,6 +139,7 @@ public:
 
 	void mem_copy_to(device_memory& mem)
 	{
+		thread_scoped_lock send_lock(send_mutex);
 		RPCSend snd(socket, "mem_copy_to");
 
 		snd.add(mem);
@@ -85,6 +148,70 @@ public:
 	}
 
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
+	{
+		if(have_error())
+			return;
+
+		/* only the requested rows are sent back */
+		size_t offset = (size_t)elem*y*w;
+		size_t size = (size_t)elem*w*h;
+		uint8_t *buffer = (uint8_t*)mem.data_pointer + offset;
+
+		thread_scoped_lock reply_lock(reply_mutex);
+
+		if(!task_running || (task_thread_id_set && pthread_equal(pthread_self(), task_thread_id))) {
+			/* nobody else reads the socket, so wait for the reply here */
+			reply_lock.unlock();
+			mem_copy_from_direct(mem, y, w, h, elem, buffer, size);
+			return;
+		}
+
+		/* one pending reply at a time, the task thread may itself need to
+		 * copy memory from a tile callback, so it never takes this lock */
+		reply_lock.unlock();
+		thread_scoped_lock copy_lock(copy_mutex);
+		reply_lock.lock();
+
+		if(!task_running) {
+			reply_lock.unlock();
+			mem_copy_from_direct(mem, y, w, h, elem, buffer, size);
+			return;
+		}
+
+		/* hand the reply over to the task thread */
+		copy_buffer = buffer;
+		copy_size = size;
+		copy_done = false;
+		reply_lock.unlock();
+
+		{
+			thread_scoped_lock send_lock(send_mutex);
+			mem_copy_from_send(mem, y, w, h, elem);
+		}
+
+		reply_lock.lock();
+		while(!copy_done && task_running)
+			reply_cond.wait(reply_lock);
+
+		bool done = copy_done;
+		copy_buffer = NULL;
+		reply_lock.unlock();
+
+		/* the task ended before the server replied, read it ourselves */
+		if(!done && !have_error()) {
+			thread_scoped_lock send_lock(send_mutex);
+			mem_copy_from_receive(buffer, size);
+		}
+	}
+
+	void mem_copy_from_direct(device_memory& mem, int y, int w, int h, int elem, uint8_t *buffer, size_t size)
+	{
+		thread_scoped_lock send_lock(send_mutex);
+		mem_copy_from_send(mem, y, w, h, elem);
+		mem_copy_from_receive(buffer, size);
+	}
+
+	void mem_copy_from_send(device_memory& mem, int y, int w, int h, int elem)
 	{
 		RPCSend snd(socket, "mem_copy_from");
 
@@ -94,13 +221,31 @@ public:
 		snd.add(h);
 		snd.add(elem);
 		snd.write();
+	}
 
+	void mem_copy_from_receive(uint8_t *buffer, size_t size)
+	{
 		RPCReceive rcv(socket);
-		rcv.read_buffer((void*)mem.data_pointer, mem.memory_size());
+		size_t reply_size = 0;
+
+		if(rcv.name == "mem_copy_from")
+			rcv.read(reply_size);
+
+		if(rcv.failed || reply_size != size || !rcv.read_buffer(buffer, size))
+			connection_error("Network connection lost while copying memory from the server");
+	}
+
+	void connection_error(const string& msg)
+	{
+		if(error_msg == "") {
+			error_msg = msg;
+			fprintf(stderr, "%s\n", error_msg.c_str());
+		}
 	}
 
 	void mem_zero(device_memory& mem)
 	{
+		thread_scoped_lock send_lock(send_mutex);
 		RPCSend snd(socket, "mem_zero");
 
 		snd.add(mem);
@@ -110,6 +255,7 @@ public:
 	void mem_free(device_memory& mem)
 	{
 		if(mem.device_pointer) {
+			thread_scoped_lock send_lock(send_mutex);
 			RPCSend snd(socket, "mem_free");
 
 			snd.add(mem);
@@ -121,6 +267,7 @@ public:
 
 	void const_copy_to(const char *name, void *host, size_t size)
 	{
+		thread_scoped_lock send_lock(send_mutex);
 		RPCSend snd(socket, "const_copy_to");
 
 		string name_string(name);
@@ -133,6 +280,8 @@ public:
 
 	void tex_alloc(const char *name, device_memory& mem, bool interpolation, bool periodic)
 	{
+		thread_scoped_lock send_lock(send_mutex);
+
 		mem.device_pointer = ++mem_counter;
 
 		RPCSend snd(socket, "tex_alloc");
@@ -150,6 +299,7 @@ public:
 	void tex_free(device_memory& mem)
 	{
 		if(mem.device_pointer) {
+			thread_scoped_lock send_lock(send_mutex);
 			RPCSend snd(socket, "tex_free");
 
 			snd.add(mem);
@@ -161,35 +311,92 @@ public:
 
 	void task_add(DeviceTask& task)
 	{
+		task_wait();
+
+		if(have_error())
+			return;
+
 		the_task = task;
 
-		RPCSend snd(socket, "task_add");
-		snd.add(task);
-		snd.write();
+		{
+			thread_scoped_lock send_lock(send_mutex);
+			RPCSend snd(socket, "task_add");
+			snd.add(task);
+			snd.write();
+		}
+
+		/* set before the thread starts, so mem_copy_from never reads the
+		 * socket at the same time as the task thread */
+		{
+			thread_scoped_lock reply_lock(reply_mutex);
+			task_running = true;
+			task_thread_id_set = false;
+		}
+
+		task_thread = new thread(function_bind(&NetworkDevice::task_run, this));
 	}
 
-	void task_wait()
+	void task_run()
 	{
-		RPCSend snd(socket, "task_wait");
-		snd.write();
+		{
+			thread_scoped_lock reply_lock(reply_mutex);
+			task_thread_id = pthread_self();
+			task_thread_id_set = true;
+		}
+
+		{
+			thread_scoped_lock send_lock(send_mutex);
+			RPCSend snd(socket, "task_wait");
+			snd.write();
+		}
 
 		list<RenderTile> the_tiles;
 
-		/* todo: run this threaded for connecting to multiple clients */
+		/* tiles are handed out on request, so each server takes new work as
+		 * soon as it runs out, and faster servers end up rendering more tiles */
 		for(;;) {
 			RPCReceive rcv(socket);
 			RenderTile tile;
 
-			if(rcv.name == "acquire_tile") {
+			if(rcv.failed) {
+				/* the session sees the error and cancels the render */
+				connection_error("Network connection to the server was lost");
+				break;
+			}
+			else if(rcv.name == "mem_copy_from") {
+				/* reply to a mem_copy_from from another thread */
+				thread_scoped_lock reply_lock(reply_mutex);
+				size_t size = 0;
+
+				rcv.read(size);
+
+				if(!copy_buffer || copy_done || size != copy_size) {
+					connection_error("Network server sent an unexpected memory reply");
+					break;
+				}
+
+				bool ok = rcv.read_buffer(copy_buffer, size);
+
+				copy_done = true;
+				reply_cond.notify_all();
+
+				if(!ok) {
+					connection_error("Network connection lost while copying memory from the server");
+					break;
+				}
+			}
+			else if(rcv.name == "acquire_tile") {
 				/* todo: watch out for recursive calls! */
 				if(the_task.acquire_tile(this, tile)) { /* write return as bool */
 					the_tiles.push_back(tile);
 
+					thread_scoped_lock send_lock(send_mutex);
 					RPCSend snd(socket, "acquire_tile");
 					snd.add(tile);
 					snd.write();
 				}
 				else {
+					thread_scoped_lock send_lock(send_mutex);
 					RPCSend snd(socket, "acquire_tile_none");
 					snd.write();
 				}
@@ -209,16 +416,32 @@ public:
 
 				the_task.release_tile(tile);
 
+				thread_scoped_lock send_lock(send_mutex);
 				RPCSend snd(socket, "release_tile");
 				snd.write();
 			}
 			else if(rcv.name == "task_wait_done")
 				break;
 		}
+
+		thread_scoped_lock reply_lock(reply_mutex);
+		task_running = false;
+		task_thread_id_set = false;
+		reply_cond.notify_all();
+	}
+
+	void task_wait()
+	{
+		if(task_thread) {
+			task_thread->join();
+			delete task_thread;
+			task_thread = NULL;
+		}
 	}
 
 	void task_cancel()
 	{
+		thread_scoped_lock send_lock(send_mutex);
 		RPCSend snd(socket, "task_cancel");
 		snd.write();
 	}
@@ -243,6 +466,41 @@ void device_network_info(vector<DeviceInfo>& devices)
 	devices.push_back(info);
 }
 
+DeviceInfo Device::network_info(const string& servers)
+{
+	vector<string> addresses;
+	string_split(addresses, servers, ", ");
+
+	DeviceInfo info;
+
+	foreach(string& address, addresses) {
+		DeviceInfo subinfo;
+
+		subinfo.type = DEVICE_NETWORK;
+		subinfo.description = "Network Device " + address;
+		subinfo.id = "NETWORK_" + address;
+		subinfo.num = info.multi_devices.size();
+		subinfo.advanced_shading = true;
+		subinfo.pack_images = false;
+
+		info.multi_devices.push_back(subinfo);
+	}
+
+	if(info.multi_devices.size() == 1)
+		return info.multi_devices[0];
+
+	/* multiple servers render together through a multi device, which spreads
+	 * the tiles over them */
+	info.type = DEVICE_MULTI;
+	info.description = string_printf("Network Device (%dx)", (int)info.multi_devices.size());
+	info.id = "NETWORK_MULTI";
+	info.num = 0;
+	info.advanced_shading = true;
+	info.pack_images = false;
+
+	return info;
+}
+
 class DeviceServer {
 public:
 	DeviceServer(Device *device_, tcp::socket& socket_)
@@ -252,11 +510,30 @@ public:
 
 	void listen()
 	{
+		/* the client starts by sending its protocol version */
+		{
+			RPCReceive rcv(socket);
+			int client_version = 0;
+
+			if(rcv.name == "version")
+				rcv.read(client_version);
+
+			RPCSend snd(socket, "version");
+			snd.add(NETWORK_PROTOCOL_VERSION);
+			snd.write();
+
+			if(client_version != NETWORK_PROTOCOL_VERSION) {
+				fprintf(stderr, "Network client uses protocol version %d, expected %d, disconnecting\n",
+					client_version, NETWORK_PROTOCOL_VERSION);
+				return;
+			}
+		}
+
 		/* receive remote function calls */
 		for(;;) {
 			RPCReceive rcv(socket);
 
-			if(rcv.name == "stop")
+			if(rcv.failed || rcv.name == "stop")
 				break;
 
 			process(rcv);
@@ -322,9 +599,13 @@ protected:
 
 			device->mem_copy_from(mem, y, w, h, elem);
 
-			RPCSend snd(socket);
+			size_t offset = (size_t)elem*y*w;
+			size_t size = (size_t)elem*w*h;
+
+			RPCSend snd(socket, "mem_copy_from");
+			snd.add(size);
 			snd.write();
-			snd.write_buffer((uint8_t*)mem.data_pointer, mem.memory_size());
+			snd.write_buffer((uint8_t*)mem.data_pointer + offset, size);
 		}
 		else if(rcv.name == "mem_zero") {
 			network_device_memory mem;
@@ -455,7 +736,7 @@ protected:
 				result = true;
 				break;
 			}
-			else if(rcv.name == "acquire_tile_none")
+			else if(rcv.failed || rcv.name == "acquire_tile_none")
 				break;
 			else
 				process(rcv);
@@ -489,7 +770,7 @@ protected:
 		while(1) {
 			RPCReceive rcv(socket);
 
-			if(rcv.name == "release_tile")
+			if(rcv.failed || rcv.name == "release_tile")
 				break;
 			else
 				process(rcv);
@@ -515,7 +796,7 @@ protected:
 	/* todo: free memory and device (osl) on network error */
 };
 
-void Device::server_run()
+void Device::server_run(int port)
 {
 	try {
 		/* starts thread that responds to discovery requests */
@@ -524,10 +805,11 @@ void Device::server_run()
 		for(;;) {
 			/* accept connection */
 			boost::asio::io_service io_service;
-			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
+			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), port));
 
 			tcp::socket socket(io_service);
 			acceptor.accept(socket);
+			socket.set_option(tcp::no_delay(true));
 
 			string remote_address = socket.remote_endpoint().address().to_string();
 			printf("Connected to remote client at: %s\n", remote_address.c_str());
@@ -21,12 +21,9 @@
 
 #ifdef WITH_NETWORK
 
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
-#include <boost/serialization/vector.hpp>
 #include <boost/thread.hpp>
 
 #include <iostream>
@@ -37,6 +34,7 @@
 #include "util_list.h"
 #include "util_map.h"
 #include "util_string.h"
+#include "util_types.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -53,6 +51,14 @@ static const int DISCOVER_PORT = 5121;
 static const string DISCOVER_REQUEST_MSG = "REQUEST_RENDER_SERVER_IP";
 static const string DISCOVER_REPLY_MSG = "REPLY_RENDER_SERVER_IP";
 
+/* increase when the layout of any message changes, client and server refuse
+ * to render together when their versions differ */
+static const int NETWORK_PROTOCOL_VERSION = 3;
+
+/* messages only hold call arguments, memory buffers are sent separately, so
+ * anything larger than this is a corrupt or hostile header */
+static const uint64_t NETWORK_MAX_MESSAGE_SIZE = 16*1024*1024;
+
 /* Serialization of device memory */
 
 class network_device_memory : public device_memory
@@ -64,14 +70,20 @@ public:
 	vector<char> local_data;
 };
 
-/* Remote procedure call Send */
+/* Remote procedure call Send
+ *
+ * Messages are a fixed size header holding the size of the message, followed
+ * by the name of the call and its arguments in native binary layout. Client
+ * and server are expected to run on machines with the same byte order and
+ * type sizes. Large memory buffers are sent as is after the message. */
 
 class RPCSend {
 public:
 	RPCSend(tcp::socket& socket_, const string& name_ = "")
-	: name(name_), socket(socket_), archive(archive_stream), sent(false)
+	: name(name_), socket(socket_), sent(false)
 	{
-		archive & name_;
+		data.resize(sizeof(uint64_t));
+		add(name_);
 	}
 
 	~RPCSend()
@@ -82,61 +94,62 @@ public:
 
 	void add(const device_memory& mem)
 	{
-		archive & mem.data_type & mem.data_elements & mem.data_size;
-		archive & mem.data_width & mem.data_height & mem.device_pointer;
+		add(mem.data_type); add(mem.data_elements); add(mem.data_size);
+		add(mem.data_width); add(mem.data_height); add(mem.device_pointer);
 	}
 
-	template<typename T> void add(const T& data)
+	template<typename T> void add(const T& value)
 	{
-		archive & data;
+		const char *bytes = (const char*)&value;
+		data.insert(data.end(), bytes, bytes + sizeof(T));
 	}
 
-	void add(const DeviceTask& task)
+	void add(const string& str)
 	{
-		int type = (int)task.type;
+		add((uint)str.size());
+		data.insert(data.end(), str.begin(), str.end());
+	}
 
-		archive & type & task.x & task.y & task.w & task.h;
-		archive & task.rgba & task.buffer & task.sample & task.num_samples;
-		archive & task.resolution & task.offset & task.stride;
-		archive & task.shader_input & task.shader_output & task.shader_eval_type;
-		archive & task.shader_x & task.shader_w;
+	void add(const DeviceTask& task)
+	{
+		add((int)task.type);
+		add(task.x); add(task.y); add(task.w); add(task.h);
+		add(task.rgba); add(task.buffer); add(task.sample); add(task.num_samples);
+		add(task.resolution); add(task.offset); add(task.stride);
+		add(task.shader_input); add(task.shader_output); add(task.shader_eval_type);
+		add(task.shader_x); add(task.shader_w);
+		add(task.adaptive_threshold); add(task.adaptive_min_samples);
 	}
 
 	void add(const RenderTile& tile)
 	{
-		archive & tile.x & tile.y & tile.w & tile.h;
-		archive & tile.start_sample & tile.num_samples & tile.sample;
-		archive & tile.resolution & tile.offset & tile.stride;
-		archive & tile.buffer & tile.rng_state & tile.rgba;
+		add(tile.x); add(tile.y); add(tile.w); add(tile.h);
+		add(tile.start_sample); add(tile.num_samples); add(tile.sample);
+		add(tile.resolution); add(tile.offset); add(tile.stride);
+		add(tile.buffer); add(tile.rng_state); add(tile.rgba);
 	}
 
 	void write()
 	{
 		boost::system::error_code error;
 
-		/* get string from stream */
-		string archive_str = archive_stream.str();
+		/* closed after a failed handshake, error is already reported */
+		if(!socket.is_open()) {
+			sent = true;
+			return;
+		}
 
-		/* first send fixed size header with size of following data */
-		ostringstream header_stream;
-		header_stream << setw(8) << hex << archive_str.size();
-		string header_str = header_stream.str();
+		/* fill in header with size of following data, and send all at once */
+		uint64_t size = data.size() - sizeof(uint64_t);
+		memcpy(&data[0], &size, sizeof(uint64_t));
 
 		boost::asio::write(socket,
-			boost::asio::buffer(header_str),
+			boost::asio::buffer(data),
 			boost::asio::transfer_all(), error);
 
 		if(error.value())
 			cout << "Network send error: " << error.message() << "\n";
 
-		/* then send actual data */
-		boost::asio::write(socket,
-			boost::asio::buffer(archive_str),
-			boost::asio::transfer_all(), error);
-		
-		if(error.value())
-			cout << "Network send error: " << error.message() << "\n";
-
 		sent = true;
 	}
 
@@ -144,6 +157,9 @@ public:
 	{
 		boost::system::error_code error;
 
+		if(!socket.is_open())
+			return;
+
 		boost::asio::write(socket,
 			boost::asio::buffer(buffer, size),
 			boost::asio::transfer_all(), error);
@@ -155,8 +171,7 @@ public:
 protected:
 	string name;
 	tcp::socket& socket;
-	ostringstream archive_stream;
-	boost::archive::text_oarchive archive;
+	vector<char> data;
 	bool sent;
 };
 
@@ -165,102 +180,116 @@ protected:
 class RPCReceive {
 public:
 	RPCReceive(tcp::socket& socket_)
-	: socket(socket_), archive_stream(NULL), archive(NULL)
+	: failed(false), socket(socket_), pos(0)
 	{
-		/* read head with fixed size */
-		vector<char> header(8);
-		size_t len = boost::asio::read(socket, boost::asio::buffer(header));
+		/* read head with fixed size, errors are reported through the failed
+		 * flag rather than exceptions, as this runs on device task threads */
+		uint64_t data_size;
+		boost::system::error_code error;
+		size_t len = boost::asio::read(socket, boost::asio::buffer(&data_size, sizeof(data_size)), error);
 
 		/* verify if we got something */
-		if(len == header.size()) {
-			/* decode header */
-			string header_str(&header[0], header.size());
-			istringstream header_stream(header_str);
-
-			size_t data_size;
-
-			if((header_stream >> hex >> data_size)) {
-				vector<char> data(data_size);
-				size_t len = boost::asio::read(socket, boost::asio::buffer(data));
-
-				if(len == data_size) {
-					archive_str = (data.size())? string(&data[0], data.size()): string("");
-#if 0
-					istringstream archive_stream(archive_str);
-					boost::archive::text_iarchive archive(archive_stream);
-#endif
-					archive_stream = new istringstream(archive_str);
-					archive = new boost::archive::text_iarchive(*archive_stream);
+		if(error || len != sizeof(data_size)) {
+			cout << "Network receive error: invalid header size\n";
+			failed = true;
+		}
+		else if(data_size > NETWORK_MAX_MESSAGE_SIZE) {
+			cout << "Network receive error: message size exceeds limit\n";
+			failed = true;
+		}
+		else {
+			data.resize(data_size);
+			len = (data_size)? boost::asio::read(socket, boost::asio::buffer(data), error): 0;
 
-					*archive & name;
-				}
-				else
-					cout << "Network receive error: data size doens't match header\n";
+			if(!error && len == data_size)
+				read(name);
+			else {
+				cout << "Network receive error: data size doesn't match header\n";
+				failed = true;
 			}
-			else
-				cout << "Network receive error: can't decode data size from header\n";
 		}
-		else
-			cout << "Network receive error: invalid header size\n";
-	}
-
-	~RPCReceive()
-	{
-		delete archive;
-		delete archive_stream;
 	}
 
 	void read(network_device_memory& mem)
 	{
-		*archive & mem.data_type & mem.data_elements & mem.data_size;
-		*archive & mem.data_width & mem.data_height & mem.device_pointer;
+		read(mem.data_type); read(mem.data_elements); read(mem.data_size);
+		read(mem.data_width); read(mem.data_height); read(mem.device_pointer);
 
 		mem.data_pointer = 0;
 	}
 
-	template<typename T> void read(T& data)
+	template<typename T> void read(T& value)
 	{
-		*archive & data;
+		if(pos + sizeof(T) <= data.size()) {
+			memcpy(&value, &data[pos], sizeof(T));
+			pos += sizeof(T);
+		}
+		else {
+			cout << "Network receive error: read past end of message\n";
+			memset(&value, 0, sizeof(T));
+		}
 	}
 
-	void read_buffer(void *buffer, size_t size)
+	void read(string& str)
 	{
-		size_t len = boost::asio::read(socket, boost::asio::buffer(buffer, size));
+		uint len = 0;
+		read(len);
 
-		if(len != size)
+		if(pos + len <= data.size()) {
+			str = string(data.begin() + pos, data.begin() + pos + len);
+			pos += len;
+		}
+		else {
+			cout << "Network receive error: read past end of message\n";
+			str = "";
+		}
+	}
+
+	bool read_buffer(void *buffer, size_t size)
+	{
+		boost::system::error_code error;
+		size_t len = boost::asio::read(socket, boost::asio::buffer(buffer, size), error);
+
+		if(error || len != size) {
 			cout << "Network receive error: buffer size doesn't match expected size\n";
+			failed = true;
+		}
+
+		return !failed;
 	}
 
 	void read(DeviceTask& task)
 	{
 		int type;
 
-		*archive & type & task.x & task.y & task.w & task.h;
-		*archive & task.rgba & task.buffer & task.sample & task.num_samples;
-		*archive & task.resolution & task.offset & task.stride;
-		*archive & task.shader_input & task.shader_output & task.shader_eval_type;
-		*archive & task.shader_x & task.shader_w;
+		read(type);
+		read(task.x); read(task.y); read(task.w); read(task.h);
+		read(task.rgba); read(task.buffer); read(task.sample); read(task.num_samples);
+		read(task.resolution); read(task.offset); read(task.stride);
+		read(task.shader_input); read(task.shader_output); read(task.shader_eval_type);
+		read(task.shader_x); read(task.shader_w);
+		read(task.adaptive_threshold); read(task.adaptive_min_samples);
 
 		task.type = (DeviceTask::Type)type;
 	}
 
 	void read(RenderTile& tile)
 	{
-		*archive & tile.x & tile.y & tile.w & tile.h;
-		*archive & tile.start_sample & tile.num_samples & tile.sample;
-		*archive & tile.resolution & tile.offset & tile.stride;
-		*archive & tile.buffer & tile.rng_state & tile.rgba;
+		read(tile.x); read(tile.y); read(tile.w); read(tile.h);
+		read(tile.start_sample); read(tile.num_samples); read(tile.sample);
+		read(tile.resolution); read(tile.offset); read(tile.stride);
+		read(tile.buffer); read(tile.rng_state); read(tile.rgba);
 
 		tile.buffers = NULL;
 	}
 
 	string name;
+	bool failed;
 
 protected:
 	tcp::socket& socket;
-	string archive_str;
-	istringstream *archive_stream;
-	boost::archive::text_iarchive *archive;
+	vector<char> data;
+	size_t pos;
 };
 
 /* Server auto discovery */
@@ -66,6 +66,11 @@ public:
 	boost::function<bool(void)> get_cancel;
 
 	bool need_finish_queue;
+
+	/* adaptive sampling, tiles stop once their pixels converged below the
+	 * threshold, zero disables */
+	float adaptive_threshold;
+	int adaptive_min_samples;
 protected:
 	double last_update_time;
 };
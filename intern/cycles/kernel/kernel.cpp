@@ -52,6 +52,51 @@ void kernel_tex_copy(KernelGlobals *kg, const char *name, device_ptr mem, size_t
 #define KERNEL_IMAGE_TEX(type, ttype, tname)
 #include "kernel_textures.h"
 
+	else if(strstr(name, "__tex_image_half4")) {
+		texture_image_half4 *tex = NULL;
+		int id = atoi(name + strlen("__tex_image_half4_"));
+		int array_index = id - TEX_IMAGE_HALF4_START_CPU;
+
+		if (array_index >= 0 && array_index < TEX_NUM_HALF4_IMAGES_CPU) {
+			tex = &kg->texture_half4_images[array_index];
+		}
+
+		if(tex) {
+			tex->data = (half4*)mem;
+			tex->width = width;
+			tex->height = height;
+		}
+	}
+	else if(strstr(name, "__tex_image_float1")) {
+		texture_image_float *tex = NULL;
+		int id = atoi(name + strlen("__tex_image_float1_"));
+		int array_index = id - TEX_IMAGE_FLOAT1_START_CPU;
+
+		if (array_index >= 0 && array_index < TEX_NUM_FLOAT1_IMAGES_CPU) {
+			tex = &kg->texture_float1_images[array_index];
+		}
+
+		if(tex) {
+			tex->data = (float*)mem;
+			tex->width = width;
+			tex->height = height;
+		}
+	}
+	else if(strstr(name, "__tex_image_byte1")) {
+		texture_image_uchar *tex = NULL;
+		int id = atoi(name + strlen("__tex_image_byte1_"));
+		int array_index = id - TEX_IMAGE_BYTE1_START_CPU;
+
+		if (array_index >= 0 && array_index < TEX_NUM_BYTE1_IMAGES_CPU) {
+			tex = &kg->texture_byte1_images[array_index];
+		}
+
+		if(tex) {
+			tex->data = (uchar*)mem;
+			tex->width = width;
+			tex->height = height;
+		}
+	}
 	else if(strstr(name, "__tex_image_float")) {
 		texture_image_float4 *tex = NULL;
 		int id = atoi(name + strlen("__tex_image_float_"));
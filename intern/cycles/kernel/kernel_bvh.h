@@ -15,6 +15,10 @@
  * limitations under the License.
  */
 
+#ifdef __QBVH__
+#include <emmintrin.h>
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 /*
@@ -42,6 +46,17 @@ CCL_NAMESPACE_BEGIN
 #define NO_EXTENDED_PRECISION volatile
 #endif
 
+/* traversal counters for the debug passes */
+#ifdef __KERNEL_DEBUG__
+#define BVH_DEBUG_INIT(isect) { (isect)->num_traversal_steps = 0; (isect)->num_intersections = 0; }
+#define BVH_DEBUG_TRAVERSAL_STEP(isect) (isect)->num_traversal_steps++
+#define BVH_DEBUG_INTERSECTION(isect) (isect)->num_intersections++
+#else
+#define BVH_DEBUG_INIT(isect)
+#define BVH_DEBUG_TRAVERSAL_STEP(isect)
+#define BVH_DEBUG_INTERSECTION(isect)
+#endif
+
 __device_inline float3 bvh_inverse_direction(float3 dir)
 {
 	/* avoid divide by zero (ooeps = exp2f(-80.0f)) */
@@ -164,6 +179,8 @@ __device_inline void bvh_node_intersect(KernelGlobals *kg,
 __device_inline void bvh_triangle_intersect(KernelGlobals *kg, Intersection *isect,
 	float3 P, float3 idir, uint visibility, int object, int triAddr)
 {
+	BVH_DEBUG_INTERSECTION(isect);
+
 	/* compute and check intersection t-value */
 	float4 v00 = kernel_tex_fetch(__tri_woop, triAddr*TRI_NODE_SIZE+0);
 	float4 v11 = kernel_tex_fetch(__tri_woop, triAddr*TRI_NODE_SIZE+1);
@@ -259,6 +276,8 @@ __device_inline void curvebounds(float *lower, float *upper, float *extremta, fl
 __device_inline void bvh_cardinal_curve_intersect(KernelGlobals *kg, Intersection *isect,
 	float3 P, float3 idir, uint visibility, int object, int curveAddr, int segment)
 {
+	BVH_DEBUG_INTERSECTION(isect);
+
 	int depth = kernel_data.curve_kernel_data.subdivisions;
 
 	/* curve Intersection check */
@@ -520,6 +539,8 @@ __device_inline void bvh_cardinal_curve_intersect(KernelGlobals *kg, Intersectio
 __device_inline void bvh_curve_intersect(KernelGlobals *kg, Intersection *isect,
 	float3 P, float3 idir, uint visibility, int object, int curveAddr, int segment)
 {
+	BVH_DEBUG_INTERSECTION(isect);
+
 	/* curve Intersection check */
 	
 	int flags = kernel_data.curve_kernel_data.curveflags;
@@ -655,6 +676,47 @@ __device_inline void bvh_curve_intersect(KernelGlobals *kg, Intersection *isect,
 }
 #endif
 
+/* Leaf Intersection
+ *
+ * Leaves contain either triangles or curve segments, so the primitive type and
+ * curve interpolation are tested once per leaf. Returns true if a shadow ray
+ * can terminate early. */
+
+__device_inline bool bvh_leaf_intersect(KernelGlobals *kg, Intersection *isect,
+	float3 P, float3 idir, uint visibility, int object, int primAddr, int primAddr2, int leafType)
+{
+#ifdef __HAIR__
+	if(leafType == BVH_LEAF_CURVE) {
+		bool interpolate = (kernel_data.curve_kernel_data.curveflags & CURVE_KN_INTERPOLATE) != 0;
+
+		for(; primAddr < primAddr2; primAddr++) {
+			uint segment = kernel_tex_fetch(__prim_segment, primAddr);
+
+			if(interpolate)
+				bvh_cardinal_curve_intersect(kg, isect, P, idir, visibility, object, primAddr, segment);
+			else
+				bvh_curve_intersect(kg, isect, P, idir, visibility, object, primAddr, segment);
+
+			/* shadow ray early termination */
+			if(visibility == PATH_RAY_SHADOW_OPAQUE && isect->prim != ~0)
+				return true;
+		}
+
+		return false;
+	}
+#endif
+
+	for(; primAddr < primAddr2; primAddr++) {
+		bvh_triangle_intersect(kg, isect, P, idir, visibility, object, primAddr);
+
+		/* shadow ray early termination */
+		if(visibility == PATH_RAY_SHADOW_OPAQUE && isect->prim != ~0)
+			return true;
+	}
+
+	return false;
+}
+
 __device bool bvh_intersect(KernelGlobals *kg, const Ray *ray, const uint visibility, Intersection *isect)
 {
 	/* traversal stack in CUDA thread-local memory */
@@ -676,6 +738,7 @@ __device bool bvh_intersect(KernelGlobals *kg, const Ray *ray, const uint visibi
 	isect->prim = ~0;
 	isect->u = 0.0f;
 	isect->v = 0.0f;
+	BVH_DEBUG_INIT(isect);
 
 	/* traversal loop */
 	do {
@@ -687,6 +750,8 @@ __device bool bvh_intersect(KernelGlobals *kg, const Ray *ray, const uint visibi
 				bool traverseChild0, traverseChild1, closestChild1;
 				int nodeAddrChild1;
 
+				BVH_DEBUG_TRAVERSAL_STEP(isect);
+
 				bvh_node_intersect(kg, &traverseChild0, &traverseChild1,
 					&closestChild1, &nodeAddr, &nodeAddrChild1,
 					P, idir, isect->t, visibility, nodeAddr);
@@ -732,26 +797,8 @@ __device bool bvh_intersect(KernelGlobals *kg, const Ray *ray, const uint visibi
 					--stackPtr;
 
 					/* primitive intersection */
-					while(primAddr < primAddr2) {
-						/* intersect ray against primitive */
-#ifdef __HAIR__
-						uint segment = kernel_tex_fetch(__prim_segment, primAddr);
-						if(segment != ~0) {
-							if(kernel_data.curve_kernel_data.curveflags & CURVE_KN_INTERPOLATE) 
-								bvh_cardinal_curve_intersect(kg, isect, P, idir, visibility, object, primAddr, segment);
-							else
-								bvh_curve_intersect(kg, isect, P, idir, visibility, object, primAddr, segment);
-						}
-						else
-#endif
-							bvh_triangle_intersect(kg, isect, P, idir, visibility, object, primAddr);
-
-						/* shadow ray early termination */
-						if(visibility == PATH_RAY_SHADOW_OPAQUE && isect->prim != ~0)
-							return true;
-
-						primAddr++;
-					}
+					if(bvh_leaf_intersect(kg, isect, P, idir, visibility, object, primAddr, primAddr2, __float_as_int(leaf.w)))
+						return true;
 #ifdef __INSTANCING__
 				}
 				else {
@@ -808,6 +855,7 @@ __device bool bvh_intersect_motion(KernelGlobals *kg, const Ray *ray, const uint
 	isect->prim = ~0;
 	isect->u = 0.0f;
 	isect->v = 0.0f;
+	BVH_DEBUG_INIT(isect);
 
 	/* traversal loop */
 	do {
@@ -819,6 +867,8 @@ __device bool bvh_intersect_motion(KernelGlobals *kg, const Ray *ray, const uint
 				bool traverseChild0, traverseChild1, closestChild1;
 				int nodeAddrChild1;
 
+				BVH_DEBUG_TRAVERSAL_STEP(isect);
+
 				bvh_node_intersect(kg, &traverseChild0, &traverseChild1,
 					&closestChild1, &nodeAddr, &nodeAddrChild1,
 					P, idir, isect->t, visibility, nodeAddr);
@@ -862,26 +912,8 @@ __device bool bvh_intersect_motion(KernelGlobals *kg, const Ray *ray, const uint
 					--stackPtr;
 
 					/* primitive intersection */
-					while(primAddr < primAddr2) {
-						/* intersect ray against primitive */
-#ifdef __HAIR__
-						uint segment = kernel_tex_fetch(__prim_segment, primAddr);
-						if(segment != ~0) {
-							if(kernel_data.curve_kernel_data.curveflags & CURVE_KN_INTERPOLATE) 
-								bvh_cardinal_curve_intersect(kg, isect, P, idir, visibility, object, primAddr, segment);
-							else
-								bvh_curve_intersect(kg, isect, P, idir, visibility, object, primAddr, segment);
-						}
-						else
-#endif
-							bvh_triangle_intersect(kg, isect, P, idir, visibility, object, primAddr);
-
-						/* shadow ray early termination */
-						if(visibility == PATH_RAY_SHADOW_OPAQUE && isect->prim != ~0)
-							return true;
-
-						primAddr++;
-					}
+					if(bvh_leaf_intersect(kg, isect, P, idir, visibility, object, primAddr, primAddr2, __float_as_int(leaf.w)))
+						return true;
 				}
 				else {
 					/* instance push */
@@ -911,18 +943,59 @@ __device bool bvh_intersect_motion(KernelGlobals *kg, const Ray *ray, const uint
 }
 #endif
 
+#ifdef __QBVH__
+CCL_NAMESPACE_END
+
+#include "kernel_qbvh.h"
+
+CCL_NAMESPACE_BEGIN
+#endif
+
 __device_inline bool scene_intersect(KernelGlobals *kg, const Ray *ray, const uint visibility, Intersection *isect)
 {
+	bool hit;
+
+#ifdef __QBVH__
+	if(kernel_data.bvh.use_qbvh)
+		hit = qbvh_intersect(kg, ray, visibility, isect);
+	else
+#endif
 #ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion)
-		return bvh_intersect_motion(kg, ray, visibility, isect);
+		hit = bvh_intersect_motion(kg, ray, visibility, isect);
 	else
-		return bvh_intersect(kg, ray, visibility, isect);
-#else
-	return bvh_intersect(kg, ray, visibility, isect);
 #endif
+		hit = bvh_intersect(kg, ray, visibility, isect);
+
+#ifdef __KERNEL_DEBUG__
+	kg->debug_data.num_bvh_traversal_steps += isect->num_traversal_steps;
+	kg->debug_data.num_bvh_intersections += isect->num_intersections;
+#endif
+
+	return hit;
 }
 
+#ifdef __RAY_PACKETS__
+__device_inline void scene_intersect_packet(KernelGlobals *kg, const Ray *rays, int num, const uint visibility, Intersection *isects)
+{
+	/* packets need the QBVH layout, otherwise fall back to single rays */
+	if(kernel_data.bvh.use_ray_packets && kernel_data.bvh.use_qbvh && num > 1) {
+		qbvh_intersect_packet(kg, rays, num, visibility, isects);
+
+#ifdef __KERNEL_DEBUG__
+		for(int i = 0; i < num; i++) {
+			kg->debug_data.num_bvh_traversal_steps += isects[i].num_traversal_steps;
+			kg->debug_data.num_bvh_intersections += isects[i].num_intersections;
+		}
+#endif
+		return;
+	}
+
+	for(int i = 0; i < num; i++)
+		scene_intersect(kg, &rays[i], visibility, &isects[i]);
+}
+#endif
+
 __device_inline float3 ray_offset(float3 P, float3 Ng)
 {
 #ifdef __INTERSECTION_REFINE__
@@ -161,6 +161,15 @@ __device_noinline float3 indirect_primitive_emission(KernelGlobals *kg, ShaderDa
 		/* multiple importance sampling, get triangle light pdf,
 		 * and compute weight with respect to BSDF pdf */
 		float pdf = triangle_light_pdf(kg, sd->Ng, sd->I, t);
+
+#ifdef __LIGHT_TREE__
+		/* light tree selection probability from the ray origin */
+		if(kernel_data.integrator.use_light_tree) {
+			int index = light_distribution_triangle_index(kg, sd->object, sd->prim);
+			pdf *= light_select_fac(kg, index, sd->P + sd->I*t);
+		}
+#endif
+
 		float mis_weight = power_heuristic(bsdf_pdf, pdf);
 
 		return L*mis_weight;
@@ -174,13 +183,16 @@ __device_noinline float3 indirect_primitive_emission(KernelGlobals *kg, ShaderDa
 __device_noinline bool indirect_lamp_emission(KernelGlobals *kg, Ray *ray, int path_flag, float bsdf_pdf, float randt, float3 *emission)
 {
 	LightSample ls;
-	int lamp = lamp_light_eval_sample(kg, randt);
+	float select_fac;
+	int lamp = lamp_light_eval_sample(kg, randt, ray->P, &select_fac);
 
 	if(lamp == ~0)
 		return false;
 
 	if(!lamp_light_eval(kg, lamp, ray->P, ray->D, ray->t, &ls))
 		return false;
+
+	ls.eval_fac /= select_fac;
 	
 	/* todo: missing texture coordinates */
 	float u = 0.0f;
@@ -18,6 +18,11 @@
 
 /* Constant Globals */
 
+#ifdef __KERNEL_CPU__
+#include "util_stats.h"
+#include "util_texture_cache.h"
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 /* On the CPU, we pass along the struct KernelGlobals to nearly everywhere in
@@ -33,12 +38,15 @@ struct OSLThreadData;
 struct OSLShadingSystem;
 #endif
 
-#define MAX_BYTE_IMAGES   512
-#define MAX_FLOAT_IMAGES  5
+#define MAX_BYTE_IMAGES   TEX_NUM_BYTE_IMAGES_CPU
+#define MAX_FLOAT_IMAGES  TEX_NUM_FLOAT_IMAGES
 
 typedef struct KernelGlobals {
 	texture_image_uchar4 texture_byte_images[MAX_BYTE_IMAGES];
 	texture_image_float4 texture_float_images[MAX_FLOAT_IMAGES];
+	texture_image_half4 texture_half4_images[TEX_NUM_HALF4_IMAGES_CPU];
+	texture_image_float texture_float1_images[TEX_NUM_FLOAT1_IMAGES_CPU];
+	texture_image_uchar texture_byte1_images[TEX_NUM_BYTE1_IMAGES_CPU];
 
 #define KERNEL_TEX(type, ttype, name) ttype name;
 #define KERNEL_IMAGE_TEX(type, ttype, name)
@@ -54,8 +62,34 @@ typedef struct KernelGlobals {
 	OSLThreadData *osl_tdata;
 #endif
 
+	/* image textures read on demand rather than stored in the arrays above */
+	TextureCache *texture_cache;
+
+	/* rays traced by this render thread */
+	RayStats ray_stats;
+
+#ifdef __KERNEL_DEBUG__
+	/* counters for the current path */
+	DebugData debug_data;
+#endif
+
 } KernelGlobals;
 
+/* image slots are ranges per storage type, see kernel_types.h */
+__device_inline float4 kernel_tex_image_interp_cpu(KernelGlobals *kg, int id, float x, float y)
+{
+	if(id < MAX_FLOAT_IMAGES)
+		return kg->texture_float_images[id].interp(x, y);
+	else if(id < TEX_IMAGE_HALF4_START_CPU)
+		return kg->texture_byte_images[id - MAX_FLOAT_IMAGES].interp(x, y);
+	else if(id < TEX_IMAGE_FLOAT1_START_CPU)
+		return kg->texture_half4_images[id - TEX_IMAGE_HALF4_START_CPU].interp(x, y);
+	else if(id < TEX_IMAGE_BYTE1_START_CPU)
+		return kg->texture_float1_images[id - TEX_IMAGE_FLOAT1_START_CPU].interp(x, y);
+	else
+		return kg->texture_byte1_images[id - TEX_IMAGE_BYTE1_START_CPU].interp(x, y);
+}
+
 #endif
 
 /* For CUDA, constant memory textures must be globals, so we can't put them
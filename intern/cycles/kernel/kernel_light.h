@@ -545,12 +545,227 @@ __device int light_distribution_sample(KernelGlobals *kg, float randt)
 	return clamp(first-1, 0, kernel_data.integrator.num_distribution-1);
 }
 
+/* Light Tree */
+
+#ifdef __LIGHT_TREE__
+
+__device float light_distribution_weight(KernelGlobals *kg, int index)
+{
+	return kernel_tex_fetch(__light_distribution, index + 1).x - kernel_tex_fetch(__light_distribution, index).x;
+}
+
+__device float light_tree_node_importance(KernelGlobals *kg, int node, float3 P)
+{
+	float4 n0 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 0);
+	float4 n1 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 1);
+
+	float3 bmin = make_float3(n0.x, n0.y, n0.z);
+	float3 bmax = make_float3(n1.x, n1.y, n1.z);
+
+	/* energy falling off with squared distance to the center of the bounds,
+	 * clamped to the bounds size so nodes containing P don't blow up */
+	float dist_sq = len_squared(P - 0.5f*(bmin + bmax));
+	float radius_sq = 0.25f*len_squared(bmax - bmin);
+
+	return n0.w/max(max(dist_sq, radius_sq), 1e-8f);
+}
+
+__device float light_tree_left_probability(KernelGlobals *kg, int node, int right, float3 P)
+{
+	float left_importance = light_tree_node_importance(kg, node + 1, P);
+	float right_importance = light_tree_node_importance(kg, right, P);
+	float total = left_importance + right_importance;
+
+	return (total > 0.0f)? left_importance/total: 0.5f;
+}
+
+__device int light_tree_sample_range(KernelGlobals *kg, float randt, int first, int num, float *pdf)
+{
+	/* pick an emitter in a leaf proportional to its weight in the distribution */
+	float total = 0.0f;
+
+	for(int i = 0; i < num; i++)
+		total += light_distribution_weight(kg, (int)kernel_tex_fetch(__light_tree_emitters, first + i));
+
+	float r = randt*total;
+
+	for(int i = 0; i < num; i++) {
+		int index = (int)kernel_tex_fetch(__light_tree_emitters, first + i);
+		float weight = light_distribution_weight(kg, index);
+
+		if(r < weight || i == num - 1) {
+			*pdf *= (total > 0.0f)? weight/total: 1.0f/num;
+			return index;
+		}
+
+		r -= weight;
+	}
+
+	return 0;
+}
+
+__device int light_tree_sample(KernelGlobals *kg, float randt, float3 P, float *pdf)
+{
+	int num_emitters = kernel_data.integrator.light_tree_num_emitters;
+	float pdf_tree = kernel_data.integrator.light_tree_pdf;
+
+	if(randt >= pdf_tree) {
+		/* distant and background lights are stored after the tree emitters */
+		*pdf = 1.0f - pdf_tree;
+		randt = (randt - pdf_tree)/(1.0f - pdf_tree);
+
+		return light_tree_sample_range(kg, randt, num_emitters, kernel_data.integrator.num_distribution - num_emitters, pdf);
+	}
+
+	*pdf = pdf_tree;
+	randt = randt/pdf_tree;
+
+	/* descend, reusing the random number at each level */
+	int node = 0;
+
+	while(1) {
+		float4 n2 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2);
+		int right = __float_as_int(n2.z);
+
+		if(right == -1)
+			return light_tree_sample_range(kg, min(randt, 1.0f - FLT_EPSILON), __float_as_int(n2.x), __float_as_int(n2.y), pdf);
+
+		float p_left = light_tree_left_probability(kg, node, right, P);
+
+		if(randt < p_left) {
+			randt = randt/p_left;
+			*pdf *= p_left;
+			node = node + 1;
+		}
+		else {
+			randt = (randt - p_left)/(1.0f - p_left);
+			*pdf *= 1.0f - p_left;
+			node = right;
+		}
+	}
+}
+
+__device float light_tree_pdf(KernelGlobals *kg, int index, float3 P)
+{
+	int num_emitters = kernel_data.integrator.light_tree_num_emitters;
+	float pdf_tree = kernel_data.integrator.light_tree_pdf;
+	int position = (int)kernel_tex_fetch(__light_tree_position, index);
+	int first, num;
+	float pdf;
+
+	if(position >= num_emitters) {
+		pdf = 1.0f - pdf_tree;
+		first = num_emitters;
+		num = kernel_data.integrator.num_distribution - num_emitters;
+	}
+	else {
+		/* follow the path to the leaf containing the emitter */
+		int node = 0;
+		pdf = pdf_tree;
+
+		while(1) {
+			float4 n2 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2);
+			int right = __float_as_int(n2.z);
+
+			if(right == -1) {
+				first = __float_as_int(n2.x);
+				num = __float_as_int(n2.y);
+				break;
+			}
+
+			float p_left = light_tree_left_probability(kg, node, right, P);
+			float4 left2 = kernel_tex_fetch(__light_tree_nodes, (node + 1)*LIGHT_TREE_NODE_SIZE + 2);
+
+			if(position < __float_as_int(left2.x) + __float_as_int(left2.y)) {
+				pdf *= p_left;
+				node = node + 1;
+			}
+			else {
+				pdf *= 1.0f - p_left;
+				node = right;
+			}
+		}
+	}
+
+	float total = 0.0f;
+
+	for(int i = 0; i < num; i++)
+		total += light_distribution_weight(kg, (int)kernel_tex_fetch(__light_tree_emitters, first + i));
+
+	return pdf*((total > 0.0f)? light_distribution_weight(kg, index)/total: 1.0f/num);
+}
+
+__device int light_distribution_triangle_index(KernelGlobals *kg, int object, int prim)
+{
+	/* triangles come first in the distribution, ordered by object and then
+	 * by primitive, so we can find them with a binary search */
+	int first = 0;
+	int len = kernel_data.integrator.num_distribution - kernel_data.integrator.num_all_lights;
+
+	while(len > 0) {
+		int half_len = len >> 1;
+		int middle = first + half_len;
+
+		float4 l = kernel_tex_fetch(__light_distribution, middle);
+		int l_object = __float_as_int(l.w);
+		int l_prim = __float_as_int(l.y);
+
+		if(l_object < 0)
+			l_object = ~l_object;
+
+		if(l_object < object || (l_object == object && l_prim < prim)) {
+			first = middle + 1;
+			len = len - half_len - 1;
+		}
+		else {
+			len = half_len;
+		}
+	}
+
+	return first;
+}
+
+#endif
+
+__device int light_select_index(KernelGlobals *kg, float randt, float3 P, float *select_fac)
+{
+	/* select_fac is the probability of picking this light relative to the
+	 * probability it has in the distribution, which the pdfs assume */
+	*select_fac = 1.0f;
+
+#ifdef __LIGHT_TREE__
+	if(kernel_data.integrator.use_light_tree) {
+		float pdf;
+		int index = light_tree_sample(kg, randt, P, &pdf);
+		float weight = light_distribution_weight(kg, index);
+
+		*select_fac = (weight > 0.0f)? pdf/weight: 0.0f;
+		return index;
+	}
+#endif
+
+	return light_distribution_sample(kg, randt);
+}
+
+__device float light_select_fac(KernelGlobals *kg, int index, float3 P)
+{
+#ifdef __LIGHT_TREE__
+	if(kernel_data.integrator.use_light_tree) {
+		float weight = light_distribution_weight(kg, index);
+		return (weight > 0.0f)? light_tree_pdf(kg, index, P)/weight: 0.0f;
+	}
+#endif
+
+	return 1.0f;
+}
+
 /* Generic Light */
 
 __device void light_sample(KernelGlobals *kg, float randt, float randu, float randv, float time, float3 P, LightSample *ls)
 {
 	/* sample index */
-	int index = light_distribution_sample(kg, randt);
+	float select_fac;
+	int index = light_select_index(kg, randt, P, &select_fac);
 
 	/* fetch light data */
 	float4 l = kernel_tex_fetch(__light_distribution, index);
@@ -571,11 +786,16 @@ __device void light_sample(KernelGlobals *kg, float randt, float randu, float ra
 
 		/* compute incoming direction, distance and pdf */
 		ls->D = normalize_len(ls->P - P, &ls->t);
-		ls->pdf = triangle_light_pdf(kg, ls->Ng, -ls->D, ls->t);
+		ls->pdf = triangle_light_pdf(kg, ls->Ng, -ls->D, ls->t)*select_fac;
 	}
 	else {
 		int lamp = -prim-1;
 		lamp_light_sample(kg, lamp, randu, randv, P, ls);
+
+		if(select_fac == 0.0f)
+			ls->pdf = 0.0f;
+		else
+			ls->eval_fac /= select_fac;
 	}
 }
 
@@ -590,16 +810,16 @@ __device void light_select(KernelGlobals *kg, int index, float randu, float rand
 	lamp_light_sample(kg, index, randu, randv, P, ls);
 }
 
-__device int lamp_light_eval_sample(KernelGlobals *kg, float randt)
+__device int lamp_light_eval_sample(KernelGlobals *kg, float randt, float3 P, float *select_fac)
 {
 	/* sample index */
-	int index = light_distribution_sample(kg, randt);
+	int index = light_select_index(kg, randt, P, select_fac);
 
 	/* fetch light data */
 	float4 l = kernel_tex_fetch(__light_distribution, index);
 	int prim = __float_as_int(l.y);
 
-	if(prim < 0) {
+	if(prim < 0 && *select_fac != 0.0f) {
 		int lamp = -prim-1;
 		return lamp;
 	}
@@ -131,5 +131,66 @@ __device_inline void kernel_write_light_passes(KernelGlobals *kg, __global float
 #endif
 }
 
+__device_inline void kernel_write_variance_pass(KernelGlobals *kg, __global float *buffer, int sample, float4 L)
+{
+#ifdef __PASSES__
+	/* sum of squared luminance, together with the combined pass this gives
+	 * a per pixel variance estimate used for adaptive sampling */
+	if(kernel_data.film.pass_flag & PASS_VARIANCE) {
+		float lum = linear_rgb_to_gray(make_float3(L.x, L.y, L.z));
+		kernel_write_pass_float(buffer + kernel_data.film.pass_variance, sample, lum*lum);
+	}
+#endif
+}
+
+#ifdef __KERNEL_DEBUG__
+
+__device_inline void kernel_debug_data_init(KernelGlobals *kg, const Intersection *camera_isect)
+{
+	DebugData *debug_data = &kg->debug_data;
+
+	/* camera rays traced as a packet were counted before integration */
+	if(camera_isect) {
+		debug_data->num_bvh_traversal_steps = camera_isect->num_traversal_steps;
+		debug_data->num_bvh_intersections = camera_isect->num_intersections;
+	}
+	else {
+		debug_data->num_bvh_traversal_steps = 0;
+		debug_data->num_bvh_intersections = 0;
+	}
+
+	debug_data->num_ray_bounces = 0;
+	debug_data->num_closures = 0;
+}
+
+__device_inline void kernel_write_debug_passes(KernelGlobals *kg, __global float *buffer, int sample)
+{
+	DebugData *debug_data = &kg->debug_data;
+	int flag = kernel_data.film.pass_flag;
+
+	if(flag & PASS_DEBUG_BVH_TRAVERSAL_STEPS)
+		kernel_write_pass_float(buffer + kernel_data.film.pass_bvh_traversal_steps,
+			sample, (float)debug_data->num_bvh_traversal_steps);
+	if(flag & PASS_DEBUG_BVH_INTERSECTIONS)
+		kernel_write_pass_float(buffer + kernel_data.film.pass_bvh_intersections,
+			sample, (float)debug_data->num_bvh_intersections);
+	if(flag & PASS_DEBUG_RAY_BOUNCES)
+		kernel_write_pass_float(buffer + kernel_data.film.pass_ray_bounces,
+			sample, (float)debug_data->num_ray_bounces);
+}
+
+__device_inline void kernel_debug_stats_add(KernelGlobals *kg)
+{
+	DebugData *debug_data = &kg->debug_data;
+	RayStats *stats = &kg->ray_stats;
+
+	/* ray counts are gathered in all builds, see kernel_path.h */
+	stats->num_closures += debug_data->num_closures;
+	stats->num_bvh_traversal_steps += debug_data->num_bvh_traversal_steps;
+	stats->num_bvh_intersections += debug_data->num_bvh_intersections;
+}
+
+#endif
+
 CCL_NAMESPACE_END
 
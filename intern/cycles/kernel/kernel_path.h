@@ -61,6 +61,13 @@ __device_inline void path_state_init(PathState *state)
 
 __device_inline void path_state_next(KernelGlobals *kg, PathState *state, int label)
 {
+#ifdef __KERNEL_CPU__
+	kg->ray_stats.num_bounce_rays++;
+#endif
+#ifdef __KERNEL_DEBUG__
+	kg->debug_data.num_ray_bounces++;
+#endif
+
 	/* ray through transparent keeps same flags from previous ray and is
 	 * not counted as a regular bounce, transparent has separate max */
 	if(label & LABEL_TRANSPARENT) {
@@ -152,18 +159,13 @@ __device_inline float path_state_terminate_probability(KernelGlobals *kg, PathSt
 	return average(throughput);
 }
 
-__device_inline bool shadow_blocked(KernelGlobals *kg, PathState *state, Ray *ray, float3 *shadow)
-{
-	*shadow = make_float3(1.0f, 1.0f, 1.0f);
-
-	if(ray->t == 0.0f)
-		return false;
-	
-	Intersection isect;
-	bool result = scene_intersect(kg, ray, PATH_RAY_SHADOW_OPAQUE, &isect);
+/* Shadow ray that hit a surface, marches on through transparent surfaces when
+ * transparent shadows are enabled. Returns true when the ray is blocked. */
 
+__device_inline bool shadow_blocked_hit(KernelGlobals *kg, PathState *state, Ray *ray, Intersection *isect, float3 *shadow)
+{
 #ifdef __TRANSPARENT_SHADOWS__
-	if(result && kernel_data.integrator.transparent_shadows) {
+	if(kernel_data.integrator.transparent_shadows) {
 		/* transparent shadows work in such a way to try to minimize overhead
 		 * in cases where we don't need them. after a regular shadow ray is
 		 * cast we check if the hit primitive was potentially transparent, and
@@ -172,7 +174,7 @@ __device_inline bool shadow_blocked(KernelGlobals *kg, PathState *state, Ray *ra
 		 *
 		 * also note that for this to work correct, multi close sampling must
 		 * be used, since we don't pass a random number to shader_eval_surface */
-		if(shader_transparent_shadow(kg, &isect)) {
+		if(shader_transparent_shadow(kg, isect)) {
 			float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
 			float3 Pend = ray->P + ray->D*ray->t;
 			int bounce = state->transparent_bounce;
@@ -194,16 +196,16 @@ __device_inline bool shadow_blocked(KernelGlobals *kg, PathState *state, Ray *ra
 #endif
 				}
 
-				if(!scene_intersect(kg, ray, PATH_RAY_SHADOW_TRANSPARENT, &isect)) {
+				if(!scene_intersect(kg, ray, PATH_RAY_SHADOW_TRANSPARENT, isect)) {
 					*shadow *= throughput;
 					return false;
 				}
 
-				if(!shader_transparent_shadow(kg, &isect))
+				if(!shader_transparent_shadow(kg, isect))
 					return true;
 
 				ShaderData sd;
-				shader_setup_from_ray(kg, &sd, &isect, ray);
+				shader_setup_from_ray(kg, &sd, isect, ray);
 				shader_eval_surface(kg, &sd, 0.0f, PATH_RAY_SHADOW, SHADER_CONTEXT_SHADOW);
 
 				throughput *= shader_bsdf_transparency(kg, &sd);
@@ -220,10 +222,91 @@ __device_inline bool shadow_blocked(KernelGlobals *kg, PathState *state, Ray *ra
 	}
 #endif
 
-	return result;
+	return true;
+}
+
+__device_inline bool shadow_blocked(KernelGlobals *kg, PathState *state, Ray *ray, float3 *shadow)
+{
+	*shadow = make_float3(1.0f, 1.0f, 1.0f);
+
+	if(ray->t == 0.0f)
+		return false;
+
+#ifdef __KERNEL_CPU__
+	kg->ray_stats.num_shadow_rays++;
+#endif
+	
+	Intersection isect;
+
+	if(!scene_intersect(kg, ray, PATH_RAY_SHADOW_OPAQUE, &isect))
+		return false;
+
+	return shadow_blocked_hit(kg, state, ray, &isect, shadow);
+}
+
+#ifdef __RAY_PACKETS__
+
+/* Direct light shadow rays from a single shading point, collected while
+ * sampling the lights and traced together as a packet. They all start from
+ * the same point, so they mostly visit the same BVH nodes. */
+
+typedef struct ShadowPacket {
+	Ray rays[RAY_PACKET_SIZE];
+	BsdfEval L_light[RAY_PACKET_SIZE];
+	float num_samples_inv[RAY_PACKET_SIZE];
+	bool is_lamp[RAY_PACKET_SIZE];
+	int num;
+} ShadowPacket;
+
+__device_inline void shadow_packet_trace(KernelGlobals *kg, ShadowPacket *packet, PathState *state,
+	PathRadiance *L, float3 throughput)
+{
+	Intersection isects[RAY_PACKET_SIZE];
+
+#ifdef __KERNEL_CPU__
+	kg->ray_stats.num_shadow_rays += packet->num;
+#endif
+
+	scene_intersect_packet(kg, packet->rays, packet->num, PATH_RAY_SHADOW_OPAQUE, isects);
+
+	for(int i = 0; i < packet->num; i++) {
+		float3 shadow = make_float3(1.0f, 1.0f, 1.0f);
+
+		if(isects[i].prim != ~0 && shadow_blocked_hit(kg, state, &packet->rays[i], &isects[i], &shadow))
+			continue;
+
+		path_radiance_accum_light(L, throughput*packet->num_samples_inv[i], &packet->L_light[i],
+			shadow, packet->num_samples_inv[i], state->bounce, packet->is_lamp[i]);
+	}
+
+	packet->num = 0;
 }
 
-__device float4 kernel_path_progressive(KernelGlobals *kg, RNG *rng, int sample, Ray ray, __global float *buffer)
+__device_inline void shadow_packet_add(KernelGlobals *kg, ShadowPacket *packet, PathState *state,
+	PathRadiance *L, float3 throughput, Ray *light_ray, BsdfEval *L_light, float num_samples_inv, bool is_lamp)
+{
+	/* zero length rays are never blocked, as in shadow_blocked */
+	if(light_ray->t == 0.0f) {
+		path_radiance_accum_light(L, throughput*num_samples_inv, L_light,
+			make_float3(1.0f, 1.0f, 1.0f), num_samples_inv, state->bounce, is_lamp);
+		return;
+	}
+
+	int i = packet->num++;
+
+	packet->rays[i] = *light_ray;
+	packet->L_light[i] = *L_light;
+	packet->num_samples_inv[i] = num_samples_inv;
+	packet->is_lamp[i] = is_lamp;
+
+	if(packet->num == RAY_PACKET_SIZE)
+		shadow_packet_trace(kg, packet, state, L, throughput);
+}
+
+#endif
+
+__device float4 kernel_path_progressive(KernelGlobals *kg, RNG *rng, int sample, Ray ray, __global float *buffer,
+	const Intersection *camera_isect)
 {
 	/* initialize */
 	PathRadiance L;
@@ -247,7 +330,18 @@ __device float4 kernel_path_progressive(KernelGlobals *kg, RNG *rng, int sample,
 		/* intersect scene */
 		Intersection isect;
 		uint visibility = path_state_ray_visibility(kg, &state);
-		bool hit = scene_intersect(kg, &ray, visibility, &isect);
+		bool hit;
+
+#ifdef __RAY_PACKETS__
+		if(camera_isect) {
+			/* camera ray was traced as part of a packet already */
+			isect = *camera_isect;
+			hit = (isect.prim != ~0);
+			camera_isect = NULL;
+		}
+		else
+#endif
+			hit = scene_intersect(kg, &ray, visibility, &isect);
 
 #ifdef __LAMP_MIS__
 		if(kernel_data.integrator.use_lamp_mis && !(state.flag & PATH_RAY_CAMERA)) {
@@ -676,7 +770,8 @@ __device void kernel_path_indirect(KernelGlobals *kg, RNG *rng, int sample, Ray
 	}
 }
 
-__device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sample, Ray ray, __global float *buffer)
+__device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sample, Ray ray, __global float *buffer,
+	const Intersection *camera_isect)
 {
 	/* initialize */
 	PathRadiance L;
@@ -695,8 +790,20 @@ __device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sam
 		/* intersect scene */
 		Intersection isect;
 		uint visibility = path_state_ray_visibility(kg, &state);
+		bool hit;
+
+#ifdef __RAY_PACKETS__
+		if(camera_isect) {
+			/* camera ray was traced as part of a packet already */
+			isect = *camera_isect;
+			hit = (isect.prim != ~0);
+			camera_isect = NULL;
+		}
+		else
+#endif
+			hit = scene_intersect(kg, &ray, visibility, &isect);
 
-		if(!scene_intersect(kg, &ray, visibility, &isect)) {
+		if(!hit) {
 			/* eval background shader if nothing hit */
 			if(kernel_data.background.transparent) {
 				L_transparent += average(throughput);
@@ -819,6 +926,11 @@ __device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sam
 			light_ray.time = sd.time;
 #endif
 
+#ifdef __RAY_PACKETS__
+			ShadowPacket shadow_packet;
+			shadow_packet.num = 0;
+#endif
+
 			/* lamp sampling */
 			for(int i = 0; i < kernel_data.integrator.num_all_lights; i++) {
 				int num_samples = light_select_num_samples(kg, i);
@@ -832,6 +944,9 @@ __device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sam
 					float light_v = path_rng(kg, rng, sample*num_samples + j, rng_offset + PRNG_LIGHT_V);
 
 					if(direct_emission(kg, &sd, i, 0.0f, 0.0f, light_u, light_v, &light_ray, &L_light, &is_lamp)) {
+#ifdef __RAY_PACKETS__
+						shadow_packet_add(kg, &shadow_packet, &state, &L, throughput, &light_ray, &L_light, num_samples_inv, is_lamp);
+#else
 						/* trace shadow ray */
 						float3 shadow;
 
@@ -839,6 +954,7 @@ __device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sam
 							/* accumulate */
 							path_radiance_accum_light(&L, throughput*num_samples_inv, &L_light, shadow, num_samples_inv, state.bounce, is_lamp);
 						}
+#endif
 					}
 				}
 			}
@@ -861,6 +977,9 @@ __device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sam
 						light_t = 0.5f*light_t;
 
 					if(direct_emission(kg, &sd, -1, light_t, 0.0f, light_u, light_v, &light_ray, &L_light, &is_lamp)) {
+#ifdef __RAY_PACKETS__
+						shadow_packet_add(kg, &shadow_packet, &state, &L, throughput, &light_ray, &L_light, num_samples_inv, is_lamp);
+#else
 						/* trace shadow ray */
 						float3 shadow;
 
@@ -868,9 +987,16 @@ __device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sam
 							/* accumulate */
 							path_radiance_accum_light(&L, throughput*num_samples_inv, &L_light, shadow, num_samples_inv, state.bounce, is_lamp);
 						}
+#endif
 					}
 				}
 			}
+
+#ifdef __RAY_PACKETS__
+			/* remaining shadow rays */
+			if(shadow_packet.num)
+				shadow_packet_trace(kg, &shadow_packet, &state, &L, throughput);
+#endif
 		}
 #endif
 
@@ -974,50 +1100,50 @@ __device float4 kernel_path_non_progressive(KernelGlobals *kg, RNG *rng, int sam
 
 #endif
 
-__device void kernel_path_trace(KernelGlobals *kg,
-	__global float *buffer, __global uint *rng_state,
-	int sample, int x, int y, int offset, int stride)
+__device_inline void kernel_path_trace_setup(KernelGlobals *kg,
+	__global uint *rng_state, int sample, int x, int y, RNG *rng, Ray *ray)
 {
-	/* buffer offset */
-	int index = offset + x + y*stride;
-	int pass_stride = kernel_data.film.pass_stride;
-
-	rng_state += index;
-	buffer += index*pass_stride;
-
 	/* initialize random numbers */
-	RNG rng;
-
 	float filter_u;
 	float filter_v;
 
-	path_rng_init(kg, rng_state, sample, &rng, x, y, &filter_u, &filter_v);
+	path_rng_init(kg, rng_state, sample, rng, x, y, &filter_u, &filter_v);
 
 	/* sample camera ray */
-	Ray ray;
-
-	float lens_u = path_rng(kg, &rng, sample, PRNG_LENS_U);
-	float lens_v = path_rng(kg, &rng, sample, PRNG_LENS_V);
+	float lens_u = path_rng(kg, rng, sample, PRNG_LENS_U);
+	float lens_v = path_rng(kg, rng, sample, PRNG_LENS_V);
 
 #ifdef __CAMERA_MOTION__
-	float time = path_rng(kg, &rng, sample, PRNG_TIME);
+	float time = path_rng(kg, rng, sample, PRNG_TIME);
 #else
 	float time = 0.0f;
 #endif
 
-	camera_sample(kg, x, y, filter_u, filter_v, lens_u, lens_v, time, &ray);
+	camera_sample(kg, x, y, filter_u, filter_v, lens_u, lens_v, time, ray);
+}
+
+__device_inline void kernel_path_trace_integrate(KernelGlobals *kg,
+	__global float *buffer, __global uint *rng_state, int sample,
+	RNG rng, Ray ray, const Intersection *camera_isect)
+{
+#ifdef __KERNEL_DEBUG__
+	kernel_debug_data_init(kg, camera_isect);
+#endif
 
 	/* integrate */
 	float4 L;
 
 	if (ray.t != 0.0f) {
+#ifdef __KERNEL_CPU__
+		kg->ray_stats.num_camera_rays++;
+#endif
 #ifdef __NON_PROGRESSIVE__
 		if(kernel_data.integrator.progressive)
 #endif
-			L = kernel_path_progressive(kg, &rng, sample, ray, buffer);
+			L = kernel_path_progressive(kg, &rng, sample, ray, buffer, camera_isect);
 #ifdef __NON_PROGRESSIVE__
 		else
-			L = kernel_path_non_progressive(kg, &rng, sample, ray, buffer);
+			L = kernel_path_non_progressive(kg, &rng, sample, ray, buffer, camera_isect);
 #endif
 	}
 	else
@@ -1025,9 +1151,73 @@ __device void kernel_path_trace(KernelGlobals *kg,
 
 	/* accumulate result in output buffer */
 	kernel_write_pass_float4(buffer, sample, L);
+	kernel_write_variance_pass(kg, buffer, sample, L);
+
+#ifdef __KERNEL_DEBUG__
+	kernel_write_debug_passes(kg, buffer, sample);
+
+	if(ray.t != 0.0f)
+		kernel_debug_stats_add(kg);
+#endif
 
 	path_rng_end(kg, rng_state, rng);
 }
 
+__device void kernel_path_trace(KernelGlobals *kg,
+	__global float *buffer, __global uint *rng_state,
+	int sample, int x, int y, int offset, int stride)
+{
+	/* buffer offset */
+	int index = offset + x + y*stride;
+	int pass_stride = kernel_data.film.pass_stride;
+
+	rng_state += index;
+	buffer += index*pass_stride;
+
+	RNG rng;
+	Ray ray;
+
+	kernel_path_trace_setup(kg, rng_state, sample, x, y, &rng, &ray);
+	kernel_path_trace_integrate(kg, buffer, rng_state, sample, rng, ray, NULL);
+}
+
+#ifdef __RAY_PACKETS__
+
+/* Trace camera rays for num pixels along x as one packet, after which each
+ * path continues with single rays. */
+
+__device void kernel_path_trace_packet(KernelGlobals *kg,
+	__global float *buffer, __global uint *rng_state,
+	int sample, int x, int y, int offset, int stride, int num)
+{
+	int pass_stride = kernel_data.film.pass_stride;
+
+	RNG rng[RAY_PACKET_SIZE];
+	Ray rays[RAY_PACKET_SIZE];
+	Intersection isects[RAY_PACKET_SIZE];
+
+	kernel_assert(num <= RAY_PACKET_SIZE);
+
+	for(int i = 0; i < num; i++) {
+		int index = offset + x + i + y*stride;
+		kernel_path_trace_setup(kg, rng_state + index, sample, x + i, y, &rng[i], &rays[i]);
+	}
+
+	/* same visibility as the first bounce in the integrator */
+	PathState state;
+	path_state_init(&state);
+	uint visibility = path_state_ray_visibility(kg, &state);
+
+	scene_intersect_packet(kg, rays, num, visibility, isects);
+
+	for(int i = 0; i < num; i++) {
+		int index = offset + x + i + y*stride;
+		kernel_path_trace_integrate(kg, buffer + index*pass_stride, rng_state + index,
+			sample, rng[i], rays[i], &isects[i]);
+	}
+}
+
+#endif
+
 CCL_NAMESPACE_END
 
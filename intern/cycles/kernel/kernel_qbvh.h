@@ -0,0 +1,435 @@
+/*
+ * Copyright 2013, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* QBVH traversal for the SSE CPU kernels
+ *
+ * Each inner node stores the bounds of its four children as rows of min/max
+ * per axis, so all four boxes are tested at once. Child indices are in row 6
+ * and child visibility in row 7, empty child slots have zero visibility. Leaf
+ * nodes store their primitive range in row 6. */
+
+/* 64 object BVH + 64 mesh BVH, with up to three children pushed per level */
+#define BVH_QSTACK_SIZE 384
+#define BVH_QNODE_SIZE 8
+
+__device_inline __m128 qbvh_node_fetch(KernelGlobals *kg, int offset)
+{
+	float4 f = kernel_tex_fetch(__bvh_nodes, offset);
+	return _mm_loadu_ps(&f.x);
+}
+
+__device_inline void qbvh_ray_setup(float3 P, float3 idir, __m128 Pidir[3], __m128 idir4[3])
+{
+	/* origin is premultiplied by the inverse direction, so the slab test is
+	 * one multiply and subtract per plane */
+	idir4[0] = _mm_set1_ps(idir.x);
+	idir4[1] = _mm_set1_ps(idir.y);
+	idir4[2] = _mm_set1_ps(idir.z);
+
+	Pidir[0] = _mm_set1_ps(P.x*idir.x);
+	Pidir[1] = _mm_set1_ps(P.y*idir.y);
+	Pidir[2] = _mm_set1_ps(P.z*idir.z);
+}
+
+__device_inline int qbvh_node_intersect(KernelGlobals *kg, float dist[4], int nodeAddr,
+	const __m128 Pidir[3], const __m128 idir4[3], float t, uint visibility)
+{
+	int offset = nodeAddr*BVH_QNODE_SIZE;
+
+	/* intersect ray against the bounding boxes of all four children */
+	__m128 lox = _mm_sub_ps(_mm_mul_ps(qbvh_node_fetch(kg, offset+0), idir4[0]), Pidir[0]);
+	__m128 hix = _mm_sub_ps(_mm_mul_ps(qbvh_node_fetch(kg, offset+1), idir4[0]), Pidir[0]);
+	__m128 loy = _mm_sub_ps(_mm_mul_ps(qbvh_node_fetch(kg, offset+2), idir4[1]), Pidir[1]);
+	__m128 hiy = _mm_sub_ps(_mm_mul_ps(qbvh_node_fetch(kg, offset+3), idir4[1]), Pidir[1]);
+	__m128 loz = _mm_sub_ps(_mm_mul_ps(qbvh_node_fetch(kg, offset+4), idir4[2]), Pidir[2]);
+	__m128 hiz = _mm_sub_ps(_mm_mul_ps(qbvh_node_fetch(kg, offset+5), idir4[2]), Pidir[2]);
+
+	__m128 tnear = _mm_max_ps(_mm_max_ps(_mm_min_ps(lox, hix), _mm_min_ps(loy, hiy)),
+	                          _mm_max_ps(_mm_min_ps(loz, hiz), _mm_setzero_ps()));
+	__m128 tfar = _mm_min_ps(_mm_min_ps(_mm_max_ps(lox, hix), _mm_max_ps(loy, hiy)),
+	                         _mm_min_ps(_mm_max_ps(loz, hiz), _mm_set1_ps(t)));
+
+	int mask = _mm_movemask_ps(_mm_cmple_ps(tnear, tfar));
+
+	/* mask out empty slots and children not visible to this ray */
+	__m128i vis = _mm_castps_si128(qbvh_node_fetch(kg, offset+7));
+#ifdef __VISIBILITY_FLAG__
+	vis = _mm_and_si128(vis, _mm_set1_epi32(visibility));
+#endif
+	mask &= ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(vis, _mm_setzero_si128())));
+
+	_mm_storeu_ps(dist, tnear);
+
+	return mask;
+}
+
+__device bool qbvh_intersect(KernelGlobals *kg, const Ray *ray, const uint visibility, Intersection *isect)
+{
+	/* traversal stack */
+	int traversalStack[BVH_QSTACK_SIZE];
+	traversalStack[0] = ENTRYPOINT_SENTINEL;
+
+	/* traversal variables */
+	int stackPtr = 0;
+	int nodeAddr = kernel_data.bvh.root;
+
+	/* ray parameters */
+	const float tmax = ray->t;
+	float3 P = ray->P;
+	float3 idir = bvh_inverse_direction(ray->D);
+	int object = ~0;
+
+#ifdef __OBJECT_MOTION__
+	Transform ob_tfm;
+#endif
+
+	__m128 Pidir[3], idir4[3];
+	qbvh_ray_setup(P, idir, Pidir, idir4);
+
+	isect->t = tmax;
+	isect->object = ~0;
+	isect->prim = ~0;
+	isect->u = 0.0f;
+	isect->v = 0.0f;
+	BVH_DEBUG_INIT(isect);
+
+	/* traversal loop */
+	do {
+		do
+		{
+			/* traverse internal nodes */
+			while(nodeAddr >= 0 && nodeAddr != ENTRYPOINT_SENTINEL)
+			{
+				float dist[4];
+
+				BVH_DEBUG_TRAVERSAL_STEP(isect);
+
+				int mask = qbvh_node_intersect(kg, dist, nodeAddr, Pidir, idir4, isect->t, visibility);
+
+				if(mask == 0) {
+					/* no children were intersected */
+					nodeAddr = traversalStack[stackPtr];
+					--stackPtr;
+					continue;
+				}
+
+				float4 cnodes = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_QNODE_SIZE+6);
+
+				/* sort intersected children far to near */
+				int childAddr[4];
+				float childDist[4];
+				int num = 0;
+
+				for(int i = 0; i < 4; i++) {
+					if(mask & (1 << i)) {
+						int j = num++;
+
+						while(j > 0 && childDist[j-1] < dist[i]) {
+							childAddr[j] = childAddr[j-1];
+							childDist[j] = childDist[j-1];
+							j--;
+						}
+
+						childAddr[j] = __float_as_int(cnodes[i]);
+						childDist[j] = dist[i];
+					}
+				}
+
+				/* push the farther children, continue with the closest */
+				for(int i = 0; i < num-1; i++) {
+					++stackPtr;
+					traversalStack[stackPtr] = childAddr[i];
+				}
+
+				nodeAddr = childAddr[num-1];
+			}
+
+			/* if node is leaf, fetch triangle list */
+			if(nodeAddr < 0) {
+				float4 leaf = kernel_tex_fetch(__bvh_nodes, (-nodeAddr-1)*BVH_QNODE_SIZE+6);
+				int primAddr = __float_as_int(leaf.x);
+
+#ifdef __INSTANCING__
+				if(primAddr >= 0) {
+#endif
+					int primAddr2 = __float_as_int(leaf.y);
+
+					/* pop */
+					nodeAddr = traversalStack[stackPtr];
+					--stackPtr;
+
+					/* primitive intersection */
+					if(bvh_leaf_intersect(kg, isect, P, idir, visibility, object, primAddr, primAddr2, __float_as_int(leaf.z)))
+						return true;
+#ifdef __INSTANCING__
+				}
+				else {
+					/* instance push */
+					object = kernel_tex_fetch(__prim_object, -primAddr-1);
+
+#ifdef __OBJECT_MOTION__
+					if(kernel_data.bvh.have_motion)
+						bvh_instance_motion_push(kg, object, ray, &P, &idir, &isect->t, &ob_tfm, tmax);
+					else
+#endif
+						bvh_instance_push(kg, object, ray, &P, &idir, &isect->t, tmax);
+
+					qbvh_ray_setup(P, idir, Pidir, idir4);
+
+					++stackPtr;
+					traversalStack[stackPtr] = ENTRYPOINT_SENTINEL;
+
+					nodeAddr = kernel_tex_fetch(__object_node, object);
+				}
+#endif
+			}
+		} while(nodeAddr != ENTRYPOINT_SENTINEL);
+
+#ifdef __INSTANCING__
+		if(stackPtr >= 0) {
+			kernel_assert(object != ~0);
+
+			/* instance pop */
+#ifdef __OBJECT_MOTION__
+			if(kernel_data.bvh.have_motion)
+				bvh_instance_motion_pop(kg, object, ray, &P, &idir, &isect->t, &ob_tfm, tmax);
+			else
+#endif
+				bvh_instance_pop(kg, object, ray, &P, &idir, &isect->t, tmax);
+
+			qbvh_ray_setup(P, idir, Pidir, idir4);
+
+			object = ~0;
+			nodeAddr = traversalStack[stackPtr];
+			--stackPtr;
+		}
+#endif
+	} while(nodeAddr != ENTRYPOINT_SENTINEL);
+
+	return (isect->prim != ~0);
+}
+
+#ifdef __RAY_PACKETS__
+
+/* Packet traversal, for coherent rays like camera rays from neighbouring
+ * pixels. Nodes are fetched once for all rays in the packet, and each stack
+ * entry stores the mask of rays that still need to visit it. */
+
+__device void qbvh_intersect_packet(KernelGlobals *kg, const Ray *rays, int num, const uint visibility, Intersection *isects)
+{
+	/* traversal stack, with ray masks */
+	int traversalStack[BVH_QSTACK_SIZE];
+	int traversalMask[BVH_QSTACK_SIZE];
+	traversalStack[0] = ENTRYPOINT_SENTINEL;
+	traversalMask[0] = 0;
+
+	/* traversal variables */
+	int stackPtr = 0;
+	int nodeAddr = kernel_data.bvh.root;
+	int active = (1 << num) - 1;
+	int done = 0;
+	int object = ~0;
+
+	/* ray parameters */
+	float3 P[RAY_PACKET_SIZE], idir[RAY_PACKET_SIZE];
+	__m128 Pidir[RAY_PACKET_SIZE][3], idir4[RAY_PACKET_SIZE][3];
+
+#ifdef __OBJECT_MOTION__
+	Transform ob_tfm[RAY_PACKET_SIZE];
+#endif
+
+	for(int r = 0; r < num; r++) {
+		P[r] = rays[r].P;
+		idir[r] = bvh_inverse_direction(rays[r].D);
+		qbvh_ray_setup(P[r], idir[r], Pidir[r], idir4[r]);
+
+		isects[r].t = rays[r].t;
+		isects[r].object = ~0;
+		isects[r].prim = ~0;
+		isects[r].u = 0.0f;
+		isects[r].v = 0.0f;
+		BVH_DEBUG_INIT(&isects[r]);
+	}
+
+	/* traversal loop */
+	do {
+		do
+		{
+			/* traverse internal nodes */
+			while(nodeAddr >= 0 && nodeAddr != ENTRYPOINT_SENTINEL)
+			{
+				/* intersect active rays, children are ordered by the
+				 * nearest distance of any ray */
+				int childMask[4] = {0, 0, 0, 0};
+				float dist[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+
+				active &= ~done;
+
+				for(int r = 0; r < num; r++) {
+					if(!(active & (1 << r)))
+						continue;
+
+					float rdist[4];
+
+					BVH_DEBUG_TRAVERSAL_STEP(&isects[r]);
+
+					int mask = qbvh_node_intersect(kg, rdist, nodeAddr, Pidir[r], idir4[r], isects[r].t, visibility);
+
+					for(int i = 0; i < 4; i++) {
+						if(mask & (1 << i)) {
+							childMask[i] |= (1 << r);
+							dist[i] = min(dist[i], rdist[i]);
+						}
+					}
+				}
+
+				float4 cnodes = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_QNODE_SIZE+6);
+
+				/* sort intersected children far to near */
+				int childAddr[4], childRays[4];
+				float childDist[4];
+				int num_children = 0;
+
+				for(int i = 0; i < 4; i++) {
+					if(childMask[i]) {
+						int j = num_children++;
+
+						while(j > 0 && childDist[j-1] < dist[i]) {
+							childAddr[j] = childAddr[j-1];
+							childRays[j] = childRays[j-1];
+							childDist[j] = childDist[j-1];
+							j--;
+						}
+
+						childAddr[j] = __float_as_int(cnodes[i]);
+						childRays[j] = childMask[i];
+						childDist[j] = dist[i];
+					}
+				}
+
+				if(num_children == 0) {
+					/* no children were intersected */
+					nodeAddr = traversalStack[stackPtr];
+					active = traversalMask[stackPtr];
+					--stackPtr;
+					continue;
+				}
+
+				/* push the farther children, continue with the closest */
+				for(int i = 0; i < num_children-1; i++) {
+					++stackPtr;
+					traversalStack[stackPtr] = childAddr[i];
+					traversalMask[stackPtr] = childRays[i];
+				}
+
+				nodeAddr = childAddr[num_children-1];
+				active = childRays[num_children-1];
+			}
+
+			/* if node is leaf, fetch triangle list */
+			if(nodeAddr < 0) {
+				float4 leaf = kernel_tex_fetch(__bvh_nodes, (-nodeAddr-1)*BVH_QNODE_SIZE+6);
+				int primAddr = __float_as_int(leaf.x);
+
+#ifdef __INSTANCING__
+				if(primAddr >= 0) {
+#endif
+					int primAddr2 = __float_as_int(leaf.y);
+					int leafType = __float_as_int(leaf.z);
+					int leafActive = active & ~done;
+
+					/* pop */
+					nodeAddr = traversalStack[stackPtr];
+					active = traversalMask[stackPtr];
+					--stackPtr;
+
+					/* primitive intersection */
+					for(int r = 0; r < num; r++) {
+						if(!(leafActive & (1 << r)))
+							continue;
+
+						if(bvh_leaf_intersect(kg, &isects[r], P[r], idir[r], visibility, object, primAddr, primAddr2, leafType))
+							done |= (1 << r);
+					}
+
+					if(done == (1 << num) - 1)
+						return;
+#ifdef __INSTANCING__
+				}
+				else {
+					/* instance push */
+					object = kernel_tex_fetch(__prim_object, -primAddr-1);
+
+					for(int r = 0; r < num; r++) {
+						if(!(active & (1 << r)))
+							continue;
+
+#ifdef __OBJECT_MOTION__
+						if(kernel_data.bvh.have_motion)
+							bvh_instance_motion_push(kg, object, &rays[r], &P[r], &idir[r], &isects[r].t, &ob_tfm[r], rays[r].t);
+						else
+#endif
+							bvh_instance_push(kg, object, &rays[r], &P[r], &idir[r], &isects[r].t, rays[r].t);
+
+						qbvh_ray_setup(P[r], idir[r], Pidir[r], idir4[r]);
+					}
+
+					++stackPtr;
+					traversalStack[stackPtr] = ENTRYPOINT_SENTINEL;
+					traversalMask[stackPtr] = active;
+
+					nodeAddr = kernel_tex_fetch(__object_node, object);
+				}
+#endif
+			}
+		} while(nodeAddr != ENTRYPOINT_SENTINEL);
+
+#ifdef __INSTANCING__
+		if(stackPtr >= 0) {
+			kernel_assert(object != ~0);
+
+			/* instance pop, active holds the rays that entered the instance */
+			for(int r = 0; r < num; r++) {
+				if(!(active & (1 << r)))
+					continue;
+
+#ifdef __OBJECT_MOTION__
+				if(kernel_data.bvh.have_motion)
+					bvh_instance_motion_pop(kg, object, &rays[r], &P[r], &idir[r], &isects[r].t, &ob_tfm[r], rays[r].t);
+				else
+#endif
+					bvh_instance_pop(kg, object, &rays[r], &P[r], &idir[r], &isects[r].t, rays[r].t);
+
+				qbvh_ray_setup(P[r], idir[r], Pidir[r], idir4[r]);
+			}
+
+			object = ~0;
+			nodeAddr = traversalStack[stackPtr];
+			active = traversalMask[stackPtr];
+			--stackPtr;
+		}
+#endif
+	} while(nodeAddr != ENTRYPOINT_SENTINEL);
+}
+
+#endif
+
+CCL_NAMESPACE_END
+
@@ -681,6 +681,10 @@ __device void shader_eval_surface(KernelGlobals *kg, ShaderData *sd,
 		sd->closure.weight = make_float3(0.8f, 0.8f, 0.8f);
 #endif
 	}
+
+#ifdef __KERNEL_DEBUG__
+	kg->debug_data.num_closures += sd->num_closure;
+#endif
 }
 
 /* Background Evaluation */
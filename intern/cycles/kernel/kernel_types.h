@@ -32,22 +32,43 @@ CCL_NAMESPACE_BEGIN
 #define OBJECT_SIZE 		11
 #define OBJECT_VECTOR_SIZE	6
 #define LIGHT_SIZE			4
+#define LIGHT_TREE_NODE_SIZE	3
 #define FILTER_TABLE_SIZE	256
 #define RAMP_TABLE_SIZE		256
 #define PARTICLE_SIZE 		5
+#define RAY_PACKET_SIZE		8
 #define TIME_INVALID		FLT_MAX
 
 #define TEX_NUM_FLOAT_IMAGES	5
 
+/* the CPU has more byte image slots, and additional half float and single
+ * channel storage types, with slots numbered after the byte images */
+#define TEX_NUM_BYTE_IMAGES_CPU		512
+#define TEX_NUM_HALF4_IMAGES_CPU	512
+#define TEX_NUM_FLOAT1_IMAGES_CPU	512
+#define TEX_NUM_BYTE1_IMAGES_CPU	512
+
+#define TEX_IMAGE_HALF4_START_CPU	(TEX_NUM_FLOAT_IMAGES + TEX_NUM_BYTE_IMAGES_CPU)
+#define TEX_IMAGE_FLOAT1_START_CPU	(TEX_IMAGE_HALF4_START_CPU + TEX_NUM_HALF4_IMAGES_CPU)
+#define TEX_IMAGE_BYTE1_START_CPU	(TEX_IMAGE_FLOAT1_START_CPU + TEX_NUM_FLOAT1_IMAGES_CPU)
+
 /* device capabilities */
 #ifdef __KERNEL_CPU__
 #define __KERNEL_SHADING__
 #define __KERNEL_ADV_SHADING__
 #define __NON_PROGRESSIVE__
 #define __HAIR__
+#define __LIGHT_TREE__
+#ifdef __KERNEL_SSE2__
+#define __QBVH__
+#define __RAY_PACKETS__
+#endif
 #ifdef WITH_OSL
 #define __OSL__
 #endif
+#ifdef WITH_CYCLES_DEBUG
+#define __KERNEL_DEBUG__
+#endif
 #endif
 
 #ifdef __KERNEL_CUDA__
@@ -223,7 +244,12 @@ typedef enum PassType {
 	PASS_AO = 131072,
 	PASS_SHADOW = 262144,
 	PASS_MOTION = 524288,
-	PASS_MOTION_WEIGHT = 1048576
+	PASS_MOTION_WEIGHT = 1048576,
+	PASS_VARIANCE = 2097152,
+	PASS_DEBUG_BVH_TRAVERSAL_STEPS = 4194304,
+	PASS_DEBUG_BVH_INTERSECTIONS = 8388608,
+	PASS_DEBUG_RAY_BOUNCES = 16777216,
+	PASS_DEBUG_RENDER_TIME = 33554432
 } PassType;
 
 #define PASS_ALL (~0)
@@ -352,8 +378,29 @@ typedef struct Intersection {
 	int prim;
 	int object;
 	int segment;
+
+#ifdef __KERNEL_DEBUG__
+	int num_traversal_steps;
+	int num_intersections;
+#endif
 } Intersection;
 
+#ifdef __KERNEL_DEBUG__
+
+/* Debug Data
+ *
+ * Counters for a single camera path, written to the debug passes and summed
+ * into the render statistics. */
+
+typedef struct DebugData {
+	int num_bvh_traversal_steps;
+	int num_bvh_intersections;
+	int num_ray_bounces;
+	int num_closures;
+} DebugData;
+
+#endif
+
 /* Attributes */
 
 #define ATTR_PRIM_TYPES		2
@@ -611,8 +658,13 @@ typedef struct KernelFilm {
 
 	int pass_shadow;
 	float pass_shadow_scale;
+	int pass_variance;
+	int pass_bvh_traversal_steps;
+
+	int pass_bvh_intersections;
+	int pass_ray_bounces;
+	int pass_render_time;
 	int pass_pad1;
-	int pass_pad2;
 } KernelFilm;
 
 typedef struct KernelBackground {
@@ -680,6 +732,12 @@ typedef struct KernelIntegrator {
 	int ao_samples;
 	int mesh_light_samples;
 	int use_lamp_mis;
+
+	/* light tree */
+	int use_light_tree;
+	int light_tree_num_emitters;
+	float light_tree_pdf;
+	int pad1;
 } KernelIntegrator;
 
 typedef struct KernelBVH {
@@ -687,9 +745,17 @@ typedef struct KernelBVH {
 	int root;
 	int attributes_map_stride;
 	int have_motion;
-	int pad2;
+	int use_qbvh;
+	int use_ray_packets;
+	int pad1, pad2, pad3;
 } KernelBVH;
 
+/* primitive type of BVH leaf nodes, a leaf contains only one type */
+typedef enum BVHLeafType {
+	BVH_LEAF_TRIANGLE = 0,
+	BVH_LEAF_CURVE = 1
+} BVHLeafType;
+
 typedef enum CurveFlag {
 	/* runtime flags */
 	CURVE_KN_BACKFACING = 1,				/* backside of cylinder? */
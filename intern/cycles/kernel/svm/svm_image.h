@@ -50,7 +50,7 @@ __device_inline float svm_image_texture_frac(float x, int *ix)
 	return x - (float)i;
 }
 
-__device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb)
+__device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint srgb)
 {
 	/* first slots are used by float textures, which are not supported here */
 	if(id < TEX_NUM_FLOAT_IMAGES)
@@ -99,12 +99,15 @@ __device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, u
 
 #else
 
-__device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb)
+__device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint srgb)
 {
 	float4 r;
 
 #ifdef __KERNEL_CPU__
-	r = kernel_tex_image_interp(id, x, y);
+	if(kg->texture_cache && kg->texture_cache->has_image(id))
+		r = kg->texture_cache->lookup(id, x, y, dx, dy);
+	else
+		r = kernel_tex_image_interp(id, x, y);
 #else
 	/* not particularly proud of this massive switch, what are the
 	 * alternatives?
@@ -241,7 +244,26 @@ __device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *stack
 	decode_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &srgb);
 
 	float3 co = stack_load_float3(stack, co_offset);
-	float4 f = svm_image_texture(kg, id, co.x, co.y, srgb);
+	float2 dx = make_float2(0.0f, 0.0f);
+	float2 dy = make_float2(0.0f, 0.0f);
+
+#ifdef __KERNEL_CPU__
+	/* derivatives for texture filtering, if the coordinates are an attribute */
+	if(node.w != ATTR_STD_NONE) {
+		AttributeElement elem;
+		int offset = find_attribute(kg, sd, node.w, &elem);
+
+		if(offset != ATTR_STD_NOT_FOUND) {
+			float3 dcodx, dcody;
+			primitive_attribute_float3(kg, sd, elem, offset, &dcodx, &dcody);
+
+			dx = make_float2(dcodx.x, dcodx.y);
+			dy = make_float2(dcody.x, dcody.y);
+		}
+	}
+#endif
+
+	float4 f = svm_image_texture(kg, id, co.x, co.y, dx, dy, srgb);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -322,13 +344,14 @@ __device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float *s
 	uint id = node.y;
 
 	float4 f = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+	float2 zero = make_float2(0.0f, 0.0f);
 
 	if(weight.x > 0.0f)
-		f += weight.x*svm_image_texture(kg, id, co.y, co.z, srgb);
+		f += weight.x*svm_image_texture(kg, id, co.y, co.z, zero, zero, srgb);
 	if(weight.y > 0.0f)
-		f += weight.y*svm_image_texture(kg, id, co.x, co.z, srgb);
+		f += weight.y*svm_image_texture(kg, id, co.x, co.z, zero, zero, srgb);
 	if(weight.z > 0.0f)
-		f += weight.z*svm_image_texture(kg, id, co.y, co.x, srgb);
+		f += weight.z*svm_image_texture(kg, id, co.y, co.x, zero, zero, srgb);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -355,7 +378,8 @@ __device void svm_node_tex_environment(KernelGlobals *kg, ShaderData *sd, float
 	else
 		uv = direction_to_mirrorball(co);
 
-	float4 f = svm_image_texture(kg, id, uv.x, uv.y, srgb);
+	float2 zero = make_float2(0.0f, 0.0f);
+	float4 f = svm_image_texture(kg, id, uv.x, uv.y, zero, zero, srgb);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
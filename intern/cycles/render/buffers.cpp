@@ -16,7 +16,9 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "buffers.h"
 #include "device.h"
@@ -391,5 +393,197 @@ void DisplayBuffer::write(Device *device, const string& filename)
 	delete out;
 }
 
+/* Tile Output */
+
+static const struct {
+	PassType type;
+	const char *name;
+	const char *channels;
+} tile_output_passes[] = {
+	{PASS_COMBINED, "Combined", "RGBA"},
+	{PASS_DEPTH, "Depth", "Z"},
+	{PASS_NORMAL, "Normal", "XYZ"},
+	{PASS_UV, "UV", "UVA"},
+	{PASS_MOTION, "Vector", "XYZW"},
+	{PASS_OBJECT_ID, "IndexOB", "X"},
+	{PASS_MATERIAL_ID, "IndexMA", "X"},
+	{PASS_DIFFUSE_COLOR, "DiffCol", "RGB"},
+	{PASS_GLOSSY_COLOR, "GlossCol", "RGB"},
+	{PASS_TRANSMISSION_COLOR, "TransCol", "RGB"},
+	{PASS_DIFFUSE_INDIRECT, "DiffInd", "RGB"},
+	{PASS_GLOSSY_INDIRECT, "GlossInd", "RGB"},
+	{PASS_TRANSMISSION_INDIRECT, "TransInd", "RGB"},
+	{PASS_DIFFUSE_DIRECT, "DiffDir", "RGB"},
+	{PASS_GLOSSY_DIRECT, "GlossDir", "RGB"},
+	{PASS_TRANSMISSION_DIRECT, "TransDir", "RGB"},
+	{PASS_EMISSION, "Emit", "RGB"},
+	{PASS_BACKGROUND, "Env", "RGB"},
+	{PASS_AO, "AO", "RGB"},
+	{PASS_SHADOW, "Shadow", "RGB"},
+	{PASS_VARIANCE, "Variance", "X"},
+	{PASS_DEBUG_BVH_TRAVERSAL_STEPS, "DebugBVHTraversalSteps", "X"},
+	{PASS_DEBUG_BVH_INTERSECTIONS, "DebugBVHIntersections", "X"},
+	{PASS_DEBUG_RAY_BOUNCES, "DebugRayBounces", "X"},
+	{PASS_DEBUG_RENDER_TIME, "DebugRenderTime", "X"},
+	{PASS_NONE, NULL, NULL}
+};
+
+static int tile_output_pass(PassType type)
+{
+	for(int i = 0; tile_output_passes[i].name; i++)
+		if(tile_output_passes[i].type == type)
+			return i;
+	
+	return -1;
+}
+
+TileOutput::TileOutput()
+{
+	out = NULL;
+	tile_size = make_int2(0, 0);
+	nchannels = 0;
+	file_y = 0;
+	file_height = 0;
+}
+
+TileOutput::~TileOutput()
+{
+	close();
+}
+
+bool TileOutput::open(const string& filename, BufferParams& params_, int2 tile_size_)
+{
+	close();
+
+	params = params_;
+	tile_size = tile_size_;
+
+	out = ImageOutput::create(filename);
+
+	if(!out)
+		return false;
+
+	if(!out->supports("tiles")) {
+		fprintf(stderr, "Cycles: %s does not support tiled images, can't write tiles.\n", filename.c_str());
+		close();
+		return false;
+	}
+
+	/* channels, named as in blender multilayer files */
+	vector<string> channelnames;
+
+	foreach(Pass& pass, params.passes) {
+		int index = tile_output_pass(pass.type);
+
+		if(index == -1)
+			continue;
+
+		for(const char *c = tile_output_passes[index].channels; *c; c++)
+			channelnames.push_back(string_printf("%s.%c", tile_output_passes[index].name, *c));
+	}
+
+	nchannels = channelnames.size();
+
+	int full_height = (params.full_height)? params.full_height: params.height;
+	file_height = ((params.height + tile_size.y - 1)/tile_size.y)*tile_size.y;
+	file_y = full_height - params.full_y - file_height;
+
+	ImageSpec spec(params.width, file_height, nchannels, TypeDesc::FLOAT);
+	spec.x = params.full_x;
+	spec.y = file_y;
+	spec.full_x = 0;
+	spec.full_y = 0;
+	spec.full_width = (params.full_width)? params.full_width: params.width;
+	spec.full_height = full_height;
+	spec.tile_width = tile_size.x;
+	spec.tile_height = tile_size.y;
+	spec.channelnames = channelnames;
+	spec.attribute("compression", "zip");
+	/* tiles finish in any order, write them immediately instead of having
+	 * them held in memory until they can be written in increasing order */
+	spec.attribute("openexr:lineOrder", "randomY");
+
+	if(!out->open(filename, spec)) {
+		fprintf(stderr, "Cycles: failed to open %s: %s\n", filename.c_str(), out->geterror().c_str());
+		close();
+		return false;
+	}
+
+	pixels.resize(tile_size.x*tile_size.y*nchannels);
+
+	return true;
+}
+
+bool TileOutput::write(RenderTile& rtile, float exposure)
+{
+	if(!out)
+		return false;
+
+	if(!rtile.buffers->copy_from_device()) {
+		error_msg = "Failed to copy tile from device";
+		return false;
+	}
+
+	int x = rtile.x - params.full_x;
+	int y = rtile.y - params.full_y;
+	int w = rtile.w;
+	int h = rtile.h;
+
+	/* tiles must match the file tile grid */
+	if(x % tile_size.x || y % tile_size.y || w > tile_size.x || h > tile_size.y) {
+		error_msg = string_printf("Tile %d, %d (%dx%d) does not match the %dx%d tiles of the output file",
+			rtile.x, rtile.y, w, h, tile_size.x, tile_size.y);
+		return false;
+	}
+
+	memset(&pixels[0], 0, sizeof(float)*pixels.size());
+	pass_pixels.resize(w*h*4);
+
+	int channel = 0;
+
+	foreach(Pass& pass, params.passes) {
+		int index = tile_output_pass(pass.type);
+
+		if(index == -1)
+			continue;
+
+		int components = strlen(tile_output_passes[index].channels);
+
+		if(!rtile.buffers->get_pass_rect(pass.type, exposure, rtile.sample, components, &pass_pixels[0])) {
+			error_msg = string_printf("Failed to read %s pass of tile %d, %d",
+				tile_output_passes[index].name, rtile.x, rtile.y);
+			return false;
+		}
+
+		/* flip vertically, the file is stored top to bottom */
+		for(int j = 0; j < h; j++) {
+			float *in = &pass_pixels[j*w*components];
+			float *pixel = &pixels[(tile_size.y - 1 - j)*tile_size.x*nchannels + channel];
+
+			for(int i = 0; i < w; i++, in += components, pixel += nchannels)
+				for(int c = 0; c < components; c++)
+					pixel[c] = in[c];
+		}
+
+		channel += components;
+	}
+
+	if(!out->write_tile(rtile.x, file_y + file_height - tile_size.y - y, 0, TypeDesc::FLOAT, &pixels[0])) {
+		error_msg = string_printf("Failed to write tile %d, %d: %s", rtile.x, rtile.y, out->geterror().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void TileOutput::close()
+{
+	if(out) {
+		out->close();
+		delete out;
+		out = NULL;
+	}
+}
+
 CCL_NAMESPACE_END
 
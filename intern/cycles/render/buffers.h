@@ -25,6 +25,7 @@
 
 #include "kernel_types.h"
 
+#include "util_image.h"
 #include "util_string.h"
 #include "util_thread.h"
 #include "util_types.h"
@@ -143,6 +144,40 @@ public:
 	RenderTile();
 };
 
+/* Tile Output
+ *
+ * Writes finished render tiles into a tiled multilayer EXR file, so the tile
+ * buffers can be freed right away and the full frame is never in memory. Not
+ * thread safe, tiles must be written one at a time. */
+
+class TileOutput {
+public:
+	TileOutput();
+	~TileOutput();
+
+	bool open(const string& filename, BufferParams& params, int2 tile_size);
+	bool write(RenderTile& rtile, float exposure);
+	void close();
+
+	const string& error_message() { return error_msg; }
+
+protected:
+	ImageOutput *out;
+	BufferParams params;
+	int2 tile_size;
+	int nchannels;
+
+	/* data window is padded at the top to whole tiles, so that cycles tiles
+	 * still line up with the file tiles after flipping vertically */
+	int file_y;
+	int file_height;
+
+	vector<float> pixels;
+	vector<float> pass_pixels;
+
+	string error_msg;
+};
+
 CCL_NAMESPACE_END
 
 #endif /* __BUFFERS_H__ */
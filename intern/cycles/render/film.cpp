@@ -138,6 +138,19 @@ void Pass::add(PassType type, vector<Pass>& passes)
 			pass.components = 4;
 			pass.exposure = false;
 			break;
+		case PASS_VARIANCE:
+			pass.components = 1;
+			break;
+		case PASS_DEBUG_BVH_TRAVERSAL_STEPS:
+		case PASS_DEBUG_BVH_INTERSECTIONS:
+		case PASS_DEBUG_RAY_BOUNCES:
+			pass.components = 1;
+			break;
+		case PASS_DEBUG_RENDER_TIME:
+			/* seconds spent on the tile, not averaged over samples */
+			pass.components = 1;
+			pass.filter = false;
+			break;
 	}
 
 	passes.push_back(pass);
@@ -225,6 +238,21 @@ void Film::device_update(Device *device, DeviceScene *dscene)
 			case PASS_MATERIAL_ID:
 				kfilm->pass_material_id = kfilm->pass_stride;
 				break;
+			case PASS_VARIANCE:
+				kfilm->pass_variance = kfilm->pass_stride;
+				break;
+			case PASS_DEBUG_BVH_TRAVERSAL_STEPS:
+				kfilm->pass_bvh_traversal_steps = kfilm->pass_stride;
+				break;
+			case PASS_DEBUG_BVH_INTERSECTIONS:
+				kfilm->pass_bvh_intersections = kfilm->pass_stride;
+				break;
+			case PASS_DEBUG_RAY_BOUNCES:
+				kfilm->pass_ray_bounces = kfilm->pass_stride;
+				break;
+			case PASS_DEBUG_RENDER_TIME:
+				kfilm->pass_render_time = kfilm->pass_stride;
+				break;
 			case PASS_DIFFUSE_COLOR:
 				kfilm->pass_diffuse_color = kfilm->pass_stride;
 				kfilm->use_light_pass = 1;
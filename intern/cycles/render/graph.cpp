@@ -67,6 +67,32 @@ ShaderNode::~ShaderNode()
 		delete socket;
 }
 
+bool ShaderNode::equals(const ShaderNode *other)
+{
+	/* nodes with parameters extend this to compare them too */
+	if(name != other->name || bump != other->bump || special_type != other->special_type)
+		return false;
+	if(inputs.size() != other->inputs.size() || outputs.size() != other->outputs.size())
+		return false;
+
+	for(size_t i = 0; i < inputs.size(); i++) {
+		ShaderInput *input = inputs[i];
+		ShaderInput *other_input = other->inputs[i];
+
+		if(input->link != other_input->link)
+			return false;
+
+		if(!input->link) {
+			if(input->default_value != other_input->default_value ||
+			   input->value != other_input->value ||
+			   input->value_string != other_input->value_string)
+				return false;
+		}
+	}
+
+	return true;
+}
+
 ShaderInput *ShaderNode::input(const char *name)
 {
 	foreach(ShaderInput *socket, inputs)
@@ -135,6 +161,8 @@ void ShaderNode::attributes(AttributeRequestSet *attributes)
 ShaderGraph::ShaderGraph()
 {
 	finalized = false;
+	num_nodes_unoptimized = 0;
+	num_nodes_optimized = 0;
 	add(new OutputNode());
 }
 
@@ -229,7 +257,11 @@ void ShaderGraph::finalize(bool do_bump, bool do_osl, bool do_multi_transform)
 	 * modified afterwards. */
 
 	if(!finalized) {
+		num_nodes_unoptimized = nodes.size();
 		clean();
+		optimize();
+		num_nodes_optimized = nodes.size();
+
 		default_inputs(do_osl);
 		refine_bump_nodes();
 
@@ -398,6 +430,8 @@ void ShaderGraph::clean()
 	 * nodes that don't feed into the output. how cycles are broken is
 	 * undefined, they are invalid input, the important thing is to not crash */
 
+	renumber_nodes();
+
 	vector<bool> removed(nodes.size(), false);
 	vector<bool> visited(nodes.size(), false);
 	vector<bool> on_stack(nodes.size(), false);
@@ -444,6 +478,149 @@ void ShaderGraph::clean()
 	nodes = newnodes;
 }
 
+void ShaderGraph::renumber_nodes()
+{
+	/* ids index into per node arrays, keep them compact after nodes
+	 * were removed */
+	int id = 0;
+
+	foreach(ShaderNode *node, nodes)
+		node->id = id++;
+}
+
+void ShaderGraph::topological_order(ShaderNode *node, vector<bool>& visited, vector<ShaderNode*>& order)
+{
+	/* dependencies come before the nodes using them */
+	visited[node->id] = true;
+
+	foreach(ShaderInput *input, node->inputs) {
+		if(input->link && !visited[input->link->parent->id])
+			topological_order(input->link->parent, visited, order);
+	}
+
+	order.push_back(node);
+}
+
+void ShaderGraph::optimize()
+{
+	/* simplify the graph before compiling, so that shaders built from node
+	 * groups or with many constant inputs don't waste time in the kernel.
+	 * nodes left without users are removed by clean(). */
+	renumber_nodes();
+	constant_fold();
+
+	renumber_nodes();
+	deduplicate_nodes();
+
+	clean();
+}
+
+void ShaderGraph::constant_fold()
+{
+	vector<bool> visited(nodes.size(), false);
+	vector<ShaderNode*> order;
+
+	topological_order(output(), visited, order);
+
+	foreach(ShaderNode *node, order) {
+		/* inputs with a default geometry value are not constant */
+		bool all_constant = true;
+
+		foreach(ShaderInput *input, node->inputs) {
+			if(input->link || input->default_value != ShaderInput::NONE) {
+				all_constant = false;
+				break;
+			}
+		}
+
+		foreach(ShaderOutput *output, node->outputs) {
+			if(output->links.empty())
+				continue;
+
+			/* temp. copy, output->links is modified when we disconnect */
+			vector<ShaderInput*> links(output->links);
+			float3 optimized_value = make_float3(0.0f, 0.0f, 0.0f);
+
+			if(all_constant && node->constant_fold(output, &optimized_value)) {
+				foreach(ShaderInput *to, links) {
+					/* unlinked, this input would get a default geometry value */
+					if(to->default_value != ShaderInput::NONE)
+						continue;
+
+					disconnect(to);
+					to->set(optimized_value);
+				}
+			}
+			else if(ShaderInput *bypass = node->constant_bypass(output)) {
+				ShaderOutput *from = bypass->link;
+
+				foreach(ShaderInput *to, links) {
+					if(!from && to->default_value != ShaderInput::NONE)
+						continue;
+
+					disconnect(to);
+
+					if(from)
+						connect(from, to);
+					else
+						to->set(bypass->value);
+				}
+			}
+		}
+	}
+}
+
+void ShaderGraph::deduplicate_nodes()
+{
+	/* merge nodes that compute the same result from the same inputs. nodes
+	 * are visited in dependency order, so that once the inputs of two nodes
+	 * were merged, the nodes themselves can be compared by their links. */
+	vector<bool> visited(nodes.size(), false);
+	vector<ShaderNode*> order;
+	map<ustring, vector<ShaderNode*> > candidates;
+
+	topological_order(output(), visited, order);
+
+	foreach(ShaderNode *node, order) {
+		if(node == output())
+			continue;
+
+		/* closures are compiled once per use by the multi closure
+		 * transform, don't merge them */
+		bool has_closure = false;
+
+		foreach(ShaderOutput *output, node->outputs)
+			if(output->type == SHADER_SOCKET_CLOSURE)
+				has_closure = true;
+
+		if(has_closure)
+			continue;
+
+		vector<ShaderNode*>& bucket = candidates[node->name];
+		bool merged = false;
+
+		foreach(ShaderNode *other, bucket) {
+			if(!node->equals(other))
+				continue;
+
+			for(size_t i = 0; i < node->outputs.size(); i++) {
+				vector<ShaderInput*> links(node->outputs[i]->links);
+
+				foreach(ShaderInput *to, links) {
+					disconnect(to);
+					connect(other->outputs[i], to);
+				}
+			}
+
+			merged = true;
+			break;
+		}
+
+		if(!merged)
+			bucket.push_back(node);
+	}
+}
+
 void ShaderGraph::default_inputs(bool do_osl)
 {
 	/* nodes can specify default texture coordinates, for now we give
@@ -188,6 +188,13 @@ public:
 	virtual bool has_surface_emission() { return false; }
 	virtual bool has_surface_transparent() { return false; }
 
+	/* graph optimization: evaluate an output when all inputs are constant,
+	 * return an input that the output can be replaced by, and test if two
+	 * nodes compute the same result given the same input links */
+	virtual bool constant_fold(ShaderOutput *socket, float3 *optimized_value) { return false; }
+	virtual ShaderInput *constant_bypass(ShaderOutput *socket) { return NULL; }
+	virtual bool equals(const ShaderNode *other);
+
 	vector<ShaderInput*> inputs;
 	vector<ShaderOutput*> outputs;
 
@@ -227,6 +234,10 @@ public:
 	list<ShaderNode*> nodes;
 	bool finalized;
 
+	/* node count before and after optimization, for statistics */
+	int num_nodes_unoptimized;
+	int num_nodes_optimized;
+
 	ShaderGraph();
 	~ShaderGraph();
 
@@ -249,6 +260,11 @@ protected:
 	void remove_proxy_nodes(vector<bool>& removed);
 	void break_cycles(ShaderNode *node, vector<bool>& visited, vector<bool>& on_stack);
 	void clean();
+	void renumber_nodes();
+	void topological_order(ShaderNode *node, vector<bool>& visited, vector<ShaderNode*>& order);
+	void optimize();
+	void constant_fold();
+	void deduplicate_nodes();
 	void bump_from_displacement();
 	void refine_bump_nodes();
 	void default_inputs(bool do_osl);
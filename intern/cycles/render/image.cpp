@@ -24,6 +24,7 @@
 #include "util_image.h"
 #include "util_path.h"
 #include "util_progress.h"
+#include "util_texture_cache.h"
 
 #ifdef WITH_OSL
 #include <OSL/oslexec.h>
@@ -36,19 +37,29 @@ ImageManager::ImageManager()
 	need_update = true;
 	pack_images = false;
 	osl_texture_system = NULL;
+	texture_cache = NULL;
 	animation_frame = 0;
 
-	tex_num_images = TEX_NUM_IMAGES;
-	tex_num_float_images = TEX_NUM_FLOAT_IMAGES;
-	tex_image_byte_start = TEX_IMAGE_BYTE_START;
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++)
+		tex_num_images[type] = 0;
+
+	tex_num_images[IMAGE_DATA_TYPE_FLOAT4] = TEX_NUM_FLOAT_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_BYTE4] = TEX_NUM_IMAGES;
+
+	tex_start_images[IMAGE_DATA_TYPE_FLOAT4] = 0;
+	tex_start_images[IMAGE_DATA_TYPE_BYTE4] = TEX_IMAGE_BYTE_START;
+	tex_start_images[IMAGE_DATA_TYPE_HALF4] = TEX_IMAGE_HALF4_START_CPU;
+	tex_start_images[IMAGE_DATA_TYPE_FLOAT] = TEX_IMAGE_FLOAT1_START_CPU;
+	tex_start_images[IMAGE_DATA_TYPE_BYTE] = TEX_IMAGE_BYTE1_START_CPU;
 }
 
 ImageManager::~ImageManager()
 {
-	for(size_t slot = 0; slot < images.size(); slot++)
-		assert(!images[slot]);
-	for(size_t slot = 0; slot < float_images.size(); slot++)
-		assert(!float_images[slot]);
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++)
+		for(size_t slot = 0; slot < images[type].size(); slot++)
+			assert(!images[type][slot]);
+
+	delete texture_cache;
 }
 
 void ImageManager::set_pack_images(bool pack_images_)
@@ -61,11 +72,21 @@ void ImageManager::set_osl_texture_system(void *texture_system)
 	osl_texture_system = texture_system;
 }
 
+void ImageManager::set_texture_cache(int max_memory_MB)
+{
+	delete texture_cache;
+	texture_cache = new TextureCache(max_memory_MB);
+}
+
 void ImageManager::set_extended_image_limits(void)
 {
-	tex_num_images = TEX_EXTENDED_NUM_IMAGES;
-	tex_num_float_images = TEX_EXTENDED_NUM_FLOAT_IMAGES;
-	tex_image_byte_start = TEX_EXTENDED_IMAGE_BYTE_START;
+	tex_num_images[IMAGE_DATA_TYPE_FLOAT4] = TEX_EXTENDED_NUM_FLOAT_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_BYTE4] = TEX_EXTENDED_NUM_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_HALF4] = TEX_NUM_HALF4_IMAGES_CPU;
+	tex_num_images[IMAGE_DATA_TYPE_FLOAT] = TEX_NUM_FLOAT1_IMAGES_CPU;
+	tex_num_images[IMAGE_DATA_TYPE_BYTE] = TEX_NUM_BYTE1_IMAGES_CPU;
+
+	tex_start_images[IMAGE_DATA_TYPE_BYTE4] = TEX_EXTENDED_IMAGE_BYTE_START;
 }
 
 bool ImageManager::set_animation_frame_update(int frame)
@@ -73,33 +94,55 @@ bool ImageManager::set_animation_frame_update(int frame)
 	if(frame != animation_frame) {
 		animation_frame = frame;
 
-		for(size_t slot = 0; slot < images.size(); slot++)
-			if(images[slot] && images[slot]->animated)
-				return true;
-
-		for(size_t slot = 0; slot < float_images.size(); slot++)
-			if(float_images[slot] && float_images[slot]->animated)
-				return true;
+		for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++)
+			for(size_t slot = 0; slot < images[type].size(); slot++)
+				if(images[type][slot] && images[type][slot]->animated)
+					return true;
 	}
 	
 	return false;
 }
 
-bool ImageManager::is_float_image(const string& filename, void *builtin_data, bool& is_linear)
+int ImageManager::type_index_to_slot(int index, ImageDataType type)
+{
+	return index + tex_start_images[type];
+}
+
+int ImageManager::slot_to_type_index(int slot, ImageDataType *type)
 {
-	bool is_float = false;
+	for(int i = 0; i < IMAGE_DATA_NUM_TYPES; i++) {
+		int index = slot - tex_start_images[i];
+
+		if(index >= 0 && index < tex_num_images[i]) {
+			*type = (ImageDataType)i;
+			return index;
+		}
+	}
+
+	assert(0);
+	*type = IMAGE_DATA_TYPE_BYTE4;
+	return -1;
+}
+
+ImageDataType ImageManager::get_image_metadata(const string& filename, void *builtin_data, bool& is_linear)
+{
+	bool is_float = false, is_half = false;
+	int channels = 4;
 	is_linear = false;
 
 	if(builtin_data) {
 		if(builtin_image_info_cb) {
-			int width, height, channels;
+			int width, height;
 			builtin_image_info_cb(filename, builtin_data, is_float, width, height, channels);
 		}
 
-		if(is_float)
+		/* builtin images only have callbacks for four channel pixels */
+		if(is_float) {
 			is_linear = true;
+			return IMAGE_DATA_TYPE_FLOAT4;
+		}
 
-		return is_float;
+		return IMAGE_DATA_TYPE_BYTE4;
 	}
 
 	ImageInput *in = ImageInput::create(filename);
@@ -122,6 +165,15 @@ bool ImageManager::is_float_image(const string& filename, void *builtin_data, bo
 				}
 			}
 
+			/* half float files can be stored as half without losing precision */
+			is_half = (spec.format == TypeDesc::HALF);
+
+			for(size_t channel = 0; channel < spec.channelformats.size(); channel++)
+				if(spec.channelformats[channel] != TypeDesc::HALF)
+					is_half = false;
+
+			channels = spec.nchannels;
+
 			/* basic color space detection, not great but better than nothing
 			 * before we do OpenColorIO integration */
 			if(is_float) {
@@ -140,137 +192,141 @@ bool ImageManager::is_float_image(const string& filename, void *builtin_data, bo
 		delete in;
 	}
 
-	return is_float;
+	if(is_float) {
+		if(channels == 1)
+			return IMAGE_DATA_TYPE_FLOAT;
+		else if(is_half)
+			return IMAGE_DATA_TYPE_HALF4;
+		else
+			return IMAGE_DATA_TYPE_FLOAT4;
+	}
+	else {
+		if(channels == 1)
+			return IMAGE_DATA_TYPE_BYTE;
+		else
+			return IMAGE_DATA_TYPE_BYTE4;
+	}
+}
+
+bool ImageManager::is_float_image(const string& filename, void *builtin_data, bool& is_linear)
+{
+	ImageDataType type = get_image_metadata(filename, builtin_data, is_linear);
+
+	return (type == IMAGE_DATA_TYPE_FLOAT4 || type == IMAGE_DATA_TYPE_HALF4 || type == IMAGE_DATA_TYPE_FLOAT);
 }
 
 int ImageManager::add_image(const string& filename, void *builtin_data, bool animated, bool& is_float, bool& is_linear)
 {
 	Image *img;
 	size_t slot;
+	ImageDataType type;
 
-	/* load image info and find out if we need a float texture */
-	is_float = (pack_images)? false: is_float_image(filename, builtin_data, is_linear);
-
-	if(is_float) {
-		/* find existing image */
-		for(slot = 0; slot < float_images.size(); slot++) {
-			if(float_images[slot] && float_images[slot]->filename == filename) {
-				float_images[slot]->users++;
-				return slot;
-			}
-		}
+	/* load image info and find out which storage type we need */
+	if(pack_images) {
+		type = IMAGE_DATA_TYPE_BYTE4;
+		is_linear = false;
+	}
+	else
+		type = get_image_metadata(filename, builtin_data, is_linear);
 
-		/* find free slot */
-		for(slot = 0; slot < float_images.size(); slot++) {
-			if(!float_images[slot])
-				break;
-		}
+	/* fall back to four channel storage on devices without the other types */
+	if(tex_num_images[type] == 0) {
+		if(type == IMAGE_DATA_TYPE_BYTE)
+			type = IMAGE_DATA_TYPE_BYTE4;
+		else
+			type = IMAGE_DATA_TYPE_FLOAT4;
+	}
 
-		if(slot == float_images.size()) {
-			/* max images limit reached */
-			if(float_images.size() == TEX_NUM_FLOAT_IMAGES) {
-				printf("ImageManager::add_image: float image limit reached %d, skipping '%s'\n",
-				       tex_num_float_images, filename.c_str());
-				return -1;
-			}
+	is_float = (type == IMAGE_DATA_TYPE_FLOAT4 || type == IMAGE_DATA_TYPE_HALF4 || type == IMAGE_DATA_TYPE_FLOAT);
 
-			float_images.resize(float_images.size() + 1);
+	/* find existing image */
+	for(slot = 0; slot < images[type].size(); slot++) {
+		if(images[type][slot] && images[type][slot]->filename == filename) {
+			images[type][slot]->users++;
+			return type_index_to_slot(slot, type);
 		}
+	}
 
-		/* add new image */
-		img = new Image();
-		img->filename = filename;
-		img->builtin_data = builtin_data;
-		img->need_load = true;
-		img->animated = animated;
-		img->users = 1;
-
-		float_images[slot] = img;
+	/* find free slot */
+	for(slot = 0; slot < images[type].size(); slot++) {
+		if(!images[type][slot])
+			break;
 	}
-	else {
-		for(slot = 0; slot < images.size(); slot++) {
-			if(images[slot] && images[slot]->filename == filename) {
-				images[slot]->users++;
-				return slot+tex_image_byte_start;
-			}
-		}
 
-		/* find free slot */
-		for(slot = 0; slot < images.size(); slot++) {
-			if(!images[slot])
-				break;
+	if(slot == images[type].size()) {
+		/* max images limit reached */
+		if(images[type].size() == tex_num_images[type]) {
+			printf("ImageManager::add_image: %s image limit reached %d, skipping '%s'\n",
+			       (is_float)? "float": "byte", tex_num_images[type], filename.c_str());
+			return -1;
 		}
 
-		if(slot == images.size()) {
-			/* max images limit reached */
-			if(images.size() == tex_num_images) {
-				printf("ImageManager::add_image: byte image limit reached %d, skipping '%s'\n",
-				       tex_num_images, filename.c_str());
-				return -1;
-			}
-
-			images.resize(images.size() + 1);
-		}
+		images[type].resize(images[type].size() + 1);
+	}
 
-		/* add new image */
-		img = new Image();
-		img->filename = filename;
-		img->builtin_data = builtin_data;
-		img->need_load = true;
-		img->animated = animated;
-		img->users = 1;
+	/* add new image */
+	img = new Image();
+	img->filename = filename;
+	img->builtin_data = builtin_data;
+	img->need_load = true;
+	img->animated = animated;
+	img->users = 1;
 
-		images[slot] = img;
+	images[type][slot] = img;
 
-		slot += tex_image_byte_start;
-	}
 	need_update = true;
 
-	return slot;
+	return type_index_to_slot(slot, type);
 }
 
 void ImageManager::remove_image(const string& filename, void *builtin_data)
 {
-	size_t slot;
-
-	for(slot = 0; slot < images.size(); slot++) {
-		if(images[slot] && images[slot]->filename == filename && images[slot]->builtin_data == builtin_data) {
-			/* decrement user count */
-			images[slot]->users--;
-			assert(images[slot]->users >= 0);
-
-			/* don't remove immediately, rather do it all together later on. one of
-			 * the reasons for this is that on shader changes we add and remove nodes
-			 * that use them, but we do not want to reload the image all the time. */
-			if(images[slot]->users == 0)
-				need_update = true;
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		for(size_t slot = 0; slot < images[type].size(); slot++) {
+			Image *img = images[type][slot];
 
-			break;
-		}
-	}
-
-	if(slot == images.size()) {
-		/* see if it's in a float texture slot */
-		for(slot = 0; slot < float_images.size(); slot++) {
-			if(float_images[slot] && float_images[slot]->filename == filename && float_images[slot]->builtin_data == builtin_data) {
+			if(img && img->filename == filename && img->builtin_data == builtin_data) {
 				/* decrement user count */
-				float_images[slot]->users--;
-				assert(float_images[slot]->users >= 0);
+				img->users--;
+				assert(img->users >= 0);
 
 				/* don't remove immediately, rather do it all together later on. one of
 				 * the reasons for this is that on shader changes we add and remove nodes
 				 * that use them, but we do not want to reload the image all the time. */
-				if(float_images[slot]->users == 0)
+				if(img->users == 0)
 					need_update = true;
 
-				break;
+				return;
 			}
 		}
 	}
 }
 
-bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
+/* pixel value of one for each storage type, half one is 0x3c00 */
+template<typename S> static S image_pixel_one();
+template<> float image_pixel_one<float>() { return 1.0f; }
+template<> uchar image_pixel_one<uchar>() { return 255; }
+template<> half image_pixel_one<half>() { return 0x3c00; }
+
+static TypeDesc image_file_format(ImageDataType type)
+{
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4:
+		case IMAGE_DATA_TYPE_FLOAT:
+			return TypeDesc::FLOAT;
+		case IMAGE_DATA_TYPE_HALF4:
+			return TypeDesc::HALF;
+		default:
+			return TypeDesc::UINT8;
+	}
+}
+
+template<typename S, typename T>
+bool ImageManager::file_load_image(Image *img, ImageDataType type, device_vector<T>& tex_img)
 {
+	const int storage_channels = sizeof(T)/sizeof(S);
+	const TypeDesc format = image_file_format(type);
+
 	if(img->filename == "")
 		return false;
 
@@ -297,15 +353,24 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 	}
 	else {
 		/* load image using builtin images callbacks */
-		if(!builtin_image_info_cb || !builtin_image_pixels_cb)
+		if(!builtin_image_info_cb)
+			return false;
+		if(format == TypeDesc::UINT8 && !builtin_image_pixels_cb)
+			return false;
+		if(format == TypeDesc::FLOAT && !builtin_image_float_pixels_cb)
+			return false;
+		if(format == TypeDesc::HALF || storage_channels != 4)
 			return false;
 
 		bool is_float;
 		builtin_image_info_cb(img->filename, img->builtin_data, is_float, width, height, components);
 	}
 
-	/* we only handle certain number of components */
-	if(!(components == 1 || components == 3 || components == 4)) {
+	/* we only handle certain number of components, and single channel
+	 * storage only for single channel images */
+	if(!(components == 1 || components == 3 || components == 4) ||
+	   (storage_channels == 1 && components != 1))
+	{
 		if(in) {
 			in->close();
 			delete in;
@@ -315,11 +380,11 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 	}
 
 	/* read RGBA pixels */
-	uchar *pixels = (uchar*)tex_img.resize(width, height);
-	int scanlinesize = width*components*sizeof(uchar);
+	S *pixels = (S*)tex_img.resize(width, height);
+	int scanlinesize = width*components*sizeof(S);
 
 	if(in) {
-		in->read_image(TypeDesc::UINT8,
+		in->read_image(format,
 			(uchar*)pixels + (height-1)*scanlinesize,
 			AutoStride,
 			-scanlinesize,
@@ -328,110 +393,76 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 		in->close();
 		delete in;
 	}
+	else if(format == TypeDesc::FLOAT) {
+		builtin_image_float_pixels_cb(img->filename, img->builtin_data, (float*)pixels);
+	}
 	else {
-		builtin_image_pixels_cb(img->filename, img->builtin_data, pixels);
+		builtin_image_pixels_cb(img->filename, img->builtin_data, (uchar*)pixels);
 	}
 
-	if(components == 3) {
-		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = 255;
-			pixels[i*4+2] = pixels[i*3+2];
-			pixels[i*4+1] = pixels[i*3+1];
-			pixels[i*4+0] = pixels[i*3+0];
+	if(storage_channels == 4) {
+		const S one = image_pixel_one<S>();
+
+		if(components == 3) {
+			for(int i = width*height-1; i >= 0; i--) {
+				pixels[i*4+3] = one;
+				pixels[i*4+2] = pixels[i*3+2];
+				pixels[i*4+1] = pixels[i*3+1];
+				pixels[i*4+0] = pixels[i*3+0];
+			}
 		}
-	}
-	else if(components == 1) {
-		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = 255;
-			pixels[i*4+2] = pixels[i];
-			pixels[i*4+1] = pixels[i];
-			pixels[i*4+0] = pixels[i];
+		else if(components == 1) {
+			for(int i = width*height-1; i >= 0; i--) {
+				pixels[i*4+3] = one;
+				pixels[i*4+2] = pixels[i];
+				pixels[i*4+1] = pixels[i];
+				pixels[i*4+0] = pixels[i];
+			}
 		}
 	}
 
 	return true;
 }
 
-bool ImageManager::file_load_float_image(Image *img, device_vector<float4>& tex_img)
+template<typename S, typename T>
+void ImageManager::device_load_image_pixels(Device *device, Image *img, ImageDataType type, int slot, device_vector<T>& tex_img)
 {
-	if(img->filename == "")
-		return false;
-
-	ImageInput *in = NULL;
-	int width, height, components;
-
-	if(!img->builtin_data) {
-		/* load image from file through OIIO */
-		in = ImageInput::create(img->filename);
-
-		if(!in)
-			return false;
-
-		ImageSpec spec;
-
-		if(!in->open(img->filename, spec)) {
-			delete in;
-			return false;
-		}
-
-		/* we only handle certain number of components */
-		width = spec.width;
-		height = spec.height;
-		components = spec.nchannels;
+	if(tex_img.device_pointer) {
+		thread_scoped_lock device_lock(device_mutex);
+		device->tex_free(tex_img);
 	}
-	else {
-		/* load image using builtin images callbacks */
-		if(!builtin_image_info_cb || !builtin_image_float_pixels_cb)
-			return false;
 
-		bool is_float;
-		builtin_image_info_cb(img->filename, img->builtin_data, is_float, width, height, components);
-	}
+	if(!file_load_image<S>(img, type, tex_img)) {
+		/* on failure to load, we set a 1x1 pixels pink image, or white
+		 * for single channel images */
+		const int storage_channels = sizeof(T)/sizeof(S);
+		const S one = image_pixel_one<S>();
+		S *pixels = (S*)tex_img.resize(1, 1);
 
-	if(!(components == 1 || components == 3 || components == 4)) {
-		if(in) {
-			in->close();
-			delete in;
+		pixels[0] = (TEX_IMAGE_MISSING_R * one);
+
+		if(storage_channels == 4) {
+			pixels[1] = (TEX_IMAGE_MISSING_G * one);
+			pixels[2] = (TEX_IMAGE_MISSING_B * one);
+			pixels[3] = (TEX_IMAGE_MISSING_A * one);
 		}
-		return false;
 	}
 
-	/* read RGBA pixels */
-	float *pixels = (float*)tex_img.resize(width, height);
-	int scanlinesize = width*components*sizeof(float);
-
-	if(in) {
-		in->read_image(TypeDesc::FLOAT,
-			(uchar*)pixels + (height-1)*scanlinesize,
-			AutoStride,
-			-scanlinesize,
-			AutoStride);
+	string name;
 
-		in->close();
-		delete in;
-	}
-	else {
-		builtin_image_float_pixels_cb(img->filename, img->builtin_data, pixels);
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4: name = string_printf("__tex_image_float_%03d", slot); break;
+		case IMAGE_DATA_TYPE_BYTE4: name = string_printf("__tex_image_%03d", slot); break;
+		case IMAGE_DATA_TYPE_HALF4: name = string_printf("__tex_image_half4_%03d", slot); break;
+		case IMAGE_DATA_TYPE_FLOAT: name = string_printf("__tex_image_float1_%03d", slot); break;
+		case IMAGE_DATA_TYPE_BYTE: name = string_printf("__tex_image_byte1_%03d", slot); break;
+		default: assert(0); return;
 	}
 
-	if(components == 3) {
-		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = 1.0f;
-			pixels[i*4+2] = pixels[i*3+2];
-			pixels[i*4+1] = pixels[i*3+1];
-			pixels[i*4+0] = pixels[i*3+0];
-		}
+	if(!pack_images) {
+		thread_scoped_lock device_lock(device_mutex);
+		device->tex_alloc(name.c_str(), tex_img, true, true);
 	}
-	else if(components == 1) {
-		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = 1.0f;
-			pixels[i*4+2] = pixels[i];
-			pixels[i*4+1] = pixels[i];
-			pixels[i*4+0] = pixels[i];
-		}
-	}
-
-	return true;
 }
 
 void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int slot, Progress *progress)
@@ -441,130 +472,91 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int sl
 	if(osl_texture_system)
 		return;
 
-	Image *img;
-	bool is_float;
-
-	if(slot >= tex_image_byte_start) {
-		img = images[slot - tex_image_byte_start];
-		is_float = false;
-	}
-	else {
-		img = float_images[slot];
-		is_float = true;
-	}
-
-	if(is_float) {
-		string filename = path_filename(float_images[slot]->filename);
-		progress->set_status("Updating Images", "Loading " + filename);
-
-		device_vector<float4>& tex_img = dscene->tex_float_image[slot];
-
-		if(tex_img.device_pointer) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_free(tex_img);
-		}
-
-		if(!file_load_float_image(img, tex_img)) {
-			/* on failure to load, we set a 1x1 pixels pink image */
-			float *pixels = (float*)tex_img.resize(1, 1);
-
-			pixels[0] = TEX_IMAGE_MISSING_R;
-			pixels[1] = TEX_IMAGE_MISSING_G;
-			pixels[2] = TEX_IMAGE_MISSING_B;
-			pixels[3] = TEX_IMAGE_MISSING_A;
-		}
+	ImageDataType type;
+	int index = slot_to_type_index(slot, &type);
+	Image *img = images[type][index];
 
-		string name;
+	if(texture_cache) {
+		/* file images are read on demand, builtin images have their pixels
+		 * in memory already so there's nothing to gain */
+		thread_scoped_lock device_lock(device_mutex);
 
-		if(slot >= 10) name = string_printf("__tex_image_float_0%d", slot);
-		else name = string_printf("__tex_image_float_00%d", slot);
+		texture_cache->remove_image(slot);
 
-		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(), tex_img, true, true);
+		if(!img->builtin_data && texture_cache->add_image(slot, img->filename)) {
+			img->need_load = false;
+			return;
 		}
 	}
-	else {
-		string filename = path_filename(images[slot - tex_image_byte_start]->filename);
-		progress->set_status("Updating Images", "Loading " + filename);
-
-		device_vector<uchar4>& tex_img = dscene->tex_image[slot - tex_image_byte_start];
-
-		if(tex_img.device_pointer) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_free(tex_img);
-		}
-
-		if(!file_load_image(img, tex_img)) {
-			/* on failure to load, we set a 1x1 pixels pink image */
-			uchar *pixels = (uchar*)tex_img.resize(1, 1);
 
-			pixels[0] = (TEX_IMAGE_MISSING_R * 255);
-			pixels[1] = (TEX_IMAGE_MISSING_G * 255);
-			pixels[2] = (TEX_IMAGE_MISSING_B * 255);
-			pixels[3] = (TEX_IMAGE_MISSING_A * 255);
-		}
+	string filename = path_filename(img->filename);
+	progress->set_status("Updating Images", "Loading " + filename);
 
-		string name;
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4:
+			device_load_image_pixels<float>(device, img, type, slot, dscene->tex_float_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_BYTE4:
+			device_load_image_pixels<uchar>(device, img, type, slot, dscene->tex_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_HALF4:
+			device_load_image_pixels<half>(device, img, type, slot, dscene->tex_half4_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_FLOAT:
+			device_load_image_pixels<float>(device, img, type, slot, dscene->tex_float1_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_BYTE:
+			device_load_image_pixels<uchar>(device, img, type, slot, dscene->tex_byte1_image[index]);
+			break;
+		default:
+			assert(0);
+			return;
+	}
 
-		if(slot >= 10) name = string_printf("__tex_image_0%d", slot);
-		else name = string_printf("__tex_image_00%d", slot);
+	img->need_load = false;
+}
 
-		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(), tex_img, true, true);
-		}
+template<typename T>
+void ImageManager::device_free_image_pixels(Device *device, device_vector<T>& tex_img)
+{
+	if(tex_img.device_pointer) {
+		thread_scoped_lock device_lock(device_mutex);
+		device->tex_free(tex_img);
 	}
 
-	img->need_load = false;
+	tex_img.clear();
 }
 
 void ImageManager::device_free_image(Device *device, DeviceScene *dscene, int slot)
 {
-	Image *img;
-	bool is_float;
-
-	if(slot >= tex_image_byte_start) {
-		img = images[slot - tex_image_byte_start];
-		is_float = false;
-	}
-	else {
-		img = float_images[slot];
-		is_float = true;
-	}
+	ImageDataType type;
+	int index = slot_to_type_index(slot, &type);
+	Image *img = images[type][index];
 
 	if(img) {
 		if(osl_texture_system) {
 #ifdef WITH_OSL
-			ustring filename(images[slot]->filename);
+			ustring filename(img->filename);
 			((OSL::TextureSystem*)osl_texture_system)->invalidate(filename);
 #endif
 		}
-		else if(is_float) {
-			device_vector<float4>& tex_img = dscene->tex_float_image[slot];
-
-			if(tex_img.device_pointer) {
-				thread_scoped_lock device_lock(device_mutex);
-				device->tex_free(tex_img);
-			}
-
-			tex_img.clear();
-
-			delete float_images[slot];
-			float_images[slot] = NULL;
-		}
 		else {
-			device_vector<uchar4>& tex_img = dscene->tex_image[slot - tex_image_byte_start];
-
-			if(tex_img.device_pointer) {
+			if(texture_cache) {
 				thread_scoped_lock device_lock(device_mutex);
-				device->tex_free(tex_img);
+				texture_cache->remove_image(slot);
 			}
 
-			tex_img.clear();
+			switch(type) {
+				case IMAGE_DATA_TYPE_FLOAT4: device_free_image_pixels(device, dscene->tex_float_image[index]); break;
+				case IMAGE_DATA_TYPE_BYTE4: device_free_image_pixels(device, dscene->tex_image[index]); break;
+				case IMAGE_DATA_TYPE_HALF4: device_free_image_pixels(device, dscene->tex_half4_image[index]); break;
+				case IMAGE_DATA_TYPE_FLOAT: device_free_image_pixels(device, dscene->tex_float1_image[index]); break;
+				case IMAGE_DATA_TYPE_BYTE: device_free_image_pixels(device, dscene->tex_byte1_image[index]); break;
+				default: assert(0); break;
+			}
 
-			delete images[slot - tex_image_byte_start];
-			images[slot - tex_image_byte_start] = NULL;
+			delete img;
+			images[type][index] = NULL;
 		}
 	}
 }
@@ -574,31 +566,25 @@ void ImageManager::device_update(Device *device, DeviceScene *dscene, Progress&
 	if(!need_update)
 		return;
 
-	TaskPool pool;
+	if(texture_cache)
+		device->set_texture_cache(texture_cache);
 
-	for(size_t slot = 0; slot < images.size(); slot++) {
-		if(!images[slot])
-			continue;
+	TaskPool pool;
 
-		if(images[slot]->users == 0) {
-			device_free_image(device, dscene, slot + tex_image_byte_start);
-		}
-		else if(images[slot]->need_load) {
-			if(!osl_texture_system) 
-				pool.push(function_bind(&ImageManager::device_load_image, this, device, dscene, slot + tex_image_byte_start, &progress));
-		}
-	}
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		for(size_t index = 0; index < images[type].size(); index++) {
+			if(!images[type][index])
+				continue;
 
-	for(size_t slot = 0; slot < float_images.size(); slot++) {
-		if(!float_images[slot])
-			continue;
+			int slot = type_index_to_slot(index, (ImageDataType)type);
 
-		if(float_images[slot]->users == 0) {
-			device_free_image(device, dscene, slot);
-		}
-		else if(float_images[slot]->need_load) {
-			if(!osl_texture_system) 
-				pool.push(function_bind(&ImageManager::device_load_image, this, device, dscene, slot, &progress));
+			if(images[type][index]->users == 0) {
+				device_free_image(device, dscene, slot);
+			}
+			else if(images[type][index]->need_load) {
+				if(!osl_texture_system) 
+					pool.push(function_bind(&ImageManager::device_load_image, this, device, dscene, slot, &progress));
+			}
 		}
 	}
 
@@ -614,23 +600,24 @@ void ImageManager::device_pack_images(Device *device, DeviceScene *dscene, Progr
 {
 	/* for OpenCL, we pack all image textures inside a single big texture, and
 	 * will do our own interpolation in the kernel */
+	vector<Image*>& byte_images = images[IMAGE_DATA_TYPE_BYTE4];
 	size_t size = 0;
 
-	for(size_t slot = 0; slot < images.size(); slot++) {
-		if(!images[slot])
+	for(size_t slot = 0; slot < byte_images.size(); slot++) {
+		if(!byte_images[slot])
 			continue;
 
 		device_vector<uchar4>& tex_img = dscene->tex_image[slot];
 		size += tex_img.size();
 	}
 
-	uint4 *info = dscene->tex_image_packed_info.resize(images.size());
+	uint4 *info = dscene->tex_image_packed_info.resize(byte_images.size());
 	uchar4 *pixels = dscene->tex_image_packed.resize(size);
 
 	size_t offset = 0;
 
-	for(size_t slot = 0; slot < images.size(); slot++) {
-		if(!images[slot])
+	for(size_t slot = 0; slot < byte_images.size(); slot++) {
+		if(!byte_images[slot])
 			continue;
 
 		device_vector<uchar4>& tex_img = dscene->tex_image[slot];
@@ -649,19 +636,21 @@ void ImageManager::device_pack_images(Device *device, DeviceScene *dscene, Progr
 
 void ImageManager::device_free(Device *device, DeviceScene *dscene)
 {
-	for(size_t slot = 0; slot < images.size(); slot++)
-		device_free_image(device, dscene, slot + tex_image_byte_start);
-	for(size_t slot = 0; slot < float_images.size(); slot++)
-		device_free_image(device, dscene, slot);
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		for(size_t index = 0; index < images[type].size(); index++)
+			device_free_image(device, dscene, type_index_to_slot(index, (ImageDataType)type));
+
+		images[type].clear();
+	}
+
+	if(texture_cache)
+		device->set_texture_cache(NULL);
 
 	device->tex_free(dscene->tex_image_packed);
 	device->tex_free(dscene->tex_image_packed_info);
 
 	dscene->tex_image_packed.clear();
 	dscene->tex_image_packed_info.clear();
-
-	images.clear();
-	float_images.clear();
 }
 
 CCL_NAMESPACE_END
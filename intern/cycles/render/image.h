@@ -33,7 +33,7 @@ CCL_NAMESPACE_BEGIN
 #define TEX_IMAGE_BYTE_START	TEX_NUM_FLOAT_IMAGES
 
 #define TEX_EXTENDED_NUM_FLOAT_IMAGES	5
-#define TEX_EXTENDED_NUM_IMAGES			512
+#define TEX_EXTENDED_NUM_IMAGES			TEX_NUM_BYTE_IMAGES_CPU
 #define TEX_EXTENDED_IMAGE_BYTE_START	TEX_EXTENDED_NUM_FLOAT_IMAGES
 
 /* color to use when textures are not found */
@@ -45,6 +45,19 @@ CCL_NAMESPACE_BEGIN
 class Device;
 class DeviceScene;
 class Progress;
+class TextureCache;
+
+/* storage types, half float and single channel types are only available
+ * with the extended image limits */
+enum ImageDataType {
+	IMAGE_DATA_TYPE_FLOAT4 = 0,
+	IMAGE_DATA_TYPE_BYTE4,
+	IMAGE_DATA_TYPE_HALF4,
+	IMAGE_DATA_TYPE_FLOAT,
+	IMAGE_DATA_TYPE_BYTE,
+
+	IMAGE_DATA_NUM_TYPES
+};
 
 class ImageManager {
 public:
@@ -54,11 +67,14 @@ public:
 	int add_image(const string& filename, void *builtin_data, bool animated, bool& is_float, bool& is_linear);
 	void remove_image(const string& filename, void *builtin_data);
 	bool is_float_image(const string& filename, void *builtin_data, bool& is_linear);
+	ImageDataType get_image_metadata(const string& filename, void *builtin_data, bool& is_linear);
 
 	void device_update(Device *device, DeviceScene *dscene, Progress& progress);
 	void device_free(Device *device, DeviceScene *dscene);
 
 	void set_osl_texture_system(void *texture_system);
+	void set_texture_cache(int max_memory_MB);
+	bool has_texture_cache() { return texture_cache != NULL; }
 	void set_pack_images(bool pack_images_);
 	void set_extended_image_limits(void);
 	bool set_animation_frame_update(int frame);
@@ -69,9 +85,8 @@ public:
 	boost::function<bool(const string &filename, void *data, unsigned char *pixels)> builtin_image_pixels_cb;
 	boost::function<bool(const string &filename, void *data, float *pixels)> builtin_image_float_pixels_cb;
 private:
-	int tex_num_images;
-	int tex_num_float_images;
-	int tex_image_byte_start;
+	int tex_num_images[IMAGE_DATA_NUM_TYPES];
+	int tex_start_images[IMAGE_DATA_NUM_TYPES];
 	thread_mutex device_mutex;
 	int animation_frame;
 
@@ -84,15 +99,22 @@ private:
 		int users;
 	};
 
-	vector<Image*> images;
-	vector<Image*> float_images;
+	vector<Image*> images[IMAGE_DATA_NUM_TYPES];
 	void *osl_texture_system;
+	TextureCache *texture_cache;
 	bool pack_images;
 
-	bool file_load_image(Image *img, device_vector<uchar4>& tex_img);
-	bool file_load_float_image(Image *img, device_vector<float4>& tex_img);
+	int type_index_to_slot(int index, ImageDataType type);
+	int slot_to_type_index(int slot, ImageDataType *type);
+
+	template<typename S, typename T>
+	bool file_load_image(Image *img, ImageDataType type, device_vector<T>& tex_img);
 
+	template<typename S, typename T>
+	void device_load_image_pixels(Device *device, Image *img, ImageDataType type, int slot, device_vector<T>& tex_img);
 	void device_load_image(Device *device, DeviceScene *dscene, int slot, Progress *progess);
+	template<typename T>
+	void device_free_image_pixels(Device *device, device_vector<T>& tex_img);
 	void device_free_image(Device *device, DeviceScene *dscene, int slot);
 
 	void device_pack_images(Device *device, DeviceScene *dscene, Progress& progess);
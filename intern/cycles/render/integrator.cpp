@@ -55,6 +55,7 @@ Integrator::Integrator()
 	ao_samples = 1;
 	mesh_light_samples = 1;
 	progressive = true;
+	use_light_tree = false;
 
 	need_update = true;
 }
@@ -163,6 +164,7 @@ bool Integrator::modified(const Integrator& integrator)
 		transmission_samples == integrator.transmission_samples &&
 		ao_samples == integrator.ao_samples &&
 		mesh_light_samples == integrator.mesh_light_samples &&
+		use_light_tree == integrator.use_light_tree &&
 		motion_blur == integrator.motion_blur);
 }
 
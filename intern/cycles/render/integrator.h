@@ -56,6 +56,7 @@ public:
 	int mesh_light_samples;
 
 	bool progressive;
+	bool use_light_tree;
 
 	bool need_update;
 
@@ -19,6 +19,7 @@
 #include "device.h"
 #include "integrator.h"
 #include "light.h"
+#include "light_tree.h"
 #include "mesh.h"
 #include "object.h"
 #include "scene.h"
@@ -93,6 +94,26 @@ static void dump_background_pixels(Device *device, DeviceScene *dscene, int res,
 	}
 }
 
+static BoundBox light_tree_bounds(Light *light)
+{
+	BoundBox bounds = BoundBox::empty;
+
+	if(light->type == LIGHT_AREA) {
+		float3 axisu = light->axisu*(light->sizeu*light->size);
+		float3 axisv = light->axisv*(light->sizev*light->size);
+		float3 extent = 0.5f*(fabs(axisu) + fabs(axisv));
+
+		bounds.grow(light->co - extent);
+		bounds.grow(light->co + extent);
+	}
+	else {
+		/* point and spot lights, spot cone is ignored */
+		bounds.grow(light->co, light->size);
+	}
+
+	return bounds;
+}
+
 /* Light */
 
 Light::Light()
@@ -192,6 +213,11 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 	float4 *distribution = dscene->light_distribution.resize(num_distribution + 1);
 	float totarea = 0.0f;
 
+	/* light tree, only used by the progressive integrator */
+	bool use_light_tree = scene->integrator->use_light_tree && scene->integrator->progressive;
+	vector<LightTreeEmitter> tree_emitters;
+	vector<LightTreeEmitter> tree_infinite_emitters;
+
 	/* triangles */
 	size_t offset = 0;
 	int j = 0;
@@ -233,7 +259,6 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 					distribution[offset].y = __int_as_float(i + mesh->tri_offset);
 					distribution[offset].z = __int_as_float(~0);
 					distribution[offset].w = __int_as_float(object_id);
-					offset++;
 
 					Mesh::Triangle t = mesh->triangles[i];
 					float3 p1 = mesh->verts[t.v[0]];
@@ -246,7 +271,19 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 						p3 = transform_point(&tfm, p3);
 					}
 
-					totarea += triangle_area(p1, p2, p3);
+					float area = triangle_area(p1, p2, p3);
+
+					if(use_light_tree) {
+						BoundBox bounds = BoundBox::empty;
+						bounds.grow(p1);
+						bounds.grow(p2);
+						bounds.grow(p3);
+
+						tree_emitters.push_back(LightTreeEmitter(bounds, area, offset));
+					}
+
+					totarea += area;
+					offset++;
 				}
 			}
 
@@ -309,6 +346,13 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 			use_lamp_mis = true;
 		if(light->type == LIGHT_BACKGROUND)
 			num_background_lights++;
+
+		if(use_light_tree) {
+			if(light->type == LIGHT_DISTANT || light->type == LIGHT_BACKGROUND)
+				tree_infinite_emitters.push_back(LightTreeEmitter(BoundBox::empty, lightarea, offset));
+			else
+				tree_emitters.push_back(LightTreeEmitter(light_tree_bounds(light), lightarea, offset));
+		}
 	}
 
 	/* normalize cumulative distribution functions */
@@ -370,6 +414,14 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 
 		/* CDF */
 		device->tex_alloc("__light_distribution", dscene->light_distribution);
+
+		/* light tree */
+		kintegrator->use_light_tree = false;
+		kintegrator->light_tree_num_emitters = 0;
+		kintegrator->light_tree_pdf = 0.0f;
+
+		if(use_light_tree && tree_emitters.size())
+			device_update_tree(device, dscene, tree_emitters, tree_infinite_emitters, num_distribution, totarea);
 	}
 	else {
 		dscene->light_distribution.clear();
@@ -380,10 +432,57 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		kintegrator->pdf_lights = 0.0f;
 		kintegrator->inv_pdf_lights = 0.0f;
 		kintegrator->use_lamp_mis = false;
+		kintegrator->use_light_tree = false;
+		kintegrator->light_tree_num_emitters = 0;
+		kintegrator->light_tree_pdf = 0.0f;
 		kfilm->pass_shadow_scale = 1.0f;
 	}
 }
 
+void LightManager::device_update_tree(Device *device, DeviceScene *dscene, vector<LightTreeEmitter>& emitters,
+	vector<LightTreeEmitter>& infinite_emitters, size_t num_distribution, float totarea)
+{
+	/* build, this reorders the emitters */
+	LightTree tree(emitters);
+
+	/* emitters in tree order, followed by lights without a position */
+	uint *tree_emitters = dscene->light_tree_emitters.resize(num_distribution);
+	uint *tree_position = dscene->light_tree_position.resize(num_distribution);
+	float tree_energy = 0.0f;
+	size_t offset = 0;
+
+	/* distribution entries not in the tree are never looked up */
+	memset(tree_position, 0, sizeof(uint)*num_distribution);
+
+	foreach(LightTreeEmitter& emitter, emitters) {
+		tree_emitters[offset] = emitter.index;
+		tree_position[emitter.index] = offset;
+		tree_energy += emitter.energy;
+		offset++;
+	}
+
+	foreach(LightTreeEmitter& emitter, infinite_emitters) {
+		tree_emitters[offset] = emitter.index;
+		tree_position[emitter.index] = offset;
+		offset++;
+	}
+
+	float4 *nodes = dscene->light_tree_nodes.resize(tree.nodes.size());
+	memcpy(nodes, &tree.nodes[0], sizeof(float4)*tree.nodes.size());
+
+	/* probability of sampling the tree rather than the lights without a
+	 * position, same as in the flat distribution */
+	KernelIntegrator *kintegrator = &dscene->data.integrator;
+
+	kintegrator->use_light_tree = true;
+	kintegrator->light_tree_num_emitters = emitters.size();
+	kintegrator->light_tree_pdf = (infinite_emitters.size())? tree_energy/totarea: 1.0f;
+
+	device->tex_alloc("__light_tree_nodes", dscene->light_tree_nodes);
+	device->tex_alloc("__light_tree_emitters", dscene->light_tree_emitters);
+	device->tex_alloc("__light_tree_position", dscene->light_tree_position);
+}
+
 void LightManager::device_update_background(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	KernelIntegrator *kintegrator = &dscene->data.integrator;
@@ -604,11 +703,17 @@ void LightManager::device_free(Device *device, DeviceScene *dscene)
 	device->tex_free(dscene->light_data);
 	device->tex_free(dscene->light_background_marginal_cdf);
 	device->tex_free(dscene->light_background_conditional_cdf);
+	device->tex_free(dscene->light_tree_nodes);
+	device->tex_free(dscene->light_tree_emitters);
+	device->tex_free(dscene->light_tree_position);
 
 	dscene->light_distribution.clear();
 	dscene->light_data.clear();
 	dscene->light_background_marginal_cdf.clear();
 	dscene->light_background_conditional_cdf.clear();
+	dscene->light_tree_nodes.clear();
+	dscene->light_tree_emitters.clear();
+	dscene->light_tree_position.clear();
 }
 
 void LightManager::tag_update(Scene *scene)
@@ -28,6 +28,7 @@ CCL_NAMESPACE_BEGIN
 
 class Device;
 class DeviceScene;
+class LightTreeEmitter;
 class Progress;
 class Scene;
 
@@ -76,6 +77,8 @@ protected:
 	void device_update_points(Device *device, DeviceScene *dscene, Scene *scene);
 	void device_update_distribution(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_update_background(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
+	void device_update_tree(Device *device, DeviceScene *dscene, vector<LightTreeEmitter>& emitters,
+		vector<LightTreeEmitter>& infinite_emitters, size_t num_distribution, float totarea);
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "light_tree.h"
+
+#include "util_algorithm.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct LightTreeEmitterCompare {
+public:
+	int dim;
+
+	LightTreeEmitterCompare(int dim_)
+	{
+		dim = dim_;
+	}
+
+	bool operator()(const LightTreeEmitter& ea, const LightTreeEmitter& eb)
+	{
+		float ca = ea.bounds.min[dim] + ea.bounds.max[dim];
+		float cb = eb.bounds.min[dim] + eb.bounds.max[dim];
+
+		if(ca < cb) return true;
+		else if(ca > cb) return false;
+
+		return ea.index < eb.index;
+	}
+};
+
+LightTree::LightTree(vector<LightTreeEmitter>& emitters_, int max_leaf_size_)
+: emitters(emitters_), max_leaf_size(max_leaf_size_)
+{
+	if(emitters.size())
+		recursive_build(0, emitters.size());
+}
+
+int LightTree::recursive_build(int start, int end)
+{
+	int node = num_nodes();
+	nodes.resize(nodes.size() + LIGHT_TREE_NODE_SIZE);
+
+	/* bounds and energy */
+	BoundBox bounds = BoundBox::empty;
+	BoundBox centroid_bounds = BoundBox::empty;
+	float energy = 0.0f;
+
+	for(int i = start; i < end; i++) {
+		bounds.grow(emitters[i].bounds);
+		centroid_bounds.grow(emitters[i].bounds.center());
+		energy += emitters[i].energy;
+	}
+
+	/* split at the middle of the largest centroid axis, falling back to the
+	 * median when all emitters end up on one side */
+	int right = -1;
+
+	if(end - start > max_leaf_size) {
+		float3 size = centroid_bounds.size();
+		int dim = (size.x > size.y)? ((size.x > size.z)? 0: 2): ((size.y > size.z)? 1: 2);
+
+		sort(emitters.begin() + start, emitters.begin() + end, LightTreeEmitterCompare(dim));
+
+		float middle = centroid_bounds.min[dim] + centroid_bounds.max[dim];
+		int split = start;
+
+		while(split < end && emitters[split].bounds.min[dim] + emitters[split].bounds.max[dim] < middle)
+			split++;
+
+		if(split == start || split == end)
+			split = (start + end)/2;
+
+		recursive_build(start, split);
+		right = recursive_build(split, end);
+	}
+
+	/* pack, children are built first so the array may have been resized */
+	float4 *n = &nodes[node*LIGHT_TREE_NODE_SIZE];
+
+	n[0] = make_float4(bounds.min.x, bounds.min.y, bounds.min.z, energy);
+	n[1] = make_float4(bounds.max.x, bounds.max.y, bounds.max.z, 0.0f);
+	n[2] = make_float4(__int_as_float(start), __int_as_float(end - start), __int_as_float(right), 0.0f);
+
+	return node;
+}
+
+CCL_NAMESPACE_END
+
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "kernel_types.h"
+
+#include "util_boundbox.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree Emitter
+ *
+ * Entry of the light distribution with a finite position, along with its
+ * bounds and the weight it has in the distribution. */
+
+class LightTreeEmitter {
+public:
+	BoundBox bounds;
+	float energy;
+	int index;
+
+	LightTreeEmitter(const BoundBox& bounds_, float energy_, int index_)
+	: bounds(bounds_), energy(energy_), index(index_) {}
+};
+
+/* Light Tree
+ *
+ * Binary tree over emitters, so lights can be picked by an estimate of their
+ * contribution to the shading point instead of by their weight alone. Nodes
+ * are stored depth first, the left child always directly follows its parent.
+ * Each node is LIGHT_TREE_NODE_SIZE float4's:
+ *
+ * bounds min + summed energy
+ * bounds max
+ * first emitter, number of emitters, right child (-1 for leaves) */
+
+class LightTree {
+public:
+	LightTree(vector<LightTreeEmitter>& emitters, int max_leaf_size = 8);
+
+	/* packed nodes */
+	vector<float4> nodes;
+
+	int num_nodes() { return nodes.size()/LIGHT_TREE_NODE_SIZE; }
+
+protected:
+	int recursive_build(int start, int end);
+
+	vector<LightTreeEmitter>& emitters;
+	int max_leaf_size;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
+
@@ -55,6 +55,13 @@ Mesh::Mesh()
 	curve_offset = 0;
 	curvekey_offset = 0;
 
+	subd_mesh = NULL;
+	subd_cache = NULL;
+	subd_dicing_rate = 1.0f;
+	subd_adaptive = false;
+	subd_shader = 0;
+	subd_smooth = true;
+
 	attributes.triangle_mesh = this;
 	curve_attributes.curve_mesh = this;
 }
@@ -62,6 +69,7 @@ Mesh::Mesh()
 Mesh::~Mesh()
 {
 	delete bvh;
+	clear_subd();
 }
 
 void Mesh::reserve(int numverts, int numtris, int numcurves, int numcurvekeys)
@@ -96,6 +104,8 @@ void Mesh::clear()
 	transform_applied = false;
 	transform_negative_scaled = false;
 	transform_normal = transform_identity();
+
+	clear_subd();
 }
 
 void Mesh::add_triangle(int v0, int v1, int v2, int shader_, bool smooth_)
@@ -595,8 +605,21 @@ void MeshManager::update_svm_attributes(Device *device, DeviceScene *dscene, Sce
 	device->tex_alloc("__attributes_map", dscene->attributes_map);
 }
 
-static void update_attribute_element_offset(Mesh *mesh, vector<float>& attr_float, vector<float4>& attr_float3,
-	Attribute *mattr, TypeDesc& type, int& offset, AttributeElement& element)
+static size_t attribute_element_size(Mesh *mesh, Attribute *mattr)
+{
+	if(!mattr)
+		return 0;
+
+	return mattr->element_size(
+		mesh->verts.size(),
+		mesh->triangles.size(),
+		mesh->curves.size(),
+		mesh->curve_keys.size());
+}
+
+static void update_attribute_element_offset(Mesh *mesh, float *attr_float, size_t& attr_float_offset,
+	float4 *attr_float3, size_t& attr_float3_offset, Attribute *mattr, TypeDesc& type, int& offset,
+	AttributeElement& element, bool copy_data)
 {
 	if(mattr) {
 		/* store element and type */
@@ -604,29 +627,27 @@ static void update_attribute_element_offset(Mesh *mesh, vector<float>& attr_floa
 		type = mattr->type;
 
 		/* store attribute data in arrays */
-		size_t size = mattr->element_size(
-			mesh->verts.size(),
-			mesh->triangles.size(),
-			mesh->curves.size(),
-			mesh->curve_keys.size());
+		size_t size = attribute_element_size(mesh, mattr);
 
 		if(mattr->type == TypeDesc::TypeFloat) {
 			float *data = mattr->data_float();
-			offset = attr_float.size();
+			offset = attr_float_offset;
 
-			attr_float.resize(attr_float.size() + size);
+			if(copy_data)
+				for(size_t k = 0; k < size; k++)
+					attr_float[offset+k] = data[k];
 
-			for(size_t k = 0; k < size; k++)
-				attr_float[offset+k] = data[k];
+			attr_float_offset += size;
 		}
 		else {
 			float3 *data = mattr->data_float3();
-			offset = attr_float3.size();
+			offset = attr_float3_offset;
 
-			attr_float3.resize(attr_float3.size() + size);
+			if(copy_data)
+				for(size_t k = 0; k < size; k++)
+					attr_float3[offset+k] = float3_to_float4(data[k]);
 
-			for(size_t k = 0; k < size; k++)
-				attr_float3[offset+k] = float3_to_float4(data[k]);
+			attr_float3_offset += size;
 		}
 
 		/* mesh vertex/curve index is global, not per object, so we sneak
@@ -649,35 +670,91 @@ static void update_attribute_element_offset(Mesh *mesh, vector<float>& attr_floa
 	}
 }
 
-void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, bool incremental)
 {
 	progress.set_status("Updating Mesh", "Computing attributes");
 
-	/* gather per mesh requested attributes. as meshes may have multiple
-	 * shaders assigned, this merges the requested attributes that have
-	 * been set per shader by the shader manager */
-	vector<AttributeRequestSet> mesh_attributes(scene->meshes.size());
+	vector<AttributeRequestSet> mesh_attributes;
+	device_attribute_requests(scene, mesh_attributes);
+
+	/* mesh attribute are stored in a single array per data type. first we
+	 * compute the size of those arrays */
+	size_t attr_float_size = 0;
+	size_t attr_float3_size = 0;
 
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
 		Mesh *mesh = scene->meshes[i];
+		AttributeRequestSet& attributes = mesh_attributes[i];
 
-		scene->need_global_attributes(mesh_attributes[i]);
+		foreach(AttributeRequest& req, attributes.requests) {
+			Attribute *triangle_mattr = mesh->attributes.find(req);
+			Attribute *curve_mattr = mesh->curve_attributes.find(req);
 
-		foreach(uint sindex, mesh->used_shaders) {
-			Shader *shader = scene->shaders[sindex];
-			mesh_attributes[i].add(shader->attributes);
+			/* todo: get rid of this exception, it's only here for giving some
+			 * working texture coordinate for subdivision as we can't preserve
+			 * any attributes yet */
+			if(!triangle_mattr && req.std == ATTR_STD_GENERATED) {
+				triangle_mattr = mesh->attributes.add(ATTR_STD_GENERATED);
+				if(mesh->verts.size())
+					memcpy(triangle_mattr->data_float3(), &mesh->verts[0], sizeof(float3)*mesh->verts.size());
+			}
+
+			if(triangle_mattr) {
+				if(triangle_mattr->type == TypeDesc::TypeFloat)
+					attr_float_size += attribute_element_size(mesh, triangle_mattr);
+				else
+					attr_float3_size += attribute_element_size(mesh, triangle_mattr);
+			}
+
+			if(curve_mattr) {
+				if(curve_mattr->type == TypeDesc::TypeFloat)
+					attr_float_size += attribute_element_size(mesh, curve_mattr);
+				else
+					attr_float3_size += attribute_element_size(mesh, curve_mattr);
+			}
 		}
 	}
 
-	/* mesh attribute are stored in a single array per data type. here we fill
-	 * those arrays, and set the offset and element type to create attribute
-	 * maps next */
-	vector<float> attr_float;
-	vector<float4> attr_float3;
+	/* when the array sizes did not change, the offsets are the same too and
+	 * only attributes of updated meshes need to be copied */
+	if(incremental && (attr_float_size != dscene->attributes_float.size() ||
+	                   attr_float3_size != dscene->attributes_float3.size()))
+	{
+		incremental = false;
+	}
+
+	float *attr_float = NULL;
+	float4 *attr_float3 = NULL;
+
+	if(incremental) {
+		attr_float = dscene->attributes_float.get_data();
+		attr_float3 = dscene->attributes_float3.get_data();
+	}
+	else {
+		device->tex_free(dscene->attributes_float);
+		device->tex_free(dscene->attributes_float3);
+
+		if(attr_float_size)
+			attr_float = dscene->attributes_float.resize(attr_float_size);
+		else
+			dscene->attributes_float.clear();
+
+		if(attr_float3_size)
+			attr_float3 = dscene->attributes_float3.resize(attr_float3_size);
+		else
+			dscene->attributes_float3.clear();
+	}
+
+	/* here we fill those arrays, and set the offset and element type to
+	 * create attribute maps next */
+	size_t attr_float_offset = 0;
+	size_t attr_float3_offset = 0;
+	bool updated = false;
 
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
 		Mesh *mesh = scene->meshes[i];
 		AttributeRequestSet& attributes = mesh_attributes[i];
+		bool copy_data = !incremental || mesh->need_update;
 
 		/* todo: we now store std and name attributes from requests even if
 		 * they actually refer to the same mesh attributes, optimize */
@@ -685,47 +762,49 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			Attribute *triangle_mattr = mesh->attributes.find(req);
 			Attribute *curve_mattr = mesh->curve_attributes.find(req);
 
-			/* todo: get rid of this exception, it's only here for giving some
-			 * working texture coordinate for subdivision as we can't preserve
-			 * any attributes yet */
-			if(!triangle_mattr && req.std == ATTR_STD_GENERATED) {
-				triangle_mattr = mesh->attributes.add(ATTR_STD_GENERATED);
-				if(mesh->verts.size())
-					memcpy(triangle_mattr->data_float3(), &mesh->verts[0], sizeof(float3)*mesh->verts.size());
-			}
+			update_attribute_element_offset(mesh, attr_float, attr_float_offset, attr_float3, attr_float3_offset,
+				triangle_mattr, req.triangle_type, req.triangle_offset, req.triangle_element, copy_data);
 
-			update_attribute_element_offset(mesh, attr_float, attr_float3, triangle_mattr,
-				req.triangle_type, req.triangle_offset, req.triangle_element);
+			update_attribute_element_offset(mesh, attr_float, attr_float_offset, attr_float3, attr_float3_offset,
+				curve_mattr, req.curve_type, req.curve_offset, req.curve_element, copy_data);
 
-			update_attribute_element_offset(mesh, attr_float, attr_float3, curve_mattr,
-				req.curve_type, req.curve_offset, req.curve_element);
+			if(copy_data)
+				updated = true;
 	
 			if(progress.get_cancel()) return;
 		}
 	}
 
-	/* create attribute lookup maps */
-	if(scene->shader_manager->use_osl())
-		update_osl_attributes(device, scene, mesh_attributes);
-	else
-		update_svm_attributes(device, dscene, scene, mesh_attributes);
+	/* create attribute lookup maps, these only change with the layout */
+	if(!incremental) {
+		device->tex_free(dscene->attributes_map);
+
+		if(scene->shader_manager->use_osl())
+			update_osl_attributes(device, scene, mesh_attributes);
+		else
+			update_svm_attributes(device, dscene, scene, mesh_attributes);
+	}
 
 	if(progress.get_cancel()) return;
 
+	if(!updated)
+		return;
+
 	/* copy to device */
 	progress.set_status("Updating Mesh", "Copying Attributes to device");
 
-	if(attr_float.size()) {
-		dscene->attributes_float.copy(&attr_float[0], attr_float.size());
-		device->tex_alloc("__attributes_float", dscene->attributes_float);
+	if(incremental) {
+		device->tex_free(dscene->attributes_float);
+		device->tex_free(dscene->attributes_float3);
 	}
-	if(attr_float3.size()) {
-		dscene->attributes_float3.copy(&attr_float3[0], attr_float3.size());
+
+	if(attr_float_size)
+		device->tex_alloc("__attributes_float", dscene->attributes_float);
+	if(attr_float3_size)
 		device->tex_alloc("__attributes_float3", dscene->attributes_float3);
-	}
 }
 
-void MeshManager::device_update_mesh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+void MeshManager::device_update_mesh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, bool incremental)
 {
 	/* count and update offsets */
 	size_t vert_size = 0;
@@ -752,51 +831,123 @@ void MeshManager::device_update_mesh(Device *device, DeviceScene *dscene, Scene
 		/* normals */
 		progress.set_status("Updating Mesh", "Computing normals");
 
-		float4 *normal = dscene->tri_normal.resize(tri_size);
-		float4 *vnormal = dscene->tri_vnormal.resize(vert_size);
-		float4 *tri_verts = dscene->tri_verts.resize(vert_size);
-		float4 *tri_vindex = dscene->tri_vindex.resize(tri_size);
+		float4 *normal, *vnormal, *tri_verts, *tri_vindex;
+		bool updated = false;
+
+		if(incremental) {
+			/* arrays keep their layout, repack updated meshes in place */
+			normal = dscene->tri_normal.get_data();
+			vnormal = dscene->tri_vnormal.get_data();
+			tri_verts = dscene->tri_verts.get_data();
+			tri_vindex = dscene->tri_vindex.get_data();
+		}
+		else {
+			normal = dscene->tri_normal.resize(tri_size);
+			vnormal = dscene->tri_vnormal.resize(vert_size);
+			tri_verts = dscene->tri_verts.resize(vert_size);
+			tri_vindex = dscene->tri_vindex.resize(tri_size);
+		}
 
 		foreach(Mesh *mesh, scene->meshes) {
+			if(incremental && !(mesh->need_update && mesh->triangles.size()))
+				continue;
+
 			mesh->pack_normals(scene, &normal[mesh->tri_offset], &vnormal[mesh->vert_offset]);
 			mesh->pack_verts(&tri_verts[mesh->vert_offset], &tri_vindex[mesh->tri_offset], mesh->vert_offset);
+			updated = true;
 
 			if(progress.get_cancel()) return;
 		}
 
 		/* vertex coordinates */
-		progress.set_status("Updating Mesh", "Copying Mesh to device");
+		if(updated) {
+			progress.set_status("Updating Mesh", "Copying Mesh to device");
+
+			if(incremental) {
+				device->tex_free(dscene->tri_normal);
+				device->tex_free(dscene->tri_vnormal);
+				device->tex_free(dscene->tri_verts);
+				device->tex_free(dscene->tri_vindex);
+			}
 
-		device->tex_alloc("__tri_normal", dscene->tri_normal);
-		device->tex_alloc("__tri_vnormal", dscene->tri_vnormal);
-		device->tex_alloc("__tri_verts", dscene->tri_verts);
-		device->tex_alloc("__tri_vindex", dscene->tri_vindex);
+			device->tex_alloc("__tri_normal", dscene->tri_normal);
+			device->tex_alloc("__tri_vnormal", dscene->tri_vnormal);
+			device->tex_alloc("__tri_verts", dscene->tri_verts);
+			device->tex_alloc("__tri_vindex", dscene->tri_vindex);
+		}
 	}
 
 	if(curve_size != 0) {
 		progress.set_status("Updating Mesh", "Copying Strands to device");
 
-		float4 *curve_keys = dscene->curve_keys.resize(curve_key_size);
-		float4 *curves = dscene->curves.resize(curve_size);
+		float4 *curve_keys, *curves;
+		bool updated = false;
+
+		if(incremental) {
+			curve_keys = dscene->curve_keys.get_data();
+			curves = dscene->curves.get_data();
+		}
+		else {
+			curve_keys = dscene->curve_keys.resize(curve_key_size);
+			curves = dscene->curves.resize(curve_size);
+		}
 
 		foreach(Mesh *mesh, scene->meshes) {
+			if(incremental && !(mesh->need_update && mesh->curves.size()))
+				continue;
+
 			mesh->pack_curves(scene, &curve_keys[mesh->curvekey_offset], &curves[mesh->curve_offset], mesh->curvekey_offset);
+			updated = true;
+
 			if(progress.get_cancel()) return;
 		}
 
-		device->tex_alloc("__curve_keys", dscene->curve_keys);
-		device->tex_alloc("__curves", dscene->curves);
+		if(updated) {
+			if(incremental) {
+				device->tex_free(dscene->curve_keys);
+				device->tex_free(dscene->curves);
+			}
+
+			device->tex_alloc("__curve_keys", dscene->curve_keys);
+			device->tex_alloc("__curves", dscene->curves);
+		}
 	}
 }
 
-void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, bool refit)
 {
+	if(refit && bvh && bvh->pack.nodes.size()) {
+		/* only objects changed, refit their bounds and upload the nodes */
+		progress.set_status("Updating Scene BVH", "Refitting");
+
+		bvh->objects = scene->objects;
+		bvh->refit(progress);
+
+		if(progress.get_cancel()) return;
+
+		progress.set_status("Updating Scene BVH", "Copying BVH to device");
+
+		device->tex_free(dscene->bvh_nodes);
+		device->tex_alloc("__bvh_nodes", dscene->bvh_nodes);
+
+		return;
+	}
+
+	/* free arrays still allocated after an incremental update */
+	device->tex_free(dscene->bvh_nodes);
+	device->tex_free(dscene->object_node);
+	device->tex_free(dscene->tri_woop);
+	device->tex_free(dscene->prim_segment);
+	device->tex_free(dscene->prim_visibility);
+	device->tex_free(dscene->prim_index);
+	device->tex_free(dscene->prim_object);
+
 	/* bvh build */
 	progress.set_status("Updating Scene BVH", "Building");
 
 	BVHParams bparams;
 	bparams.top_level = true;
-	bparams.use_qbvh = scene->params.use_qbvh;
+	bparams.use_qbvh = scene->params.use_qbvh && device->info.use_qbvh;
 	bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
 	bparams.use_cache = scene->params.use_bvh_cache;
 
@@ -841,6 +992,8 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	}
 
 	dscene->data.bvh.root = pack.root_index;
+	dscene->data.bvh.use_qbvh = bparams.use_qbvh;
+	dscene->data.bvh.use_ray_packets = bparams.use_qbvh && scene->params.use_ray_packets;
 }
 
 void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
@@ -849,10 +1002,15 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		return;
 
 	/* update normals */
+	bool attributes_changed = false;
+
 	foreach(Mesh *mesh, scene->meshes) {
-		foreach(uint shader, mesh->used_shaders)
-			if(scene->shaders[shader]->need_update_attributes)
+		foreach(uint shader, mesh->used_shaders) {
+			if(scene->shaders[shader]->need_update_attributes) {
 				mesh->need_update = true;
+				attributes_changed = true;
+			}
+		}
 
 		if(mesh->need_update) {
 			mesh->add_face_normals();
@@ -862,13 +1020,36 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		}
 	}
 
+	/* for interactive updates, if meshes and objects keep the same layout in
+	 * the device arrays, only updated meshes are repacked and uploaded, and
+	 * when no mesh changed the top level BVH is refit instead of rebuilt */
+	vector<size_t> layout;
+	device_layout(scene, layout);
+
+	bool incremental = (scene->params.bvh_type == SceneParams::BVH_DYNAMIC &&
+	                    !attributes_changed && layout == last_layout);
+	bool geometry_changed = false;
+
+	foreach(Mesh *mesh, scene->meshes) {
+		if(mesh->need_update) {
+			geometry_changed = true;
+
+			if(mesh->displacement_method != Mesh::DISPLACE_BUMP)
+				incremental = false;
+		}
+	}
+
+	/* only valid again once this update completes without cancelling */
+	last_layout.clear();
+
 	/* device update */
-	device_free(device, dscene);
+	if(!incremental)
+		device_free(device, dscene);
 
-	device_update_mesh(device, dscene, scene, progress);
+	device_update_mesh(device, dscene, scene, progress, incremental);
 	if(progress.get_cancel()) return;
 
-	device_update_attributes(device, dscene, scene, progress);
+	device_update_attributes(device, dscene, scene, progress, incremental);
 	if(progress.get_cancel()) return;
 
 	/* update displacement */
@@ -899,11 +1080,15 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		if(mesh->need_update && !mesh->transform_applied)
 			num_bvh++;
 
+	/* qbvh is only used when the device kernels can traverse it */
+	SceneParams bvh_params = scene->params;
+	bvh_params.use_qbvh = scene->params.use_qbvh && device->info.use_qbvh;
+
 	TaskPool pool;
 
 	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update) {
-			pool.push(function_bind(&Mesh::compute_bvh, mesh, &scene->params, &progress, i, num_bvh));
+			pool.push(function_bind(&Mesh::compute_bvh, mesh, &bvh_params, &progress, i, num_bvh));
 			i++;
 		}
 	}
@@ -926,11 +1111,75 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	if(progress.get_cancel()) return;
 
-	device_update_bvh(device, dscene, scene, progress);
+	device_update_bvh(device, dscene, scene, progress, incremental && !geometry_changed);
+	if(progress.get_cancel()) return;
 
+	last_layout = layout;
 	need_update = false;
 }
 
+void MeshManager::device_attribute_requests(Scene *scene, vector<AttributeRequestSet>& mesh_attributes)
+{
+	/* gather per mesh requested attributes. as meshes may have multiple
+	 * shaders assigned, this merges the requested attributes that have
+	 * been set per shader by the shader manager */
+	mesh_attributes.clear();
+	mesh_attributes.resize(scene->meshes.size());
+
+	for(size_t i = 0; i < scene->meshes.size(); i++) {
+		Mesh *mesh = scene->meshes[i];
+
+		scene->need_global_attributes(mesh_attributes[i]);
+
+		foreach(uint sindex, mesh->used_shaders) {
+			Shader *shader = scene->shaders[sindex];
+			mesh_attributes[i].add(shader->attributes);
+		}
+	}
+}
+
+void MeshManager::device_layout(Scene *scene, vector<size_t>& layout)
+{
+	/* objects and mesh sizes determine offsets into the device arrays */
+	foreach(Mesh *mesh, scene->meshes) {
+		layout.push_back((size_t)mesh);
+		layout.push_back(mesh->verts.size());
+		layout.push_back(mesh->triangles.size());
+		layout.push_back(mesh->curve_keys.size());
+		layout.push_back(mesh->curves.size());
+		layout.push_back(mesh->transform_applied);
+	}
+
+	foreach(Object *object, scene->objects) {
+		layout.push_back((size_t)object);
+		layout.push_back((size_t)object->mesh);
+	}
+
+	/* requested attributes determine the attribute map and the offsets into
+	 * the attribute arrays, which an incremental update does not rebuild */
+	vector<AttributeRequestSet> mesh_attributes;
+	device_attribute_requests(scene, mesh_attributes);
+
+	for(size_t i = 0; i < scene->meshes.size(); i++) {
+		Mesh *mesh = scene->meshes[i];
+
+		layout.push_back(mesh_attributes[i].size());
+
+		foreach(AttributeRequest& req, mesh_attributes[i].requests) {
+			Attribute *triangle_mattr = mesh->attributes.find(req);
+			Attribute *curve_mattr = mesh->curve_attributes.find(req);
+
+			layout.push_back((size_t)req.std);
+			layout.push_back((size_t)req.name.c_str());
+
+			layout.push_back((triangle_mattr)? (size_t)(triangle_mattr->type == TypeDesc::TypeFloat): 2);
+			layout.push_back((triangle_mattr)? (size_t)triangle_mattr->element: 0);
+			layout.push_back((curve_mattr)? (size_t)(curve_mattr->type == TypeDesc::TypeFloat): 2);
+			layout.push_back((curve_mattr)? (size_t)curve_mattr->element: 0);
+		}
+	}
+}
+
 void MeshManager::device_free(Device *device, DeviceScene *dscene)
 {
 	device->tex_free(dscene->bvh_nodes);
@@ -967,6 +1216,8 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->attributes_float.clear();
 	dscene->attributes_float3.clear();
 
+	last_layout.clear();
+
 #ifdef WITH_OSL
 	OSLGlobals *og = (OSLGlobals*)device->osl_memory();
 
@@ -33,12 +33,16 @@
 CCL_NAMESPACE_BEGIN
 
 class BVH;
+class Camera;
 class Device;
+class DiagSplit;
+class DiceCache;
 class DeviceScene;
 class Mesh;
 class Progress;
 class Scene;
 class SceneParams;
+class SubdMesh;
 class AttributeRequest;
 
 /* Mesh */
@@ -93,6 +97,16 @@ public:
 	Transform transform_normal;
 	DisplacementMethod displacement_method;
 
+	/* Subdivision, the control mesh is tessellated into verts and triangles
+	 * on scene update. with adaptive dicing the dicing rate is in pixels as
+	 * seen from the camera, otherwise in object space. */
+	SubdMesh *subd_mesh;
+	DiceCache *subd_cache;
+	float subd_dicing_rate;
+	bool subd_adaptive;
+	int subd_shader;
+	bool subd_smooth;
+
 	/* Update Flags */
 	bool need_update;
 	bool need_update_rebuild;
@@ -111,10 +125,13 @@ public:
 
 	void reserve(int numverts, int numfaces, int numcurves, int numcurvekeys);
 	void clear();
+	void clear_subd();
 	void add_triangle(int v0, int v1, int v2, int shader, bool smooth);
 	void add_curve_key(float3 loc, float radius);
 	void add_curve(int first_key, int num_keys, int shader);
 
+	void tessellate(DiagSplit *split);
+
 	void compute_bounds();
 	void add_face_normals();
 	void add_vertex_normals();
@@ -142,6 +159,7 @@ public:
 	~MeshManager();
 
 	bool displace(Device *device, Scene *scene, Mesh *mesh, Progress& progress);
+	void tessellate(Scene *scene, Progress& progress);
 
 	/* attributes */
 	void update_osl_attributes(Device *device, Scene *scene, vector<AttributeRequestSet>& mesh_attributes);
@@ -149,12 +167,19 @@ public:
 
 	void device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_update_object(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
-	void device_update_mesh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
-	void device_update_attributes(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
-	void device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
+	void device_update_mesh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, bool incremental = false);
+	void device_update_attributes(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, bool incremental = false);
+	void device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, bool refit = false);
 	void device_free(Device *device, DeviceScene *dscene);
 
 	void tag_update(Scene *scene);
+
+protected:
+	/* layout of the device arrays at the last update */
+	vector<size_t> last_layout;
+
+	void device_layout(Scene *scene, vector<size_t>& layout);
+	void device_attribute_requests(Scene *scene, vector<AttributeRequestSet>& mesh_attributes);
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2013, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "camera.h"
+#include "mesh.h"
+#include "object.h"
+#include "scene.h"
+
+#include "subd_cache.h"
+#include "subd_mesh.h"
+#include "subd_split.h"
+
+#include "util_foreach.h"
+#include "util_progress.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Mesh */
+
+void Mesh::clear_subd()
+{
+	delete subd_mesh;
+	delete subd_cache;
+
+	subd_mesh = NULL;
+	subd_cache = NULL;
+}
+
+void Mesh::tessellate(DiagSplit *split)
+{
+	/* clear previous tessellation, curves are kept */
+	verts.clear();
+	triangles.clear();
+	shader.clear();
+	smooth.clear();
+	attributes.clear();
+
+	transform_applied = false;
+	transform_negative_scaled = false;
+	transform_normal = transform_identity();
+
+	if(!subd_cache)
+		subd_cache = new DiceCache();
+
+	subd_mesh->tessellate(split, false, this, subd_shader, subd_smooth, subd_cache);
+}
+
+/* Mesh Manager */
+
+void MeshManager::tessellate(Scene *scene, Progress& progress)
+{
+	/* tessellate subdivision meshes before objects apply transforms, adaptive
+	 * meshes are tessellated again when the camera changed */
+	Camera *camera = scene->camera;
+	bool camera_changed = camera->need_update;
+
+	camera->update();
+
+	vector<Mesh*> subd_meshes;
+
+	foreach(Mesh *mesh, scene->meshes)
+		if(mesh->subd_mesh)
+			subd_meshes.push_back(mesh);
+
+	if(subd_meshes.size() == 0)
+		return;
+
+	vector<DiceCache*> caches;
+	int i = 0;
+
+	foreach(Mesh *mesh, subd_meshes) {
+		i++;
+
+		if(mesh->subd_cache)
+			caches.push_back(mesh->subd_cache);
+
+		if(!(mesh->need_update || (mesh->subd_adaptive && camera_changed)))
+			continue;
+
+		string msg = "Tessellating ";
+		if(mesh->name == "")
+			msg += string_printf("%u/%u", (uint)i, (uint)subd_meshes.size());
+		else
+			msg += string_printf("%s %u/%u", mesh->name.c_str(), (uint)i, (uint)subd_meshes.size());
+
+		progress.set_status("Updating Subdivision", msg);
+
+		DiagSplit split;
+		split.dicing_rate = mesh->subd_dicing_rate;
+
+		if(mesh->subd_adaptive) {
+			/* instanced meshes are diced for the first object using them */
+			Transform objecttoworld = transform_identity();
+
+			foreach(Object *object, scene->objects) {
+				if(object->mesh == mesh) {
+					objecttoworld = object->tfm;
+					break;
+				}
+			}
+
+			split.camera = camera;
+			split.objecttocamera = camera->worldtocamera * objecttoworld;
+		}
+
+		bool had_cache = (mesh->subd_cache != NULL);
+
+		mesh->tessellate(&split);
+		mesh->tag_update(scene, true);
+
+		if(!had_cache)
+			caches.push_back(mesh->subd_cache);
+
+		if(progress.get_cancel()) return;
+	}
+
+	/* bound memory used by diced faces kept for the next tessellation */
+	DiceCache::limit(caches, (size_t)scene->params.subd_cache_memory*1024*1024);
+}
+
+CCL_NAMESPACE_END
+
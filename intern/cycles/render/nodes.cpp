@@ -20,7 +20,9 @@
 #include "nodes.h"
 #include "svm.h"
 #include "osl.h"
+#include "svm_math_util.h"
 
+#include "util_color.h"
 #include "util_transform.h"
 
 CCL_NAMESPACE_BEGIN
@@ -80,6 +82,20 @@ bool TextureMapping::skip()
 	return true;
 }
 
+bool TextureMapping::equals(const TextureMapping& other) const
+{
+	return translation == other.translation &&
+	       rotation == other.rotation &&
+	       scale == other.scale &&
+	       min == other.min &&
+	       max == other.max &&
+	       use_minmax == other.use_minmax &&
+	       x_mapping == other.x_mapping &&
+	       y_mapping == other.y_mapping &&
+	       z_mapping == other.z_mapping &&
+	       projection == other.projection;
+}
+
 void TextureMapping::compile(SVMCompiler& compiler, int offset_in, int offset_out)
 {
 	if(offset_in == SVM_STACK_INVALID || offset_out == SVM_STACK_INVALID)
@@ -110,6 +126,16 @@ void TextureMapping::compile(OSLCompiler &compiler)
 	}
 }
 
+/* Texture */
+
+bool TextureNode::equals(const ShaderNode *other)
+{
+	/* names are compared first, so other is of the same type */
+	const TextureNode *other_node = static_cast<const TextureNode*>(other);
+	return ShaderNode::equals(other) &&
+	       tex_mapping.equals(other_node->tex_mapping);
+}
+
 /* Image Texture */
 
 static ShaderEnum color_space_init()
@@ -170,6 +196,18 @@ ShaderNode *ImageTextureNode::clone() const
 	return node;
 }
 
+bool ImageTextureNode::equals(const ShaderNode *other)
+{
+	const ImageTextureNode *other_node = static_cast<const ImageTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       filename == other_node->filename &&
+	       builtin_data == other_node->builtin_data &&
+	       color_space == other_node->color_space &&
+	       projection == other_node->projection &&
+	       projection_blend == other_node->projection_blend &&
+	       animated == other_node->animated;
+}
+
 void ImageTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -200,13 +238,22 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 		}
 
 		if(projection == "Flat") {
+			/* the texture cache filters using derivatives of UV coordinates */
+			uint uv_id = ATTR_STD_NONE;
+
+			if(image_manager->has_texture_cache() && tex_mapping.skip() && vector_in->link &&
+			   vector_in->link->parent->name == ustring("texture_coordinate") &&
+			   strcmp(vector_in->link->name, "UV") == 0)
+				uv_id = compiler.attribute(ATTR_STD_UV);
+
 			compiler.add_node(NODE_TEX_IMAGE,
 				slot,
 				compiler.encode_uchar4(
 					vector_offset,
 					color_out->stack_offset,
 					alpha_out->stack_offset,
-					srgb));
+					srgb),
+				uv_id);
 		}
 		else {
 			compiler.add_node(NODE_TEX_IMAGE_BOX,
@@ -301,6 +348,17 @@ ShaderNode *EnvironmentTextureNode::clone() const
 	return node;
 }
 
+bool EnvironmentTextureNode::equals(const ShaderNode *other)
+{
+	const EnvironmentTextureNode *other_node = static_cast<const EnvironmentTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       filename == other_node->filename &&
+	       builtin_data == other_node->builtin_data &&
+	       color_space == other_node->color_space &&
+	       projection == other_node->projection &&
+	       animated == other_node->animated;
+}
+
 void EnvironmentTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -444,6 +502,14 @@ SkyTextureNode::SkyTextureNode()
 	add_output("Color", SHADER_SOCKET_COLOR);
 }
 
+bool SkyTextureNode::equals(const ShaderNode *other)
+{
+	const SkyTextureNode *other_node = static_cast<const SkyTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       sun_direction == other_node->sun_direction &&
+	       turbidity == other_node->turbidity;
+}
+
 void SkyTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -509,6 +575,13 @@ GradientTextureNode::GradientTextureNode()
 	add_output("Fac", SHADER_SOCKET_FLOAT);
 }
 
+bool GradientTextureNode::equals(const ShaderNode *other)
+{
+	const GradientTextureNode *other_node = static_cast<const GradientTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       type == other_node->type;
+}
+
 void GradientTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -629,6 +702,13 @@ VoronoiTextureNode::VoronoiTextureNode()
 	add_output("Fac", SHADER_SOCKET_FLOAT);
 }
 
+bool VoronoiTextureNode::equals(const ShaderNode *other)
+{
+	const VoronoiTextureNode *other_node = static_cast<const VoronoiTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       coloring == other_node->coloring;
+}
+
 void VoronoiTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *scale_in = input("Scale");
@@ -700,6 +780,13 @@ MusgraveTextureNode::MusgraveTextureNode()
 	add_output("Color", SHADER_SOCKET_COLOR);
 }
 
+bool MusgraveTextureNode::equals(const ShaderNode *other)
+{
+	const MusgraveTextureNode *other_node = static_cast<const MusgraveTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       type == other_node->type;
+}
+
 void MusgraveTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -785,6 +872,13 @@ WaveTextureNode::WaveTextureNode()
 	add_output("Fac", SHADER_SOCKET_FLOAT);
 }
 
+bool WaveTextureNode::equals(const ShaderNode *other)
+{
+	const WaveTextureNode *other_node = static_cast<const WaveTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       type == other_node->type;
+}
+
 void WaveTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *scale_in = input("Scale");
@@ -851,6 +945,13 @@ MagicTextureNode::MagicTextureNode()
 	add_output("Fac", SHADER_SOCKET_FLOAT);
 }
 
+bool MagicTextureNode::equals(const ShaderNode *other)
+{
+	const MagicTextureNode *other_node = static_cast<const MagicTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       depth == other_node->depth;
+}
+
 void MagicTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -975,6 +1076,16 @@ BrickTextureNode::BrickTextureNode()
 	add_output("Fac", SHADER_SOCKET_FLOAT);
 }
 
+bool BrickTextureNode::equals(const ShaderNode *other)
+{
+	const BrickTextureNode *other_node = static_cast<const BrickTextureNode*>(other);
+	return TextureNode::equals(other) &&
+	       offset == other_node->offset &&
+	       squash == other_node->squash &&
+	       offset_frequency == other_node->offset_frequency &&
+	       squash_frequency == other_node->squash_frequency;
+}
+
 void BrickTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -1057,6 +1168,13 @@ NormalNode::NormalNode()
 	add_output("Dot",  SHADER_SOCKET_FLOAT);
 }
 
+bool NormalNode::equals(const ShaderNode *other)
+{
+	const NormalNode *other_node = static_cast<const NormalNode*>(other);
+	return ShaderNode::equals(other) &&
+	       direction == other_node->direction;
+}
+
 void NormalNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *normal_in = input("Normal");
@@ -1089,6 +1207,13 @@ MappingNode::MappingNode()
 	add_output("Vector", SHADER_SOCKET_POINT);
 }
 
+bool MappingNode::equals(const ShaderNode *other)
+{
+	const MappingNode *other_node = static_cast<const MappingNode*>(other);
+	return ShaderNode::equals(other) &&
+	       tex_mapping.equals(other_node->tex_mapping);
+}
+
 void MappingNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -1156,6 +1281,48 @@ ConvertNode::ConvertNode(ShaderSocketType from_, ShaderSocketType to_)
 		assert(0);
 }
 
+bool ConvertNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	ShaderInput *in = inputs[0];
+
+	/* int and string conversions are left to the kernel */
+	if(from == SHADER_SOCKET_INT || to == SHADER_SOCKET_INT ||
+	   from == SHADER_SOCKET_STRING || to == SHADER_SOCKET_STRING)
+		return false;
+
+	if(from == SHADER_SOCKET_FLOAT) {
+		/* float to float3 */
+		float f = in->value.x;
+		*optimized_value = make_float3(f, f, f);
+	}
+	else if(to == SHADER_SOCKET_FLOAT) {
+		float f;
+
+		if(from == SHADER_SOCKET_COLOR)
+			/* color to float */
+			f = linear_rgb_to_gray(in->value);
+		else
+			/* vector/point/normal to float */
+			f = (in->value.x + in->value.y + in->value.z)*(1.0f/3.0f);
+
+		*optimized_value = make_float3(f, 0.0f, 0.0f);
+	}
+	else {
+		/* float3 to float3 */
+		*optimized_value = in->value;
+	}
+
+	return true;
+}
+
+bool ConvertNode::equals(const ShaderNode *other)
+{
+	const ConvertNode *other_node = static_cast<const ConvertNode*>(other);
+	return ShaderNode::equals(other) &&
+	       from == other_node->from &&
+	       to == other_node->to;
+}
+
 void ConvertNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *in = inputs[0];
@@ -1874,6 +2041,13 @@ void TextureCoordinateNode::attributes(AttributeRequestSet *attributes)
 	ShaderNode::attributes(attributes);
 }
 
+bool TextureCoordinateNode::equals(const ShaderNode *other)
+{
+	const TextureCoordinateNode *other_node = static_cast<const TextureCoordinateNode*>(other);
+	return ShaderNode::equals(other) &&
+	       from_dupli == other_node->from_dupli;
+}
+
 void TextureCoordinateNode::compile(SVMCompiler& compiler)
 {
 	ShaderOutput *out;
@@ -2312,6 +2486,19 @@ ValueNode::ValueNode()
 	add_output("Value", SHADER_SOCKET_FLOAT);
 }
 
+bool ValueNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	*optimized_value = make_float3(value, 0.0f, 0.0f);
+	return true;
+}
+
+bool ValueNode::equals(const ShaderNode *other)
+{
+	const ValueNode *other_node = static_cast<const ValueNode*>(other);
+	return ShaderNode::equals(other) &&
+	       value == other_node->value;
+}
+
 void ValueNode::compile(SVMCompiler& compiler)
 {
 	ShaderOutput *val_out = output("Value");
@@ -2336,6 +2523,19 @@ ColorNode::ColorNode()
 	add_output("Color", SHADER_SOCKET_COLOR);
 }
 
+bool ColorNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	*optimized_value = value;
+	return true;
+}
+
+bool ColorNode::equals(const ShaderNode *other)
+{
+	const ColorNode *other_node = static_cast<const ColorNode*>(other);
+	return ShaderNode::equals(other) &&
+	       value == other_node->value;
+}
+
 void ColorNode::compile(SVMCompiler& compiler)
 {
 	ShaderOutput *color_out = output("Color");
@@ -2387,6 +2587,22 @@ MixClosureNode::MixClosureNode()
 	add_output("Closure",  SHADER_SOCKET_CLOSURE);
 }
 
+ShaderInput *MixClosureNode::constant_bypass(ShaderOutput *socket)
+{
+	ShaderInput *fac_in = input("Fac");
+
+	if(fac_in->link)
+		return NULL;
+
+	/* a closure fully mixed to one side */
+	if(fac_in->value.x <= 0.0f)
+		return input("Closure1");
+	else if(fac_in->value.x >= 1.0f)
+		return input("Closure2");
+
+	return NULL;
+}
+
 void MixClosureNode::compile(SVMCompiler& compiler)
 {
 	/* handled in the SVM compiler */
@@ -2440,6 +2656,15 @@ InvertNode::InvertNode()
 	add_output("Color",  SHADER_SOCKET_COLOR);
 }
 
+bool InvertNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	float factor = input("Fac")->value.x;
+	float3 color = input("Color")->value;
+
+	*optimized_value = factor*(make_float3(1.0f, 1.0f, 1.0f) - color) + (1.0f - factor)*color;
+	return true;
+}
+
 void InvertNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *fac_in = input("Fac");
@@ -2501,6 +2726,44 @@ static ShaderEnum mix_type_init()
 
 ShaderEnum MixNode::type_enum = mix_type_init();
 
+bool MixNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	float fac = input("Fac")->value.x;
+	float3 color1 = input("Color1")->value;
+	float3 color2 = input("Color2")->value;
+
+	*optimized_value = svm_mix((NodeMix)type_enum[type], fac, color1, color2);
+
+	if(use_clamp)
+		*optimized_value = svm_mix_clamp(*optimized_value);
+
+	return true;
+}
+
+ShaderInput *MixNode::constant_bypass(ShaderOutput *socket)
+{
+	ShaderInput *fac_in = input("Fac");
+
+	/* only plain mixing passes a color through unchanged */
+	if(type != ustring("Mix") || use_clamp || fac_in->link)
+		return NULL;
+
+	if(fac_in->value.x <= 0.0f)
+		return input("Color1");
+	else if(fac_in->value.x >= 1.0f)
+		return input("Color2");
+
+	return NULL;
+}
+
+bool MixNode::equals(const ShaderNode *other)
+{
+	const MixNode *other_node = static_cast<const MixNode*>(other);
+	return ShaderNode::equals(other) &&
+	       type == other_node->type &&
+	       use_clamp == other_node->use_clamp;
+}
+
 void MixNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *fac_in = input("Fac");
@@ -2539,6 +2802,12 @@ CombineRGBNode::CombineRGBNode()
 	add_output("Image", SHADER_SOCKET_COLOR);
 }
 
+bool CombineRGBNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	*optimized_value = make_float3(input("R")->value.x, input("G")->value.x, input("B")->value.x);
+	return true;
+}
+
 void CombineRGBNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *red_in = input("R");
@@ -2572,6 +2841,22 @@ GammaNode::GammaNode()
 	add_output("Color", SHADER_SOCKET_COLOR);
 }
 
+bool GammaNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	float3 color = input("Color")->value;
+	float gamma = input("Gamma")->value.x;
+
+	if(color.x > 0.0f)
+		color.x = powf(color.x, gamma);
+	if(color.y > 0.0f)
+		color.y = powf(color.y, gamma);
+	if(color.z > 0.0f)
+		color.z = powf(color.z, gamma);
+
+	*optimized_value = color;
+	return true;
+}
+
 void GammaNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *color_in = input("Color");
@@ -2632,6 +2917,20 @@ SeparateRGBNode::SeparateRGBNode()
 	add_output("B", SHADER_SOCKET_FLOAT);
 }
 
+bool SeparateRGBNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	float3 color = input("Image")->value;
+
+	for(int channel = 0; channel < 3; channel++) {
+		if(outputs[channel] == socket) {
+			*optimized_value = make_float3(color[channel], 0.0f, 0.0f);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void SeparateRGBNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *color_in = input("Image");
@@ -2717,6 +3016,13 @@ void AttributeNode::attributes(AttributeRequestSet *attributes)
 	ShaderNode::attributes(attributes);
 }
 
+bool AttributeNode::equals(const ShaderNode *other)
+{
+	const AttributeNode *other_node = static_cast<const AttributeNode*>(other);
+	return ShaderNode::equals(other) &&
+	       attribute == other_node->attribute;
+}
+
 void AttributeNode::compile(SVMCompiler& compiler)
 {
 	ShaderOutput *color_out = output("Color");
@@ -2928,6 +3234,57 @@ static ShaderEnum math_type_init()
 
 ShaderEnum MathNode::type_enum = math_type_init();
 
+bool MathNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	float value1 = input("Value1")->value.x;
+	float value2 = input("Value2")->value.x;
+	float value = svm_math((NodeMath)type_enum[type], value1, value2);
+
+	if(use_clamp)
+		value = svm_math(NODE_MATH_CLAMP, value, 0.0f);
+
+	*optimized_value = make_float3(value, 0.0f, 0.0f);
+	return true;
+}
+
+ShaderInput *MathNode::constant_bypass(ShaderOutput *socket)
+{
+	ShaderInput *value1_in = input("Value1");
+	ShaderInput *value2_in = input("Value2");
+
+	if(use_clamp)
+		return NULL;
+
+	/* operations with an identity constant pass the other value through */
+	if(!value2_in->link) {
+		float value2 = value2_in->value.x;
+
+		if((type == ustring("Add") || type == ustring("Subtract")) && value2 == 0.0f)
+			return value1_in;
+		if((type == ustring("Multiply") || type == ustring("Divide")) && value2 == 1.0f)
+			return value1_in;
+	}
+
+	if(!value1_in->link) {
+		float value1 = value1_in->value.x;
+
+		if(type == ustring("Add") && value1 == 0.0f)
+			return value2_in;
+		if(type == ustring("Multiply") && value1 == 1.0f)
+			return value2_in;
+	}
+
+	return NULL;
+}
+
+bool MathNode::equals(const ShaderNode *other)
+{
+	const MathNode *other_node = static_cast<const MathNode*>(other);
+	return ShaderNode::equals(other) &&
+	       type == other_node->type &&
+	       use_clamp == other_node->use_clamp;
+}
+
 void MathNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *value1_in = input("Value1");
@@ -2983,6 +3340,29 @@ static ShaderEnum vector_math_type_init()
 
 ShaderEnum VectorMathNode::type_enum = vector_math_type_init();
 
+bool VectorMathNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	float value;
+	float3 vector;
+
+	svm_vector_math(&value, &vector, (NodeVectorMath)type_enum[type],
+	                input("Vector1")->value, input("Vector2")->value);
+
+	if(socket == output("Value"))
+		*optimized_value = make_float3(value, 0.0f, 0.0f);
+	else
+		*optimized_value = vector;
+
+	return true;
+}
+
+bool VectorMathNode::equals(const ShaderNode *other)
+{
+	const VectorMathNode *other_node = static_cast<const VectorMathNode*>(other);
+	return ShaderNode::equals(other) &&
+	       type == other_node->type;
+}
+
 void VectorMathNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector1_in = input("Vector1");
@@ -3064,6 +3444,13 @@ RGBCurvesNode::RGBCurvesNode()
 	add_output("Color", SHADER_SOCKET_COLOR);
 }
 
+bool RGBCurvesNode::equals(const ShaderNode *other)
+{
+	const RGBCurvesNode *other_node = static_cast<const RGBCurvesNode*>(other);
+	return ShaderNode::equals(other) &&
+	       memcmp(curves, other_node->curves, sizeof(curves)) == 0;
+}
+
 void RGBCurvesNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *fac_in = input("Fac");
@@ -3102,6 +3489,13 @@ VectorCurvesNode::VectorCurvesNode()
 	add_output("Vector", SHADER_SOCKET_VECTOR);
 }
 
+bool VectorCurvesNode::equals(const ShaderNode *other)
+{
+	const VectorCurvesNode *other_node = static_cast<const VectorCurvesNode*>(other);
+	return ShaderNode::equals(other) &&
+	       memcmp(curves, other_node->curves, sizeof(curves)) == 0;
+}
+
 void VectorCurvesNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *fac_in = input("Fac");
@@ -3140,6 +3534,13 @@ RGBRampNode::RGBRampNode()
 	add_output("Alpha", SHADER_SOCKET_FLOAT);
 }
 
+bool RGBRampNode::equals(const ShaderNode *other)
+{
+	const RGBRampNode *other_node = static_cast<const RGBRampNode*>(other);
+	return ShaderNode::equals(other) &&
+	       memcmp(ramp, other_node->ramp, sizeof(ramp)) == 0;
+}
+
 void RGBRampNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *fac_in = input("Fac");
@@ -3208,6 +3609,12 @@ OSLScriptNode::OSLScriptNode()
 {
 }
 
+bool OSLScriptNode::equals(const ShaderNode *other)
+{
+	/* script parameters are not known here */
+	return false;
+}
+
 void OSLScriptNode::compile(SVMCompiler& compiler)
 {
 	/* doesn't work for SVM, obviously ... */
@@ -3267,6 +3674,14 @@ void NormalMapNode::attributes(AttributeRequestSet *attributes)
 	ShaderNode::attributes(attributes);
 }
 
+bool NormalMapNode::equals(const ShaderNode *other)
+{
+	const NormalMapNode *other_node = static_cast<const NormalMapNode*>(other);
+	return ShaderNode::equals(other) &&
+	       space == other_node->space &&
+	       attribute == other_node->attribute;
+}
+
 void NormalMapNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput  *color_in = input("Color");
@@ -3367,6 +3782,15 @@ void TangentNode::attributes(AttributeRequestSet *attributes)
 	ShaderNode::attributes(attributes);
 }
 
+bool TangentNode::equals(const ShaderNode *other)
+{
+	const TangentNode *other_node = static_cast<const TangentNode*>(other);
+	return ShaderNode::equals(other) &&
+	       direction_type == other_node->direction_type &&
+	       axis == other_node->axis &&
+	       attribute == other_node->attribute;
+}
+
 void TangentNode::compile(SVMCompiler& compiler)
 {
 	ShaderOutput *tangent_out = output("Tangent");
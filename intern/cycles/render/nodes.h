@@ -35,6 +35,7 @@ public:
 	TextureMapping();
 	Transform compute_transform();
 	bool skip();
+	bool equals(const TextureMapping& other) const;
 	void compile(SVMCompiler& compiler, int offset_in, int offset_out);
 	void compile(OSLCompiler &compiler);
 
@@ -57,6 +58,7 @@ public:
 class TextureNode : public ShaderNode {
 public:
 	TextureNode(const char *name_) : ShaderNode(name_) {}
+	bool equals(const ShaderNode *other);
 	TextureMapping tex_mapping;
 };
 
@@ -65,6 +67,7 @@ public:
 	SHADER_NODE_NO_CLONE_CLASS(ImageTextureNode)
 	~ImageTextureNode();
 	ShaderNode *clone() const;
+	bool equals(const ShaderNode *other);
 
 	ImageManager *image_manager;
 	int slot;
@@ -86,6 +89,7 @@ public:
 	SHADER_NODE_NO_CLONE_CLASS(EnvironmentTextureNode)
 	~EnvironmentTextureNode();
 	ShaderNode *clone() const;
+	bool equals(const ShaderNode *other);
 
 	ImageManager *image_manager;
 	int slot;
@@ -104,6 +108,7 @@ public:
 class SkyTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(SkyTextureNode)
+	bool equals(const ShaderNode *other);
 
 	float3 sun_direction;
 	float turbidity;
@@ -117,6 +122,7 @@ public:
 class GradientTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(GradientTextureNode)
+	bool equals(const ShaderNode *other);
 
 	ustring type;
 	static ShaderEnum type_enum;
@@ -130,6 +136,7 @@ public:
 class VoronoiTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(VoronoiTextureNode)
+	bool equals(const ShaderNode *other);
 
 	ustring coloring;
 
@@ -139,6 +146,7 @@ public:
 class MusgraveTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(MusgraveTextureNode)
+	bool equals(const ShaderNode *other);
 
 	ustring type;
 
@@ -148,6 +156,7 @@ public:
 class WaveTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(WaveTextureNode)
+	bool equals(const ShaderNode *other);
 
 	ustring type;
 	static ShaderEnum type_enum;
@@ -156,6 +165,7 @@ public:
 class MagicTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(MagicTextureNode)
+	bool equals(const ShaderNode *other);
 
 	int depth;
 };
@@ -168,6 +178,7 @@ public:
 class BrickTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(BrickTextureNode)
+	bool equals(const ShaderNode *other);
 	
 	float offset, squash;
 	int offset_frequency, squash_frequency;
@@ -176,6 +187,7 @@ public:
 class MappingNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(MappingNode)
+	bool equals(const ShaderNode *other);
 
 	TextureMapping tex_mapping;
 };
@@ -184,6 +196,8 @@ class ConvertNode : public ShaderNode {
 public:
 	ConvertNode(ShaderSocketType from, ShaderSocketType to);
 	SHADER_NODE_BASE_CLASS(ConvertNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	bool equals(const ShaderNode *other);
 
 	ShaderSocketType from, to;
 };
@@ -309,6 +323,7 @@ public:
 class TextureCoordinateNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(TextureCoordinateNode)
+	bool equals(const ShaderNode *other);
 	void attributes(AttributeRequestSet *attributes);
 	
 	bool from_dupli;
@@ -345,6 +360,8 @@ public:
 class ValueNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(ValueNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	bool equals(const ShaderNode *other);
 
 	float value;
 };
@@ -352,6 +369,8 @@ public:
 class ColorNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(ColorNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	bool equals(const ShaderNode *other);
 
 	float3 value;
 };
@@ -364,6 +383,7 @@ public:
 class MixClosureNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(MixClosureNode)
+	ShaderInput *constant_bypass(ShaderOutput *socket);
 };
 
 class MixClosureWeightNode : public ShaderNode {
@@ -374,11 +394,15 @@ public:
 class InvertNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(InvertNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
 };
 
 class MixNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(MixNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	ShaderInput *constant_bypass(ShaderOutput *socket);
+	bool equals(const ShaderNode *other);
 
 	bool use_clamp;
 
@@ -389,11 +413,13 @@ public:
 class CombineRGBNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(CombineRGBNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
 };
 
 class GammaNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(GammaNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
 };
 
 class BrightContrastNode : public ShaderNode {
@@ -404,6 +430,7 @@ public:
 class SeparateRGBNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(SeparateRGBNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
 };
 
 class HSVNode : public ShaderNode {
@@ -414,6 +441,7 @@ public:
 class AttributeNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(AttributeNode)
+	bool equals(const ShaderNode *other);
 	void attributes(AttributeRequestSet *attributes);
 
 	ustring attribute;
@@ -437,6 +465,9 @@ public:
 class MathNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(MathNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	ShaderInput *constant_bypass(ShaderOutput *socket);
+	bool equals(const ShaderNode *other);
 
 	bool use_clamp;
 
@@ -447,6 +478,7 @@ public:
 class NormalNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(NormalNode)
+	bool equals(const ShaderNode *other);
 
 	float3 direction;
 };
@@ -454,6 +486,8 @@ public:
 class VectorMathNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(VectorMathNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	bool equals(const ShaderNode *other);
 
 	ustring type;
 	static ShaderEnum type_enum;
@@ -467,18 +501,21 @@ public:
 class RGBCurvesNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(RGBCurvesNode)
+	bool equals(const ShaderNode *other);
 	float4 curves[RAMP_TABLE_SIZE];
 };
 
 class VectorCurvesNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(VectorCurvesNode)
+	bool equals(const ShaderNode *other);
 	float4 curves[RAMP_TABLE_SIZE];
 };
 
 class RGBRampNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(RGBRampNode)
+	bool equals(const ShaderNode *other);
 	float4 ramp[RAMP_TABLE_SIZE];
 };
 
@@ -490,6 +527,7 @@ public:
 class OSLScriptNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(OSLScriptNode)
+	bool equals(const ShaderNode *other);
 	string filepath;
 	string bytecode_hash;
 	
@@ -502,6 +540,7 @@ public:
 class NormalMapNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(NormalMapNode)
+	bool equals(const ShaderNode *other);
 	void attributes(AttributeRequestSet *attributes);
 
 	ustring space;
@@ -513,6 +552,7 @@ public:
 class TangentNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(TangentNode)
+	bool equals(const ShaderNode *other);
 	void attributes(AttributeRequestSet *attributes);
 
 	ustring direction_type;
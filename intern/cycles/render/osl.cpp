@@ -94,6 +94,8 @@ void OSLShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 			scene->light_manager->need_update = true;
 	}
 
+	device_update_graph_stats(scene);
+
 	/* setup shader engine */
 	og->ss = ss;
 	og->ts = ts;
@@ -65,6 +65,10 @@ Scene::Scene(const SceneParams& params_, const DeviceInfo& device_info_)
 
 	if (device_info_.type == DEVICE_CPU)
 		image_manager->set_extended_image_limits();
+
+	/* on demand image textures, OSL uses its own texture system */
+	if(device_info_.type == DEVICE_CPU && params.shadingsystem == SceneParams::SVM && params.use_texture_cache)
+		image_manager->set_texture_cache(params.texture_cache_memory);
 }
 
 Scene::~Scene()
@@ -158,6 +162,11 @@ void Scene::device_update(Device *device_, Progress& progress)
 
 	if(progress.get_cancel()) return;
 
+	progress.set_status("Updating Subdivision");
+	mesh_manager->tessellate(this, progress);
+
+	if(progress.get_cancel()) return;
+
 	progress.set_status("Updating Camera");
 	camera->device_update(device, &dscene, this);
 
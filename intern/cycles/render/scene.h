@@ -90,6 +90,9 @@ public:
 	device_vector<float4> light_data;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
+	device_vector<float4> light_tree_nodes;
+	device_vector<uint> light_tree_emitters;
+	device_vector<uint> light_tree_position;
 
 	/* particles */
 	device_vector<float4> particles;
@@ -108,6 +111,9 @@ public:
 	/* images */
 	device_vector<uchar4> tex_image[TEX_EXTENDED_NUM_IMAGES];
 	device_vector<float4> tex_float_image[TEX_EXTENDED_NUM_FLOAT_IMAGES];
+	device_vector<half4> tex_half4_image[TEX_NUM_HALF4_IMAGES_CPU];
+	device_vector<float> tex_float1_image[TEX_NUM_FLOAT1_IMAGES_CPU];
+	device_vector<uchar> tex_byte1_image[TEX_NUM_BYTE1_IMAGES_CPU];
 
 	/* opencl images */
 	device_vector<uchar4> tex_image_packed;
@@ -125,7 +131,11 @@ public:
 	bool use_bvh_cache;
 	bool use_bvh_spatial_split;
 	bool use_qbvh;
+	bool use_ray_packets;
 	bool persistent_data;
+	bool use_texture_cache;
+	int texture_cache_memory;
+	int subd_cache_memory;
 
 	SceneParams()
 	{
@@ -133,11 +143,11 @@ public:
 		bvh_type = BVH_DYNAMIC;
 		use_bvh_cache = false;
 		use_bvh_spatial_split = false;
-#ifdef __QBVH__
 		use_qbvh = true;
-#else
-		use_qbvh = false;
-#endif
+		use_ray_packets = false;
+		use_texture_cache = false;
+		texture_cache_memory = 4096;
+		subd_cache_memory = 256;
 	}
 
 	bool modified(const SceneParams& params)
@@ -146,7 +156,11 @@ public:
 		&& use_bvh_cache == params.use_bvh_cache
 		&& use_bvh_spatial_split == params.use_bvh_spatial_split
 		&& use_qbvh == params.use_qbvh
-		&& persistent_data == params.persistent_data); }
+		&& use_ray_packets == params.use_ray_packets
+		&& persistent_data == params.persistent_data
+		&& use_texture_cache == params.use_texture_cache
+		&& texture_cache_memory == params.texture_cache_memory
+		&& subd_cache_memory == params.subd_cache_memory); }
 };
 
 /* Scene */
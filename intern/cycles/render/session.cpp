@@ -16,12 +16,14 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <limits.h>
 
 #include "buffers.h"
 #include "camera.h"
 #include "device.h"
+#include "film.h"
 #include "scene.h"
 #include "session.h"
 
@@ -60,6 +62,13 @@ Session::Session(const SessionParams& params_)
 		display = new DisplayBuffer(device);
 	}
 
+	/* in background mode there is no full frame buffer, so write the
+	 * finished tiles to the output file as they come in */
+	if(params.background && !params.progressive_refine && params.output_path != "")
+		tile_output = new TileOutput();
+	else
+		tile_output = NULL;
+
 	session_thread = NULL;
 	scene = NULL;
 
@@ -105,6 +114,7 @@ Session::~Session()
 	foreach(RenderBuffers *buffers, tile_buffers)
 		delete buffers;
 
+	delete tile_output;
 	delete buffers;
 	delete display;
 	delete scene;
@@ -447,13 +457,19 @@ void Session::release_tile(RenderTile& rtile)
 {
 	thread_scoped_lock tile_lock(tile_mutex);
 
-	if(write_render_tile_cb) {
-		if(params.progressive_refine == false) {
+	if(params.progressive_refine == false) {
+		/* a tile missing from the file fails the render, rather than
+		 * silently leaving a hole in the output */
+		if(tile_output && !tile_output->write(rtile, scene->film->exposure))
+			progress.set_cancel(tile_output->error_message());
+
+		if(write_render_tile_cb) {
 			/* todo: optimize this by making it thread safe and removing lock */
 			write_render_tile_cb(rtile);
+		}
 
+		if(tile_output || write_render_tile_cb)
 			delete rtile.buffers;
-		}
 	}
 
 	update_status_time();
@@ -619,6 +635,12 @@ void Session::run()
 			run_cpu();
 	}
 
+#ifdef WITH_CYCLES_DEBUG
+	/* kernel statistics, closure and BVH counts are only gathered in debug builds */
+	if(stats.rays.num_camera_rays)
+		printf("%s", stats.rays.report().c_str());
+#endif
+
 	/* progress update */
 	if(progress.get_cancel())
 		progress.set_status("Cancel", progress.get_cancel_message());
@@ -646,6 +668,16 @@ void Session::reset_(BufferParams& buffer_params, int samples)
 
 	tile_manager.reset(buffer_params, samples);
 
+	if(tile_output) {
+		thread_scoped_lock tile_lock(tile_mutex);
+
+		if(!tile_output->open(params.output_path, buffer_params, params.tile_size)) {
+			progress.set_cancel("Failed to open output file " + params.output_path);
+			delete tile_output;
+			tile_output = NULL;
+		}
+	}
+
 	start_time = time_dt();
 	preview_time = 0.0;
 	paused_time = 0.0;
@@ -814,6 +846,12 @@ void Session::path_trace()
 	task.update_progress_sample = function_bind(&Session::update_progress_sample, this);
 	task.need_finish_queue = params.progressive_refine;
 
+	/* adaptive sampling only makes sense when each tile is rendered in one go */
+	if(params.background && !params.progressive_refine) {
+		task.adaptive_threshold = params.adaptive_threshold;
+		task.adaptive_min_samples = params.adaptive_min_samples;
+	}
+
 	device->task_add(task);
 }
 
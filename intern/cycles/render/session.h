@@ -37,6 +37,7 @@ class DisplayBuffer;
 class Progress;
 class RenderBuffers;
 class Scene;
+class TileOutput;
 
 /* Session Parameters */
 
@@ -55,6 +56,9 @@ public:
 	int start_resolution;
 	int threads;
 
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
 	double cancel_timeout;
 	double reset_timeout;
 	double text_timeout;
@@ -74,6 +78,9 @@ public:
 		start_resolution = INT_MAX;
 		threads = 0;
 
+		adaptive_threshold = 0.0f;
+		adaptive_min_samples = 16;
+
 		cancel_timeout = 0.1;
 		reset_timeout = 0.1;
 		text_timeout = 1.0;
@@ -93,6 +100,8 @@ public:
 		&& tile_size == params.tile_size
 		&& start_resolution == params.start_resolution
 		&& threads == params.threads
+		&& adaptive_threshold == params.adaptive_threshold
+		&& adaptive_min_samples == params.adaptive_min_samples
 		&& cancel_timeout == params.cancel_timeout
 		&& reset_timeout == params.reset_timeout
 		&& text_timeout == params.text_timeout
@@ -192,6 +201,9 @@ protected:
 	bool update_progressive_refine(bool cancel);
 
 	vector<RenderBuffers *> tile_buffers;
+
+	/* background render streamed to output_path tile by tile */
+	TileOutput *tile_output;
 };
 
 CCL_NAMESPACE_END
@@ -115,6 +115,9 @@ void Shader::tag_used(Scene *scene)
 ShaderManager::ShaderManager()
 {
 	need_update = true;
+	num_graph_nodes = 0;
+	num_graph_nodes_optimized = 0;
+	num_svm_nodes = 0;
 }
 
 ShaderManager::~ShaderManager()
@@ -194,6 +197,17 @@ void ShaderManager::device_update_shaders_used(Scene *scene)
 		scene->shaders[light->shader]->used = true;
 }
 
+void ShaderManager::device_update_graph_stats(Scene *scene)
+{
+	num_graph_nodes = 0;
+	num_graph_nodes_optimized = 0;
+
+	foreach(Shader *shader, scene->shaders) {
+		num_graph_nodes += shader->graph->num_nodes_unoptimized;
+		num_graph_nodes_optimized += shader->graph->num_nodes_optimized;
+	}
+}
+
 void ShaderManager::device_update_common(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	device_free_common(device, dscene);
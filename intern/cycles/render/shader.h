@@ -107,6 +107,12 @@ class ShaderManager {
 public:
 	bool need_update;
 
+	/* node counts of all shader graphs before and after graph optimization,
+	 * and the size of the compiled SVM program, from the last device update */
+	int num_graph_nodes;
+	int num_graph_nodes_optimized;
+	int num_svm_nodes;
+
 	static ShaderManager *create(Scene *scene, int shadingsystem);
 	virtual ~ShaderManager();
 
@@ -119,6 +125,7 @@ public:
 	virtual void device_free(Device *device, DeviceScene *dscene) = 0;
 
 	void device_update_shaders_used(Scene *scene);
+	void device_update_graph_stats(Scene *scene);
 	void device_update_common(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_free_common(Device *device, DeviceScene *dscene);
 
@@ -89,6 +89,9 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 	dscene->svm_nodes.copy((uint4*)&svm_nodes[0], svm_nodes.size());
 	device->tex_alloc("__svm_nodes", dscene->svm_nodes);
 
+	device_update_graph_stats(scene);
+	num_svm_nodes = svm_nodes.size();
+
 	for(i = 0; i < scene->shaders.size(); i++) {
 		Shader *shader = scene->shaders[i];
 		shader->need_update = false;
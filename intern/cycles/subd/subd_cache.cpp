@@ -0,0 +1,197 @@
+/*
+ * Copyright 2013, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "mesh.h"
+
+#include "subd_cache.h"
+#include "subd_split.h"
+
+#include "util_algorithm.h"
+#include "util_foreach.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Dice Cache */
+
+DiceCache::DiceCache()
+{
+	used_memory = 0;
+}
+
+DiceCache::~DiceCache()
+{
+	clear();
+}
+
+void DiceCache::make_key(DiagSplit *split, vector<float>& key)
+{
+	key.clear();
+
+	for(size_t i = 0; i < split->subpatches_quad.size(); i++) {
+		QuadDice::SubPatch& sub = split->subpatches_quad[i];
+		QuadDice::EdgeFactors& ef = split->edgefactors_quad[i];
+
+		key.push_back(sub.P00.x); key.push_back(sub.P00.y);
+		key.push_back(sub.P10.x); key.push_back(sub.P10.y);
+		key.push_back(sub.P01.x); key.push_back(sub.P01.y);
+		key.push_back(sub.P11.x); key.push_back(sub.P11.y);
+
+		key.push_back((float)ef.tu0);
+		key.push_back((float)ef.tu1);
+		key.push_back((float)ef.tv0);
+		key.push_back((float)ef.tv1);
+	}
+
+	for(size_t i = 0; i < split->subpatches_triangle.size(); i++) {
+		TriangleDice::SubPatch& sub = split->subpatches_triangle[i];
+		TriangleDice::EdgeFactors& ef = split->edgefactors_triangle[i];
+
+		key.push_back(sub.Pu.x); key.push_back(sub.Pu.y);
+		key.push_back(sub.Pv.x); key.push_back(sub.Pv.y);
+		key.push_back(sub.Pw.x); key.push_back(sub.Pw.y);
+
+		key.push_back((float)ef.tu);
+		key.push_back((float)ef.tv);
+		key.push_back((float)ef.tw);
+	}
+}
+
+bool DiceCache::lookup(int face, const vector<float>& key, Mesh *mesh, int shader, bool smooth, double time)
+{
+	map<int, Entry>::iterator it = entries.find(face);
+
+	if(it == entries.end() || it->second.key != key)
+		return false;
+
+	Entry& entry = it->second;
+	entry.last_used = time;
+
+	/* append verts and normals */
+	size_t vert_offset = mesh->verts.size();
+	size_t num_verts = entry.P.size();
+
+	mesh->reserve(vert_offset + num_verts, mesh->triangles.size(),
+		mesh->curves.size(), mesh->curve_keys.size());
+
+	Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
+	float3 *N = attr_vN->data_float3();
+
+	for(size_t i = 0; i < num_verts; i++) {
+		mesh->verts[vert_offset + i] = entry.P[i];
+		N[vert_offset + i] = entry.N[i];
+	}
+
+	/* append triangles */
+	for(size_t i = 0; i < entry.triangles.size(); i += 3) {
+		mesh->add_triangle(vert_offset + entry.triangles[i],
+			vert_offset + entry.triangles[i+1],
+			vert_offset + entry.triangles[i+2],
+			shader, smooth);
+	}
+
+	return true;
+}
+
+void DiceCache::insert(int face, const vector<float>& key, Mesh *mesh, size_t vert_offset, size_t tri_offset, double time)
+{
+	remove(face);
+
+	Entry& entry = entries[face];
+	entry.key = key;
+	entry.last_used = time;
+
+	Attribute *attr_vN = mesh->attributes.find(ATTR_STD_VERTEX_NORMAL);
+	float3 *N = (attr_vN)? attr_vN->data_float3(): NULL;
+
+	for(size_t i = vert_offset; i < mesh->verts.size(); i++) {
+		entry.P.push_back(mesh->verts[i]);
+		entry.N.push_back((N)? N[i]: make_float3(0.0f, 0.0f, 0.0f));
+	}
+
+	for(size_t i = tri_offset; i < mesh->triangles.size(); i++) {
+		Mesh::Triangle& t = mesh->triangles[i];
+
+		entry.triangles.push_back(t.v[0] - (int)vert_offset);
+		entry.triangles.push_back(t.v[1] - (int)vert_offset);
+		entry.triangles.push_back(t.v[2] - (int)vert_offset);
+	}
+
+	used_memory += entry.memory_size();
+}
+
+void DiceCache::remove(int face)
+{
+	map<int, Entry>::iterator it = entries.find(face);
+
+	if(it != entries.end()) {
+		used_memory -= it->second.memory_size();
+		entries.erase(it);
+	}
+}
+
+void DiceCache::clear()
+{
+	entries.clear();
+	used_memory = 0;
+}
+
+size_t DiceCache::Entry::memory_size() const
+{
+	return sizeof(Entry) +
+	       key.size()*sizeof(float) +
+	       P.size()*sizeof(float3) +
+	       N.size()*sizeof(float3) +
+	       triangles.size()*sizeof(int);
+}
+
+void DiceCache::limit(const vector<DiceCache*>& caches, size_t max_memory)
+{
+	size_t total_memory = 0;
+
+	foreach(DiceCache *cache, caches)
+		total_memory += cache->used_memory;
+
+	if(total_memory <= max_memory)
+		return;
+
+	/* sort faces of all caches by last use */
+	typedef pair<double, pair<DiceCache*, int> > LRUItem;
+	vector<LRUItem> items;
+
+	foreach(DiceCache *cache, caches) {
+		map<int, Entry>::iterator it;
+
+		for(it = cache->entries.begin(); it != cache->entries.end(); it++)
+			items.push_back(LRUItem(it->second.last_used, make_pair(cache, it->first)));
+	}
+
+	sort(items.begin(), items.end());
+
+	/* free oldest first */
+	for(size_t i = 0; i < items.size() && total_memory > max_memory; i++) {
+		DiceCache *cache = items[i].second.first;
+		size_t memory = cache->used_memory;
+
+		cache->remove(items[i].second.second);
+		total_memory -= memory - cache->used_memory;
+	}
+}
+
+CCL_NAMESPACE_END
+
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2013, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __SUBD_CACHE_H__
+#define __SUBD_CACHE_H__
+
+#include "util_map.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class DiagSplit;
+class Mesh;
+
+/* Dice Cache
+ *
+ * Diced geometry of the faces of a subdivision mesh, so that faces that are
+ * split into the same subpatches with the same edge factors as in a previous
+ * tessellation don't need to be diced again. With camera adaptive dicing this
+ * is the case for most faces when the camera moves only a little. The inner
+ * grid of a cached face is not part of the key, it only affects density and
+ * not stitching to neighbors. Memory is bounded by freeing the least recently
+ * used faces. */
+
+class DiceCache {
+public:
+	DiceCache();
+	~DiceCache();
+
+	/* key identifying how a face is diced, from the subpatches and edge
+	 * factors of the last split */
+	static void make_key(DiagSplit *split, vector<float>& key);
+
+	/* add cached geometry of a face to the mesh, if it was diced the same way */
+	bool lookup(int face, const vector<float>& key, Mesh *mesh, int shader, bool smooth, double time);
+	/* store geometry of a face, diced into the mesh starting at the offsets */
+	void insert(int face, const vector<float>& key, Mesh *mesh, size_t vert_offset, size_t tri_offset, double time);
+
+	void clear();
+	size_t memory_size() { return used_memory; }
+
+	/* free least recently used faces until all caches fit in max_memory */
+	static void limit(const vector<DiceCache*>& caches, size_t max_memory);
+
+protected:
+	struct Entry {
+		vector<float> key;
+		vector<float3> P;
+		vector<float3> N;
+		vector<int> triangles;
+		double last_used;
+
+		size_t memory_size() const;
+	};
+
+	void remove(int face);
+
+	map<int, Entry> entries;
+	size_t used_memory;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __SUBD_CACHE_H__ */
+
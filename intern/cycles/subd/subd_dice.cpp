@@ -38,16 +38,40 @@ EdgeDice::EdgeDice(Mesh *mesh_, int shader_, bool smooth_, float dicing_rate_)
 	shader = shader_;
 	smooth = smooth_;
 	camera = NULL;
+	objecttocamera = transform_identity();
 
 	mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 }
 
+float3 EdgeDice::project(Camera *camera, const Transform& objecttocamera, float3 P)
+{
+	/* project to raster space, so the dicing rate is in pixels */
+	P = transform_point(&objecttocamera, P);
+
+	if(camera->type == CAMERA_PERSPECTIVE) {
+		/* mirror points behind the camera in front of it, so that they
+		 * still get a finite dicing rate that decreases with distance */
+		P.z = max(fabsf(P.z), camera->nearclip);
+		return transform_perspective(&camera->cameratoraster, P);
+	}
+	else if(camera->type == CAMERA_ORTHOGRAPHIC) {
+		return transform_perspective(&camera->cameratoraster, P);
+	}
+	else {
+		/* panorama, approximate pixels per radian with equirectangular */
+		float d = max(len(P), camera->nearclip);
+		return P*(camera->width/(2.0f*M_PI_F*d));
+	}
+}
+
 void EdgeDice::reserve(int num_verts, int num_tris)
 {
 	vert_offset = mesh->verts.size();
 	tri_offset = mesh->triangles.size();
 
-	mesh->reserve(vert_offset + num_verts, tri_offset + num_tris, 0, 0);
+	/* keep curves, the mesh may have hair too */
+	mesh->reserve(vert_offset + num_verts, tri_offset + num_tris,
+		mesh->curves.size(), mesh->curve_keys.size());
 
 	Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 
@@ -141,7 +165,7 @@ float3 QuadDice::eval_projected(SubPatch& sub, float u, float v)
 
 	sub.patch->eval(&P, NULL, NULL, uv.x, uv.y);
 	if(camera)
-		P = transform_perspective(&camera->worldtoraster, P);
+		P = project(camera, objecttocamera, P);
 
 	return P;
 }
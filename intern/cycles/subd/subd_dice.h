@@ -24,6 +24,7 @@
  * DiagSplit. For more algorithm details, see the DiagSplit paper or the
  * ARB_tessellation_shader OpenGL extension, Section 2.X.2. */
 
+#include "util_transform.h"
 #include "util_types.h"
 #include "util_vector.h"
 
@@ -38,6 +39,7 @@ class Patch;
 class EdgeDice {
 public:
 	Camera *camera;
+	Transform objecttocamera;
 	Mesh *mesh;
 	float3 *mesh_P;
 	float3 *mesh_N;
@@ -49,6 +51,8 @@ public:
 
 	EdgeDice(Mesh *mesh, int shader, bool smooth, float dicing_rate);
 
+	static float3 project(Camera *camera, const Transform& objecttocamera, float3 P);
+
 	void reserve(int num_verts, int num_tris);
 
 	int add_vert(Patch *patch, float2 uv);
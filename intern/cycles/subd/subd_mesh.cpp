@@ -28,7 +28,10 @@
 
 #include <stdio.h>
 
+#include "mesh.h"
+
 #include "subd_build.h"
+#include "subd_cache.h"
 #include "subd_edge.h"
 #include "subd_face.h"
 #include "subd_mesh.h"
@@ -38,6 +41,7 @@
 
 #include "util_debug.h"
 #include "util_foreach.h"
+#include "util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -285,19 +289,39 @@ void SubdMesh::link_boundary_edge(SubdEdge *edge)
 		edge->vert->edge = edge;
 }
 
-void SubdMesh::tessellate(DiagSplit *split, bool linear, Mesh *mesh, int shader, bool smooth)
+void SubdMesh::tessellate(DiagSplit *split, bool linear, Mesh *mesh, int shader, bool smooth, DiceCache *cache)
 {
 	SubdBuilder *builder = SubdBuilder::create(linear);
 	int num_faces = faces.size();
+	double time = time_dt();
+	vector<float> key;
 		        
 	for(int f = 0; f < num_faces; f++) {
 		SubdFace *face = faces[f];
 		Patch *patch = builder->run(face);
 
 		if(patch->is_triangle())
-			split->split_triangle(mesh, patch, shader, smooth);
+			split->split_triangle(patch);
+		else
+			split->split_quad(patch);
+
+		if(cache) {
+			/* reuse diced geometry if the face was split the same way */
+			DiceCache::make_key(split, key);
+
+			if(cache->lookup(f, key, mesh, shader, smooth, time)) {
+				split->clear();
+			}
+			else {
+				size_t vert_offset = mesh->verts.size();
+				size_t tri_offset = mesh->triangles.size();
+
+				split->dice(mesh, shader, smooth);
+				cache->insert(f, key, mesh, vert_offset, tri_offset, time);
+			}
+		}
 		else
-			split->split_quad(mesh, patch, shader, smooth);
+			split->dice(mesh, shader, smooth);
 
 		delete patch;
 	}
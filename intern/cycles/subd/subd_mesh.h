@@ -40,6 +40,7 @@ class SubdVert;
 class SubdEdge;
 
 class DiagSplit;
+class DiceCache;
 class Mesh;
 
 /* Subd Mesh, half edge based for dynamic mesh manipulation */
@@ -62,7 +63,7 @@ public:
 
 	bool link_boundary();
 	void tessellate(DiagSplit *split, bool linear,
-		Mesh *mesh, int shader, bool smooth);
+		Mesh *mesh, int shader, bool smooth, DiceCache *cache = NULL);
 
 protected:
 	bool can_add_face(int *index, int num);
@@ -37,6 +37,7 @@ DiagSplit::DiagSplit()
 	split_threshold = 1;
 	dicing_rate = 0.1f;
 	camera = NULL;
+	objecttocamera = transform_identity();
 }
 
 void DiagSplit::dispatch(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef)
@@ -57,7 +58,7 @@ float3 DiagSplit::project(Patch *patch, float2 uv)
 
 	patch->eval(&P, NULL, NULL, uv.x, uv.y);
 	if(camera)
-		P = transform_perspective(&camera->worldtoraster, P);
+		P = EdgeDice::project(camera, objecttocamera, P);
 
 	return P;
 }
@@ -82,8 +83,10 @@ int DiagSplit::T(Patch *patch, float2 Pstart, float2 Pend)
 		Plast = P;
 	}
 
-	int tmin = (int)ceil(Lsum/dicing_rate);
-	int tmax = (int)ceil((test_steps-1)*Lmax/dicing_rate); // XXX paper says N instead of N-1, seems wrong?
+	/* clamp, so that geometry very close to the camera doesn't get diced or
+	 * split indefinitely */
+	int tmin = (int)ceil(min(Lsum/dicing_rate, (float)DSPLIT_MAX_SEGMENTS));
+	int tmax = (int)ceil(min((test_steps-1)*Lmax/dicing_rate, (float)DSPLIT_MAX_SEGMENTS)); // XXX paper says N instead of N-1, seems wrong?
 
 	if(tmax - tmin > split_threshold)
 		return DSPLIT_NON_UNIFORM;
@@ -246,7 +249,7 @@ void DiagSplit::split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int de
 		dispatch(sub, ef);
 }
 
-void DiagSplit::split_triangle(Mesh *mesh, Patch *patch, int shader, bool smooth)
+void DiagSplit::split_triangle(Patch *patch)
 {
 	TriangleDice::SubPatch sub_split;
 	TriangleDice::EdgeFactors ef_split;
@@ -262,11 +265,7 @@ void DiagSplit::split_triangle(Mesh *mesh, Patch *patch, int shader, bool smooth
 
 	split(sub_split, ef_split);
 
-	TriangleDice dice(mesh, shader, smooth, dicing_rate);
-	dice.camera = camera;
-
 	for(size_t i = 0; i < subpatches_triangle.size(); i++) {
-		TriangleDice::SubPatch& sub = subpatches_triangle[i];
 		TriangleDice::EdgeFactors& ef = edgefactors_triangle[i];
 
 		ef.tu = 4;
@@ -276,15 +275,10 @@ void DiagSplit::split_triangle(Mesh *mesh, Patch *patch, int shader, bool smooth
 		ef.tu = max(ef.tu, 1);
 		ef.tv = max(ef.tv, 1);
 		ef.tw = max(ef.tw, 1);
-
-		dice.dice(sub, ef);
 	}
-
-	subpatches_triangle.clear();
-	edgefactors_triangle.clear();
 }
 
-void DiagSplit::split_quad(Mesh *mesh, Patch *patch, int shader, bool smooth)
+void DiagSplit::split_quad(Patch *patch)
 {
 	QuadDice::SubPatch sub_split;
 	QuadDice::EdgeFactors ef_split;
@@ -302,23 +296,58 @@ void DiagSplit::split_quad(Mesh *mesh, Patch *patch, int shader, bool smooth)
 
 	split(sub_split, ef_split);
 
-	QuadDice dice(mesh, shader, smooth, dicing_rate);
-	dice.camera = camera;
-
 	for(size_t i = 0; i < subpatches_quad.size(); i++) {
-		QuadDice::SubPatch& sub = subpatches_quad[i];
 		QuadDice::EdgeFactors& ef = edgefactors_quad[i];
 
 		ef.tu0 = max(ef.tu0, 1);
 		ef.tu1 = max(ef.tu1, 1);
 		ef.tv0 = max(ef.tv0, 1);
 		ef.tv1 = max(ef.tv1, 1);
+	}
+}
+
+void DiagSplit::dice(Mesh *mesh, int shader, bool smooth)
+{
+	/* dice the subpatches from the last split */
+	if(subpatches_triangle.size()) {
+		TriangleDice dice(mesh, shader, smooth, dicing_rate);
+		dice.camera = camera;
+		dice.objecttocamera = objecttocamera;
+
+		for(size_t i = 0; i < subpatches_triangle.size(); i++)
+			dice.dice(subpatches_triangle[i], edgefactors_triangle[i]);
+	}
+
+	if(subpatches_quad.size()) {
+		QuadDice dice(mesh, shader, smooth, dicing_rate);
+		dice.camera = camera;
+		dice.objecttocamera = objecttocamera;
 
-		dice.dice(sub, ef);
+		for(size_t i = 0; i < subpatches_quad.size(); i++)
+			dice.dice(subpatches_quad[i], edgefactors_quad[i]);
 	}
 
+	clear();
+}
+
+void DiagSplit::clear()
+{
 	subpatches_quad.clear();
 	edgefactors_quad.clear();
+	subpatches_triangle.clear();
+	edgefactors_triangle.clear();
+}
+
+void DiagSplit::split_triangle(Mesh *mesh, Patch *patch, int shader, bool smooth)
+{
+	split_triangle(patch);
+	dice(mesh, shader, smooth);
+}
+
+void DiagSplit::split_quad(Mesh *mesh, Patch *patch, int shader, bool smooth)
+{
+	split_quad(patch);
+	dice(mesh, shader, smooth);
 }
 
 CCL_NAMESPACE_END
@@ -35,6 +35,7 @@ class Mesh;
 class Patch;
 
 #define DSPLIT_NON_UNIFORM -1
+#define DSPLIT_MAX_SEGMENTS 256
 
 class DiagSplit {
 public:
@@ -47,6 +48,7 @@ public:
 	int split_threshold;
 	float dicing_rate;
 	Camera *camera;
+	Transform objecttocamera;
 
 	DiagSplit();
 
@@ -61,6 +63,11 @@ public:
 	void dispatch(TriangleDice::SubPatch& sub, TriangleDice::EdgeFactors& ef);
 	void split(TriangleDice::SubPatch& sub, TriangleDice::EdgeFactors& ef, int depth=0);
 
+	void split_triangle(Patch *patch);
+	void split_quad(Patch *patch);
+	void dice(Mesh *mesh, int shader, bool smooth);
+	void clear();
+
 	void split_triangle(Mesh *mesh, Patch *patch, int shader, bool smooth);
 	void split_quad(Mesh *mesh, Patch *patch, int shader, bool smooth);
 };
@@ -28,6 +28,7 @@ using std::swap;
 using std::max;
 using std::min;
 using std::remove;
+using std::partition;
 
 CCL_NAMESPACE_END
 
@@ -17,7 +17,21 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <ctime>
+#include <utility>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+#include "util_algorithm.h"
 #include "util_cache.h"
 #include "util_debug.h"
 #include "util_foreach.h"
@@ -37,19 +51,41 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* File Header */
+
+#define CACHE_FILE_MAGIC 0x43434348
+#define CACHE_FILE_VERSION 3
+
+/* data of each buffer starts at a multiple of this in the file, enough for
+ * SSE loads from mapped arrays */
+#define CACHE_FILE_ALIGNMENT 16
+
+struct CacheHeader {
+	uint magic;
+	uint version;
+	uint64_t size;
+	char md5[32];
+};
+
 /* CacheData */
 
 CacheData::CacheData(const string& name_)
 {
 	name = name_;
-	f = NULL;
 	have_filename = false;
+
+	data = NULL;
+	data_mutable = NULL;
+	data_size = 0;
+	data_offset = 0;
+
+	map = NULL;
+	map_size = 0;
 }
 
 CacheData::~CacheData()
 {
-	if(f)
-		fclose(f);
+	unmap_file();
 }
 
 const string& CacheData::get_filename()
@@ -68,6 +104,98 @@ const string& CacheData::get_filename()
 	return filename;
 }
 
+bool CacheData::map_file(const string& filepath)
+{
+	unmap_file();
+
+#ifndef _WIN32
+	int fd = open(filepath.c_str(), O_RDONLY);
+
+	if(fd == -1)
+		return false;
+
+	struct stat st;
+
+	if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	void *mem = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(mem == MAP_FAILED)
+		return false;
+
+	map = mem;
+	map_size = st.st_size;
+	data_mutable = (uint8_t*)map;
+	data_size = map_size;
+#else
+	if(!path_read_binary(filepath, map_buffer) || map_buffer.size() == 0)
+		return false;
+
+	data_mutable = &map_buffer[0];
+	data_size = map_buffer.size();
+#endif
+
+	data = data_mutable;
+
+	data_offset = 0;
+
+	return true;
+}
+
+void CacheData::unmap_file()
+{
+#ifndef _WIN32
+	if(map)
+		munmap(map, map_size);
+#endif
+
+	map = NULL;
+	map_size = 0;
+	map_buffer.clear();
+
+	data = NULL;
+	data_mutable = NULL;
+	data_size = 0;
+	data_offset = 0;
+}
+
+bool CacheData::read_bytes(void *dst, size_t size)
+{
+	if(!data || size > data_size - data_offset)
+		return false;
+
+	memcpy(dst, data + data_offset, size);
+	data_offset += size;
+
+	return true;
+}
+
+bool CacheData::read_value(void *dst, size_t size)
+{
+	size_t stored_size;
+
+	if(!read_bytes(&stored_size, sizeof(stored_size)) || stored_size != size || !read_align())
+		return false;
+
+	return read_bytes(dst, size);
+}
+
+bool CacheData::read_align()
+{
+	size_t offset = (data_offset + CACHE_FILE_ALIGNMENT - 1) & ~(size_t)(CACHE_FILE_ALIGNMENT - 1);
+
+	if(!data || offset > data_size)
+		return false;
+
+	data_offset = offset;
+
+	return true;
+}
+
 /* Cache */
 
 Cache Cache::global;
@@ -77,61 +205,180 @@ string Cache::data_filename(CacheData& key)
 	return path_user_get(path_join("cache", key.get_filename()));
 }
 
+static bool cache_write(FILE *f, const void *data, size_t size, MD5Hash *hash)
+{
+	if(hash) {
+		/* md5 append takes an int size, so hash large buffers in chunks */
+		const uint8_t *bytes = (const uint8_t*)data;
+		const size_t chunk = 1 << 30;
+
+		for(size_t offset = 0; offset < size; offset += chunk)
+			hash->append(bytes + offset, (int)min(chunk, size - offset));
+	}
+
+	return fwrite(data, size, 1, f) == 1;
+}
+
 void Cache::insert(CacheData& key, CacheData& value)
 {
 	string filename = data_filename(key);
 	path_create_directories(filename);
-	FILE *f = fopen(filename.c_str(), "wb");
+
+	/* write to a temporary file and rename it when complete, so other
+	 * processes never see partially written files */
+	string tmp_filename = string_printf("%s.%d.tmp", filename.c_str(), (int)getpid());
+	FILE *f = fopen(tmp_filename.c_str(), "wb");
 
 	if(!f) {
-		fprintf(stderr, "Failed to open file %s for writing.\n", filename.c_str());
+		fprintf(stderr, "Failed to open file %s for writing.\n", tmp_filename.c_str());
 		return;
 	}
 
+	CacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CACHE_FILE_MAGIC;
+	header.version = CACHE_FILE_VERSION;
+
+	/* header is written twice, second time with the hash filled in */
+	MD5Hash hash;
+	bool ok = cache_write(f, &header, sizeof(header), NULL);
+	size_t offset = sizeof(header);
+
 	foreach(CacheBuffer& buffer, value.buffers) {
-		if(!fwrite(&buffer.size, sizeof(buffer.size), 1, f))
-			fprintf(stderr, "Failed to write to file %s.\n", filename.c_str());
+		/* size, then padding up to the aligned start of the data */
+		static const char padding[CACHE_FILE_ALIGNMENT] = {0};
+		size_t padding_size = (CACHE_FILE_ALIGNMENT - (offset + sizeof(buffer.size)) % CACHE_FILE_ALIGNMENT) % CACHE_FILE_ALIGNMENT;
+
+		ok = ok && cache_write(f, &buffer.size, sizeof(buffer.size), &hash);
+		if(padding_size)
+			ok = ok && cache_write(f, padding, padding_size, &hash);
 		if(buffer.size)
-			if(!fwrite(buffer.data, buffer.size, 1, f))
-				fprintf(stderr, "Failed to write to file %s.\n", filename.c_str());
+			ok = ok && cache_write(f, buffer.data, buffer.size, &hash);
+
+		offset += sizeof(buffer.size) + padding_size + buffer.size;
 	}
-	
-	fclose(f);
+
+	header.size = offset - sizeof(header);
+
+	string hex = hash.get_hex();
+	memcpy(header.md5, hex.c_str(), min(hex.size(), sizeof(header.md5)));
+
+	ok = ok && fseek(f, 0, SEEK_SET) == 0;
+	ok = ok && cache_write(f, &header, sizeof(header), NULL);
+	ok = (fclose(f) == 0) && ok;
+
+	if(!ok) {
+		fprintf(stderr, "Failed to write to file %s.\n", tmp_filename.c_str());
+		::remove(tmp_filename.c_str());
+		return;
+	}
+
+#ifdef _WIN32
+	/* rename does not overwrite existing files on windows */
+	::remove(filename.c_str());
+#endif
+
+	if(::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+		fprintf(stderr, "Failed to rename file %s.\n", tmp_filename.c_str());
+		::remove(tmp_filename.c_str());
+		return;
+	}
+
+	if(max_size)
+		limit_size(key.get_filename());
 }
 
 bool Cache::lookup(CacheData& key, CacheData& value)
 {
 	string filename = data_filename(key);
-	FILE *f = fopen(filename.c_str(), "rb");
 
-	if(!f)
+	if(!value.map_file(filename))
 		return false;
 	
+	/* validate header and contents */
+	CacheHeader header;
+	bool valid = value.read_bytes(&header, sizeof(header)) &&
+	             header.magic == CACHE_FILE_MAGIC &&
+	             header.version == CACHE_FILE_VERSION &&
+	             header.size == value.data_size - sizeof(header);
+
+	if(valid) {
+		MD5Hash hash;
+		const uint8_t *bytes = value.data + sizeof(header);
+		const size_t chunk = 1 << 30;
+
+		for(size_t offset = 0; offset < header.size; offset += chunk)
+			hash.append(bytes + offset, (int)min(chunk, (size_t)header.size - offset));
+
+		string hex = hash.get_hex();
+		valid = (hex.size() == sizeof(header.md5) && memcmp(hex.c_str(), header.md5, sizeof(header.md5)) == 0);
+	}
+
+	if(!valid) {
+		fprintf(stderr, "Discarding invalid cache file %s.\n", filename.c_str());
+		value.unmap_file();
+		::remove(filename.c_str());
+		return false;
+	}
+
 	value.name = key.name;
-	value.f = f;
+
+	/* mark as recently used for limit_size */
+	if(max_size) {
+		boost::system::error_code error;
+		boost::filesystem::last_write_time(filename, std::time(NULL), error);
+	}
 
 	return true;
 }
 
-void Cache::clear_except(const string& name, const set<string>& except)
+void Cache::limit_size(const string& keep_filename)
 {
 	string dir = path_user_get("cache");
 
-	if(boost::filesystem::exists(dir)) {
+	if(!boost::filesystem::exists(dir))
+		return;
+
+	/* files by last use, lookup updates the modification time */
+	vector<std::pair<std::time_t, std::pair<size_t, boost::filesystem::path> > > files;
+	size_t total_size = 0;
+
+	try {
 		boost::filesystem::directory_iterator it(dir), it_end;
 
 		for(; it != it_end; it++) {
+			const boost::filesystem::path& path = it->path();
 #if (BOOST_FILESYSTEM_VERSION == 2)
-			string filename = it->path().filename();
+			string filename = path.filename();
 #else
-			string filename = it->path().filename().string();
+			string filename = path.filename().string();
 #endif
 
-			if(boost::starts_with(filename, name))
-				if(except.find(filename) == except.end())
-					boost::filesystem::remove(it->path());
+			/* temporary files are still being written, possibly by another process */
+			if(boost::ends_with(filename, ".tmp") || !boost::filesystem::is_regular_file(path))
+				continue;
+
+			size_t size = boost::filesystem::file_size(path);
+			total_size += size;
+
+			if(filename != keep_filename)
+				files.push_back(std::make_pair(boost::filesystem::last_write_time(path), std::make_pair(size, path)));
+		}
+
+		sort(files.begin(), files.end());
+
+		for(size_t i = 0; i < files.size() && total_size > max_size; i++) {
+			boost::system::error_code error;
+
+			/* another process may have removed it already */
+			if(boost::filesystem::remove(files[i].second.second, error))
+				total_size -= files[i].second.first;
 		}
 	}
+	catch(const boost::filesystem::filesystem_error& e) {
+		/* files may disappear while iterating, eviction is best effort */
+		fprintf(stderr, "Failed to limit cache size: %s\n", e.what());
+	}
 }
 
 CCL_NAMESPACE_END
@@ -30,10 +30,19 @@
  * invalidate cache entries, at the cost of exta computation. If everything
  * is stored in a global cache, computations can perhaps even be shared between
  * different scenes where it may be hard to detect duplicate work.
+ *
+ * Files start with a header containing a version and an MD5 hash of the
+ * data, so truncated or corrupt files from crashed or concurrent processes
+ * are detected and discarded. Files are written to a temporary file first
+ * and then renamed, and memory mapped for reading. Arrays start aligned in
+ * the file, so they can be used from the mapped memory without copying.
  */
 
+#include <stdio.h>
+
 #include "util_set.h"
 #include "util_string.h"
+#include "util_types.h"
 #include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
@@ -53,7 +62,6 @@ public:
 	string name;
 	string filename;
 	bool have_filename;
-	FILE *f;
 
 	CacheData(const string& name = "");
 	~CacheData();
@@ -98,68 +106,128 @@ public:
 		buffers.push_back(buffer);
 	}
 
-	template<typename T> void read(array<T>& data)
+	/* reading returns false if the data does not match what was written */
+	template<typename T> bool read(array<T>& data)
 	{
 		size_t size;
 
-		if(!fread(&size, sizeof(size), 1, f)) {
+		if(!read_bytes(&size, sizeof(size)) || size % sizeof(T) != 0 || !read_align()) {
 			fprintf(stderr, "Failed to read vector size from cache.\n");
-			return;
+			return false;
 		}
 
-		if(!size)
-			return;
+		if(!size) {
+			data.clear();
+			return true;
+		}
 
 		data.resize(size/sizeof(T));
 
-		if(!fread(&data[0], size, 1, f)) {
+		if(!read_bytes(&data[0], size)) {
 			fprintf(stderr, "Failed to read vector data from cache (%lu).\n", (unsigned long)size);
-			return;
+			return false;
 		}
+
+		return true;
 	}
 
-	void read(int& data)
+	/* point the array at the mapped file contents instead of copying them,
+	 * the CacheData must stay alive as long as the array references them */
+	template<typename T> bool read_reference(array<T>& data)
 	{
 		size_t size;
 
-		if(!fread(&size, sizeof(size), 1, f))
-			fprintf(stderr, "Failed to read int size from cache.\n");
-		if(!fread(&data, sizeof(data), 1, f))
-			fprintf(stderr, "Failed to read int from cache.\n");
+		if(!read_bytes(&size, sizeof(size)) || size % sizeof(T) != 0 || !read_align()) {
+			fprintf(stderr, "Failed to read vector size from cache.\n");
+			return false;
+		}
+
+		if(!size) {
+			data.clear();
+			return true;
+		}
+
+		if(size > data_size - data_offset) {
+			fprintf(stderr, "Failed to read vector data from cache (%lu).\n", (unsigned long)size);
+			return false;
+		}
+
+		data.reference((T*)(data_mutable + data_offset), size/sizeof(T));
+		data_offset += size;
+
+		return true;
 	}
 
-	void read(float& data)
+	bool read(int& data)
 	{
-		size_t size;
+		if(!read_value(&data, sizeof(data))) {
+			fprintf(stderr, "Failed to read int from cache.\n");
+			return false;
+		}
 
-		if(!fread(&size, sizeof(size), 1, f))
-			fprintf(stderr, "Failed to read float size from cache.\n");
-		if(!fread(&data, sizeof(data), 1, f))
-			fprintf(stderr, "Failed to read float from cache.\n");
+		return true;
 	}
 
-	void read(size_t& data)
+	bool read(float& data)
 	{
-		size_t size;
+		if(!read_value(&data, sizeof(data))) {
+			fprintf(stderr, "Failed to read float from cache.\n");
+			return false;
+		}
+
+		return true;
+	}
 
-		if(!fread(&size, sizeof(size), 1, f))
-			fprintf(stderr, "Failed to read size_t size from cache.\n");
-		if(!fread(&data, sizeof(data), 1, f))
+	bool read(size_t& data)
+	{
+		if(!read_value(&data, sizeof(data))) {
 			fprintf(stderr, "Failed to read size_t from cache.\n");
+			return false;
+		}
+
+		return true;
 	}
+
+protected:
+	friend class Cache;
+
+	/* file contents, memory mapped copy on write when possible, so arrays
+	 * referencing them can still be modified in place */
+	const uint8_t *data;
+	uint8_t *data_mutable;
+	size_t data_size;
+	size_t data_offset;
+
+	void *map;
+	size_t map_size;
+	vector<uint8_t> map_buffer;
+
+	bool map_file(const string& filepath);
+	void unmap_file();
+
+	bool read_bytes(void *dst, size_t size);
+	bool read_value(void *dst, size_t size);
+	bool read_align();
 };
 
 class Cache {
 public:
 	static Cache global;
 
+	/* when non-zero, least recently used files are removed after an insert
+	 * once the files in the cache directory add up to more bytes than this.
+	 * the directory may be shared by multiple processes, so nothing is
+	 * removed by default */
+	size_t max_size;
+
+	Cache() : max_size(0) {}
+
 	void insert(CacheData& key, CacheData& value);
 	bool lookup(CacheData& key, CacheData& value);
 
-	void clear_except(const string& name, const set<string>& except);
-
 protected:
 	string data_filename(CacheData& key);
+	void limit_size(const string& keep_filename);
 };
 
 CCL_NAMESPACE_END
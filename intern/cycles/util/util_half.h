@@ -0,0 +1,73 @@
+/*
+ * Copyright 2013, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __UTIL_HALF_H__
+#define __UTIL_HALF_H__
+
+#include "util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Half Floats
+ *
+ * 16 bit floats with the same layout as OpenEXR half, used for image storage.
+ * Conversion from float is done by OpenImageIO when loading images, so only
+ * conversion to float is needed here. */
+
+#ifndef __KERNEL_GPU__
+
+typedef unsigned short half;
+
+struct half4 {
+	half x, y, z, w;
+};
+
+__device_inline float half_to_float(half h)
+{
+	union { uint i; float f; } magic, out;
+
+	magic.i = 113 << 23;
+	const uint shifted_exp = 0x7c00 << 13;
+
+	/* exponent and mantissa, rebias exponent */
+	out.i = (h & 0x7fff) << 13;
+	uint exp = shifted_exp & out.i;
+	out.i += (127 - 15) << 23;
+
+	if(exp == shifted_exp) {
+		/* inf and nan */
+		out.i += (128 - 16) << 23;
+	}
+	else if(exp == 0) {
+		/* zero and denormals, renormalize */
+		out.i += 1 << 23;
+		out.f -= magic.f;
+	}
+
+	/* sign */
+	out.i |= (uint)(h & 0x8000) << 16;
+
+	return out.f;
+}
+
+#endif
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_HALF_H__ */
+
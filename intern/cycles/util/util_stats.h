@@ -19,8 +19,64 @@
 #ifndef __UTIL_STATS_H__
 #define __UTIL_STATS_H__
 
+#include "util_string.h"
+#include "util_thread.h"
+#include "util_types.h"
+
 CCL_NAMESPACE_BEGIN
 
+/* Ray Statistics
+ *
+ * Counters gathered by the CPU kernel, each render thread keeps its own and
+ * adds them to Stats when done. Rays are counted in all builds, closures and
+ * BVH traversal only when built with WITH_CYCLES_DEBUG. */
+
+class RayStats {
+public:
+	RayStats()
+	: num_camera_rays(0), num_bounce_rays(0), num_shadow_rays(0),
+	  num_closures(0), num_bvh_traversal_steps(0), num_bvh_intersections(0) {}
+
+	void add(const RayStats& other) {
+		num_camera_rays += other.num_camera_rays;
+		num_bounce_rays += other.num_bounce_rays;
+		num_shadow_rays += other.num_shadow_rays;
+		num_closures += other.num_closures;
+		num_bvh_traversal_steps += other.num_bvh_traversal_steps;
+		num_bvh_intersections += other.num_bvh_intersections;
+	}
+
+	string report() const {
+		uint64_t num_rays = num_camera_rays + num_bounce_rays + num_shadow_rays;
+		double inv_paths = (num_camera_rays)? 1.0/(double)num_camera_rays: 0.0;
+		double inv_rays = (num_rays)? 1.0/(double)num_rays: 0.0;
+
+		return string_printf(
+			"Rays:\n"
+			"  Camera                  %llu\n"
+			"  Bounce                  %llu\n"
+			"  Shadow                  %llu\n"
+			"  Average bounces         %.2f\n"
+			"  Closures per path       %.2f\n"
+			"  BVH steps per ray       %.2f\n"
+			"  Intersections per ray   %.2f\n",
+			(unsigned long long)num_camera_rays,
+			(unsigned long long)num_bounce_rays,
+			(unsigned long long)num_shadow_rays,
+			num_bounce_rays*inv_paths,
+			num_closures*inv_paths,
+			num_bvh_traversal_steps*inv_rays,
+			num_bvh_intersections*inv_rays);
+	}
+
+	uint64_t num_camera_rays;
+	uint64_t num_bounce_rays;
+	uint64_t num_shadow_rays;
+	uint64_t num_closures;
+	uint64_t num_bvh_traversal_steps;
+	uint64_t num_bvh_intersections;
+};
+
 class Stats {
 public:
 	Stats() : mem_used(0), mem_peak(0) {}
@@ -35,8 +91,16 @@ public:
 		mem_used -= size;
 	}
 
+	void rays_add(const RayStats& other) {
+		thread_scoped_lock lock(rays_mutex);
+		rays.add(other);
+	}
+
 	size_t mem_used;
 	size_t mem_peak;
+
+	RayStats rays;
+	thread_mutex rays_mutex;
 };
 
 CCL_NAMESPACE_END
@@ -18,6 +18,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <boost/algorithm/string.hpp>
 
@@ -88,5 +89,25 @@ void string_split(vector<string>& tokens, const string& str, const string& separ
 			tokens.push_back(token);
 }
 
+bool string_startswith(const string& str, const char *start)
+{
+	size_t len = strlen(start);
+
+	if(len > str.size())
+		return false;
+
+	return strncmp(str.c_str(), start, len) == 0;
+}
+
+bool string_endswith(const string& str, const char *end)
+{
+	size_t len = strlen(end);
+
+	if(len > str.size())
+		return false;
+
+	return strncmp(str.c_str() + str.size() - len, end, len) == 0;
+}
+
 CCL_NAMESPACE_END
 
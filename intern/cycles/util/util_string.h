@@ -42,6 +42,8 @@ string string_printf(const char *format, ...) PRINTF_ATTRIBUTE;
 
 bool string_iequals(const string& a, const string& b);
 void string_split(vector<string>& tokens, const string& str, const string& separators = "\t ");
+bool string_startswith(const string& str, const char *start);
+bool string_endswith(const string& str, const char *end);
 
 CCL_NAMESPACE_END
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <OpenImageIO/texture.h>
+
+#include "util_texture_cache.h"
+
+CCL_NAMESPACE_BEGIN
+
+OIIO_NAMESPACE_USING
+
+TextureCache::TextureCache(int max_memory_MB)
+{
+	/* not shared, so OSL and other renders keep their own memory budget */
+	TextureSystem *ts = TextureSystem::create(false);
+
+	ts->attribute("automip", 1);
+	ts->attribute("autotile", 64);
+	ts->attribute("gray_to_rgb", 1);
+	ts->attribute("max_memory_MB", (float)max_memory_MB);
+
+	texture_system = ts;
+}
+
+TextureCache::~TextureCache()
+{
+	for(size_t slot = 0; slot < images.size(); slot++)
+		remove_image(slot);
+
+	TextureSystem::destroy((TextureSystem*)texture_system);
+}
+
+bool TextureCache::add_image(int slot, const string& filename)
+{
+	TextureSystem *ts = (TextureSystem*)texture_system;
+	ustring name(filename);
+	int resolution[2];
+
+	/* only opens the file header, pixels are read on the first lookup */
+	if(!ts->get_texture_info(name, 0, ustring("resolution"), TypeDesc(TypeDesc::INT, 2), resolution))
+		return false;
+
+	remove_image(slot);
+
+	if(slot >= (int)images.size())
+		images.resize(slot + 1, NULL);
+
+	images[slot] = new ustring(name);
+
+	return true;
+}
+
+void TextureCache::remove_image(int slot)
+{
+	if(!has_image(slot))
+		return;
+
+	ustring *name = (ustring*)images[slot];
+
+	((TextureSystem*)texture_system)->invalidate(*name);
+
+	delete name;
+	images[slot] = NULL;
+}
+
+float4 TextureCache::lookup(int slot, float x, float y, float2 dx, float2 dy)
+{
+	TextureSystem *ts = (TextureSystem*)texture_system;
+	TextureOpt options;
+	float result[4];
+
+	options.nchannels = 4;
+	options.swrap = TextureOpt::WrapPeriodic;
+	options.twrap = TextureOpt::WrapPeriodic;
+	/* alpha for images without an alpha channel */
+	options.fill = 1.0f;
+
+	/* images are stored bottom to top, texture system t goes top to bottom */
+	if(!ts->texture(*(ustring*)images[slot], options, x, 1.0f - y, dx.x, -dx.y, dy.x, -dy.y, result))
+		return make_float4(1.0f, 0.0f, 1.0f, 1.0f);
+
+	return make_float4(result[0], result[1], result[2], result[3]);
+}
+
+string TextureCache::statistics()
+{
+	return ((TextureSystem*)texture_system)->getstats(1, true);
+}
+
+CCL_NAMESPACE_END
+
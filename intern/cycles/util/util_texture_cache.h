@@ -0,0 +1,66 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __UTIL_TEXTURE_CACHE_H__
+#define __UTIL_TEXTURE_CACHE_H__
+
+/* Texture Cache
+ *
+ * Image textures read on demand through the OpenImageIO texture system,
+ * instead of being loaded into memory in full before rendering. Images are
+ * split into tiles and mipmapped (on the fly if the file is not already), and
+ * only the tiles that are accessed get read, within a memory budget.
+ *
+ * Used by the CPU device for SVM image textures, OSL has its own. */
+
+#include "util_string.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class TextureCache {
+public:
+	TextureCache(int max_memory_MB);
+	~TextureCache();
+
+	/* images are registered by texture slot, returns false if the file can't
+	 * be read, in which case it should be loaded the regular way */
+	bool add_image(int slot, const string& filename);
+	void remove_image(int slot);
+
+	bool has_image(int slot)
+	{
+		return (slot < (int)images.size() && images[slot]);
+	}
+
+	/* filtered lookup, with the same coordinates as regular image textures and
+	 * derivatives of them for choosing the mipmap level, may be zero */
+	float4 lookup(int slot, float x, float y, float2 dx, float2 dy);
+
+	string statistics();
+
+protected:
+	void *texture_system;
+	vector<void*> images;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_TEXTURE_CACHE_H__ */
+
@@ -33,7 +33,10 @@ using std::vector;
  * Simplified version of vector, serving two purposes:
  * - somewhat faster in that it does not clear memory on resize/alloc,
  *   this was actually showing up in profiles quite significantly
- * - if this is used, we are not tempted to use inefficient operations */
+ * - if this is used, we are not tempted to use inefficient operations
+ *
+ * An array can also reference memory it does not own, for example a memory
+ * mapped file. It owns its memory again after it is resized or assigned. */
 
 template<typename T>
 class array
@@ -43,10 +46,13 @@ public:
 	{
 		data = NULL;
 		datasize = 0;
+		referenced = false;
 	}
 
 	array(size_t newsize)
 	{
+		referenced = false;
+
 		if(newsize == 0) {
 			data = NULL;
 			datasize = 0;
@@ -64,6 +70,8 @@ public:
 
 	array& operator=(const array& from)
 	{
+		referenced = false;
+
 		if(from.datasize == 0) {
 			data = NULL;
 			datasize = 0;
@@ -79,6 +87,7 @@ public:
 
 	array& operator=(const vector<T>& from)
 	{
+		referenced = false;
 		datasize = from.size();
 		data = NULL;
 
@@ -92,7 +101,8 @@ public:
 
 	~array()
 	{
-		delete [] data;
+		if(!referenced)
+			delete [] data;
 	}
 
 	void resize(size_t newsize)
@@ -103,18 +113,32 @@ public:
 		else {
 			T *newdata = new T[newsize];
 			memcpy(newdata, data, ((datasize < newsize)? datasize: newsize)*sizeof(T));
-			delete [] data;
+			if(!referenced)
+				delete [] data;
 
 			data = newdata;
 			datasize = newsize;
+			referenced = false;
 		}
 	}
 
 	void clear()
 	{
-		delete [] data;
+		if(!referenced)
+			delete [] data;
 		data = NULL;
 		datasize = 0;
+		referenced = false;
+	}
+
+	/* use memory owned by someone else, which must stay valid as long as
+	 * the array references it */
+	void reference(T *ptr, size_t newsize)
+	{
+		clear();
+		data = ptr;
+		datasize = newsize;
+		referenced = (ptr != NULL);
 	}
 
 	size_t size() const
@@ -130,6 +154,7 @@ public:
 protected:
 	T *data;
 	size_t datasize;
+	bool referenced;
 };
 
 CCL_NAMESPACE_END
@@ -261,6 +261,7 @@ class NODE_PT_quality(bpy.types.Panel):
         col = layout.column()
         col.prop(tree, "use_opencl")
         col.prop(tree, "use_groupnode_buffer")
+        col.prop(tree, "use_half_buffers")
         col.prop(tree, "two_pass")
         col.prop(tree, "use_viewer_border")
         col.prop(snode, "show_highlight")
@@ -465,6 +465,33 @@ void BLI_rw_mutex_end(ThreadRWMutex *mutex)
 	pthread_rwlock_destroy(mutex);
 }
 
+/* Condition */
+
+void BLI_condition_init(ThreadCondition *cond)
+{
+	pthread_cond_init(cond, NULL);
+}
+
+void BLI_condition_wait(ThreadCondition *cond, ThreadMutex *mutex)
+{
+	pthread_cond_wait(cond, mutex);
+}
+
+void BLI_condition_notify_one(ThreadCondition *cond)
+{
+	pthread_cond_signal(cond);
+}
+
+void BLI_condition_notify_all(ThreadCondition *cond)
+{
+	pthread_cond_broadcast(cond);
+}
+
+void BLI_condition_end(ThreadCondition *cond)
+{
+	pthread_cond_destroy(cond);
+}
+
 /* ************************************************ */
 
 typedef struct ThreadedWorker {
@@ -325,7 +325,27 @@ void COM_deinitialize(void);
  * @brief Clear all compositor caches. (Compositor system will still remain available). 
  * To deinitialize the compositor use the COM_deinitialize method.
  */
-// void COM_clearCaches(void); // NOT YET WRITTEN
+void COM_clearCaches(void);
+
+/**
+ * @brief Collect timings and memory usage of the following COM_execute calls.
+ * Every call is a run, runs of the same node tree are accumulated.
+ * @see ExecutionStatistics
+ */
+void COM_startStatistics(void);
+
+/**
+ * @brief Write the collected statistics as a JSON object.
+ * @param filepath
+ *   file to write to, NULL writes to stdout
+ * @return 1 when written, 0 when the file could not be opened
+ */
+int COM_writeStatistics(const char *filepath);
+
+/**
+ * @brief Stop collecting statistics.
+ */
+void COM_stopStatistics(void);
 
 /**
  * @brief Return a list of highlighted bnodes pointers.
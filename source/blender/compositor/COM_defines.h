@@ -107,6 +107,44 @@ typedef enum OrderOfChunks {
 
 #define COM_NUMBER_OF_CHANNELS 4
 
+/**
+ * @brief number of channels a MemoryBuffer stores per pixel for each DataType
+ * @see MemoryBuffer.getNumberOfChannels
+ */
+#define COM_NUM_CHANNELS_VALUE 1
+#define COM_NUM_CHANNELS_VECTOR 3
+#define COM_NUM_CHANNELS_COLOR 4
+
+/**
+ * @brief number of pixels that row executions process at once
+ * @see SocketReader.executeRow
+ */
+#define COM_ROW_SPAN 64
+
+/**
+ * @brief maximum number of inputs of an operation that can be fused
+ * @see FusedOperation
+ */
+#define COM_FUSED_MAX_OPERANDS 4
+
+/**
+ * @brief maximum number of rows a FusedOperation keeps intermediate results in
+ * @see FusedOperation
+ */
+#define COM_FUSED_MAX_REGISTERS 8
+
 #define COM_BLUR_BOKEH_PIXELS 512
 
+/**
+ * @brief number of horizontal bands the bokeh is approximated with
+ * @see FastBokehBlurOperation
+ */
+#define COM_FAST_BOKEH_BANDS 8
+
+/**
+ * @brief maximum number of bytes of ExecutionGroup results kept between executions
+ * @see ResultCache
+ */
+#define COM_RESULTCACHE_MAXSIZE ((size_t)512 * 1024 * 1024)
+
 #endif
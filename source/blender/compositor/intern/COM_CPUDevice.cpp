@@ -21,17 +21,22 @@
  */
 
 #include "COM_CPUDevice.h"
+#include "COM_ExecutionStatistics.h"
+
+#include "PIL_time.h"
 
 void CPUDevice::execute(WorkPackage *work)
 {
 	const unsigned int chunkNumber = work->getChunkNumber();
 	ExecutionGroup *executionGroup = work->getExecutionGroup();
+	const double startTime = PIL_check_seconds_timer();
 	rcti rect;
 
 	executionGroup->determineChunkRect(&rect, chunkNumber);
 
 	executionGroup->getOutputNodeOperation()->executeRegion(&rect, chunkNumber);
 
+	ExecutionStatistics::chunkExecuted(executionGroup, startTime, PIL_check_seconds_timer());
 	executionGroup->finalizeChunkExecution(chunkNumber, NULL);
 }
 
@@ -180,6 +180,7 @@ public:
 	void setFastCalculation(bool fastCalculation) {this->m_fastCalculation = fastCalculation;}
 	bool isFastCalculation() {return this->m_fastCalculation;}
 	inline bool isGroupnodeBufferEnabled() {return this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER;}
+	inline bool isHalfFloatBufferEnabled() {return this->getbNodeTree()->flag & NTREE_COM_HALF_BUFFER;}
 };
 
 
@@ -35,8 +35,10 @@
 #include "COM_ReadBufferOperation.h"
 #include "COM_WorkScheduler.h"
 #include "COM_ViewerOperation.h"
+#include "COM_FusedOperation.h"
 #include "COM_ChunkOrder.h"
 #include "COM_ExecutionSystemHelper.h"
+#include "COM_ExecutionStatistics.h"
 
 #include "MEM_guardedalloc.h"
 #include "BLI_math.h"
@@ -64,6 +66,7 @@ ExecutionGroup::ExecutionGroup()
 	this->m_chunksFinished = 0;
 	BLI_rcti_init(&this->m_viewerBorder, 0, 0, 0, 0);
 	this->m_executionStartTime = 0;
+	this->m_cacheable = false;
 }
 
 CompositorPriority ExecutionGroup::getRenderPriotrity()
@@ -182,6 +185,27 @@ void ExecutionGroup::initExecution()
 
 }
 
+bool ExecutionGroup::isExecuted() const
+{
+	if (this->m_chunkExecutionStates == NULL) {
+		return false;
+	}
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		if (this->m_chunkExecutionStates[index] != COM_ES_EXECUTED) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ExecutionGroup::setExecuted()
+{
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		this->m_chunkExecutionStates[index] = COM_ES_EXECUTED;
+	}
+	this->m_chunksFinished = this->m_numberOfChunks;
+}
+
 void ExecutionGroup::deinitExecution()
 {
 	if (this->m_chunkExecutionStates != NULL) {
@@ -352,6 +376,7 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 		bool startEvaluated = false;
 		finished = true;
 		int numberEvaluated = 0;
+		const unsigned int numberOfFinishedWork = WorkScheduler::getNumberOfFinishedWork();
 
 		for (index = startIndex; index < this->m_numberOfChunks && numberEvaluated < maxNumberEvaluated; index++) {
 			chunkNumber = chunkOrder[index];
@@ -377,13 +402,18 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 			}
 		}
 
-		WorkScheduler::finish();
+		/* continue as soon as a chunk is executed, its dependent chunks can be scheduled */
+		if (!finished) {
+			WorkScheduler::waitForFinishedWork(numberOfFinishedWork);
+		}
 
 		if (bTree->test_break && bTree->test_break(bTree->tbh)) {
 			breaked = true;
 		}
 	}
 
+	WorkScheduler::finish();
+
 	MEM_freeN(chunkOrder);
 }
 
@@ -421,6 +451,7 @@ void ExecutionGroup::printBackgroundStats(void)
 	float megs_used_memory, mmap_used_memory, megs_peak_memory;
 	double execution_time;
 	char timestr[64];
+	unsigned int numberOfFusedOperations = 0;
 
 	execution_time = PIL_check_seconds_timer() - this->m_executionStartTime;
 
@@ -440,6 +471,14 @@ void ExecutionGroup::printBackgroundStats(void)
 	printf("| Tree %s, Tile %d-%d ", this->m_bTree->id.name + 2,
 	       this->m_chunksFinished, this->m_numberOfChunks);
 
+	for (unsigned int index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isFusedOperation()) {
+			numberOfFusedOperations += ((FusedOperation *)operation)->getNumberOfFusedOperations();
+		}
+	}
+	printf("| Operations %d (%u fused) ", (int)this->m_operations.size(), numberOfFusedOperations);
+
 	fputc('\n', stdout);
 	fflush(stdout);
 }
@@ -468,7 +507,7 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
 		progress /= this->m_numberOfChunks;
 		this->m_bTree->progress(this->m_bTree->prh, progress);
 
-		if (G.background)
+		if (G.background && !ExecutionStatistics::isCollecting())
 			printBackgroundStats();
 	}
 }
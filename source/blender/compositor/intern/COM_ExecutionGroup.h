@@ -30,6 +30,7 @@
 #include "COM_MemoryProxy.h"
 #include "COM_Device.h"
 #include "COM_CompositorContext.h"
+#include "COM_ResultCache.h"
 
 
 /**
@@ -173,6 +174,17 @@ private:
 	 */
 	double m_executionStartTime;
 
+	/**
+	 * @brief key of the result of this ExecutionGroup in the ResultCache
+	 * @note only valid when m_cacheable is set
+	 */
+	ResultCacheKey m_cacheKey;
+
+	/**
+	 * @brief is the result of this ExecutionGroup kept in the ResultCache
+	 */
+	bool m_cacheable;
+
 	// methods
 	/**
 	 * @brief check whether parameter operation can be added to the execution group
@@ -298,6 +310,11 @@ public:
 	 * @brief get the height of this execution group
 	 */
 	const unsigned int getHeight() { return this->m_height; }
+
+	/**
+	 * @brief get the number of chunks of this execution group
+	 */
+	const unsigned int getNumberOfChunks() const { return this->m_numberOfChunks; }
 	
 	/**
 	 * @brief does this ExecutionGroup contains a complex NodeOperation
@@ -359,6 +376,28 @@ public:
 	 */
 	void finalizeChunkExecution(int chunkNumber, MemoryBuffer **memoryBuffers);
 	
+	/**
+	 * @brief are all chunks of this ExecutionGroup executed
+	 */
+	bool isExecuted() const;
+
+	/**
+	 * @brief mark all chunks of this ExecutionGroup as executed.
+	 * used when the result has been restored from the ResultCache.
+	 */
+	void setExecuted();
+
+	/**
+	 * @brief set the key of the result of this ExecutionGroup in the ResultCache
+	 */
+	void setCacheKey(const ResultCacheKey &key) { this->m_cacheKey = key; this->m_cacheable = true; }
+
+	/**
+	 * @brief get the key of the result of this ExecutionGroup in the ResultCache
+	 * @return NULL when the result is not cached
+	 */
+	const ResultCacheKey *getCacheKey() const { return this->m_cacheable ? &this->m_cacheKey : NULL; }
+
 	/**
 	 * @brief deinitExecution is called just after execution the whole graph.
 	 * @note It will release all needed resources
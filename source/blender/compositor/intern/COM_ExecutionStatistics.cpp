@@ -0,0 +1,387 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Jeroen Bakker
+ *		Monique Dewanchand
+ */
+
+#include <ctype.h>
+#include <float.h>
+#include <map>
+#include <string>
+#include <string.h>
+#include <typeinfo>
+#include <vector>
+
+#include "COM_ExecutionStatistics.h"
+#include "COM_ExecutionSystem.h"
+#include "COM_ExecutionGroup.h"
+#include "COM_NodeOperation.h"
+#include "COM_FusedOperation.h"
+
+#include "PIL_time.h"
+
+extern "C" {
+	#include "BLI_threads.h"
+	#include "DNA_node_types.h"
+}
+
+using namespace std;
+
+/* accumulated over all runs */
+typedef struct GroupStatistics {
+	vector<unsigned int> operations;
+	unsigned int width;
+	unsigned int height;
+	unsigned long long chunks;
+	double chunkTime;
+	double wallTime;
+} GroupStatistics;
+
+typedef struct OperationStatistics {
+	string type;
+	string node;
+	vector<unsigned int> groups;
+	double initTime;
+	double deinitTime;
+} OperationStatistics;
+
+/* collected during a single run */
+typedef struct ChunkStatistics {
+	unsigned int chunks;
+	double chunkTime;
+	double startTime;
+	double endTime;
+} ChunkStatistics;
+
+static bool s_collecting = false;
+static ThreadMutex s_mutex;
+
+static string s_treeName;
+static int s_chunkSize = 0;
+static unsigned int s_runs = 0;
+static double s_totalTime = 0.0;
+static double s_minTime = 0.0;
+static double s_maxTime = 0.0;
+static unsigned long long s_totalChunks = 0;
+static long long s_peakMemory = 0;
+static vector<GroupStatistics> s_groups;
+static vector<OperationStatistics> s_operations;
+
+static double s_runStartTime = 0.0;
+static long long s_runMemory = 0;
+static long long s_runPeakMemory = 0;
+static map<ExecutionGroup *, ChunkStatistics> s_runChunks;
+static map<NodeOperation *, double> s_runInitTimes;
+static map<NodeOperation *, double> s_runDeinitTimes;
+
+/* class name of the operation, without the decorations the compiler adds */
+static string operation_type_name(NodeOperation *operation)
+{
+	const char *name = typeid(*operation).name();
+	if (strncmp(name, "class ", 6) == 0) {
+		name += 6;
+	}
+	while (isdigit(*name)) {
+		name++;
+	}
+	return name;
+}
+
+static void write_json_string(FILE *file, const string &value)
+{
+	fputc('"', file);
+	for (size_t index = 0; index < value.size(); index++) {
+		const unsigned char c = value[index];
+		if (c == '"' || c == '\\') {
+			fprintf(file, "\\%c", c);
+		}
+		else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		}
+		else {
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+static void write_json_indices(FILE *file, const vector<unsigned int> &indices)
+{
+	fprintf(file, "[");
+	for (size_t index = 0; index < indices.size(); index++) {
+		fprintf(file, "%s%u", (index == 0) ? "" : ", ", indices[index]);
+	}
+	fprintf(file, "]");
+}
+
+void ExecutionStatistics::begin()
+{
+	if (!s_collecting) {
+		BLI_mutex_init(&s_mutex);
+	}
+
+	s_treeName.clear();
+	s_chunkSize = 0;
+	s_runs = 0;
+	s_totalTime = 0.0;
+	s_minTime = DBL_MAX;
+	s_maxTime = 0.0;
+	s_totalChunks = 0;
+	s_peakMemory = 0;
+	s_groups.clear();
+	s_operations.clear();
+	s_runMemory = 0;
+	s_runPeakMemory = 0;
+
+	s_collecting = true;
+}
+
+void ExecutionStatistics::end()
+{
+	if (s_collecting) {
+		s_collecting = false;
+		BLI_mutex_end(&s_mutex);
+	}
+}
+
+bool ExecutionStatistics::isCollecting()
+{
+	return s_collecting;
+}
+
+void ExecutionStatistics::executionStarted()
+{
+	if (!s_collecting) {
+		return;
+	}
+
+	BLI_mutex_lock(&s_mutex);
+	s_runChunks.clear();
+	s_runInitTimes.clear();
+	s_runDeinitTimes.clear();
+	s_runPeakMemory = s_runMemory;
+	s_runStartTime = PIL_check_seconds_timer();
+	BLI_mutex_unlock(&s_mutex);
+}
+
+void ExecutionStatistics::executionFinished(ExecutionSystem *system)
+{
+	if (!s_collecting) {
+		return;
+	}
+
+	vector<ExecutionGroup *> &groups = system->getExecutionGroups();
+	vector<NodeOperation *> &operations = system->getOperations();
+	const double time = PIL_check_seconds_timer() - s_runStartTime;
+	unsigned int index;
+
+	BLI_mutex_lock(&s_mutex);
+
+	/* the first run determines the layout of the groups and operations */
+	if (s_runs == 0) {
+		const bNodeTree *tree = system->getContext().getbNodeTree();
+		s_treeName = tree->id.name + 2;
+		s_chunkSize = system->getContext().getChunksize();
+
+		map<NodeOperation *, unsigned int> operationIndices;
+		s_operations.resize(operations.size());
+		for (index = 0; index < operations.size(); index++) {
+			NodeOperation *operation = operations[index];
+			OperationStatistics &statistics = s_operations[index];
+			operationIndices[operation] = index;
+			statistics.type = operation_type_name(operation);
+			statistics.node = operation->getbNode() ? operation->getbNode()->name : "";
+			statistics.initTime = 0.0;
+			statistics.deinitTime = 0.0;
+		}
+
+		s_groups.resize(groups.size());
+		for (index = 0; index < groups.size(); index++) {
+			ExecutionGroup *group = groups[index];
+			GroupStatistics &statistics = s_groups[index];
+			statistics.width = group->getWidth();
+			statistics.height = group->getHeight();
+			statistics.chunks = 0;
+			statistics.chunkTime = 0.0;
+			statistics.wallTime = 0.0;
+
+			for (unsigned int operationIndex = 0; operationIndex < operations.size(); operationIndex++) {
+				NodeOperation *operation = operations[operationIndex];
+				if (!group->containsOperation(operation)) {
+					continue;
+				}
+				statistics.operations.push_back(operationIndex);
+				s_operations[operationIndex].groups.push_back(index);
+
+				/* fused operations are not part of a group, they are calculated by their FusedOperation */
+				if (operation->isFusedOperation()) {
+					FusedOperation *fusedOperation = (FusedOperation *)operation;
+					for (unsigned int fusedIndex = 0; fusedIndex < fusedOperation->getNumberOfFusedOperations(); fusedIndex++) {
+						const unsigned int fusedOperationIndex = operationIndices[fusedOperation->getFusedOperation(fusedIndex)];
+						statistics.operations.push_back(fusedOperationIndex);
+						s_operations[fusedOperationIndex].groups.push_back(index);
+					}
+				}
+			}
+		}
+	}
+
+	for (index = 0; index < groups.size() && index < s_groups.size(); index++) {
+		map<ExecutionGroup *, ChunkStatistics>::iterator found = s_runChunks.find(groups[index]);
+		if (found != s_runChunks.end()) {
+			const ChunkStatistics &chunks = found->second;
+			s_groups[index].chunks += chunks.chunks;
+			s_groups[index].chunkTime += chunks.chunkTime;
+			s_groups[index].wallTime += chunks.endTime - chunks.startTime;
+			s_totalChunks += chunks.chunks;
+		}
+	}
+
+	for (index = 0; index < operations.size() && index < s_operations.size(); index++) {
+		s_operations[index].initTime += s_runInitTimes[operations[index]];
+		s_operations[index].deinitTime += s_runDeinitTimes[operations[index]];
+	}
+
+	s_runs++;
+	s_totalTime += time;
+	s_minTime = min(s_minTime, time);
+	s_maxTime = max(s_maxTime, time);
+	s_peakMemory = max(s_peakMemory, s_runPeakMemory - s_runMemory);
+
+	BLI_mutex_unlock(&s_mutex);
+}
+
+void ExecutionStatistics::operationInitialized(NodeOperation *operation, double time)
+{
+	if (!s_collecting) {
+		return;
+	}
+
+	BLI_mutex_lock(&s_mutex);
+	s_runInitTimes[operation] += time;
+	BLI_mutex_unlock(&s_mutex);
+}
+
+void ExecutionStatistics::operationDeinitialized(NodeOperation *operation, double time)
+{
+	if (!s_collecting) {
+		return;
+	}
+
+	BLI_mutex_lock(&s_mutex);
+	s_runDeinitTimes[operation] += time;
+	BLI_mutex_unlock(&s_mutex);
+}
+
+void ExecutionStatistics::chunkExecuted(ExecutionGroup *group, double startTime, double endTime)
+{
+	if (!s_collecting) {
+		return;
+	}
+
+	BLI_mutex_lock(&s_mutex);
+	map<ExecutionGroup *, ChunkStatistics>::iterator found = s_runChunks.find(group);
+	if (found == s_runChunks.end()) {
+		ChunkStatistics chunks;
+		chunks.chunks = 1;
+		chunks.chunkTime = endTime - startTime;
+		chunks.startTime = startTime;
+		chunks.endTime = endTime;
+		s_runChunks[group] = chunks;
+	}
+	else {
+		ChunkStatistics &chunks = found->second;
+		chunks.chunks++;
+		chunks.chunkTime += endTime - startTime;
+		chunks.startTime = min(chunks.startTime, startTime);
+		chunks.endTime = max(chunks.endTime, endTime);
+	}
+	BLI_mutex_unlock(&s_mutex);
+}
+
+void ExecutionStatistics::memoryBufferAllocated(size_t size)
+{
+	if (!s_collecting) {
+		return;
+	}
+
+	BLI_mutex_lock(&s_mutex);
+	s_runMemory += size;
+	s_runPeakMemory = max(s_runPeakMemory, s_runMemory);
+	BLI_mutex_unlock(&s_mutex);
+}
+
+void ExecutionStatistics::memoryBufferFreed(size_t size)
+{
+	if (!s_collecting) {
+		return;
+	}
+
+	BLI_mutex_lock(&s_mutex);
+	s_runMemory -= size;
+	BLI_mutex_unlock(&s_mutex);
+}
+
+void ExecutionStatistics::write(FILE *file)
+{
+	const double runs = max(s_runs, 1u);
+	unsigned int index;
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"tree\": ");
+	write_json_string(file, s_treeName);
+	fprintf(file, ",\n");
+	fprintf(file, "  \"threads\": %d,\n", BLI_system_thread_count());
+	fprintf(file, "  \"chunk_size\": %d,\n", s_chunkSize);
+	fprintf(file, "  \"runs\": %u,\n", s_runs);
+	fprintf(file, "  \"time\": {\"min\": %.6f, \"avg\": %.6f, \"max\": %.6f},\n",
+	        (s_runs) ? s_minTime : 0.0, s_totalTime / runs, s_maxTime);
+	fprintf(file, "  \"chunks\": %.1f,\n", s_totalChunks / runs);
+	fprintf(file, "  \"chunks_per_second\": %.2f,\n", (s_totalTime > 0.0) ? s_totalChunks / s_totalTime : 0.0);
+	fprintf(file, "  \"peak_memory_buffers\": %lld,\n", s_peakMemory);
+
+	fprintf(file, "  \"groups\": [");
+	for (index = 0; index < s_groups.size(); index++) {
+		const GroupStatistics &group = s_groups[index];
+		fprintf(file, "%s\n    {\"group\": %u, \"width\": %u, \"height\": %u, ",
+		        (index == 0) ? "" : ",", index, group.width, group.height);
+		fprintf(file, "\"chunks\": %.1f, \"chunk_time\": %.6f, \"wall_time\": %.6f, \"chunks_per_second\": %.2f, ",
+		        group.chunks / runs, group.chunkTime / runs, group.wallTime / runs,
+		        (group.wallTime > 0.0) ? group.chunks / group.wallTime : 0.0);
+		fprintf(file, "\"operations\": ");
+		write_json_indices(file, group.operations);
+		fprintf(file, "}");
+	}
+	fprintf(file, "\n  ],\n");
+
+	fprintf(file, "  \"operations\": [");
+	for (index = 0; index < s_operations.size(); index++) {
+		const OperationStatistics &operation = s_operations[index];
+		fprintf(file, "%s\n    {\"operation\": %u, \"type\": ", (index == 0) ? "" : ",", index);
+		write_json_string(file, operation.type);
+		fprintf(file, ", \"node\": ");
+		write_json_string(file, operation.node);
+		fprintf(file, ", \"groups\": ");
+		write_json_indices(file, operation.groups);
+		fprintf(file, ", \"init_time\": %.6f, \"deinit_time\": %.6f}",
+		        operation.initTime / runs, operation.deinitTime / runs);
+	}
+	fprintf(file, "\n  ]\n");
+	fprintf(file, "}\n");
+}
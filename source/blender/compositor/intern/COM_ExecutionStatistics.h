@@ -0,0 +1,106 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Jeroen Bakker
+ *		Monique Dewanchand
+ */
+
+class ExecutionStatistics;
+
+#ifndef _COM_ExecutionStatistics_h_
+#define _COM_ExecutionStatistics_h_
+
+#include <stdio.h>
+
+class ExecutionSystem;
+class ExecutionGroup;
+class NodeOperation;
+
+/**
+ * @brief collects timings and memory usage of ExecutionSystem's for benchmarking.
+ *
+ * Between begin and end every executed ExecutionSystem is a run. Per ExecutionGroup the
+ * number of executed chunks, the time spent calculating them (summed over all devices) and
+ * the time between the start of the first and the end of the last chunk are collected.
+ * The operations of an ExecutionGroup are calculated pixel by pixel together, their time
+ * is part of the time of the group. Per operation only the time of initExecution and
+ * deinitExecution is measured.
+ *
+ * The peak memory usage of the MemoryBuffer's allocated during a run is tracked as well.
+ *
+ * Runs of the same node tree produce the same ExecutionGroup's and operations in the same
+ * order, results are accumulated by index.
+ * @see COM_statistics_begin
+ * @ingroup Execution
+ */
+class ExecutionStatistics {
+public:
+	/**
+	 * @brief start collecting, all collected results are cleared
+	 */
+	static void begin();
+
+	/**
+	 * @brief stop collecting
+	 */
+	static void end();
+
+	/**
+	 * @brief are statistics being collected
+	 */
+	static bool isCollecting();
+
+	/**
+	 * @brief a run starts, before its ExecutionSystem is constructed
+	 * the time of a run includes converting the node tree, fusing and grouping the operations
+	 * and determining their resolutions.
+	 */
+	static void executionStarted();
+
+	/**
+	 * @brief an ExecutionSystem finished its execution, after the operations are deinitialized
+	 */
+	static void executionFinished(ExecutionSystem *system);
+
+	/**
+	 * @brief an operation is initialized or deinitialized
+	 * @param time seconds spent in NodeOperation.initExecution or NodeOperation.deinitExecution
+	 */
+	static void operationInitialized(NodeOperation *operation, double time);
+	static void operationDeinitialized(NodeOperation *operation, double time);
+
+	/**
+	 * @brief a device calculated a chunk of the group
+	 * @note called from the device threads
+	 */
+	static void chunkExecuted(ExecutionGroup *group, double startTime, double endTime);
+
+	/**
+	 * @brief a MemoryBuffer is allocated or freed
+	 * @note called from the device threads
+	 */
+	static void memoryBufferAllocated(size_t size);
+	static void memoryBufferFreed(size_t size);
+
+	/**
+	 * @brief write the collected results as a JSON object
+	 */
+	static void write(FILE *file);
+};
+
+#endif
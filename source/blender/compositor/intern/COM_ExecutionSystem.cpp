@@ -40,6 +40,8 @@ extern "C" {
 #include "COM_WriteBufferOperation.h"
 #include "COM_ReadBufferOperation.h"
 #include "COM_ExecutionSystemHelper.h"
+#include "COM_ResultCache.h"
+#include "COM_ExecutionStatistics.h"
 
 #include "BKE_global.h"
 
@@ -80,7 +82,9 @@ ExecutionSystem::ExecutionSystem(RenderData *rd, bNodeTree *editingtree, bool re
 	this->m_context.setDisplaySettings(displaySettings);
 
 	this->convertToOperations();
+	ExecutionSystemHelper::fuseOperations(this);
 	this->groupOperations(); /* group operations in ExecutionGroups */
+	this->determineMemoryProxyTypes();
 	unsigned int index;
 	unsigned int resolution[2];
 
@@ -160,7 +164,9 @@ void ExecutionSystem::execute()
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		operation->setbNodeTree(this->m_context.getbNodeTree());
+		double startTime = PIL_check_seconds_timer();
 		operation->initExecution();
+		ExecutionStatistics::operationInitialized(operation, PIL_check_seconds_timer() - startTime);
 	}
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
@@ -174,6 +180,7 @@ void ExecutionSystem::execute()
 		executionGroup->setChunksize(this->m_context.getChunksize());
 		executionGroup->initExecution();
 	}
+	ResultCache::restore(this);
 
 	WorkScheduler::start(this->m_context);
 
@@ -185,15 +192,20 @@ void ExecutionSystem::execute()
 
 	WorkScheduler::finish();
 	WorkScheduler::stop();
+	ResultCache::store(this);
 
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
+		double startTime = PIL_check_seconds_timer();
 		operation->deinitExecution();
+		ExecutionStatistics::operationDeinitialized(operation, PIL_check_seconds_timer() - startTime);
 	}
 	for (index = 0; index < this->m_groups.size(); index++) {
 		ExecutionGroup *executionGroup = this->m_groups[index];
 		executionGroup->deinitExecution();
 	}
+
+	ExecutionStatistics::executionFinished(this);
 }
 
 void ExecutionSystem::executeGroups(CompositorPriority priority)
@@ -297,8 +309,17 @@ void ExecutionSystem::convertToOperations()
 	unsigned int index;
 	for (index = 0; index < this->m_nodes.size(); index++) {
 		Node *node = (Node *)this->m_nodes[index];
+		unsigned int firstOperation = this->m_operations.size();
 		node->convertToOperations(this, &this->m_context);
 
+		/* remember the editor node of the operations, it identifies their settings in the ResultCache */
+		for (unsigned int operationIndex = firstOperation; operationIndex < this->m_operations.size(); operationIndex++) {
+			NodeOperation *operation = this->m_operations[operationIndex];
+			if (operation->getbNode() == NULL) {
+				operation->setbNode(node->getbNode());
+			}
+		}
+
 		debug_check_node_connections(node);
 	}
 
@@ -342,6 +363,43 @@ void ExecutionSystem::convertToOperations()
 	}
 }
 
+void ExecutionSystem::determineMemoryProxyTypes()
+{
+	const bool halfFloat = this->m_context.isHalfFloatBufferEnabled();
+	unsigned int index;
+
+	/* buffers only store the channels of the data that is written to them */
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+			InputSocket *inputSocket = writeOperation->getInputSocket(0);
+			DataType datatype = COM_DT_COLOR;
+			if (inputSocket->isConnected()) {
+				datatype = inputSocket->getConnection()->getFromSocket()->getDataType();
+			}
+			writeOperation->getMemoryProxy()->setDataType(datatype);
+			writeOperation->getMemoryProxy()->setHalfFloat(halfFloat);
+		}
+	}
+
+	/* complex operations access the buffers of their inputs directly as RGBA floats */
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isReadBufferOperation()) {
+			ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+			OutputSocket *outputSocket = readOperation->getOutputSocket();
+			for (int connectionIndex = 0; connectionIndex < outputSocket->getNumberOfConnections(); connectionIndex++) {
+				NodeOperation *toOperation = (NodeOperation *)outputSocket->getConnection(connectionIndex)->getToNode();
+				if (toOperation->isComplex()) {
+					readOperation->getMemoryProxy()->setDataType(COM_DT_COLOR);
+					readOperation->getMemoryProxy()->setHalfFloat(false);
+				}
+			}
+		}
+	}
+}
+
 void ExecutionSystem::groupOperations()
 {
 	vector<NodeOperation *> outputOperations;
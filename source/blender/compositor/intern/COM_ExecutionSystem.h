@@ -214,6 +214,13 @@ public:
 	 */
 	void groupOperations();
 
+	/**
+	 * @brief determine the datatype and storage of the MemoryProxy's
+	 * @note called after the operations are grouped
+	 * @see MemoryBuffer
+	 */
+	void determineMemoryProxyTypes();
+
 	/**
 	 * @brief get the reference to the compositor context
 	 */
@@ -37,6 +37,7 @@
 #include "COM_WriteBufferOperation.h"
 #include "COM_ReadBufferOperation.h"
 #include "COM_ViewerBaseOperation.h"
+#include "COM_FusedOperation.h"
 
 extern "C" {
 #include "BKE_node.h"
@@ -115,6 +116,101 @@ void ExecutionSystemHelper::findOutputNodeOperations(vector<NodeOperation *> *re
 	}
 }
 
+static bool is_fusable_operation(NodeOperation *operation)
+{
+	if (!operation->isPixelLocal()) {
+		return false;
+	}
+	if (operation->getNumberOfOutputSockets() != 1 || operation->getNumberOfInputSockets() > COM_FUSED_MAX_OPERANDS) {
+		return false;
+	}
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		if (!operation->getInputSocket(index)->isConnected()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* is the operation calculated by the fused operation of the only operation using its output */
+static bool is_fused_into_user(NodeOperation *operation)
+{
+	OutputSocket *outputSocket = operation->getOutputSocket();
+	if (outputSocket->getNumberOfConnections() != 1) {
+		return false;
+	}
+	NodeOperation *user = (NodeOperation *)outputSocket->getConnection(0)->getToNode();
+	return is_fusable_operation(user) &&
+	       user->getWidth() == operation->getWidth() &&
+	       user->getHeight() == operation->getHeight();
+}
+
+static void collect_fused_operations(vector<NodeOperation *> &chain, NodeOperation *operation)
+{
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		NodeOperation *inputOperation = (NodeOperation *)operation->getInputSocket(index)->getConnection()->getFromNode();
+		if (is_fusable_operation(inputOperation) && is_fused_into_user(inputOperation)) {
+			collect_fused_operations(chain, inputOperation);
+		}
+	}
+	chain.push_back(operation);
+}
+
+void ExecutionSystemHelper::fuseOperations(ExecutionSystem *system)
+{
+	vector<NodeOperation *> &operations = system->getOperations();
+	vector<NodeOperation *> chainOutputs;
+	unsigned int index;
+
+	for (index = 0; index < operations.size(); index++) {
+		NodeOperation *operation = operations[index];
+		if (is_fusable_operation(operation) && !is_fused_into_user(operation)) {
+			chainOutputs.push_back(operation);
+		}
+	}
+
+	for (index = 0; index < chainOutputs.size(); index++) {
+		NodeOperation *chainOutput = chainOutputs[index];
+		vector<NodeOperation *> chain;
+		collect_fused_operations(chain, chainOutput);
+		if (chain.size() < 2) {
+			continue;
+		}
+
+		FusedOperation *fusedOperation = new FusedOperation(chainOutput->getOutputSocket()->getDataType());
+		for (vector<NodeOperation *>::iterator it = chain.begin(); it != chain.end(); ++it) {
+			fusedOperation->addOperation(*it);
+		}
+		if (!fusedOperation->compile()) {
+			delete fusedOperation;
+			continue;
+		}
+
+		/* connect the inputs of the chain to the fused operation, every input is read once */
+		for (vector<NodeOperation *>::iterator it = chain.begin(); it != chain.end(); ++it) {
+			NodeOperation *operation = *it;
+			for (unsigned int inputIndex = 0; inputIndex < operation->getNumberOfInputSockets(); inputIndex++) {
+				InputSocket *inputSocket = operation->getInputSocket(inputIndex);
+				int fusedInputIndex = fusedOperation->findInputSocketIndex(inputSocket->getConnection()->getFromSocket());
+				if (fusedInputIndex != -1) {
+					InputSocket *fusedInputSocket = fusedOperation->getInputSocket(fusedInputIndex);
+					if (fusedInputSocket->isConnected()) {
+						inputSocket->unlinkConnections(system);
+					}
+					else {
+						inputSocket->relinkConnections(fusedInputSocket);
+					}
+				}
+			}
+		}
+		chainOutput->getOutputSocket()->relinkConnections(fusedOperation->getOutputSocket(), false);
+
+		unsigned int resolution[2] = {chainOutput->getWidth(), chainOutput->getHeight()};
+		fusedOperation->setResolution(resolution);
+		addOperation(operations, fusedOperation);
+	}
+}
+
 static InputSocket *find_input(NodeRange &node_range, bNode *bnode, bNodeSocket *bsocket)
 {
 	for (NodeIterator it = node_range.first; it != node_range.second; ++it) {
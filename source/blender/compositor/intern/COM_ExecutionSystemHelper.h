@@ -96,6 +96,17 @@ public:
 	 */
 	static void findOutputNodeOperations(vector<NodeOperation *> *result, vector<NodeOperation *>& operations, bool rendering);
 
+	/**
+	 * @brief replace chains of pixel local operations by FusedOperation's
+	 *
+	 * A pixel local operation is fused into the operation using its output, when that is the
+	 * only user and it is pixel local as well. The chains are disconnected from the other
+	 * operations, they are calculated by the FusedOperation.
+	 * @note must be called after the resolutions of the operations are determined
+	 * @param system the execution system
+	 */
+	static void fuseOperations(ExecutionSystem *system);
+
 	/**
 	 * @brief add a bNodeLink to the list of links
 	 * the bNodeLink will be wrapped in a SocketConnection
@@ -21,14 +21,88 @@
  */
 
 #include "COM_MemoryBuffer.h"
+#include "COM_ExecutionStatistics.h"
 #include "MEM_guardedalloc.h"
 //#include "BKE_global.h"
 
+/* conversion between float and half float, rounding to nearest even */
+static unsigned short float_to_half(float value)
+{
+	union { float f; unsigned int u; } in;
+	unsigned short result;
+
+	in.f = value;
+	const unsigned int sign = in.u & 0x80000000u;
+	in.u ^= sign;
+
+	if (in.u >= 0x47800000u) {
+		/* too large for half: infinity, NaN stays NaN */
+		result = (in.u > 0x7f800000u) ? 0x7e00 : 0x7c00;
+	}
+	else if (in.u < 0x38800000u) {
+		/* denormal or zero, let the float addition round the mantissa */
+		union { float f; unsigned int u; } magic;
+		magic.u = 0x3f000000u;
+		in.f += magic.f;
+		result = in.u - magic.u;
+	}
+	else {
+		const unsigned int mantissaOdd = (in.u >> 13) & 1;
+		in.u += 0xc8000fffu;
+		in.u += mantissaOdd;
+		result = in.u >> 13;
+	}
+	return result | (sign >> 16);
+}
+
+static float half_to_float(unsigned short value)
+{
+	union { float f; unsigned int u; } out;
+	const unsigned int shiftedExponent = 0x7c00u << 13;
+
+	out.u = (value & 0x7fffu) << 13;
+	const unsigned int exponent = shiftedExponent & out.u;
+	out.u += (127 - 15) << 23;
+
+	if (exponent == shiftedExponent) {
+		/* infinity or NaN */
+		out.u += (128 - 16) << 23;
+	}
+	else if (exponent == 0) {
+		/* denormal or zero */
+		union { float f; unsigned int u; } magic;
+		magic.u = 113u << 23;
+		out.u += 1 << 23;
+		out.f -= magic.f;
+	}
+	out.u |= (value & 0x8000u) << 16;
+	return out.f;
+}
+
+static unsigned int determine_number_of_channels(DataType datatype)
+{
+	switch (datatype) {
+		case COM_DT_VALUE:
+			return COM_NUM_CHANNELS_VALUE;
+		case COM_DT_VECTOR:
+			return COM_NUM_CHANNELS_VECTOR;
+		case COM_DT_COLOR:
+		default:
+			return COM_NUM_CHANNELS_COLOR;
+	}
+}
+
 unsigned int MemoryBuffer::determineBufferSize()
 {
 	return getWidth() * getHeight();
 }
 
+size_t MemoryBuffer::getMemorySize()
+{
+	const size_t elementSize = this->m_halfFloat ? sizeof(unsigned short) : sizeof(float);
+	return (size_t)this->determineBufferSize() * this->m_num_channels * elementSize;
+}
+
 int MemoryBuffer::getWidth() const
 {
 	return this->m_rect.xmax - this->m_rect.xmin;
@@ -38,14 +112,30 @@ int MemoryBuffer::getHeight() const
 	return this->m_rect.ymax - this->m_rect.ymin;
 }
 
+void MemoryBuffer::allocateBuffer()
+{
+	const unsigned int size = this->determineBufferSize() * this->m_num_channels;
+	if (this->m_halfFloat) {
+		this->m_buffer = NULL;
+		this->m_halfBuffer = (unsigned short *)MEM_mallocN(sizeof(unsigned short) * size, "COM_MemoryBuffer");
+	}
+	else {
+		this->m_buffer = (float *)MEM_mallocN(sizeof(float) * size, "COM_MemoryBuffer");
+		this->m_halfBuffer = NULL;
+	}
+	ExecutionStatistics::memoryBufferAllocated(this->getMemorySize());
+}
+
 MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect)
 {
 	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = chunkNumber;
-	this->m_buffer = (float *)MEM_mallocN(sizeof(float) * determineBufferSize() * COM_NUMBER_OF_CHANNELS, "COM_MemoryBuffer");
+	this->m_datatype = memoryProxy->getDataType();
+	this->m_num_channels = determine_number_of_channels(this->m_datatype);
+	this->m_halfFloat = memoryProxy->isHalfFloat();
+	this->allocateBuffer();
 	this->m_state = COM_MB_ALLOCATED;
-	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
 }
 
@@ -54,20 +144,47 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
 	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = -1;
-	this->m_buffer = (float *)MEM_mallocN(sizeof(float) * determineBufferSize() * COM_NUMBER_OF_CHANNELS, "COM_MemoryBuffer");
-	this->m_state = COM_MB_TEMPORARILY;
 	this->m_datatype = COM_DT_COLOR;
+	this->m_num_channels = COM_NUM_CHANNELS_COLOR;
+	this->m_halfFloat = false;
+	this->allocateBuffer();
+	this->m_state = COM_MB_TEMPORARILY;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
 }
+
+MemoryBuffer::MemoryBuffer(DataType datatype, rcti *rect, bool halfFloat)
+{
+	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
+	this->m_memoryProxy = NULL;
+	this->m_chunkNumber = -1;
+	this->m_datatype = datatype;
+	this->m_num_channels = determine_number_of_channels(datatype);
+	this->m_halfFloat = halfFloat;
+	this->allocateBuffer();
+	this->m_state = COM_MB_TEMPORARILY;
+	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
+}
+
 MemoryBuffer *MemoryBuffer::duplicate()
 {
-	MemoryBuffer *result = new MemoryBuffer(this->m_memoryProxy, &this->m_rect);
-	memcpy(result->m_buffer, this->m_buffer, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	MemoryBuffer *result = new MemoryBuffer(this->m_datatype, &this->m_rect, this->m_halfFloat);
+	result->m_memoryProxy = this->m_memoryProxy;
+	if (this->m_halfFloat) {
+		memcpy(result->m_halfBuffer, this->m_halfBuffer, this->getMemorySize());
+	}
+	else {
+		memcpy(result->m_buffer, this->m_buffer, this->getMemorySize());
+	}
 	return result;
 }
 void MemoryBuffer::clear()
 {
-	memset(this->m_buffer, 0, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	if (this->m_halfFloat) {
+		memset(this->m_halfBuffer, 0, this->getMemorySize());
+	}
+	else {
+		memset(this->m_buffer, 0, this->getMemorySize());
+	}
 }
 
 float *MemoryBuffer::convertToValueBuffer()
@@ -77,11 +194,10 @@ float *MemoryBuffer::convertToValueBuffer()
 
 	float *result = (float *)MEM_mallocN(sizeof(float) * size, __func__);
 
-	const float *fp_src = this->m_buffer;
-	float       *fp_dst = result;
-
-	for (i = 0; i < size; i++, fp_dst++, fp_src += COM_NUMBER_OF_CHANNELS) {
-		*fp_dst = *fp_src;
+	for (i = 0; i < size; i++) {
+		float color[4];
+		readElement(color, i);
+		result[i] = color[0];
 	}
 
 	return result;
@@ -89,16 +205,17 @@ float *MemoryBuffer::convertToValueBuffer()
 
 float MemoryBuffer::getMaximumValue()
 {
-	float result = this->m_buffer[0];
 	const unsigned int size = this->determineBufferSize();
 	unsigned int i;
+	float color[4];
 
-	const float *fp_src = this->m_buffer;
+	readElement(color, 0);
+	float result = color[0];
 
-	for (i = 0; i < size; i++, fp_src += COM_NUMBER_OF_CHANNELS) {
-		float value = *fp_src;
-		if (value > result) {
-			result = value;
+	for (i = 1; i < size; i++) {
+		readElement(color, i);
+		if (color[0] > result) {
+			result = color[0];
 		}
 	}
 
@@ -127,10 +244,57 @@ float MemoryBuffer::getMaximumValue(rcti *rect)
 
 MemoryBuffer::~MemoryBuffer()
 {
+	if (this->m_buffer || this->m_halfBuffer) {
+		ExecutionStatistics::memoryBufferFreed(this->getMemorySize());
+	}
 	if (this->m_buffer) {
 		MEM_freeN(this->m_buffer);
 		this->m_buffer = NULL;
 	}
+	if (this->m_halfBuffer) {
+		MEM_freeN(this->m_halfBuffer);
+		this->m_halfBuffer = NULL;
+	}
+}
+
+void MemoryBuffer::readTypedElement(float result[4], int index)
+{
+	const unsigned int offset = index * this->m_num_channels;
+	unsigned int channel;
+
+	if (this->m_halfFloat) {
+		for (channel = 0; channel < this->m_num_channels; channel++) {
+			result[channel] = half_to_float(this->m_halfBuffer[offset + channel]);
+		}
+	}
+	else {
+		for (channel = 0; channel < this->m_num_channels; channel++) {
+			result[channel] = this->m_buffer[offset + channel];
+		}
+	}
+	for (; channel < COM_NUMBER_OF_CHANNELS; channel++) {
+		result[channel] = 0.0f;
+	}
+}
+
+void MemoryBuffer::writeElement(int index, const float color[4])
+{
+	const unsigned int offset = index * this->m_num_channels;
+	unsigned int channel;
+
+	if (this->m_halfFloat) {
+		for (channel = 0; channel < this->m_num_channels; channel++) {
+			this->m_halfBuffer[offset + channel] = float_to_half(color[channel]);
+		}
+	}
+	else if (this->m_num_channels == COM_NUMBER_OF_CHANNELS) {
+		copy_v4_v4(&this->m_buffer[offset], color);
+	}
+	else {
+		for (channel = 0; channel < this->m_num_channels; channel++) {
+			this->m_buffer[offset + channel] = color[channel];
+		}
+	}
 }
 
 void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
@@ -147,11 +311,77 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
 	int offset;
 	int otherOffset;
 
+	if (this->m_num_channels == otherBuffer->m_num_channels && this->m_halfFloat == otherBuffer->m_halfFloat) {
+		const unsigned int channels = this->m_num_channels;
+		for (otherY = minY; otherY < maxY; otherY++) {
+			otherOffset = ((otherY - otherBuffer->m_rect.ymin) * otherBuffer->m_chunkWidth + minX - otherBuffer->m_rect.xmin) * channels;
+			offset = ((otherY - this->m_rect.ymin) * this->m_chunkWidth + minX - this->m_rect.xmin) * channels;
+			if (this->m_halfFloat) {
+				memcpy(&this->m_halfBuffer[offset], &otherBuffer->m_halfBuffer[otherOffset], (maxX - minX) * channels * sizeof(unsigned short));
+			}
+			else {
+				memcpy(&this->m_buffer[offset], &otherBuffer->m_buffer[otherOffset], (maxX - minX) * channels * sizeof(float));
+			}
+		}
+	}
+	else {
+		/* different storage, convert every pixel */
+		float color[4];
+		for (otherY = minY; otherY < maxY; otherY++) {
+			otherOffset = (otherY - otherBuffer->m_rect.ymin) * otherBuffer->m_chunkWidth + minX - otherBuffer->m_rect.xmin;
+			offset = (otherY - this->m_rect.ymin) * this->m_chunkWidth + minX - this->m_rect.xmin;
+			for (unsigned int x = minX; x < maxX; x++, offset++, otherOffset++) {
+				otherBuffer->readElement(color, otherOffset);
+				this->writeElement(offset, color);
+			}
+		}
+	}
+}
+
+void MemoryBuffer::readRow(float *result, int x, int y, int width)
+{
+	int x1 = x;
+	int x2 = x + width;
 
-	for (otherY = minY; otherY < maxY; otherY++) {
-		otherOffset = ((otherY - otherBuffer->m_rect.ymin) * otherBuffer->m_chunkWidth + minX - otherBuffer->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		offset = ((otherY - this->m_rect.ymin) * this->m_chunkWidth + minX - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		memcpy(&this->m_buffer[offset], &otherBuffer->m_buffer[otherOffset], (maxX - minX) * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	if (y >= this->m_rect.ymin && y < this->m_rect.ymax) {
+		x1 = max_ii(x1, this->m_rect.xmin);
+		x2 = min_ii(x2, this->m_rect.xmax);
+	}
+	else {
+		x1 = x2;
+	}
+
+	if (x1 < x2) {
+		const int index = this->m_chunkWidth * (y - this->m_rect.ymin) + x1 - this->m_rect.xmin;
+		if (this->m_num_channels == COM_NUMBER_OF_CHANNELS && !this->m_halfFloat) {
+			memcpy(&result[(x1 - x) * COM_NUMBER_OF_CHANNELS], &this->m_buffer[index * COM_NUMBER_OF_CHANNELS], sizeof(float) * (x2 - x1) * COM_NUMBER_OF_CHANNELS);
+		}
+		else {
+			for (int i = 0; i < x2 - x1; i++) {
+				readTypedElement(&result[(x1 - x + i) * COM_NUMBER_OF_CHANNELS], index + i);
+			}
+		}
+	}
+	else {
+		x1 = x2 = x;
+	}
+
+	/* zero pixels outside of the buffer */
+	memset(result, 0, sizeof(float) * (x1 - x) * COM_NUMBER_OF_CHANNELS);
+	memset(&result[(x2 - x) * COM_NUMBER_OF_CHANNELS], 0, sizeof(float) * (x + width - x2) * COM_NUMBER_OF_CHANNELS);
+}
+
+void MemoryBuffer::writeRow(int x, int y, int width, const float *colors)
+{
+	if (y < this->m_rect.ymin || y >= this->m_rect.ymax) {
+		return;
+	}
+	const int x1 = max_ii(x, this->m_rect.xmin);
+	const int x2 = min_ii(x + width, this->m_rect.xmax);
+	const int index = this->m_chunkWidth * (y - this->m_rect.ymin) - this->m_rect.xmin;
+
+	for (int xi = x1; xi < x2; xi++) {
+		writeElement(index + xi, &colors[(xi - x) * COM_NUMBER_OF_CHANNELS]);
 	}
 }
 
@@ -160,8 +390,7 @@ void MemoryBuffer::writePixel(int x, int y, const float color[4])
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
-		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		copy_v4_v4(&this->m_buffer[offset], color);
+		writeElement(this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin, color);
 	}
 }
 
@@ -170,8 +399,11 @@ void MemoryBuffer::addPixel(int x, int y, const float color[4])
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
-		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		add_v4_v4(&this->m_buffer[offset], color);
+		const int index = this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin;
+		float result[4];
+		readElement(result, index);
+		add_v4_v4(result, color);
+		writeElement(index, result);
 	}
 }
 
@@ -63,6 +63,15 @@ private:
 	 */
 	DataType m_datatype;
 	
+	/**
+	 * @brief number of channels stored per pixel, determined by the data type
+	 */
+	unsigned int m_num_channels;
+	
+	/**
+	 * @brief are the channels stored as half floats
+	 */
+	bool m_halfFloat;
 	
 	/**
 	 * @brief region of this buffer inside relative to the MemoryProxy
@@ -89,18 +98,29 @@ private:
 	 * @brief the actual float buffer/data
 	 */
 	float *m_buffer;
+	
+	/**
+	 * @brief the actual half float buffer/data, used instead of m_buffer when m_halfFloat is set
+	 */
+	unsigned short *m_halfBuffer;
 
 public:
 	/**
 	 * @brief construct new MemoryBuffer for a chunk
+	 * @note data type and storage are taken from the MemoryProxy
 	 */
 	MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect);
 	
 	/**
-	 * @brief construct new temporarily MemoryBuffer for an area
+	 * @brief construct new temporarily color MemoryBuffer for an area
 	 */
 	MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect);
 	
+	/**
+	 * @brief construct new temporarily MemoryBuffer for an area, storing only the channels of the datatype
+	 */
+	MemoryBuffer(DataType datatype, rcti *rect, bool halfFloat = false);
+	
 	/**
 	 * @brief destructor
 	 */
@@ -114,8 +134,29 @@ public:
 	/**
 	 * @brief get the data of this MemoryBuffer
 	 * @note buffer should already be available in memory
+	 * @note every pixel has getNumberOfChannels() floats, half float buffers have no float data
 	 */
-	float *getBuffer() { return this->m_buffer; }
+	float *getBuffer() { BLI_assert(!this->m_halfFloat); return this->m_buffer; }
+	
+	/**
+	 * @brief get the data type of the pixels in this MemoryBuffer
+	 */
+	const DataType getDataType() const { return this->m_datatype; }
+	
+	/**
+	 * @brief get the number of channels stored per pixel
+	 */
+	const unsigned int getNumberOfChannels() const { return this->m_num_channels; }
+	
+	/**
+	 * @brief are the channels stored as half floats
+	 */
+	const bool isHalfFloat() const { return this->m_halfFloat; }
+	
+	/**
+	 * @brief get the number of bytes used to store the pixels
+	 */
+	size_t getMemorySize();
 	
 	/**
 	 * @brief after execution the state will be set to available by calling this method
@@ -132,8 +173,7 @@ public:
 		{
 			const int dx = x - this->m_rect.xmin;
 			const int dy = y - this->m_rect.ymin;
-			const int offset = (this->m_chunkWidth * dy + dx) * COM_NUMBER_OF_CHANNELS;
-			copy_v4_v4(result, &this->m_buffer[offset]);
+			readElement(result, this->m_chunkWidth * dy + dx);
 		}
 		else {
 			zero_v4(result);
@@ -144,22 +184,28 @@ public:
 	{
 		const int dx = x - this->m_rect.xmin;
 		const int dy = y - this->m_rect.ymin;
-		const int offset = (this->m_chunkWidth * dy + dx) * COM_NUMBER_OF_CHANNELS;
+		const int index = this->m_chunkWidth * dy + dx;
 
-		BLI_assert(offset >= 0);
-		BLI_assert(offset < this->determineBufferSize() * COM_NUMBER_OF_CHANNELS);
+		BLI_assert(index >= 0);
+		BLI_assert(index < this->determineBufferSize());
 		BLI_assert(x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 		           y >= this->m_rect.ymin && y < this->m_rect.ymax);
 
-#if 0
-		/* always true */
-		BLI_assert((int)(MEM_allocN_len(this->m_buffer) / sizeof(*this->m_buffer)) ==
-		           (int)(this->determineBufferSize() * COM_NUMBER_OF_CHANNELS));
-#endif
-
-		copy_v4_v4(result, &this->m_buffer[offset]);
+		readElement(result, index);
 	}
 	
+	/**
+	 * @brief read a row of pixels, pixels outside of the buffer are zero
+	 * @param result float[4 * width] array to store the pixels
+	 */
+	void readRow(float *result, int x, int y, int width);
+
+	/**
+	 * @brief write a row of pixels, pixels outside of the buffer are skipped
+	 * @param colors float[4 * width] array with the pixels
+	 */
+	void writeRow(int x, int y, int width, const float *colors);
+
 	void writePixel(int x, int y, const float color[4]);
 	void addPixel(int x, int y, const float color[4]);
 	inline void readCubic(float result[4], float x, float y)
@@ -246,6 +292,24 @@ public:
 private:
 	unsigned int determineBufferSize();
 
+	void allocateBuffer();
+
+	/**
+	 * @brief read the pixel at index into a float[4], missing channels are zero
+	 */
+	inline void readElement(float result[4], int index)
+	{
+		if (this->m_num_channels == COM_NUMBER_OF_CHANNELS && !this->m_halfFloat) {
+			copy_v4_v4(result, &this->m_buffer[index * COM_NUMBER_OF_CHANNELS]);
+		}
+		else {
+			readTypedElement(result, index);
+		}
+	}
+
+	void readTypedElement(float result[4], int index);
+	void writeElement(int index, const float color[4]);
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryBuffer")
 #endif
@@ -50,7 +50,15 @@ private:
 	/**
 	 * @brief datatype of this MemoryProxy
 	 */
-	/* DataType m_datatype; */ /* UNUSED */
+	/**
+	 * @brief datatype of the buffer, only the channels of this datatype are stored
+	 */
+	DataType m_datatype;
+	
+	/**
+	 * @brief store the buffer as half floats
+	 */
+	bool m_halfFloat;
 	
 	/**
 	 * @brief channel information of this buffer
@@ -98,6 +106,14 @@ public:
 	 */
 	void free();
 
+	void setDataType(DataType datatype) { this->m_datatype = datatype; }
+
+	DataType getDataType() { return this->m_datatype; }
+
+	void setHalfFloat(bool halfFloat) { this->m_halfFloat = halfFloat; }
+
+	bool isHalfFloat() { return this->m_halfFloat; }
+
 	/**
 	 * @brief get the allocated memory
 	 */
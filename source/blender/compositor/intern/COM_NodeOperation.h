@@ -65,6 +65,14 @@ private:
 	 */
 	bool m_openCL;
 
+	/**
+	 * @brief is this operation pixel local.
+	 *
+	 * The output of a pixel local operation only depends on its inputs at the same pixel.
+	 * Chains of pixel local operations are fused into a single FusedOperation.
+	 */
+	bool m_pixelLocal;
+
 	/**
 	 * @brief mutex reference for very special node initializations
 	 * @note only use when you really know what you are doing.
@@ -170,6 +178,15 @@ public:
 	                           list<cl_kernel> *clKernelsToCleanUp) {}
 	virtual void deinitExecution();
 
+	/**
+	 * @brief calculate a span of pixels from the values of the inputs
+	 * @note this method is only called for pixel local operations by the FusedOperation
+	 * @param output is a float[4 * width] array to store the result
+	 * @param inputs for every input socket a float[4 * width] array with its values
+	 * @param width the number of pixels to calculate
+	 */
+	virtual void executeSpan(float *output, float **inputs, int width) {}
+
 	bool isResolutionSet() {
 		return this->m_isResolutionSet;
 	}
@@ -196,6 +213,20 @@ public:
 	 * Mostly Filter types (Blurs, Convolution, Defocus etc) need this to be set to true.
 	 */
 	const bool isComplex() const { return this->m_complex; }
+
+	/**
+	 * @brief is this operation pixel local
+	 * @see NodeOperation.executeSpan
+	 * @see FusedOperation
+	 */
+	const bool isPixelLocal() const { return this->m_pixelLocal; }
+
+	/**
+	 * @brief is this operation of type FusedOperation
+	 * @return [true:false]
+	 * @see FusedOperation
+	 */
+	virtual const bool isFusedOperation() const { return false; }
 	virtual const bool isSetOperation() const { return false; }
 
 	/**
@@ -280,6 +311,12 @@ protected:
 	 */
 	void setOpenCL(bool openCL) { this->m_openCL = openCL; }
 
+	/**
+	 * @brief set whether this operation is pixel local
+	 * @note pixel local operations must implement executeSpan
+	 */
+	void setPixelLocal(bool pixelLocal) { this->m_pixelLocal = pixelLocal; }
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:NodeOperation")
 #endif
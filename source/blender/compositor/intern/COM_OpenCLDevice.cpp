@@ -22,6 +22,9 @@
 
 #include "COM_OpenCLDevice.h"
 #include "COM_WorkScheduler.h"
+#include "COM_ExecutionStatistics.h"
+
+#include "PIL_time.h"
 
 typedef enum COM_VendorID  {NVIDIA = 0x10DE, AMD = 0x1002} COM_VendorID;
 
@@ -52,6 +55,7 @@ void OpenCLDevice::execute(WorkPackage *work)
 {
 	const unsigned int chunkNumber = work->getChunkNumber();
 	ExecutionGroup *executionGroup = work->getExecutionGroup();
+	const double startTime = PIL_check_seconds_timer();
 	rcti rect;
 
 	executionGroup->determineChunkRect(&rect, chunkNumber);
@@ -63,6 +67,7 @@ void OpenCLDevice::execute(WorkPackage *work)
 
 	delete outputBuffer;
 	
+	ExecutionStatistics::chunkExecuted(executionGroup, startTime, PIL_check_seconds_timer());
 	executionGroup->finalizeChunkExecution(chunkNumber, inputBuffers);
 }
 cl_mem OpenCLDevice::COM_clAttachMemoryBufferToKernelParameter(cl_kernel kernel, int parameterIndex, int offsetIndex,
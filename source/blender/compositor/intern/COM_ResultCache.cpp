@@ -0,0 +1,488 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Jeroen Bakker
+ *		Monique Dewanchand
+ */
+
+#include <map>
+#include <set>
+#include <typeinfo>
+#include <vector>
+
+#include "COM_ResultCache.h"
+#include "COM_ExecutionSystem.h"
+#include "COM_ExecutionGroup.h"
+#include "COM_InputSocket.h"
+#include "COM_SocketConnection.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
+#include "COM_FusedOperation.h"
+#include "COM_defines.h"
+
+#include "MEM_guardedalloc.h"
+#include "PIL_time.h"
+
+extern "C" {
+	#include "BLI_md5.h"
+	#include "BLI_utildefines.h"
+	#include "DNA_camera_types.h"
+	#include "DNA_color_types.h"
+	#include "DNA_mask_types.h"
+	#include "DNA_node_types.h"
+	#include "DNA_object_types.h"
+	#include "DNA_scene_types.h"
+	#include "BKE_camera.h"
+	#include "BKE_node.h"
+}
+
+using namespace std;
+
+class ResultCacheEntry {
+private:
+	ResultCacheKey m_key;
+	MemoryBuffer *m_buffer;
+	double m_timeLastUsage;
+
+public:
+	ResultCacheEntry(const ResultCacheKey &key, MemoryBuffer *result) {
+		this->m_key = key;
+		this->m_buffer = new MemoryBuffer(result->getDataType(), result->getRect(), result->isHalfFloat());
+		this->m_buffer->copyContentFrom(result);
+		this->updateLastUsage();
+	}
+
+	~ResultCacheEntry() {
+		delete this->m_buffer;
+	}
+
+	void updateLastUsage() {
+		this->m_timeLastUsage = PIL_check_seconds_timer();
+	}
+
+	inline double getTimeLastUsage() {
+		return this->m_timeLastUsage;
+	}
+
+	bool isCacheFor(const ResultCacheKey &key) {
+		return this->m_key == key;
+	}
+
+	MemoryBuffer *getBuffer() { return this->m_buffer; }
+
+	size_t getMemorySize() {
+		return this->m_buffer->getMemorySize();
+	}
+
+#ifdef WITH_CXX_GUARDEDALLOC
+	MEM_CXX_CLASS_ALLOC_FUNCS("COM:ResultCacheEntry")
+#endif
+};
+
+static vector<ResultCacheEntry *> s_results;
+static size_t s_resultsSize = 0;
+
+/* generation of every editor node of the last execution, keyed by the original node */
+static map<const bNode *, unsigned int> s_nodeGenerations;
+static unsigned int s_lastGeneration = 0;
+/* generation of nodes that are not in s_nodeGenerations, changes when entries are pruned */
+static unsigned int s_defaultGeneration = 0;
+
+/**
+ * @brief collects the data that identifies a result and digests it into a ResultCacheKey
+ */
+class ResultCacheKeyBuilder {
+private:
+	vector<unsigned char> m_data;
+
+public:
+	void add(const void *data, size_t size) {
+		const unsigned char *bytes = (const unsigned char *)data;
+		this->m_data.insert(this->m_data.end(), bytes, bytes + size);
+	}
+
+	template<typename T> void add(const T &value) {
+		this->add(&value, sizeof(T));
+	}
+
+	void addString(const char *str) {
+		this->add(str, strlen(str) + 1);
+	}
+
+	/* add a block allocated by the guarded allocator, the whole block is part of the key */
+	void addAllocation(const void *block) {
+		size_t size = block ? MEM_allocN_len(block) : 0;
+		this->add(size);
+		if (size) {
+			this->add(block, size);
+		}
+	}
+
+	/* masks are edited without tagging the node, so their content is part of the key */
+	void addMask(const Mask *mask) {
+		for (const MaskLayer *masklay = (const MaskLayer *)mask->masklayers.first; masklay; masklay = masklay->next) {
+			this->add(masklay->alpha);
+			this->add(masklay->blend);
+			this->add(masklay->blend_flag);
+			this->add(masklay->falloff);
+			this->add(masklay->restrictflag);
+			for (const MaskSpline *spline = (const MaskSpline *)masklay->splines.first; spline; spline = spline->next) {
+				this->add(spline->flag);
+				this->add(spline->offset_mode);
+				this->add(spline->weight_interp);
+				this->add(spline->parent);
+				this->addAllocation(spline->points);
+				/* the evaluated points, these follow parenting and animation */
+				this->addAllocation(spline->points_deform);
+				for (int index = 0; index < spline->tot_point; index++) {
+					this->addAllocation(spline->points[index].uw);
+				}
+			}
+			for (const MaskLayerShape *shape = (const MaskLayerShape *)masklay->splines_shapes.first; shape; shape = shape->next) {
+				this->add(shape->frame);
+				this->addAllocation(shape->data);
+			}
+		}
+	}
+
+	/* the camera settings defocus reads from the scene camera */
+	void addCamera(const Object *camob) {
+		this->add(camob);
+		if (camob && camob->type == OB_CAMERA) {
+			const Camera *camera = (const Camera *)camob->data;
+			this->add(camera->lens);
+			this->add(camera->sensor_fit);
+			this->add(camera->sensor_x);
+			this->add(camera->sensor_y);
+			this->add(BKE_camera_object_dof_distance((Object *)camob));
+		}
+	}
+
+	void addKey(const ResultCacheKey &key) {
+		this->add(key.digest, sizeof(key.digest));
+	}
+
+	ResultCacheKey finish() {
+		ResultCacheKey key;
+		/* make sure the data is never empty */
+		this->add('\0');
+		md5_buffer((const char *)&this->m_data[0], this->m_data.size(), key.digest);
+		return key;
+	}
+};
+
+/**
+ * @brief calculates the ResultCacheKey of the ExecutionGroup's of an ExecutionSystem
+ * keys of operations and editor nodes are reused as the same operation can be upstream of several groups.
+ */
+class ResultCacheHasher {
+private:
+	set<const bNode *> m_treeNodes;
+	map<NodeOperation *, ResultCacheKey> m_operationKeys;
+	map<const bNode *, ResultCacheKey> m_nodeKeys;
+	ResultCacheKey m_contextKey;
+
+public:
+	ResultCacheHasher(ExecutionSystem *system) {
+		CompositorContext &context = system->getContext();
+		const bNodeTree *editingtree = context.getbNodeTree();
+		for (const bNode *node = (const bNode *)editingtree->nodes.first; node; node = node->next) {
+			this->m_treeNodes.insert(node);
+		}
+
+		ResultCacheKeyBuilder builder;
+		builder.add((int)context.getQuality());
+		builder.add(context.isFastCalculation());
+		builder.add(context.getFramenumber());
+		if (editingtree->flag & NTREE_VIEWER_BORDER) {
+			builder.add(editingtree->viewer_border);
+		}
+		this->m_contextKey = builder.finish();
+	}
+
+	/**
+	 * @brief the node that identifies an editor node between executions
+	 * nodes of the localized tree are copies, nodes inside groups are shared with the editor.
+	 */
+	const bNode *getOriginalNode(const bNode *node) {
+		if (node->original && this->m_treeNodes.find(node) != this->m_treeNodes.end()) {
+			return node->original;
+		}
+		return node;
+	}
+
+	ResultCacheKey getNodeKey(const bNode *node) {
+		map<const bNode *, ResultCacheKey>::iterator found = this->m_nodeKeys.find(node);
+		if (found != this->m_nodeKeys.end()) {
+			return found->second;
+		}
+
+		ResultCacheKeyBuilder builder;
+		const bNode *original = this->getOriginalNode(node);
+		map<const bNode *, unsigned int>::iterator generation = s_nodeGenerations.find(original);
+		builder.add(original);
+		builder.add(generation != s_nodeGenerations.end() ? generation->second : s_defaultGeneration);
+
+		builder.add(node->type);
+		builder.add(node->custom1);
+		builder.add(node->custom2);
+		builder.add(node->custom3);
+		builder.add(node->custom4);
+		builder.add(node->id);
+		if (node->id && GS(node->id->name) == ID_MSK) {
+			builder.addMask((const Mask *)node->id);
+		}
+		if (node->type == CMP_NODE_DEFOCUS) {
+			const Scene *scene = (const Scene *)node->id;
+			builder.addCamera(scene ? scene->camera : NULL);
+		}
+		/* the storage of the distortion node is a runtime cache, its settings are stored in the movie clip */
+		if (node->type != CMP_NODE_MOVIEDISTORTION) {
+			builder.addAllocation(node->storage);
+		}
+		if (node->storage && ELEM4(node->type, CMP_NODE_TIME, CMP_NODE_CURVE_VEC, CMP_NODE_CURVE_RGB, CMP_NODE_HUECORRECT)) {
+			const CurveMapping *cumap = (const CurveMapping *)node->storage;
+			for (int index = 0; index < CM_TOT; index++) {
+				builder.addAllocation(cumap->cm[index].curve);
+			}
+		}
+		for (const bNodeSocket *sock = (const bNodeSocket *)node->inputs.first; sock; sock = sock->next) {
+			builder.addAllocation(sock->default_value);
+		}
+		/* input nodes keep their values in the output sockets */
+		for (const bNodeSocket *sock = (const bNodeSocket *)node->outputs.first; sock; sock = sock->next) {
+			builder.addAllocation(sock->default_value);
+		}
+
+		ResultCacheKey key = builder.finish();
+		this->m_nodeKeys[node] = key;
+		return key;
+	}
+
+	ResultCacheKey getOperationKey(NodeOperation *operation) {
+		map<NodeOperation *, ResultCacheKey>::iterator found = this->m_operationKeys.find(operation);
+		if (found != this->m_operationKeys.end()) {
+			return found->second;
+		}
+
+		ResultCacheKeyBuilder builder;
+		builder.addString(typeid(*operation).name());
+		builder.add(operation->getWidth());
+		builder.add(operation->getHeight());
+
+		if (operation->getbNode()) {
+			builder.addKey(this->getNodeKey(operation->getbNode()));
+		}
+
+		if (operation->isSetOperation()) {
+			float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+			operation->read(value, 0.0f, 0.0f, COM_PS_NEAREST);
+			builder.add(value, sizeof(value));
+		}
+
+		if (operation->isReadBufferOperation()) {
+			ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+			builder.addKey(this->getOperationKey(readOperation->getMemoryProxy()->getWriteBufferOperation()));
+		}
+
+		/* the fused operations are no longer connected to the inputs, the program tells how they are read */
+		if (operation->isFusedOperation()) {
+			FusedOperation *fusedOperation = (FusedOperation *)operation;
+			for (unsigned int index = 0; index < fusedOperation->getNumberOfInstructions(); index++) {
+				const FusedInstruction &instruction = fusedOperation->getInstruction(index);
+				if (instruction.operation) {
+					builder.addKey(this->getOperationKey(instruction.operation));
+				}
+				builder.add(instruction.input);
+				builder.add(instruction.operands, sizeof(instruction.operands));
+				builder.add(instruction.result);
+			}
+		}
+
+		for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+			InputSocket *inputSocket = operation->getInputSocket(index);
+			builder.add((int)inputSocket->getResizeMode());
+			if (inputSocket->isConnected()) {
+				NodeOperation *inputOperation = (NodeOperation *)inputSocket->getConnection()->getFromNode();
+				builder.addKey(this->getOperationKey(inputOperation));
+			}
+			else {
+				builder.add(index);
+			}
+		}
+
+		ResultCacheKey key = builder.finish();
+		this->m_operationKeys[operation] = key;
+		return key;
+	}
+
+	ResultCacheKey getGroupKey(ExecutionGroup *group) {
+		ResultCacheKeyBuilder builder;
+		builder.addKey(this->m_contextKey);
+		builder.addKey(this->getOperationKey(group->getOutputNodeOperation()));
+		return builder.finish();
+	}
+};
+
+static bool is_cacheable_group(ExecutionGroup *group)
+{
+	if (group->isOutputExecutionGroup()) {
+		return false;
+	}
+	if (group->getWidth() == 0 || group->getHeight() == 0) {
+		return false;
+	}
+	return group->getOutputNodeOperation()->isWriteBufferOperation();
+}
+
+static ResultCacheEntry *find_result(const ResultCacheKey &key)
+{
+	for (vector<ResultCacheEntry *>::iterator it = s_results.begin(); it != s_results.end(); ++it) {
+		ResultCacheEntry *entry = *it;
+		if (entry->isCacheFor(key)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void free_least_recently_used_results(size_t maxSize)
+{
+	while (s_resultsSize > maxSize && s_results.size() > 0) {
+		double minTime = PIL_check_seconds_timer();
+		vector<ResultCacheEntry *>::iterator minTimeIterator = s_results.begin();
+		for (vector<ResultCacheEntry *>::iterator it = s_results.begin(); it != s_results.end(); ++it) {
+			ResultCacheEntry *entry = *it;
+			if (entry->getTimeLastUsage() < minTime) {
+				minTime = entry->getTimeLastUsage();
+				minTimeIterator = it;
+			}
+		}
+		ResultCacheEntry *entry = *minTimeIterator;
+		s_resultsSize -= entry->getMemorySize();
+		s_results.erase(minTimeIterator);
+		delete entry;
+	}
+}
+
+/**
+ * @brief give every node tagged with need_exec a new generation.
+ * The tag is cleared, so the two passes of a two pass execution do not see it twice.
+ * Only the nodes of this execution are kept, when others are dropped the default generation
+ * changes, so a dropped node that is still alive in another tree is never matched to an old result.
+ */
+static void consume_update_tags(ExecutionSystem *system, ResultCacheHasher &hasher)
+{
+	map<const bNode *, unsigned int> generations;
+	vector<Node *> &nodes = system->getNodes();
+	for (unsigned int index = 0; index < nodes.size(); index++) {
+		bNode *node = nodes[index]->getbNode();
+		if (node == NULL) {
+			continue;
+		}
+		const bNode *original = hasher.getOriginalNode(node);
+		if (node->need_exec) {
+			generations[original] = ++s_lastGeneration;
+			node->need_exec = 0;
+		}
+		else if (generations.find(original) == generations.end()) {
+			map<const bNode *, unsigned int>::iterator generation = s_nodeGenerations.find(original);
+			generations[original] = generation != s_nodeGenerations.end() ? generation->second : s_defaultGeneration;
+		}
+	}
+
+	bool pruned = false;
+	for (map<const bNode *, unsigned int>::iterator it = s_nodeGenerations.begin(); it != s_nodeGenerations.end(); ++it) {
+		if (generations.find(it->first) == generations.end()) {
+			pruned = true;
+			break;
+		}
+	}
+	s_nodeGenerations.swap(generations);
+	if (pruned) {
+		s_defaultGeneration = ++s_lastGeneration;
+	}
+}
+
+void ResultCache::restore(ExecutionSystem *system)
+{
+	if (system->getContext().isRendering()) {
+		return;
+	}
+
+	ResultCacheHasher hasher(system);
+	consume_update_tags(system, hasher);
+
+	vector<ExecutionGroup *> &groups = system->getExecutionGroups();
+	for (unsigned int index = 0; index < groups.size(); index++) {
+		ExecutionGroup *group = groups[index];
+		if (!is_cacheable_group(group)) {
+			continue;
+		}
+
+		ResultCacheKey key = hasher.getGroupKey(group);
+		group->setCacheKey(key);
+
+		ResultCacheEntry *entry = find_result(key);
+		if (entry) {
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)group->getOutputNodeOperation();
+			writeOperation->getMemoryProxy()->getBuffer()->copyContentFrom(entry->getBuffer());
+			entry->updateLastUsage();
+			group->setExecuted();
+		}
+	}
+}
+
+void ResultCache::store(ExecutionSystem *system)
+{
+	if (system->getContext().isRendering()) {
+		return;
+	}
+
+	vector<ExecutionGroup *> &groups = system->getExecutionGroups();
+	for (unsigned int index = 0; index < groups.size(); index++) {
+		ExecutionGroup *group = groups[index];
+		const ResultCacheKey *key = group->getCacheKey();
+		/* groups that are not completely calculated (cancelled, or only partially needed) are not stored */
+		if (key == NULL || !group->isExecuted()) {
+			continue;
+		}
+		if (find_result(*key)) {
+			continue;
+		}
+
+		WriteBufferOperation *writeOperation = (WriteBufferOperation *)group->getOutputNodeOperation();
+		MemoryBuffer *buffer = writeOperation->getMemoryProxy()->getBuffer();
+		size_t size = buffer->getMemorySize();
+		if (size > COM_RESULTCACHE_MAXSIZE) {
+			continue;
+		}
+
+		s_results.push_back(new ResultCacheEntry(*key, buffer));
+		s_resultsSize += size;
+	}
+
+	free_least_recently_used_results(COM_RESULTCACHE_MAXSIZE);
+}
+
+void ResultCache::free()
+{
+	free_least_recently_used_results(0);
+	s_nodeGenerations.clear();
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Jeroen Bakker
+ *		Monique Dewanchand
+ */
+
+class ResultCache;
+
+#ifndef _COM_ResultCache_h_
+#define _COM_ResultCache_h_
+
+#include <string.h>
+
+class ExecutionSystem;
+
+/**
+ * @brief identifies the result of an ExecutionGroup.
+ * md5 digest of all operations, editor node settings and inputs upstream of its WriteBufferOperation.
+ * @ingroup Execution
+ */
+typedef struct ResultCacheKey {
+	unsigned char digest[16];
+
+	bool operator==(const ResultCacheKey &other) const { return memcmp(this->digest, other.digest, sizeof(this->digest)) == 0; }
+} ResultCacheKey;
+
+/**
+ * @brief keeps the results of ExecutionGroup's between executions of the compositor.
+ *
+ * When the user tweaks a node the whole ExecutionSystem is rebuild. ExecutionGroup's that are
+ * not downstream of the tweaked node will produce the same MemoryBuffer as in the previous
+ * execution. These buffers are restored from this cache and their chunks are not scheduled,
+ * so their inputs are never evaluated.
+ *
+ * Changes that are not visible in the node settings (a new render result, an animated image or
+ * movie clip) are signaled by the bNode.need_exec tag. Every tagged node gets a new generation
+ * which is part of the key.
+ * Masks and the scene camera of defocus are edited without tagging the node, their settings
+ * are part of the key of the node that reads them.
+ *
+ * Least recently used results are freed when the cache grows beyond COM_RESULTCACHE_MAXSIZE.
+ * @ingroup Execution
+ */
+class ResultCache {
+public:
+	/**
+	 * @brief restore the cached results of the ExecutionGroup's of the system
+	 * @note must be called after ExecutionGroup.initExecution and before scheduling
+	 */
+	static void restore(ExecutionSystem *system);
+
+	/**
+	 * @brief store the results of the fully executed ExecutionGroup's of the system
+	 * @note must be called before the MemoryProxy's of the system are freed
+	 */
+	static void store(ExecutionSystem *system);
+
+	/**
+	 * @brief free all cached results
+	 */
+	static void free();
+};
+
+#endif
@@ -90,6 +90,21 @@ protected:
 	 */
 	virtual void executePixel(float output[4], float x, float y, float dx, float dy, PixelSampler sampler) {}
 
+	/**
+	 * @brief calculate a row of pixels
+	 * @note this method is called for non-complex, operations can implement it to process
+	 * the row in a batch instead of per pixel. the default implementation calls executePixel
+	 * @param output is a float[4 * width] array to store the result
+	 * @param x the x-coordinate of the first pixel in image space
+	 * @param y the y-coordinate of the row in image space
+	 * @param width the number of pixels to calculate
+	 */
+	virtual void executeRow(float *output, int x, int y, int width) {
+		for (int i = 0; i < width; i++) {
+			executePixel(&output[i * COM_NUMBER_OF_CHANNELS], (float)(x + i), (float)y, COM_PS_NEAREST);
+		}
+	}
+
 public:
 	inline void read(float *result, float x, float y, PixelSampler sampler) {
 		executePixel(result, x, y, sampler);
@@ -100,6 +115,9 @@ public:
 	inline void read(float *result, float x, float y, float dx, float dy, PixelSampler sampler) {
 		executePixel(result, x, y, dx, dy, sampler);
 	}
+	inline void readRow(float *result, int x, int y, int width) {
+		executeRow(result, x, y, width);
+	}
 
 	virtual void *initializeTileData(rcti *rect) { return 0; }
 	virtual void deinitializeTileData(rcti *rect, void *data) {
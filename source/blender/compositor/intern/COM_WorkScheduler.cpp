@@ -20,6 +20,7 @@
  *		Monique Dewanchand
  */
 
+#include <deque>
 #include <list>
 #include <stdio.h>
 
@@ -56,8 +57,30 @@ static vector<CPUDevice *> g_cpudevices;
 /// @brief list of all thread for every CPUDevice in cpudevices a thread exists
 static ListBase g_cputhreads;
 static bool g_cpuInitialized = false;
-/// @brief all scheduled work for the cpu
-static ThreadQueue *g_cpuqueue;
+
+/**
+ * @brief the scheduled work of a single CPUDevice
+ * the device takes its work from the front, devices without work steal from the back.
+ */
+typedef struct CPUWorkQueue {
+	SpinLock lock;
+	deque<WorkPackage *> packages;
+} CPUWorkQueue;
+
+/// @brief all scheduled work for the cpu, for every CPUDevice in cpudevices a queue exists
+static vector<CPUWorkQueue *> g_cpuqueues;
+/// @brief protects the counters below, idle CPUDevices and waiting ExecutionGroups wait on its conditions
+static ThreadMutex g_workMutex;
+/// @brief notified when work is added to the cpu queues or when the threads are stopped
+static ThreadCondition g_cpuWorkCondition;
+/// @brief notified when a work package is finished
+static ThreadCondition g_finishedCondition;
+/// @brief number of work packages in the cpu queues
+static unsigned int g_cpuQueuedWork = 0;
+/// @brief number of scheduled and finished work packages of all devices
+static unsigned int g_scheduledWork = 0;
+static unsigned int g_finishedWork = 0;
+static bool g_cpuStopping = false;
 static ThreadQueue *g_gpuqueue;
 #ifdef COM_OPENCL_ENABLED
 static cl_context g_context;
@@ -139,15 +162,97 @@ int COM_isHighlightedbNode(bNode *bnode)
 } // end extern "C"
 
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+/* neighbouring chunks go to the same queue, in every ExecutionGroup. A device keeps
+ * working on the area of the image it calculated the inputs of. */
+static CPUWorkQueue *cpu_queue_for_package(WorkPackage *package)
+{
+	ExecutionGroup *group = package->getExecutionGroup();
+	size_t index = ((size_t)package->getChunkNumber() * g_cpuqueues.size()) / max(group->getNumberOfChunks(), 1u);
+	return g_cpuqueues[min(index, g_cpuqueues.size() - 1)];
+}
+
+static void cpu_queue_push(CPUWorkQueue *queue, WorkPackage *package)
+{
+	BLI_spin_lock(&queue->lock);
+	queue->packages.push_back(package);
+	BLI_spin_unlock(&queue->lock);
+}
+
+static WorkPackage *cpu_queue_pop(CPUWorkQueue *queue, bool steal)
+{
+	WorkPackage *package = NULL;
+	BLI_spin_lock(&queue->lock);
+	if (!queue->packages.empty()) {
+		if (steal) {
+			package = queue->packages.back();
+			queue->packages.pop_back();
+		}
+		else {
+			package = queue->packages.front();
+			queue->packages.pop_front();
+		}
+	}
+	BLI_spin_unlock(&queue->lock);
+	return package;
+}
+
+/* take the next package of the own queue, or steal one of the queues of the neighbouring areas */
+static WorkPackage *cpu_work_pop(unsigned int queueIndex)
+{
+	const unsigned int numberOfQueues = g_cpuqueues.size();
+	WorkPackage *package = cpu_queue_pop(g_cpuqueues[queueIndex], false);
+
+	for (unsigned int distance = 1; package == NULL && distance < numberOfQueues; distance++) {
+		package = cpu_queue_pop(g_cpuqueues[(queueIndex + distance) % numberOfQueues], true);
+	}
+
+	if (package) {
+		BLI_mutex_lock(&g_workMutex);
+		g_cpuQueuedWork--;
+		BLI_mutex_unlock(&g_workMutex);
+	}
+	return package;
+}
+
+static void work_finished()
+{
+	BLI_mutex_lock(&g_workMutex);
+	g_finishedWork++;
+	BLI_condition_notify_all(&g_finishedCondition);
+	BLI_mutex_unlock(&g_workMutex);
+}
+
 void *WorkScheduler::thread_execute_cpu(void *data)
 {
 	Device *device = (Device *)data;
+	unsigned int queueIndex = 0;
 	WorkPackage *work;
-	
-	while ((work = (WorkPackage *)BLI_thread_queue_pop(g_cpuqueue))) {
+
+	while (g_cpudevices[queueIndex] != device) {
+		queueIndex++;
+	}
+
+	while (true) {
+		work = cpu_work_pop(queueIndex);
+		if (work == NULL) {
+			bool stop;
+			BLI_mutex_lock(&g_workMutex);
+			while (g_cpuQueuedWork == 0 && !g_cpuStopping) {
+				BLI_condition_wait(&g_cpuWorkCondition, &g_workMutex);
+			}
+			stop = (g_cpuQueuedWork == 0);
+			BLI_mutex_unlock(&g_workMutex);
+
+			if (stop) {
+				break;
+			}
+			continue;
+		}
+
 		HIGHLIGHT(work);
 		device->execute(work);
 		delete work;
+		work_finished();
 	}
 	
 	return NULL;
@@ -162,6 +267,7 @@ void *WorkScheduler::thread_execute_gpu(void *data)
 		HIGHLIGHT(work);
 		device->execute(work);
 		delete work;
+		work_finished();
 	}
 	
 	return NULL;
@@ -178,16 +284,22 @@ void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
 	device.execute(package);
 	delete package;
 #elif COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+	BLI_mutex_lock(&g_workMutex);
+	g_scheduledWork++;
+	BLI_mutex_unlock(&g_workMutex);
+
 #ifdef COM_OPENCL_ENABLED
 	if (group->isOpenCL() && g_openclActive) {
 		BLI_thread_queue_push(g_gpuqueue, package);
+		return;
 	}
-	else {
-		BLI_thread_queue_push(g_cpuqueue, package);
-	}
-#else
-	BLI_thread_queue_push(cpuqueue, package);
 #endif
+	cpu_queue_push(cpu_queue_for_package(package), package);
+
+	BLI_mutex_lock(&g_workMutex);
+	g_cpuQueuedWork++;
+	BLI_condition_notify_one(&g_cpuWorkCondition);
+	BLI_mutex_unlock(&g_workMutex);
 #endif
 }
 
@@ -195,7 +307,18 @@ void WorkScheduler::start(CompositorContext &context)
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
 	unsigned int index;
-	g_cpuqueue = BLI_thread_queue_init();
+	BLI_mutex_init(&g_workMutex);
+	BLI_condition_init(&g_cpuWorkCondition);
+	BLI_condition_init(&g_finishedCondition);
+	g_cpuQueuedWork = 0;
+	g_scheduledWork = 0;
+	g_finishedWork = 0;
+	g_cpuStopping = false;
+	for (index = 0; index < g_cpudevices.size(); index++) {
+		CPUWorkQueue *queue = new CPUWorkQueue();
+		BLI_spin_init(&queue->lock);
+		g_cpuqueues.push_back(queue);
+	}
 	BLI_init_threads(&g_cputhreads, thread_execute_cpu, g_cpudevices.size());
 	for (index = 0; index < g_cpudevices.size(); index++) {
 		Device *device = g_cpudevices[index];
@@ -220,26 +343,52 @@ void WorkScheduler::start(CompositorContext &context)
 void WorkScheduler::finish()
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-#ifdef COM_OPENCL_ENABLED
-	if (g_openclActive) {
-		BLI_thread_queue_wait_finish(g_gpuqueue);
-		BLI_thread_queue_wait_finish(g_cpuqueue);
-	}
-	else {
-		BLI_thread_queue_wait_finish(g_cpuqueue);
+	BLI_mutex_lock(&g_workMutex);
+	while (g_finishedWork != g_scheduledWork) {
+		BLI_condition_wait(&g_finishedCondition, &g_workMutex);
 	}
+	BLI_mutex_unlock(&g_workMutex);
+#endif
+}
+
+unsigned int WorkScheduler::getNumberOfFinishedWork()
+{
+#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+	unsigned int numberOfFinishedWork;
+	BLI_mutex_lock(&g_workMutex);
+	numberOfFinishedWork = g_finishedWork;
+	BLI_mutex_unlock(&g_workMutex);
+	return numberOfFinishedWork;
 #else
-	BLI_thread_queue_wait_finish(cpuqueue);
+	return 0;
 #endif
+}
+
+void WorkScheduler::waitForFinishedWork(unsigned int numberOfFinishedWork)
+{
+#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+	BLI_mutex_lock(&g_workMutex);
+	while (g_finishedWork == numberOfFinishedWork && g_finishedWork != g_scheduledWork) {
+		BLI_condition_wait(&g_finishedCondition, &g_workMutex);
+	}
+	BLI_mutex_unlock(&g_workMutex);
 #endif
 }
+
 void WorkScheduler::stop()
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-	BLI_thread_queue_nowait(g_cpuqueue);
+	BLI_mutex_lock(&g_workMutex);
+	g_cpuStopping = true;
+	BLI_condition_notify_all(&g_cpuWorkCondition);
+	BLI_mutex_unlock(&g_workMutex);
 	BLI_end_threads(&g_cputhreads);
-	BLI_thread_queue_free(g_cpuqueue);
-	g_cpuqueue = NULL;
+	while (!g_cpuqueues.empty()) {
+		CPUWorkQueue *queue = g_cpuqueues.back();
+		g_cpuqueues.pop_back();
+		BLI_spin_end(&queue->lock);
+		delete queue;
+	}
 #ifdef COM_OPENCL_ENABLED
 	if (g_openclActive) {
 		BLI_thread_queue_nowait(g_gpuqueue);
@@ -248,6 +397,9 @@ void WorkScheduler::stop()
 		g_gpuqueue = NULL;
 	}
 #endif
+	BLI_condition_end(&g_cpuWorkCondition);
+	BLI_condition_end(&g_finishedCondition);
+	BLI_mutex_end(&g_workMutex);
 #endif
 }
 
@@ -105,6 +105,20 @@ public:
 	 */
 	static void finish();
 
+	/**
+	 * @brief get the number of work packages that are finished since the start
+	 * @see waitForFinishedWork
+	 */
+	static unsigned int getNumberOfFinishedWork();
+
+	/**
+	 * @brief wait until more work is finished
+	 * returns when more than numberOfFinishedWork packages are finished, or when all scheduled work is finished.
+	 * An ExecutionGroup uses this to schedule the chunks that depend on the finished work.
+	 * @param numberOfFinishedWork result of getNumberOfFinishedWork before the last scheduling
+	 */
+	static void waitForFinishedWork(unsigned int numberOfFinishedWork);
+
 	/**
 	 * @brief Are there OpenCL capable GPU devices initialized?
 	 * the result of this method is stored in the CompositorContext
@@ -23,6 +23,7 @@
 
 extern "C" {
 #include "BKE_node.h"
+#include "BLI_fileops.h"
 #include "BLI_threads.h"
 }
 #include "BKE_main.h"
@@ -33,6 +34,8 @@ extern "C" {
 #include "COM_WorkScheduler.h"
 #include "OCL_opencl.h"
 #include "COM_MovieDistortionOperation.h"
+#include "COM_ResultCache.h"
+#include "COM_ExecutionStatistics.h"
 
 static ThreadMutex s_compositorMutex;
 static char is_compositorMutex_init = FALSE;
@@ -40,6 +43,7 @@ static char is_compositorMutex_init = FALSE;
 static void intern_freeCompositorCaches()
 {
 	deintializeDistortionCache();
+	ResultCache::free();
 }
 
 void COM_execute(RenderData *rd, bNodeTree *editingtree, int rendering,
@@ -78,6 +82,7 @@ void COM_execute(RenderData *rd, bNodeTree *editingtree, int rendering,
 	bool twopass = (editingtree->flag & NTREE_TWO_PASS) > 0 && !rendering;
 	/* initialize execution system */
 	if (twopass) {
+		ExecutionStatistics::executionStarted();
 		ExecutionSystem *system = new ExecutionSystem(rd, editingtree, rendering, twopass, viewSettings, displaySettings);
 		system->execute();
 		delete system;
@@ -90,6 +95,7 @@ void COM_execute(RenderData *rd, bNodeTree *editingtree, int rendering,
 		}
 	}
 
+	ExecutionStatistics::executionStarted();
 	ExecutionSystem *system = new ExecutionSystem(rd, editingtree, rendering, false, viewSettings, displaySettings);
 	system->execute();
 	delete system;
@@ -97,7 +103,7 @@ void COM_execute(RenderData *rd, bNodeTree *editingtree, int rendering,
 	BLI_mutex_unlock(&s_compositorMutex);
 }
 
-static void UNUSED_FUNCTION(COM_freeCaches)()
+void COM_clearCaches()
 {
 	if (is_compositorMutex_init) {
 		BLI_mutex_lock(&s_compositorMutex);
@@ -106,6 +112,34 @@ static void UNUSED_FUNCTION(COM_freeCaches)()
 	}
 }
 
+void COM_startStatistics()
+{
+	ExecutionStatistics::begin();
+}
+
+int COM_writeStatistics(const char *filepath)
+{
+	FILE *file = (filepath) ? BLI_fopen(filepath, "w") : stdout;
+	if (file == NULL) {
+		return FALSE;
+	}
+
+	ExecutionStatistics::write(file);
+
+	if (file != stdout) {
+		fclose(file);
+	}
+	else {
+		fflush(file);
+	}
+	return TRUE;
+}
+
+void COM_stopStatistics()
+{
+	ExecutionStatistics::end();
+}
+
 void COM_deinitialize()
 {
 	if (is_compositorMutex_init) {
@@ -27,6 +27,7 @@
 #include "COM_ExecutionSystem.h"
 #include "COM_BokehBlurOperation.h"
 #include "COM_VariableSizeBokehBlurOperation.h"
+#include "COM_FastBokehBlurOperation.h"
 #include "COM_ConvertDepthToRadiusOperation.h"
 
 BokehBlurNode::BokehBlurNode(bNode *editorNode) : Node(editorNode)
@@ -42,7 +43,23 @@ void BokehBlurNode::convertToOperations(ExecutionSystem *graph, CompositorContex
 
 	bool connectedSizeSocket = inputSizeSocket->isConnected();
 
-	if ((b_node->custom1 & CMP_NODEFLAG_BLUR_VARIABLE_SIZE) && connectedSizeSocket) {
+	if (b_node->custom1 & CMP_NODEFLAG_BLUR_FAST_BOKEH) {
+		FastBokehBlurOperation *operation = new FastBokehBlurOperation();
+
+		this->getInputSocket(0)->relinkConnections(operation->getInputSocket(0), 0, graph);
+		this->getInputSocket(1)->relinkConnections(operation->getInputSocket(1), 1, graph);
+		this->getInputSocket(2)->relinkConnections(operation->getInputSocket(2), 2, graph);
+		this->getInputSocket(3)->relinkConnections(operation->getInputSocket(3), 3, graph);
+		operation->setbNode(this->getbNode());
+		graph->addOperation(operation);
+		this->getOutputSocket(0)->relinkConnections(operation->getOutputSocket());
+
+		operation->setDoScaleSize(true);
+		if ((b_node->custom1 & CMP_NODEFLAG_BLUR_VARIABLE_SIZE) && connectedSizeSocket) {
+			operation->setMaxBlur(b_node->custom4);
+		}
+	}
+	else if ((b_node->custom1 & CMP_NODEFLAG_BLUR_VARIABLE_SIZE) && connectedSizeSocket) {
 		VariableSizeBokehBlurOperation *operation = new VariableSizeBokehBlurOperation();
 
 		this->getInputSocket(0)->relinkConnections(operation->getInputSocket(0), 0, graph);
@@ -28,6 +28,7 @@
 #include "COM_ExecutionSystem.h"
 #include "COM_ConvertDepthToRadiusOperation.h"
 #include "COM_VariableSizeBokehBlurOperation.h"
+#include "COM_FastBokehBlurOperation.h"
 #include "COM_BokehImageOperation.h"
 #include "COM_MathBaseOperation.h"
 #include "COM_SetValueOperation.h"
@@ -99,27 +100,45 @@ void DefocusNode::convertToOperations(ExecutionSystem *graph, CompositorContext
 	bokeh->deleteDataOnFinish();
 	graph->addOperation(bokeh);
 
-#ifdef COM_DEFOCUS_SEARCH	
-	InverseSearchRadiusOperation *search = new InverseSearchRadiusOperation();
-	addLink(graph, radiusOperation->getOutputSocket(0), search->getInputSocket(0));
-	search->setMaxBlur(data->maxblur);
-	graph->addOperation(search);
-#endif
-	VariableSizeBokehBlurOperation *operation = new VariableSizeBokehBlurOperation();
-	if (data->preview) {
-		operation->setQuality(COM_QUALITY_LOW);
+	NodeOperation *operation;
+	if (data->fast) {
+		FastBokehBlurOperation *fastOperation = new FastBokehBlurOperation();
+		SetValueOperation *boundingBox = new SetValueOperation();
+		boundingBox->setValue(1.0f);
+		graph->addOperation(boundingBox);
+
+		fastOperation->setMaxBlur(data->maxblur);
+		fastOperation->setbNode(node);
+		fastOperation->setThreshold(data->bthresh);
+		addLink(graph, bokeh->getOutputSocket(), fastOperation->getInputSocket(1));
+		addLink(graph, radiusOperation->getOutputSocket(), fastOperation->getInputSocket(2));
+		addLink(graph, boundingBox->getOutputSocket(), fastOperation->getInputSocket(3));
+		operation = fastOperation;
 	}
 	else {
-		operation->setQuality(context->getQuality());
-	}
-	operation->setMaxBlur(data->maxblur);
-	operation->setbNode(node);
-	operation->setThreshold(data->bthresh);
-	addLink(graph, bokeh->getOutputSocket(), operation->getInputSocket(1));
-	addLink(graph, radiusOperation->getOutputSocket(), operation->getInputSocket(2));
 #ifdef COM_DEFOCUS_SEARCH
-	addLink(graph, search->getOutputSocket(), operation->getInputSocket(3));
+		InverseSearchRadiusOperation *search = new InverseSearchRadiusOperation();
+		addLink(graph, radiusOperation->getOutputSocket(0), search->getInputSocket(0));
+		search->setMaxBlur(data->maxblur);
+		graph->addOperation(search);
 #endif
+		VariableSizeBokehBlurOperation *exactOperation = new VariableSizeBokehBlurOperation();
+		if (data->preview) {
+			exactOperation->setQuality(COM_QUALITY_LOW);
+		}
+		else {
+			exactOperation->setQuality(context->getQuality());
+		}
+		exactOperation->setMaxBlur(data->maxblur);
+		exactOperation->setbNode(node);
+		exactOperation->setThreshold(data->bthresh);
+		addLink(graph, bokeh->getOutputSocket(), exactOperation->getInputSocket(1));
+		addLink(graph, radiusOperation->getOutputSocket(), exactOperation->getInputSocket(2));
+#ifdef COM_DEFOCUS_SEARCH
+		addLink(graph, search->getOutputSocket(), exactOperation->getInputSocket(3));
+#endif
+		operation = exactOperation;
+	}
 	if (data->gamco) {
 		GammaCorrectOperation *correct = new GammaCorrectOperation();
 		GammaUncorrectOperation *inverse = new GammaUncorrectOperation();
@@ -46,6 +46,7 @@ ColorBalanceLGGOperation::ColorBalanceLGGOperation() : NodeOperation()
 	this->m_inputValueOperation = NULL;
 	this->m_inputColorOperation = NULL;
 	this->setResolutionInputSocketIndex(1);
+	this->setPixelLocal(true);
 }
 
 void ColorBalanceLGGOperation::initExecution()
@@ -73,6 +74,22 @@ void ColorBalanceLGGOperation::executePixel(float output[4], float x, float y, P
 
 }
 
+void ColorBalanceLGGOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *value = inputs[0];
+	const float *inputColor = inputs[1];
+
+	for (int i = 0; i < width; i++, output += 4, value += 4, inputColor += 4) {
+		float fac = min(1.0f, value[0]);
+		const float mfac = 1.0f - fac;
+
+		output[0] = mfac * inputColor[0] + fac * colorbalance_lgg(inputColor[0], this->m_lift[0], this->m_gamma_inv[0], this->m_gain[0]);
+		output[1] = mfac * inputColor[1] + fac * colorbalance_lgg(inputColor[1], this->m_lift[1], this->m_gamma_inv[1], this->m_gain[1]);
+		output[2] = mfac * inputColor[2] + fac * colorbalance_lgg(inputColor[2], this->m_lift[2], this->m_gamma_inv[2], this->m_gain[2]);
+		output[3] = inputColor[3];
+	}
+}
+
 void ColorBalanceLGGOperation::deinitExecution()
 {
 	this->m_inputValueOperation = NULL;
@@ -51,6 +51,11 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+
+	/**
+	 * the inner loop of this program, for a span of input values
+	 */
+	void executeSpan(float *output, float **inputs, int width);
 	
 	/**
 	 * Initialize the execution
@@ -128,7 +128,7 @@ void CompositorOperation::deinitExecution()
 
 void CompositorOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
-	float color[8]; // 7 is enough
+	float row[COM_ROW_SPAN * COM_NUMBER_OF_CHANNELS];
 	float *buffer = this->m_outputBuffer;
 	float *zbuffer = this->m_depthBuffer;
 
@@ -142,31 +142,38 @@ void CompositorOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 	int offset4 = offset * COM_NUMBER_OF_CHANNELS;
 	int x;
 	int y;
+	int i;
 	bool breaked = false;
 
 	for (y = y1; y < y2 && (!breaked); y++) {
-		for (x = x1; x < x2 && (!breaked); x++) {
-			this->m_imageInput->read(color, x, y, COM_PS_NEAREST);
+		this->m_imageInput->readRow(buffer + offset4, x1, y, x2 - x1);
+
+		for (x = x1; x < x2; x += COM_ROW_SPAN) {
+			const int num = min_ii(x2 - x, COM_ROW_SPAN);
+
 			if (this->m_ignoreAlpha) {
-				color[3] = 1.0f;
+				for (i = 0; i < num; i++)
+					buffer[offset4 + i * COM_NUMBER_OF_CHANNELS + 3] = 1.0f;
 			}
 			else {
 				if (this->m_alphaInput != NULL) {
-					this->m_alphaInput->read(&(color[3]), x, y, COM_PS_NEAREST);
+					this->m_alphaInput->readRow(row, x, y, num);
+					for (i = 0; i < num; i++)
+						buffer[offset4 + i * COM_NUMBER_OF_CHANNELS + 3] = row[i * COM_NUMBER_OF_CHANNELS];
 				}
 			}
 
-			copy_v4_v4(buffer + offset4, color);
-
 			if (this->m_depthInput != NULL) {
-				this->m_depthInput->read(color, x, y, COM_PS_NEAREST);
-				zbuffer[offset] = color[0];
-			}
-			offset4 += COM_NUMBER_OF_CHANNELS;
-			offset++;
-			if (isBreaked()) {
-				breaked = true;
+				this->m_depthInput->readRow(row, x, y, num);
+				for (i = 0; i < num; i++)
+					zbuffer[offset + i] = row[i * COM_NUMBER_OF_CHANNELS];
 			}
+
+			offset4 += num * COM_NUMBER_OF_CHANNELS;
+			offset += num;
+		}
+		if (isBreaked()) {
+			breaked = true;
 		}
 		offset += add;
 		offset4 += add * COM_NUMBER_OF_CHANNELS;
@@ -27,6 +27,7 @@ ConvertColorToBWOperation::ConvertColorToBWOperation() : NodeOperation()
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VALUE);
 	this->m_inputOperation = NULL;
+	this->setPixelLocal(true);
 }
 
 void ConvertColorToBWOperation::initExecution()
@@ -41,6 +42,22 @@ void ConvertColorToBWOperation::executePixel(float output[4], float x, float y,
 	output[0] = rgb_to_bw(inputColor);
 }
 
+void ConvertColorToBWOperation::executeRow(float *output, int x, int y, int width)
+{
+	/* convert in place */
+	this->m_inputOperation->readRow(output, x, y, width);
+	executeSpan(output, &output, width);
+}
+
+void ConvertColorToBWOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *input = inputs[0];
+
+	for (int i = 0; i < width; i++, output += 4, input += 4) {
+		output[0] = rgb_to_bw(input);
+	}
+}
+
 void ConvertColorToBWOperation::deinitExecution()
 {
 	this->m_inputOperation = NULL;
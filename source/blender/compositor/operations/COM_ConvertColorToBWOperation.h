@@ -45,6 +45,16 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+
+	/**
+	 * the inner loop of this program, for a row of pixels
+	 */
+	void executeRow(float *output, int x, int y, int width);
+
+	/**
+	 * the inner loop of this program, for a span of input values
+	 */
+	void executeSpan(float *output, float **inputs, int width);
 	
 	/**
 	 * Initialize the execution
@@ -27,6 +27,7 @@ ConvertColorToValueProg::ConvertColorToValueProg() : NodeOperation()
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VALUE);
 	this->m_inputOperation = NULL;
+	this->setPixelLocal(true);
 }
 
 void ConvertColorToValueProg::initExecution()
@@ -41,6 +42,22 @@ void ConvertColorToValueProg::executePixel(float output[4], float x, float y, Pi
 	output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueProg::executeRow(float *output, int x, int y, int width)
+{
+	/* convert in place */
+	this->m_inputOperation->readRow(output, x, y, width);
+	executeSpan(output, &output, width);
+}
+
+void ConvertColorToValueProg::executeSpan(float *output, float **inputs, int width)
+{
+	const float *input = inputs[0];
+
+	for (int i = 0; i < width; i++, output += 4, input += 4) {
+		output[0] = (input[0] + input[1] + input[2]) / 3.0f;
+	}
+}
+
 void ConvertColorToValueProg::deinitExecution()
 {
 	this->m_inputOperation = NULL;
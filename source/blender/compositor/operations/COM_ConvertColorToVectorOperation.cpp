@@ -27,6 +27,7 @@ ConvertColorToVectorOperation::ConvertColorToVectorOperation() : NodeOperation()
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VECTOR);
 	this->m_inputOperation = NULL;
+	this->setPixelLocal(true);
 }
 
 void ConvertColorToVectorOperation::initExecution()
@@ -39,6 +40,20 @@ void ConvertColorToVectorOperation::executePixel(float output[4], float x, float
 	this->m_inputOperation->read(output, x, y, sampler);
 }
 
+void ConvertColorToVectorOperation::executeRow(float *output, int x, int y, int width)
+{
+	this->m_inputOperation->readRow(output, x, y, width);
+}
+
+void ConvertColorToVectorOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *input = inputs[0];
+
+	for (int i = 0; i < width; i++, output += 4, input += 4) {
+		copy_v4_v4(output, input);
+	}
+}
+
 void ConvertColorToVectorOperation::deinitExecution()
 {
 	this->m_inputOperation = NULL;
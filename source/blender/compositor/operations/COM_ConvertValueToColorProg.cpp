@@ -27,6 +27,7 @@ ConvertValueToColorProg::ConvertValueToColorProg() : NodeOperation()
 	this->addInputSocket(COM_DT_VALUE);
 	this->addOutputSocket(COM_DT_COLOR);
 	this->m_inputProgram = NULL;
+	this->setPixelLocal(true);
 }
 void ConvertValueToColorProg::initExecution()
 {
@@ -41,6 +42,27 @@ void ConvertValueToColorProg::executePixel(float output[4], float x, float y, Pi
 	output[3] = 1.0f;
 }
 
+void ConvertValueToColorProg::executeRow(float *output, int x, int y, int width)
+{
+	/* convert in place */
+	this->m_inputProgram->readRow(output, x, y, width);
+	executeSpan(output, &output, width);
+}
+
+void ConvertValueToColorProg::executeSpan(float *output, float **inputs, int width)
+{
+	const float *input = inputs[0];
+
+	for (int i = 0; i < width; i++, output += 4, input += 4) {
+#ifdef __SSE__
+		_mm_storeu_ps(output, _mm_set_ps(1.0f, input[0], input[0], input[0]));
+#else
+		output[0] = output[1] = output[2] = input[0];
+		output[3] = 1.0f;
+#endif
+	}
+}
+
 void ConvertValueToColorProg::deinitExecution()
 {
 	this->m_inputProgram = NULL;
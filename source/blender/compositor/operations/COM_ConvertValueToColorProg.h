@@ -24,6 +24,10 @@
 #define _COM_ConvertValueToColorProg_h
 #include "COM_NodeOperation.h"
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 
 class ConvertValueToColorProg : public NodeOperation {
 private:
@@ -38,6 +42,16 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+
+	/**
+	 * the inner loop of this program, for a row of pixels
+	 */
+	void executeRow(float *output, int x, int y, int width);
+
+	/**
+	 * the inner loop of this program, for a span of input values
+	 */
+	void executeSpan(float *output, float **inputs, int width);
 	
 	/**
 	 * Initialize the execution
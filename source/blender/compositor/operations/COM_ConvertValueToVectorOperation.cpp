@@ -27,6 +27,7 @@ ConvertValueToVectorOperation::ConvertValueToVectorOperation() : NodeOperation()
 	this->addInputSocket(COM_DT_VALUE);
 	this->addOutputSocket(COM_DT_VECTOR);
 	this->m_inputOperation = NULL;
+	this->setPixelLocal(true);
 }
 
 void ConvertValueToVectorOperation::initExecution()
@@ -44,6 +45,27 @@ void ConvertValueToVectorOperation::executePixel(float output[4], float x, float
 	output[3] = 0.0f;
 }
 
+void ConvertValueToVectorOperation::executeRow(float *output, int x, int y, int width)
+{
+	/* convert in place */
+	this->m_inputOperation->readRow(output, x, y, width);
+	executeSpan(output, &output, width);
+}
+
+void ConvertValueToVectorOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *input = inputs[0];
+
+	for (int i = 0; i < width; i++, output += 4, input += 4) {
+#ifdef __SSE__
+		_mm_storeu_ps(output, _mm_set_ps(0.0f, input[0], input[0], input[0]));
+#else
+		output[0] = output[1] = output[2] = input[0];
+		output[3] = 0.0f;
+#endif
+	}
+}
+
 void ConvertValueToVectorOperation::deinitExecution()
 {
 	this->m_inputOperation = NULL;
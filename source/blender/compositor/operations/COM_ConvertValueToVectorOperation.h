@@ -24,6 +24,10 @@
 #define _COM_ConvertValueToVectorOperation_h
 #include "COM_NodeOperation.h"
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 
 /**
  * this program converts an input color to an output value.
@@ -45,6 +49,16 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+
+	/**
+	 * the inner loop of this program, for a row of pixels
+	 */
+	void executeRow(float *output, int x, int y, int width);
+
+	/**
+	 * the inner loop of this program, for a span of input values
+	 */
+	void executeSpan(float *output, float **inputs, int width);
 	
 	/**
 	 * Initialize the execution
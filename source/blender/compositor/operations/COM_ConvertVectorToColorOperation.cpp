@@ -27,6 +27,7 @@ ConvertVectorToColorOperation::ConvertVectorToColorOperation() : NodeOperation()
 	this->addInputSocket(COM_DT_VECTOR);
 	this->addOutputSocket(COM_DT_COLOR);
 	this->m_inputOperation = NULL;
+	this->setPixelLocal(true);
 }
 
 void ConvertVectorToColorOperation::initExecution()
@@ -40,6 +41,23 @@ void ConvertVectorToColorOperation::executePixel(float output[4], float x, float
 	output[3] = 1.0f;
 }
 
+void ConvertVectorToColorOperation::executeRow(float *output, int x, int y, int width)
+{
+	/* convert in place */
+	this->m_inputOperation->readRow(output, x, y, width);
+	executeSpan(output, &output, width);
+}
+
+void ConvertVectorToColorOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *input = inputs[0];
+
+	for (int i = 0; i < width; i++, output += 4, input += 4) {
+		copy_v3_v3(output, input);
+		output[3] = 1.0f;
+	}
+}
+
 void ConvertVectorToColorOperation::deinitExecution()
 {
 	this->m_inputOperation = NULL;
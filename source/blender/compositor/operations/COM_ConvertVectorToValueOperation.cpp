@@ -27,6 +27,7 @@ ConvertVectorToValueOperation::ConvertVectorToValueOperation() : NodeOperation()
 	this->addInputSocket(COM_DT_VECTOR);
 	this->addOutputSocket(COM_DT_VALUE);
 	this->m_inputOperation = NULL;
+	this->setPixelLocal(true);
 }
 
 void ConvertVectorToValueOperation::initExecution()
@@ -41,6 +42,22 @@ void ConvertVectorToValueOperation::executePixel(float output[4], float x, float
 	output[0] = (input[0] + input[1] + input[2]) / 3.0f;
 }
 
+void ConvertVectorToValueOperation::executeRow(float *output, int x, int y, int width)
+{
+	/* convert in place */
+	this->m_inputOperation->readRow(output, x, y, width);
+	executeSpan(output, &output, width);
+}
+
+void ConvertVectorToValueOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *input = inputs[0];
+
+	for (int i = 0; i < width; i++, output += 4, input += 4) {
+		output[0] = (input[0] + input[1] + input[2]) / 3.0f;
+	}
+}
+
 void ConvertVectorToValueOperation::deinitExecution()
 {
 	this->m_inputOperation = NULL;
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor: 
+ *		Jeroen Bakker 
+ *		Monique Dewanchand
+ */
+
+#include <float.h>
+
+#include "COM_FastBokehBlurOperation.h"
+#include "BLI_math.h"
+#include "MEM_guardedalloc.h"
+
+/* weighted color channels and the weight */
+#define TABLE_CHANNELS (COM_NUMBER_OF_CHANNELS + 1)
+
+FastBokehBlurOperation::FastBokehBlurOperation() : NodeOperation()
+{
+	this->addInputSocket(COM_DT_COLOR);
+	this->addInputSocket(COM_DT_COLOR, COM_SC_NO_RESIZE); // do not resize the bokeh image.
+	this->addInputSocket(COM_DT_VALUE); // radius
+	this->addInputSocket(COM_DT_VALUE); // bounding box
+	this->addOutputSocket(COM_DT_COLOR);
+	this->setComplex(true);
+
+	this->m_inputProgram = NULL;
+	this->m_inputBokehProgram = NULL;
+	this->m_inputSizeProgram = NULL;
+	this->m_inputBoundingBoxProgram = NULL;
+	this->m_maxBlur = FLT_MAX;
+	this->m_threshold = 0.0f;
+	this->m_do_size_scale = false;
+	this->m_table = NULL;
+}
+
+void FastBokehBlurOperation::initExecution()
+{
+	initMutex();
+	this->m_inputProgram = getInputSocketReader(0);
+	this->m_inputBokehProgram = getInputSocketReader(1);
+	this->m_inputSizeProgram = getInputSocketReader(2);
+	this->m_inputBoundingBoxProgram = getInputSocketReader(3);
+}
+
+void FastBokehBlurOperation::deinitExecution()
+{
+	if (this->m_table) {
+		MEM_freeN(this->m_table);
+		this->m_table = NULL;
+	}
+	deinitMutex();
+	this->m_inputProgram = NULL;
+	this->m_inputBokehProgram = NULL;
+	this->m_inputSizeProgram = NULL;
+	this->m_inputBoundingBoxProgram = NULL;
+}
+
+float FastBokehBlurOperation::getSizeScalar()
+{
+	const float max_dim = max(this->m_width, this->m_height);
+	return this->m_do_size_scale ? (max_dim / 100.0f) : 1.0f;
+}
+
+float FastBokehBlurOperation::getRadius(float size, float scalar)
+{
+	return min(size * scalar, this->m_maxBlur);
+}
+
+void FastBokehBlurOperation::determineBands()
+{
+	const int width = this->m_inputBokehProgram->getWidth();
+	const int height = this->m_inputBokehProgram->getHeight();
+	float *rows = (float *)MEM_mallocN(sizeof(float) * width * COM_FAST_BOKEH_BANDS, __func__);
+	float bokeh[4];
+	float peak = 0.0f;
+	int band, x;
+
+	/* the bokeh is mirrored, a pixel gathers the colors of the pixels whose bokeh covers it */
+	for (band = 0; band < COM_FAST_BOKEH_BANDS; band++) {
+		const float v = -1.0f + (band + 0.5f) * (2.0f / COM_FAST_BOKEH_BANDS);
+		const int y = min_ii((int)((0.5f - v * 0.5f) * height), height - 1);
+		for (x = 0; x < width; x++) {
+			this->m_inputBokehProgram->read(bokeh, x, y, COM_PS_NEAREST);
+			rows[band * width + x] = max_fff(bokeh[0], bokeh[1], bokeh[2]);
+			peak = max(peak, rows[band * width + x]);
+		}
+	}
+
+	for (band = 0; band < COM_FAST_BOKEH_BANDS; band++) {
+		int minx = width;
+		int maxx = -1;
+		for (x = 0; x < width; x++) {
+			if (rows[band * width + x] > peak * 0.5f) {
+				minx = min(minx, x);
+				maxx = max(maxx, x);
+			}
+		}
+
+		if (maxx == -1) {
+			this->m_bandMinX[band] = 1.0f;
+			this->m_bandMaxX[band] = -1.0f;
+		}
+		else {
+			this->m_bandMinX[band] = 1.0f - (maxx + 1) * (2.0f / width);
+			this->m_bandMaxX[band] = 1.0f - minx * (2.0f / width);
+		}
+	}
+
+	MEM_freeN(rows);
+}
+
+void FastBokehBlurOperation::calculateTable(MemoryBuffer *color, MemoryBuffer *size)
+{
+	const int width = this->getWidth();
+	const int height = this->getHeight();
+	const size_t stride = (size_t)(width + 1) * TABLE_CHANNELS;
+	const float scalar = this->getSizeScalar();
+	double *table = (double *)MEM_callocN(sizeof(double) * stride * (height + 1), __func__);
+	float readColor[4];
+	float readSize[4];
+
+	for (int y = 0; y < height; y++) {
+		const double *previousRow = &table[y * stride];
+		double *row = &table[(y + 1) * stride];
+		double rowSum[TABLE_CHANNELS] = {0.0};
+
+		for (int x = 0; x < width; x++) {
+			color->read(readColor, x, y);
+			size->read(readSize, x, y);
+			const float weight = max(this->getRadius(readSize[0], scalar), 1.0f);
+			const size_t offset = (x + 1) * TABLE_CHANNELS;
+
+			for (int c = 0; c < COM_NUMBER_OF_CHANNELS; c++) {
+				rowSum[c] += readColor[c] * weight;
+			}
+			rowSum[COM_NUMBER_OF_CHANNELS] += weight;
+
+			for (int c = 0; c < TABLE_CHANNELS; c++) {
+				row[offset + c] = previousRow[offset + c] + rowSum[c];
+			}
+		}
+	}
+
+	this->m_table = table;
+}
+
+void *FastBokehBlurOperation::initializeTileData(rcti *rect)
+{
+	lockMutex();
+	if (!this->m_table) {
+		MemoryBuffer *color = (MemoryBuffer *)this->m_inputProgram->initializeTileData(rect);
+		MemoryBuffer *size = (MemoryBuffer *)this->m_inputSizeProgram->initializeTileData(rect);
+		determineBands();
+		calculateTable(color, size);
+	}
+	unlockMutex();
+	return this->m_table;
+}
+
+void FastBokehBlurOperation::addRectangle(double sum[TABLE_CHANNELS], int xmin, int ymin, int xmax, int ymax)
+{
+	const size_t stride = (size_t)(this->getWidth() + 1) * TABLE_CHANNELS;
+	const double *topLeft = &this->m_table[ymin * stride + xmin * TABLE_CHANNELS];
+	const double *topRight = &this->m_table[ymin * stride + xmax * TABLE_CHANNELS];
+	const double *bottomLeft = &this->m_table[ymax * stride + xmin * TABLE_CHANNELS];
+	const double *bottomRight = &this->m_table[ymax * stride + xmax * TABLE_CHANNELS];
+
+	for (int c = 0; c < TABLE_CHANNELS; c++) {
+		sum[c] += bottomRight[c] - bottomLeft[c] - topRight[c] + topLeft[c];
+	}
+}
+
+void FastBokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
+{
+	float readColor[4];
+	float readSize[4];
+	float boundingBox[4];
+
+	this->m_inputProgram->read(readColor, x, y, COM_PS_NEAREST);
+	this->m_inputSizeProgram->read(readSize, x, y, COM_PS_NEAREST);
+	this->m_inputBoundingBoxProgram->read(boundingBox, x, y, COM_PS_NEAREST);
+
+	const float radius = this->getRadius(readSize[0], this->getSizeScalar());
+	if (boundingBox[0] <= 0.0f || radius <= this->m_threshold || radius < 1.0f) {
+		copy_v4_v4(output, readColor);
+		return;
+	}
+
+	const int width = this->getWidth();
+	const int height = this->getHeight();
+	const float extent = radius + 0.5f;
+	double sum[TABLE_CHANNELS] = {0.0};
+
+	for (int band = 0; band < COM_FAST_BOKEH_BANDS; band++) {
+		if (this->m_bandMinX[band] > this->m_bandMaxX[band]) {
+			continue;
+		}
+		const float v = -1.0f + band * (2.0f / COM_FAST_BOKEH_BANDS);
+		int ymin = y + (int)floorf(v * extent + 0.5f);
+		int ymax = y + (int)floorf((v + 2.0f / COM_FAST_BOKEH_BANDS) * extent + 0.5f);
+		int xmin = x + (int)floorf(this->m_bandMinX[band] * extent + 0.5f);
+		int xmax = x + (int)floorf(this->m_bandMaxX[band] * extent + 0.5f);
+
+		CLAMP(xmin, 0, width);
+		CLAMP(xmax, 0, width);
+		CLAMP(ymin, 0, height);
+		CLAMP(ymax, 0, height);
+		if (xmin < xmax && ymin < ymax) {
+			addRectangle(sum, xmin, ymin, xmax, ymax);
+		}
+	}
+
+	if (sum[COM_NUMBER_OF_CHANNELS] > 0.0) {
+		const double weight = 1.0 / sum[COM_NUMBER_OF_CHANNELS];
+		output[0] = sum[0] * weight;
+		output[1] = sum[1] * weight;
+		output[2] = sum[2] * weight;
+		output[3] = sum[3] * weight;
+	}
+	else {
+		copy_v4_v4(output, readColor);
+	}
+
+	/* blend in out values over the threshold, otherwise we get sharp, ugly transitions */
+	if ((this->m_threshold > 0.0f) &&
+	    (radius < this->m_threshold * 2.0f))
+	{
+		/* factor from 0-1 */
+		float fac = (radius - this->m_threshold) / this->m_threshold;
+		interp_v4_v4v4(output, readColor, output, fac);
+	}
+}
+
+bool FastBokehBlurOperation::determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output)
+{
+	rcti newInput;
+	rcti bokehInput;
+
+	/* the summed area table covers the whole image */
+	newInput.xmin = 0;
+	newInput.ymin = 0;
+	newInput.xmax = this->getWidth();
+	newInput.ymax = this->getHeight();
+
+	NodeOperation *operation = getInputOperation(1);
+	bokehInput.xmin = 0;
+	bokehInput.ymin = 0;
+	bokehInput.xmax = operation->getWidth();
+	bokehInput.ymax = operation->getHeight();
+	if (operation->determineDependingAreaOfInterest(&bokehInput, readOperation, output) ) {
+		return true;
+	}
+	operation = getInputOperation(3);
+	if (operation->determineDependingAreaOfInterest(input, readOperation, output) ) {
+		return true;
+	}
+	operation = getInputOperation(2);
+	if (operation->determineDependingAreaOfInterest(&newInput, readOperation, output) ) {
+		return true;
+	}
+	operation = getInputOperation(0);
+	if (operation->determineDependingAreaOfInterest(&newInput, readOperation, output) ) {
+		return true;
+	}
+	return false;
+}
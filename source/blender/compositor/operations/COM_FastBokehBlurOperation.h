@@ -0,0 +1,103 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor: 
+ *		Jeroen Bakker 
+ *		Monique Dewanchand
+ */
+
+#ifndef _COM_FastBokehBlurOperation_h
+#define _COM_FastBokehBlurOperation_h
+#include "COM_NodeOperation.h"
+
+/**
+ * @brief bokeh blur where the time per pixel does not depend on the blur radius
+ *
+ * The bokeh image is approximated by COM_FAST_BOKEH_BANDS horizontal bands, every band is
+ * a rectangle with the horizontal extent of the bokeh at the center of the band. The colors
+ * of the rectangles are looked up in a summed area table of the whole input image, so every
+ * pixel is calculated with a constant number of lookups.
+ *
+ * Pixels are weighted with their own blur radius, sharp pixels contribute less to the
+ * blurred pixels around them. The radius of the calculated pixel determines the size
+ * of the bokeh.
+ *
+ * The summed area table is calculated once, with double precision, and needs
+ * 5 doubles per pixel.
+ * @see VariableSizeBokehBlurOperation for the exact calculation
+ * @see BokehBlurOperation for the exact calculation
+ * @ingroup Operation
+ */
+class FastBokehBlurOperation : public NodeOperation {
+private:
+	float m_maxBlur;
+	float m_threshold;
+	bool m_do_size_scale;  /* scale size, matching 'BokehBlurNode' */
+	SocketReader *m_inputProgram;
+	SocketReader *m_inputBokehProgram;
+	SocketReader *m_inputSizeProgram;
+	SocketReader *m_inputBoundingBoxProgram;
+
+	/**
+	 * @brief horizontal extent of the bokeh in every band, relative to the radius
+	 * the minimum is bigger than the maximum for empty bands
+	 */
+	float m_bandMinX[COM_FAST_BOKEH_BANDS];
+	float m_bandMaxX[COM_FAST_BOKEH_BANDS];
+
+	/**
+	 * @brief summed area table of the weighted colors and the weights
+	 * (width + 1) * (height + 1) entries, the first row and column are zero
+	 */
+	double *m_table;
+
+	float getSizeScalar();
+	float getRadius(float size, float scalar);
+	void determineBands();
+	void calculateTable(MemoryBuffer *color, MemoryBuffer *size);
+	void addRectangle(double sum[5], int xmin, int ymin, int xmax, int ymax);
+
+public:
+	FastBokehBlurOperation();
+
+	/**
+	 * the inner loop of this program
+	 */
+	void executePixel(float output[4], int x, int y, void *data);
+	
+	/**
+	 * Initialize the execution
+	 */
+	void initExecution();
+	
+	void *initializeTileData(rcti *rect);
+	
+	/**
+	 * Deinitialize the execution
+	 */
+	void deinitExecution();
+	
+	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
+	
+	void setMaxBlur(float maxRadius) { this->m_maxBlur = maxRadius; }
+
+	void setThreshold(float threshold) { this->m_threshold = threshold; }
+
+	void setDoScaleSize(bool scale_size) { this->m_do_size_scale = scale_size; }
+};
+
+#endif
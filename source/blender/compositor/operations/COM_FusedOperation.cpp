@@ -0,0 +1,191 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Jeroen Bakker
+ *		Monique Dewanchand
+ */
+
+#include "COM_FusedOperation.h"
+#include "COM_SocketConnection.h"
+
+#include <map>
+#include <string.h>
+
+extern "C" {
+#include "BLI_math.h"
+}
+
+FusedOperation::FusedOperation(DataType datatype) : NodeOperation()
+{
+	this->addOutputSocket(datatype);
+	this->m_numberOfRegisters = 0;
+}
+
+int FusedOperation::allocateRegister(vector<bool> &registersInUse)
+{
+	int index;
+	for (index = 0; index < (int)registersInUse.size(); index++) {
+		if (!registersInUse[index]) {
+			registersInUse[index] = true;
+			return index;
+		}
+	}
+	registersInUse.push_back(true);
+	this->m_numberOfRegisters = max(this->m_numberOfRegisters, (int)registersInUse.size());
+	return index;
+}
+
+bool FusedOperation::compile()
+{
+	map<OutputSocket *, unsigned int> lastUse;
+	map<OutputSocket *, int> registers;
+	vector<bool> registersInUse;
+	unsigned int index;
+
+	/* the last fused operation reading a value, its register is free after that */
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		for (unsigned int inputIndex = 0; inputIndex < operation->getNumberOfInputSockets(); inputIndex++) {
+			lastUse[operation->getInputSocket(inputIndex)->getConnection()->getFromSocket()] = index;
+		}
+	}
+
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		FusedInstruction instruction;
+		unsigned int inputIndex;
+
+		memset(&instruction, 0, sizeof(FusedInstruction));
+		instruction.operation = operation;
+		instruction.input = -1;
+
+		for (inputIndex = 0; inputIndex < operation->getNumberOfInputSockets(); inputIndex++) {
+			OutputSocket *fromSocket = operation->getInputSocket(inputIndex)->getConnection()->getFromSocket();
+			map<OutputSocket *, int>::iterator found = registers.find(fromSocket);
+
+			if (found == registers.end()) {
+				/* not calculated in the chain, load it just before it is needed */
+				FusedInstruction load;
+				memset(&load, 0, sizeof(FusedInstruction));
+				load.operation = NULL;
+				load.input = this->findInputSocketIndex(fromSocket);
+				if (load.input == -1) {
+					load.input = this->m_inputOutputSockets.size();
+					this->addInputSocket(fromSocket->getDataType());
+					this->m_inputOutputSockets.push_back(fromSocket);
+				}
+				load.result = this->allocateRegister(registersInUse);
+				this->m_program.push_back(load);
+
+				registers[fromSocket] = load.result;
+				instruction.operands[inputIndex] = load.result;
+			}
+			else {
+				instruction.operands[inputIndex] = found->second;
+			}
+		}
+
+		/* the result never shares a register with the operands, executeSpan can not work in place */
+		if (index == this->m_operations.size() - 1) {
+			instruction.result = -1;
+		}
+		else {
+			instruction.result = this->allocateRegister(registersInUse);
+			registers[operation->getOutputSocket()] = instruction.result;
+		}
+		this->m_program.push_back(instruction);
+
+		for (inputIndex = 0; inputIndex < operation->getNumberOfInputSockets(); inputIndex++) {
+			OutputSocket *fromSocket = operation->getInputSocket(inputIndex)->getConnection()->getFromSocket();
+			if (lastUse[fromSocket] == index) {
+				registersInUse[registers[fromSocket]] = false;
+			}
+		}
+	}
+
+	return this->m_numberOfRegisters <= COM_FUSED_MAX_REGISTERS;
+}
+
+int FusedOperation::findInputSocketIndex(OutputSocket *outputSocket) const
+{
+	for (unsigned int index = 0; index < this->m_inputOutputSockets.size(); index++) {
+		if (this->m_inputOutputSockets[index] == outputSocket) {
+			return index;
+		}
+	}
+	return -1;
+}
+
+void FusedOperation::initExecution()
+{
+	/* the fused operations are initialized by the ExecutionSystem */
+	for (unsigned int index = 0; index < this->getNumberOfInputSockets(); index++) {
+		this->m_inputReaders.push_back(this->getInputSocketReader(index));
+	}
+}
+
+void FusedOperation::deinitExecution()
+{
+	this->m_inputReaders.clear();
+}
+
+void FusedOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
+{
+	float registers[COM_FUSED_MAX_REGISTERS][COM_NUMBER_OF_CHANNELS];
+	float *operands[COM_FUSED_MAX_OPERANDS];
+
+	for (vector<FusedInstruction>::iterator it = this->m_program.begin(); it != this->m_program.end(); ++it) {
+		const FusedInstruction &instruction = *it;
+		float *result = (instruction.result == -1) ? output : registers[instruction.result];
+
+		if (instruction.operation == NULL) {
+			this->m_inputReaders[instruction.input]->read(result, x, y, sampler);
+		}
+		else {
+			for (unsigned int index = 0; index < instruction.operation->getNumberOfInputSockets(); index++) {
+				operands[index] = registers[instruction.operands[index]];
+			}
+			instruction.operation->executeSpan(result, operands, 1);
+		}
+	}
+}
+
+void FusedOperation::executeRow(float *output, int x, int y, int width)
+{
+	float registers[COM_FUSED_MAX_REGISTERS][COM_ROW_SPAN * COM_NUMBER_OF_CHANNELS];
+	float *operands[COM_FUSED_MAX_OPERANDS];
+
+	for (int span = 0; span < width; span += COM_ROW_SPAN) {
+		int num = min_ii(width - span, COM_ROW_SPAN);
+
+		for (vector<FusedInstruction>::iterator it = this->m_program.begin(); it != this->m_program.end(); ++it) {
+			const FusedInstruction &instruction = *it;
+			float *result = (instruction.result == -1) ? &output[span * COM_NUMBER_OF_CHANNELS] : registers[instruction.result];
+
+			if (instruction.operation == NULL) {
+				this->m_inputReaders[instruction.input]->readRow(result, x + span, y, num);
+			}
+			else {
+				for (unsigned int index = 0; index < instruction.operation->getNumberOfInputSockets(); index++) {
+					operands[index] = registers[instruction.operands[index]];
+				}
+				instruction.operation->executeSpan(result, operands, num);
+			}
+		}
+	}
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2011, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Jeroen Bakker
+ *		Monique Dewanchand
+ */
+
+#ifndef _COM_FusedOperation_h
+#define _COM_FusedOperation_h
+
+#include "COM_NodeOperation.h"
+
+/**
+ * @brief an instruction of the program of a FusedOperation
+ * either loads an input socket into a register or executes a fused operation.
+ */
+typedef struct FusedInstruction {
+	/**
+	 * @brief the operation to execute, NULL when an input socket is loaded
+	 */
+	NodeOperation *operation;
+
+	/**
+	 * @brief index of the input socket to load
+	 */
+	int input;
+
+	/**
+	 * @brief registers holding the values of the input sockets of the operation
+	 */
+	int operands[COM_FUSED_MAX_OPERANDS];
+
+	/**
+	 * @brief register to store the result in, -1 stores it in the output of the FusedOperation
+	 */
+	int result;
+} FusedInstruction;
+
+/**
+ * @brief calculates a chain of pixel local operations as a single operation
+ *
+ * The chain is compiled into a program. Every input of the chain is read once into a register,
+ * the fused operations calculate their results from registers into registers using
+ * NodeOperation.executeSpan and the last one writes the output. A register is reused as soon
+ * as its value is no longer needed, rows are calculated in spans of COM_ROW_SPAN pixels.
+ *
+ * The fused operations stay part of the ExecutionSystem, which initializes them, but they are
+ * no longer connected to the operations outside the chain.
+ * @see ExecutionSystemHelper.fuseOperations
+ * @ingroup Operation
+ */
+class FusedOperation : public NodeOperation {
+private:
+	/**
+	 * @brief the fused operations, the inputs of an operation come before it, the last one is the output
+	 */
+	vector<NodeOperation *> m_operations;
+
+	/**
+	 * @brief the output sockets outside the chain, for every input socket of this operation
+	 */
+	vector<OutputSocket *> m_inputOutputSockets;
+
+	/**
+	 * @brief the compiled program
+	 */
+	vector<FusedInstruction> m_program;
+
+	/**
+	 * @brief number of registers the program uses
+	 */
+	int m_numberOfRegisters;
+
+	/**
+	 * @brief cached readers of the input sockets
+	 */
+	vector<SocketReader *> m_inputReaders;
+
+	/**
+	 * @brief allocate a free register
+	 */
+	int allocateRegister(vector<bool> &registersInUse);
+
+public:
+	FusedOperation(DataType datatype);
+
+	/**
+	 * @brief add an operation to the chain
+	 * @note the operations connected to its input sockets must be added first
+	 */
+	void addOperation(NodeOperation *operation) { this->m_operations.push_back(operation); }
+
+	/**
+	 * @brief compile the chain into a program
+	 * adds an input socket for every output socket outside the chain that is read.
+	 * @note must be called before the chain is disconnected from the other operations
+	 * @return false when the chain needs more than COM_FUSED_MAX_REGISTERS registers
+	 */
+	bool compile();
+
+	/**
+	 * @brief get the index of the input socket that reads the output socket outside the chain
+	 * @return the index or -1 when the output socket is not read
+	 */
+	int findInputSocketIndex(OutputSocket *outputSocket) const;
+
+	const unsigned int getNumberOfFusedOperations() const { return this->m_operations.size(); }
+	NodeOperation *getFusedOperation(unsigned int index) const { return this->m_operations[index]; }
+	const unsigned int getNumberOfInstructions() const { return this->m_program.size(); }
+	const FusedInstruction &getInstruction(unsigned int index) const { return this->m_program[index]; }
+
+	const bool isFusedOperation() const { return true; }
+
+	void initExecution();
+	void deinitExecution();
+	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width);
+};
+
+#endif
@@ -30,6 +30,7 @@ GammaOperation::GammaOperation() : NodeOperation()
 	this->addOutputSocket(COM_DT_COLOR);
 	this->m_inputProgram = NULL;
 	this->m_inputGammaProgram = NULL;
+	this->setPixelLocal(true);
 }
 void GammaOperation::initExecution()
 {
@@ -53,6 +54,22 @@ void GammaOperation::executePixel(float output[4], float x, float y, PixelSample
 	output[3] = inputValue[3];
 }
 
+void GammaOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *inputValue = inputs[0];
+	const float *inputGamma = inputs[1];
+
+	for (int i = 0; i < width; i++, output += 4, inputValue += 4, inputGamma += 4) {
+		const float gamma = inputGamma[0];
+		/* check for negative to avoid nan's */
+		output[0] = inputValue[0] > 0.0f ? powf(inputValue[0], gamma) : inputValue[0];
+		output[1] = inputValue[1] > 0.0f ? powf(inputValue[1], gamma) : inputValue[1];
+		output[2] = inputValue[2] > 0.0f ? powf(inputValue[2], gamma) : inputValue[2];
+
+		output[3] = inputValue[3];
+	}
+}
+
 void GammaOperation::deinitExecution()
 {
 	this->m_inputProgram = NULL;
@@ -32,6 +32,7 @@ InvertOperation::InvertOperation() : NodeOperation()
 	this->m_color = true;
 	this->m_alpha = false;
 	setResolutionInputSocketIndex(1);
+	this->setPixelLocal(true);
 }
 void InvertOperation::initExecution()
 {
@@ -65,6 +66,31 @@ void InvertOperation::executePixel(float output[4], float x, float y, PixelSampl
 
 }
 
+void InvertOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *inputValue = inputs[0];
+	const float *inputColor = inputs[1];
+
+	for (int i = 0; i < width; i++, output += 4, inputValue += 4, inputColor += 4) {
+		const float value = inputValue[0];
+		const float invertedValue = 1.0f - value;
+
+		if (this->m_color) {
+			output[0] = (1.0f - inputColor[0]) * value + inputColor[0] * invertedValue;
+			output[1] = (1.0f - inputColor[1]) * value + inputColor[1] * invertedValue;
+			output[2] = (1.0f - inputColor[2]) * value + inputColor[2] * invertedValue;
+		}
+		else {
+			copy_v3_v3(output, inputColor);
+		}
+
+		if (this->m_alpha)
+			output[3] = (1.0f - inputColor[3]) * value + inputColor[3] * invertedValue;
+		else
+			output[3] = inputColor[3];
+	}
+}
+
 void InvertOperation::deinitExecution()
 {
 	this->m_inputValueProgram = NULL;
@@ -72,6 +72,21 @@ void MathBaseOperation::clampIfNeeded(float *color)
 	}
 }
 
+void MathBaseOperation::executeMathRow(float *output, int x, int y, int width)
+{
+	float inputValue1[COM_ROW_SPAN * COM_NUMBER_OF_CHANNELS];
+	float inputValue2[COM_ROW_SPAN * COM_NUMBER_OF_CHANNELS];
+
+	for (int span = 0; span < width; span += COM_ROW_SPAN) {
+		int num = min_ii(width - span, COM_ROW_SPAN);
+
+		this->m_inputValue1Operation->readRow(inputValue1, x + span, y, num);
+		this->m_inputValue2Operation->readRow(inputValue2, x + span, y, num);
+
+		mathRow(&output[span * COM_NUMBER_OF_CHANNELS], inputValue1, inputValue2, num);
+	}
+}
+
 void MathAddOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -85,6 +100,15 @@ void MathAddOperation::executePixel(float output[4], float x, float y, PixelSamp
 	clampIfNeeded(output);
 }
 
+void MathAddOperation::mathRow(float *output, const float *value1, const float *value2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value1 += 4, value2 += 4) {
+		output[0] = value1[0] + value2[0];
+
+		clampIfNeeded(output);
+	}
+}
+
 void MathSubtractOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -98,6 +122,15 @@ void MathSubtractOperation::executePixel(float output[4], float x, float y, Pixe
 	clampIfNeeded(output);
 }
 
+void MathSubtractOperation::mathRow(float *output, const float *value1, const float *value2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value1 += 4, value2 += 4) {
+		output[0] = value1[0] - value2[0];
+
+		clampIfNeeded(output);
+	}
+}
+
 void MathMultiplyOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -111,6 +144,15 @@ void MathMultiplyOperation::executePixel(float output[4], float x, float y, Pixe
 	clampIfNeeded(output);
 }
 
+void MathMultiplyOperation::mathRow(float *output, const float *value1, const float *value2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value1 += 4, value2 += 4) {
+		output[0] = value1[0] * value2[0];
+
+		clampIfNeeded(output);
+	}
+}
+
 void MathDivideOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -127,6 +169,18 @@ void MathDivideOperation::executePixel(float output[4], float x, float y, PixelS
 	clampIfNeeded(output);
 }
 
+void MathDivideOperation::mathRow(float *output, const float *value1, const float *value2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value1 += 4, value2 += 4) {
+		if (value2[0] == 0) /* We don't want to divide by zero. */
+			output[0] = 0.0;
+		else
+			output[0] = value1[0] / value2[0];
+
+		clampIfNeeded(output);
+	}
+}
+
 void MathSineOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -265,6 +319,15 @@ void MathMinimumOperation::executePixel(float output[4], float x, float y, Pixel
 	clampIfNeeded(output);
 }
 
+void MathMinimumOperation::mathRow(float *output, const float *value1, const float *value2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value1 += 4, value2 += 4) {
+		output[0] = min(value1[0], value2[0]);
+
+		clampIfNeeded(output);
+	}
+}
+
 void MathMaximumOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -278,6 +341,15 @@ void MathMaximumOperation::executePixel(float output[4], float x, float y, Pixel
 	clampIfNeeded(output);
 }
 
+void MathMaximumOperation::mathRow(float *output, const float *value1, const float *value2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value1 += 4, value2 += 4) {
+		output[0] = max(value1[0], value2[0]);
+
+		clampIfNeeded(output);
+	}
+}
+
 void MathRoundOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -304,6 +376,15 @@ void MathLessThanOperation::executePixel(float output[4], float x, float y, Pixe
 	clampIfNeeded(output);
 }
 
+void MathLessThanOperation::mathRow(float *output, const float *value1, const float *value2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value1 += 4, value2 += 4) {
+		output[0] = value1[0] < value2[0] ? 1.0f : 0.0f;
+
+		clampIfNeeded(output);
+	}
+}
+
 void MathGreaterThanOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -317,4 +398,13 @@ void MathGreaterThanOperation::executePixel(float output[4], float x, float y, P
 	clampIfNeeded(output);
 }
 
+void MathGreaterThanOperation::mathRow(float *output, const float *value1, const float *value2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value1 += 4, value2 += 4) {
+		output[0] = value1[0] > value2[0] ? 1.0f : 0.0f;
+
+		clampIfNeeded(output);
+	}
+}
+
 
@@ -46,12 +46,30 @@ protected:
 	MathBaseOperation();
 
 	void clampIfNeeded(float color[4]);
+
+	/**
+	 * @brief execute a row in spans of COM_ROW_SPAN pixels
+	 * reads the input rows and calculates them with mathRow, subclasses that implement
+	 * mathRow use this for executeRow
+	 */
+	void executeMathRow(float *output, int x, int y, int width);
+
+	/**
+	 * @brief calculate a span of input rows, only called through executeMathRow
+	 */
+	virtual void mathRow(float *output, const float *value1, const float *value2, int width) {}
 public:
 	/**
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler) = 0;
 	
+	/**
+	 * the inner loop of this program, for a span of input values
+	 * @note only valid for operations that implement mathRow
+	 */
+	void executeSpan(float *output, float **inputs, int width) { mathRow(output, inputs[0], inputs[1], width); }
+	
 	/**
 	 * Initialize the execution
 	 */
@@ -72,23 +90,31 @@ public:
 
 class MathAddOperation : public MathBaseOperation {
 public:
-	MathAddOperation() : MathBaseOperation() {}
+	MathAddOperation() : MathBaseOperation() { this->setPixelLocal(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width) { executeMathRow(output, x, y, width); }
+	void mathRow(float *output, const float *value1, const float *value2, int width);
 };
 class MathSubtractOperation : public MathBaseOperation {
 public:
-	MathSubtractOperation() : MathBaseOperation() {}
+	MathSubtractOperation() : MathBaseOperation() { this->setPixelLocal(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width) { executeMathRow(output, x, y, width); }
+	void mathRow(float *output, const float *value1, const float *value2, int width);
 };
 class MathMultiplyOperation : public MathBaseOperation {
 public:
-	MathMultiplyOperation() : MathBaseOperation() {}
+	MathMultiplyOperation() : MathBaseOperation() { this->setPixelLocal(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width) { executeMathRow(output, x, y, width); }
+	void mathRow(float *output, const float *value1, const float *value2, int width);
 };
 class MathDivideOperation : public MathBaseOperation {
 public:
-	MathDivideOperation() : MathBaseOperation() {}
+	MathDivideOperation() : MathBaseOperation() { this->setPixelLocal(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width) { executeMathRow(output, x, y, width); }
+	void mathRow(float *output, const float *value1, const float *value2, int width);
 };
 class MathSineOperation : public MathBaseOperation {
 public:
@@ -133,13 +159,17 @@ public:
 };
 class MathMinimumOperation : public MathBaseOperation {
 public:
-	MathMinimumOperation() : MathBaseOperation() {}
+	MathMinimumOperation() : MathBaseOperation() { this->setPixelLocal(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width) { executeMathRow(output, x, y, width); }
+	void mathRow(float *output, const float *value1, const float *value2, int width);
 };
 class MathMaximumOperation : public MathBaseOperation {
 public:
-	MathMaximumOperation() : MathBaseOperation() {}
+	MathMaximumOperation() : MathBaseOperation() { this->setPixelLocal(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width) { executeMathRow(output, x, y, width); }
+	void mathRow(float *output, const float *value1, const float *value2, int width);
 };
 class MathRoundOperation : public MathBaseOperation {
 public:
@@ -148,13 +178,17 @@ public:
 };
 class MathLessThanOperation : public MathBaseOperation {
 public:
-	MathLessThanOperation() : MathBaseOperation() {}
+	MathLessThanOperation() : MathBaseOperation() { this->setPixelLocal(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width) { executeMathRow(output, x, y, width); }
+	void mathRow(float *output, const float *value1, const float *value2, int width);
 };
 class MathGreaterThanOperation : public MathBaseOperation {
 public:
-	MathGreaterThanOperation() : MathBaseOperation() {}
+	MathGreaterThanOperation() : MathBaseOperation() { this->setPixelLocal(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width) { executeMathRow(output, x, y, width); }
+	void mathRow(float *output, const float *value1, const float *value2, int width);
 };
 
 #endif
@@ -63,6 +63,45 @@ void MixBaseOperation::executePixel(float output[4], float x, float y, PixelSamp
 	output[3] = inputColor1[3];
 }
 
+void MixBaseOperation::executeMixRow(float *output, int x, int y, int width)
+{
+	float inputValue[COM_ROW_SPAN * COM_NUMBER_OF_CHANNELS];
+	float inputColor1[COM_ROW_SPAN * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SPAN * COM_NUMBER_OF_CHANNELS];
+
+	for (int span = 0; span < width; span += COM_ROW_SPAN) {
+		int num = min_ii(width - span, COM_ROW_SPAN);
+
+		this->m_inputValueOperation->readRow(inputValue, x + span, y, num);
+		this->m_inputColor1Operation->readRow(inputColor1, x + span, y, num);
+		this->m_inputColor2Operation->readRow(inputColor2, x + span, y, num);
+
+		mixRow(&output[span * COM_NUMBER_OF_CHANNELS], inputValue, inputColor1, inputColor2, num);
+	}
+}
+
+void MixBaseOperation::mixRow(float *output, const float *value, const float *color1, const float *color2, int width)
+{
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+		float facm = 1.0f - fac;
+#ifdef __SSE__
+		__m128 c1 = _mm_loadu_ps(color1);
+		__m128 c2 = _mm_loadu_ps(color2);
+		__m128 result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(facm), c1), _mm_mul_ps(_mm_set1_ps(fac), c2));
+
+		_mm_storeu_ps(output, finishMix(result, c1));
+#else
+		output[0] = facm * color1[0] + fac * color2[0];
+		output[1] = facm * color1[1] + fac * color2[1];
+		output[2] = facm * color1[2] + fac * color2[2];
+		output[3] = color1[3];
+
+		clampIfNeeded(output);
+#endif
+	}
+}
+
 void MixBaseOperation::deinitExecution()
 {
 	this->m_inputValueOperation = NULL;
@@ -24,6 +24,10 @@
 #define _COM_MixBaseOperation_h
 #include "COM_NodeOperation.h"
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 
 /**
  * this program converts an input color to an output value.
@@ -49,6 +53,39 @@ protected:
 			CLAMP(color[3], 0.0f, 1.0f);
 		}
 	}
+
+	inline float mixFactor(const float value[4], const float color2[4])
+	{
+		return (m_valueAlphaMultiply) ? value[0] * color2[3] : value[0];
+	}
+
+#ifdef __SSE__
+	/**
+	 * rgb of the mixed color with the alpha of the first color, clamped if needed
+	 */
+	inline __m128 finishMix(__m128 result, __m128 color1)
+	{
+		__m128 alpha = _mm_shuffle_ps(result, color1, _MM_SHUFFLE(3, 3, 2, 2));
+		result = _mm_shuffle_ps(result, alpha, _MM_SHUFFLE(2, 0, 1, 0));
+
+		if (m_useClamp) {
+			result = _mm_min_ps(_mm_max_ps(result, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		}
+		return result;
+	}
+#endif
+
+	/**
+	 * @brief execute a row in spans of COM_ROW_SPAN pixels
+	 * reads the input rows and mixes them with mixRow, subclasses that implement mixRow
+	 * use this for executeRow
+	 */
+	void executeMixRow(float *output, int x, int y, int width);
+
+	/**
+	 * @brief mix a span of input rows, the default implementation blends the colors
+	 */
+	virtual void mixRow(float *output, const float *value, const float *color1, const float *color2, int width);
 	
 public:
 	/**
@@ -61,6 +98,12 @@ public:
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
 	
+	/**
+	 * the inner loop of this program, for a span of input values
+	 * @note only valid for operations that implement mixRow
+	 */
+	void executeSpan(float *output, float **inputs, int width) { mixRow(output, inputs[0], inputs[1], inputs[2], width); }
+	
 	/**
 	 * Initialize the execution
 	 */
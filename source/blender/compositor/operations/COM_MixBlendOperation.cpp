@@ -24,7 +24,7 @@
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setPixelLocal(true);
 }
 
 void MixBlendOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
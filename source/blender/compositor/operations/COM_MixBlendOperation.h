@@ -41,5 +41,10 @@ public:
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
 
+	/**
+	 * the inner loop of this program, for a row of pixels
+	 */
+	void executeRow(float *output, int x, int y, int width) { executeMixRow(output, x, y, width); }
+
 };
 #endif
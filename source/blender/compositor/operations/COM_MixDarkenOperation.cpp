@@ -24,7 +24,7 @@
 
 MixDarkenOperation::MixDarkenOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setPixelLocal(true);
 }
 
 void MixDarkenOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -57,3 +57,32 @@ void MixDarkenOperation::executePixel(float output[4], float x, float y, PixelSa
 	clampIfNeeded(output);
 }
 
+void MixDarkenOperation::mixRow(float *output, const float *value, const float *color1, const float *color2, int width)
+{
+#ifdef __SSE__
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+		__m128 f = _mm_set1_ps(fac);
+		__m128 fm = _mm_set1_ps(1.0f - fac);
+		__m128 c1 = _mm_loadu_ps(color1);
+		__m128 c2 = _mm_loadu_ps(color2);
+		__m128 result = _mm_min_ps(_mm_add_ps(c2, _mm_mul_ps(_mm_sub_ps(one, c2), fm)), c1);
+
+		_mm_storeu_ps(output, finishMix(result, c1));
+	}
+#else
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+		float facm = 1.0f - fac;
+
+		output[0] = min_ff(color2[0] + (1.0f - color2[0]) * facm, color1[0]);
+		output[1] = min_ff(color2[1] + (1.0f - color2[1]) * facm, color1[1]);
+		output[2] = min_ff(color2[2] + (1.0f - color2[2]) * facm, color1[2]);
+		output[3] = color1[3];
+
+		clampIfNeeded(output);
+	}
+#endif
+}
@@ -41,5 +41,11 @@ public:
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
 
+	/**
+	 * the inner loop of this program, for a row of pixels
+	 */
+	void executeRow(float *output, int x, int y, int width) { executeMixRow(output, x, y, width); }
+	void mixRow(float *output, const float *value, const float *color1, const float *color2, int width);
+
 };
 #endif
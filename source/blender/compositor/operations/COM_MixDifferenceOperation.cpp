@@ -25,7 +25,7 @@
 
 MixDifferenceOperation::MixDifferenceOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setPixelLocal(true);
 }
 
 void MixDifferenceOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -50,3 +50,30 @@ void MixDifferenceOperation::executePixel(float output[4], float x, float y, Pix
 	clampIfNeeded(output);
 }
 
+void MixDifferenceOperation::mixRow(float *output, const float *value, const float *color1, const float *color2, int width)
+{
+#ifdef __SSE__
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+		__m128 f = _mm_set1_ps(fac);
+		__m128 fm = _mm_set1_ps(1.0f - fac);
+		__m128 c1 = _mm_loadu_ps(color1);
+		__m128 c2 = _mm_loadu_ps(color2);
+		__m128 result = _mm_add_ps(_mm_mul_ps(fm, c1), _mm_mul_ps(f, _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(c1, c2))));
+
+		_mm_storeu_ps(output, finishMix(result, c1));
+	}
+#else
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+		float facm = 1.0f - fac;
+
+		output[0] = facm * color1[0] + fac * fabsf(color1[0] - color2[0]);
+		output[1] = facm * color1[1] + fac * fabsf(color1[1] - color2[1]);
+		output[2] = facm * color1[2] + fac * fabsf(color1[2] - color2[2]);
+		output[3] = color1[3];
+
+		clampIfNeeded(output);
+	}
+#endif
+}
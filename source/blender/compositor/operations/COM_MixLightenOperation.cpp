@@ -24,7 +24,7 @@
 
 MixLightenOperation::MixLightenOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setPixelLocal(true);
 }
 
 void MixLightenOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -55,3 +55,28 @@ void MixLightenOperation::executePixel(float output[4], float x, float y, PixelS
 	clampIfNeeded(output);
 }
 
+void MixLightenOperation::mixRow(float *output, const float *value, const float *color1, const float *color2, int width)
+{
+#ifdef __SSE__
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+		__m128 f = _mm_set1_ps(fac);
+		__m128 c1 = _mm_loadu_ps(color1);
+		__m128 c2 = _mm_loadu_ps(color2);
+		__m128 result = _mm_max_ps(_mm_mul_ps(f, c2), c1);
+
+		_mm_storeu_ps(output, finishMix(result, c1));
+	}
+#else
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+
+		output[0] = max_ff(fac * color2[0], color1[0]);
+		output[1] = max_ff(fac * color2[1], color1[1]);
+		output[2] = max_ff(fac * color2[2], color1[2]);
+		output[3] = color1[3];
+
+		clampIfNeeded(output);
+	}
+#endif
+}
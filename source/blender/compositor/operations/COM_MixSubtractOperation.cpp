@@ -24,7 +24,7 @@
 
 MixSubtractOperation::MixSubtractOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setPixelLocal(true);
 }
 
 void MixSubtractOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -48,3 +48,28 @@ void MixSubtractOperation::executePixel(float output[4], float x, float y, Pixel
 	clampIfNeeded(output);
 }
 
+void MixSubtractOperation::mixRow(float *output, const float *value, const float *color1, const float *color2, int width)
+{
+#ifdef __SSE__
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+		__m128 f = _mm_set1_ps(fac);
+		__m128 c1 = _mm_loadu_ps(color1);
+		__m128 c2 = _mm_loadu_ps(color2);
+		__m128 result = _mm_sub_ps(c1, _mm_mul_ps(f, c2));
+
+		_mm_storeu_ps(output, finishMix(result, c1));
+	}
+#else
+	for (int i = 0; i < width; i++, output += 4, value += 4, color1 += 4, color2 += 4) {
+		float fac = mixFactor(value, color2);
+
+		output[0] = color1[0] - fac * color2[0];
+		output[1] = color1[1] - fac * color2[1];
+		output[2] = color1[2] - fac * color2[2];
+		output[3] = color1[3];
+
+		clampIfNeeded(output);
+	}
+#endif
+}
@@ -30,6 +30,7 @@ SetAlphaOperation::SetAlphaOperation() : NodeOperation()
 	
 	this->m_inputColor = NULL;
 	this->m_inputAlpha = NULL;
+	this->setPixelLocal(true);
 }
 
 void SetAlphaOperation::initExecution()
@@ -48,6 +49,17 @@ void SetAlphaOperation::executePixel(float output[4], float x, float y, PixelSam
 	output[3] = alphaInput[0];
 }
 
+void SetAlphaOperation::executeSpan(float *output, float **inputs, int width)
+{
+	const float *inputColor = inputs[0];
+	const float *alphaInput = inputs[1];
+
+	for (int i = 0; i < width; i++, output += 4, inputColor += 4, alphaInput += 4) {
+		copy_v3_v3(output, inputColor);
+		output[3] = alphaInput[0];
+	}
+}
+
 void SetAlphaOperation::deinitExecution()
 {
 	this->m_inputColor = NULL;
@@ -57,6 +57,11 @@ public:
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
 
+	/**
+	 * the inner loop of this program, for a row of pixels
+	 */
+	void executeRow(float *output, int x, int y, int width);
+
 	void determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2]);
 	const bool isSetOperation() const { return true; }
 
@@ -81,30 +81,37 @@ void ViewerOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 	const int offsetadd4 = offsetadd * 4;
 	int offset = (y1 * this->getWidth() + x1);
 	int offset4 = offset * 4;
-	float alpha[4], depth[4];
+	float row[COM_ROW_SPAN * COM_NUMBER_OF_CHANNELS];
 	int x;
 	int y;
+	int i;
 	bool breaked = false;
 
 	for (y = y1; y < y2 && (!breaked); y++) {
-		for (x = x1; x < x2; x++) {
-			this->m_imageInput->read(&(buffer[offset4]), x, y, COM_PS_NEAREST);
+		this->m_imageInput->readRow(&(buffer[offset4]), x1, y, x2 - x1);
+
+		for (x = x1; x < x2; x += COM_ROW_SPAN) {
+			const int num = min_ii(x2 - x, COM_ROW_SPAN);
+
 			if (this->m_ignoreAlpha) {
-				buffer[offset4 + 3] = 1.0f;
+				for (i = 0; i < num; i++)
+					buffer[offset4 + i * 4 + 3] = 1.0f;
 			}
 			else {
 				if (this->m_alphaInput != NULL) {
-					this->m_alphaInput->read(alpha, x, y, COM_PS_NEAREST);
-					buffer[offset4 + 3] = alpha[0];
+					this->m_alphaInput->readRow(row, x, y, num);
+					for (i = 0; i < num; i++)
+						buffer[offset4 + i * 4 + 3] = row[i * 4];
 				}
 			}
 			if (m_depthInput) {
-				this->m_depthInput->read(depth, x, y, COM_PS_NEAREST);
-				depthbuffer[offset] = depth[0];
+				this->m_depthInput->readRow(row, x, y, num);
+				for (i = 0; i < num; i++)
+					depthbuffer[offset + i] = row[i * 4];
 			}
 
-			offset ++;
-			offset4 += 4;
+			offset += num;
+			offset4 += num * 4;
 		}
 		if (isBreaked()) {
 			breaked = true;
@@ -60,7 +60,6 @@ void WriteBufferOperation::deinitExecution()
 void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
 	MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
-	float *buffer = memoryBuffer->getBuffer();
 	if (this->m_input->isComplex()) {
 		void *data = this->m_input->initializeTileData(rect);
 		int x1 = rect->xmin;
@@ -70,12 +69,11 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int x;
 		int y;
 		bool breaked = false;
+		float color[4];
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
 			for (x = x1; x < x2; x++) {
-				this->m_input->read(&(buffer[offset4]), x, y, data);
-				offset4 += COM_NUMBER_OF_CHANNELS;
-
+				this->m_input->read(color, x, y, data);
+				memoryBuffer->writePixel(x, y, color);
 			}
 			if (isBreaked()) {
 				breaked = true;
@@ -93,19 +91,33 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int x2 = rect->xmax;
 		int y2 = rect->ymax;
 
-		int x;
+		/* color buffers are written in place, other buffers only store some of the channels */
+		const bool inPlace = memoryBuffer->getNumberOfChannels() == COM_NUMBER_OF_CHANNELS && !memoryBuffer->isHalfFloat();
+		float *row = NULL;
+		if (!inPlace) {
+			row = (float *)MEM_mallocN(sizeof(float) * (x2 - x1) * COM_NUMBER_OF_CHANNELS, __func__);
+		}
+
 		int y;
 		bool breaked = false;
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
-			for (x = x1; x < x2; x++) {
-				this->m_input->read(&(buffer[offset4]), x, y, COM_PS_NEAREST);
-				offset4 += COM_NUMBER_OF_CHANNELS;
+			/* operations execute the row at once when they can, per pixel otherwise */
+			if (inPlace) {
+				int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
+				this->m_input->readRow(&(memoryBuffer->getBuffer()[offset4]), x1, y, x2 - x1);
+			}
+			else {
+				this->m_input->readRow(row, x1, y, x2 - x1);
+				memoryBuffer->writeRow(x1, y, x2 - x1, row);
 			}
 			if (isBreaked()) {
 				breaked = true;
 			}
 		}
+
+		if (row) {
+			MEM_freeN(row);
+		}
 	}
 	memoryBuffer->setCreatedState();
 }
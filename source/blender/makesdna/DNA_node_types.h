@@ -404,6 +404,7 @@ typedef struct bNodeTree {
 #define NTREE_TWO_PASS				4	/* two pass */
 #define NTREE_COM_GROUPNODE_BUFFER	8	/* use groupnode buffers */
 #define NTREE_VIEWER_BORDER		16	/* use a border for viewer nodes */
+#define NTREE_COM_HALF_BUFFER		32	/* store intermediate buffers as half floats */
 
 /* XXX not nice, but needed as a temporary flags
  * for group updates after library linking.
@@ -497,7 +498,8 @@ enum {
 };
 
 enum {
-	CMP_NODEFLAG_BLUR_VARIABLE_SIZE = (1 << 0)
+	CMP_NODEFLAG_BLUR_VARIABLE_SIZE = (1 << 0),
+	CMP_NODEFLAG_BLUR_FAST_BOKEH    = (1 << 1)   /* bokeh blur node only */
 };
 
 typedef struct NodeFrame {
@@ -646,7 +648,7 @@ typedef struct NodeVertexCol {
 
 /* qdn: Defocus blur node */
 typedef struct NodeDefocus {
-	char bktype, pad_c1, preview, gamco;
+	char bktype, fast, preview, gamco;
 	short samples, no_zbuf;
 	float fstop, maxblur, bthresh, scale;
 	float rotation, pad_f1;
@@ -257,6 +257,55 @@ void ntreeCompositExecTree(bNodeTree *ntree, RenderData *rd, int rendering, int
 	(void)do_preview;
 }
 
+static int composite_benchmark_test_break(void *UNUSED(handle))
+{
+	return G.is_break;
+}
+
+static void composite_benchmark_progress(void *UNUSED(handle), float UNUSED(progress))
+{
+	/* pass */
+}
+
+/* execute the compositing tree of the scene a number of times, as for rendering, and write the
+ * timings and memory usage as JSON to filepath (NULL for stdout). Caches are cleared before every
+ * run, so all nodes are calculated every time.
+ * Returns 0 when the scene has no compositing tree or the statistics could not be written. */
+int ntreeCompositBenchmark(Scene *scene, int runs, const char *filepath)
+{
+#ifdef WITH_COMPOSITOR
+	bNodeTree *ntree = scene->nodetree;
+	int run, ok;
+
+	if (ntree == NULL) {
+		return 0;
+	}
+
+	ntree->test_break = composite_benchmark_test_break;
+	ntree->progress = composite_benchmark_progress;
+	ntree->stats_draw = NULL;
+	ntree->update_draw = NULL;
+	ntree->tbh = ntree->prh = ntree->sdh = ntree->udh = NULL;
+
+	COM_startStatistics();
+	for (run = 0; run < runs && !G.is_break; run++) {
+		COM_clearCaches();
+		ntreeCompositTagRender(scene);
+		ntreeCompositExecTree(ntree, &scene->r, 1, 0, &scene->view_settings, &scene->display_settings);
+	}
+	ok = COM_writeStatistics(filepath);
+	COM_stopStatistics();
+
+	ntree->test_break = NULL;
+	ntree->progress = NULL;
+
+	return ok;
+#else
+	(void)scene, (void)runs, (void)filepath;
+	return 0;
+#endif
+}
+
 /* *********************************************** */
 
 static void set_output_visible(bNode *node, int passflag, int index, int pass)
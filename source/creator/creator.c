@@ -73,11 +73,13 @@
 #endif
 
 #include "BLI_args.h"
+#include "BLI_math_base.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 #include "BLI_callbacks.h"
 
 #include "DNA_ID.h"
+#include "DNA_node_types.h"
 #include "DNA_scene_types.h"
 #include "DNA_userdef_types.h"
 
@@ -1074,6 +1076,55 @@ static int set_skip_frame(int argc, const char **argv, void *data)
 	}
 }
 
+static int set_compositor_chunk_size(int argc, const char **argv, void *data)
+{
+	bContext *C = data;
+	Scene *scene = CTX_data_scene(C);
+	if (scene && scene->nodetree) {
+		if (argc > 1) {
+			int chunksize = atoi(argv[1]);
+			if (chunksize < NTREE_CHUNCKSIZE_32 || chunksize > NTREE_CHUNCKSIZE_1024 || !is_power_of_2_i(chunksize)) {
+				printf("\nError: chunk size must be a power of 2 between 32 and 1024 '--compositor-chunk-size'.\n");
+				return 1;
+			}
+			scene->nodetree->chunksize = chunksize;
+			return 1;
+		}
+		else {
+			printf("\nError: chunk size must follow '--compositor-chunk-size'.\n");
+			return 0;
+		}
+	}
+	else {
+		printf("\nError: no blend with a compositing tree loaded. cannot use '--compositor-chunk-size'.\n");
+		return 0;
+	}
+}
+
+static int compositor_benchmark(int argc, const char **argv, void *data)
+{
+	bContext *C = data;
+	Scene *scene = CTX_data_scene(C);
+	if (scene && scene->nodetree) {
+		if (argc > 2) {
+			int runs = max_ii(atoi(argv[1]), 1);
+			const char *filepath = STREQ(argv[2], "-") ? NULL : argv[2];
+			if (!ntreeCompositBenchmark(scene, runs, filepath)) {
+				printf("\nError: cannot write compositor benchmark results to '%s'.\n", argv[2]);
+			}
+			return 2;
+		}
+		else {
+			printf("\nError: number of runs and output file must follow '--compositor-benchmark'.\n");
+			return 0;
+		}
+	}
+	else {
+		printf("\nError: no blend with a compositing tree loaded. cannot use '--compositor-benchmark'.\n");
+		return 0;
+	}
+}
+
 /* macro for ugly context setup/reset */
 #ifdef WITH_PYTHON
 #define BPY_CTX_SETUP(_cmd)                                                   \
@@ -1382,6 +1433,8 @@ static void setupArguments(bContext *C, bArgs *ba, SYS_SystemHandle *syshandle)
 	BLI_argsAdd(ba, 4, "-g", NULL, game_doc, set_ge_parameters, syshandle);
 	BLI_argsAdd(ba, 4, "-f", "--render-frame", "<frame>\n\tRender frame <frame> and save it.\n\t+<frame> start frame relative, -<frame> end frame relative.", render_frame, C);
 	BLI_argsAdd(ba, 4, "-a", "--render-anim", "\n\tRender frames from start to end (inclusive)", render_animation, C);
+	BLI_argsAdd(ba, 4, NULL, "--compositor-chunk-size", "<size>\n\tSet the chunk size of the compositing tree to <size> (32-1024, use before the --compositor-benchmark argument)", set_compositor_chunk_size, C);
+	BLI_argsAdd(ba, 4, NULL, "--compositor-benchmark", "<runs> <file>\n\tExecute the compositing tree <runs> times and write timings and memory usage as JSON to <file>\n\t'-' writes to stdout, set the number of threads with -t before", compositor_benchmark, C);
 	BLI_argsAdd(ba, 4, "-S", "--scene", "<name>\n\tSet the active scene <name> for rendering", set_scene, C);
 	BLI_argsAdd(ba, 4, "-s", "--frame-start", "<frame>\n\tSet start to frame <frame> (use before the -a argument)", set_start_frame, C);
 	BLI_argsAdd(ba, 4, "-e", "--frame-end", "<frame>\n\tSet end to frame <frame> (use before the -a argument)", set_end_frame, C);
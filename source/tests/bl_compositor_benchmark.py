@@ -0,0 +1,242 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Creates synthetic reference compositing trees for the compositor benchmark
+# and optionally runs the benchmark on them. The trees only use procedural
+# textures as input, so no render or image files are needed.
+#
+# Create the .blend files:
+#   ./blender.bin --background --factory-startup \
+#       --python source/tests/bl_compositor_benchmark.py -- \
+#       --output-dir /tmp/compositor_benchmark
+#
+# Create them and run every tree 5 times with 8 threads and 256x256 chunks,
+# the results are written next to the .blend files as JSON:
+#   ./blender.bin --background --factory-startup \
+#       --python source/tests/bl_compositor_benchmark.py -- \
+#       --output-dir /tmp/compositor_benchmark --runs 5 --threads 8 --chunk-size 256
+#
+# A single tree can be benchmarked directly as well:
+#   ./blender.bin -b /tmp/compositor_benchmark/blur_heavy.blend -t 8 \
+#       --compositor-chunk-size 256 --compositor-benchmark 5 -
+
+import bpy
+import os
+import subprocess
+import sys
+
+
+def new_tree(scene, resolution):
+    scene.render.resolution_x = resolution[0]
+    scene.render.resolution_y = resolution[1]
+    scene.render.resolution_percentage = 100
+    scene.use_nodes = True
+
+    tree = scene.node_tree
+    tree.nodes.clear()
+    return tree
+
+
+def texture_node(tree, name, texture_type, noise_scale):
+    texture = bpy.data.textures.new(name, texture_type)
+    if hasattr(texture, "noise_scale"):
+        texture.noise_scale = noise_scale
+
+    node = tree.nodes.new("CompositorNodeTexture")
+    node.name = name
+    node.texture = texture
+    return node
+
+
+def composite_node(tree, socket):
+    node = tree.nodes.new("CompositorNodeComposite")
+    tree.links.new(socket, node.inputs[0])
+    return node
+
+
+def create_blur_heavy(scene, resolution):
+    """Large gaussian, bokeh and variable size defocus blurs."""
+    tree = new_tree(scene, resolution)
+    links = tree.links
+
+    plate = texture_node(tree, "Plate", 'CLOUDS', 0.05)
+    depth = texture_node(tree, "Depth", 'BLEND', 0.25)
+
+    blur = tree.nodes.new("CompositorNodeBlur")
+    blur.filter_type = 'GAUSS'
+    blur.size_x = 64
+    blur.size_y = 64
+    links.new(plate.outputs["Color"], blur.inputs["Image"])
+
+    bokeh_image = tree.nodes.new("CompositorNodeBokehImage")
+    bokeh_image.flaps = 6
+
+    bokeh_blur = tree.nodes.new("CompositorNodeBokehBlur")
+    bokeh_blur.inputs["Size"].default_value = 2.0
+    links.new(blur.outputs["Image"], bokeh_blur.inputs["Image"])
+    links.new(bokeh_image.outputs["Image"], bokeh_blur.inputs["Bokeh"])
+
+    defocus = tree.nodes.new("CompositorNodeDefocus")
+    defocus.use_zbuffer = False
+    defocus.z_scale = 32.0
+    defocus.blur_max = 32.0
+    links.new(bokeh_blur.outputs["Image"], defocus.inputs["Image"])
+    links.new(depth.outputs["Value"], defocus.inputs["Z"])
+
+    glare = tree.nodes.new("CompositorNodeGlare")
+    glare.glare_type = 'FOG_GLOW'
+    links.new(defocus.outputs["Image"], glare.inputs["Image"])
+
+    composite_node(tree, glare.outputs["Image"])
+
+
+def create_keying(scene, resolution):
+    """Green screen plate keyed and composited over a background."""
+    tree = new_tree(scene, resolution)
+    links = tree.links
+
+    foreground = texture_node(tree, "Foreground", 'CLOUDS', 0.1)
+    matte = texture_node(tree, "Matte", 'VORONOI', 0.5)
+    background = texture_node(tree, "Background", 'MARBLE', 0.2)
+
+    screen = tree.nodes.new("CompositorNodeRGB")
+    screen.outputs[0].default_value = (0.1, 0.8, 0.15, 1.0)
+
+    plate = tree.nodes.new("CompositorNodeMixRGB")
+    links.new(matte.outputs["Value"], plate.inputs[0])
+    links.new(screen.outputs[0], plate.inputs[1])
+    links.new(foreground.outputs["Color"], plate.inputs[2])
+
+    keying = tree.nodes.new("CompositorNodeKeying")
+    links.new(plate.outputs["Image"], keying.inputs["Image"])
+    links.new(screen.outputs[0], keying.inputs["Key Color"])
+
+    spill = tree.nodes.new("CompositorNodeColorSpill")
+    links.new(keying.outputs["Image"], spill.inputs["Image"])
+
+    channel_key = tree.nodes.new("CompositorNodeChannelMatte")
+    links.new(plate.outputs["Image"], channel_key.inputs["Image"])
+
+    garbage = tree.nodes.new("CompositorNodeMath")
+    garbage.operation = 'MULTIPLY'
+    links.new(keying.outputs["Matte"], garbage.inputs[0])
+    links.new(channel_key.outputs["Matte"], garbage.inputs[1])
+
+    set_alpha = tree.nodes.new("CompositorNodeSetAlpha")
+    links.new(spill.outputs["Image"], set_alpha.inputs["Image"])
+    links.new(garbage.outputs["Value"], set_alpha.inputs["Alpha"])
+
+    alpha_over = tree.nodes.new("CompositorNodeAlphaOver")
+    links.new(background.outputs["Color"], alpha_over.inputs[1])
+    links.new(set_alpha.outputs["Image"], alpha_over.inputs[2])
+
+    composite_node(tree, alpha_over.outputs["Image"])
+
+
+def create_many_passes(scene, resolution, passes=16):
+    """Many passes, each graded with pixel local nodes, added together."""
+    tree = new_tree(scene, resolution)
+    links = tree.links
+
+    texture_types = ('CLOUDS', 'MARBLE', 'WOOD', 'VORONOI', 'MUSGRAVE', 'STUCCI')
+    blend_types = ('ADD', 'MULTIPLY', 'SCREEN', 'LIGHTEN', 'DARKEN', 'DIFFERENCE')
+    result = None
+
+    for index in range(passes):
+        source = texture_node(tree, "Pass %d" % index, texture_types[index % len(texture_types)], 0.1 + 0.02 * index)
+
+        gamma = tree.nodes.new("CompositorNodeGamma")
+        gamma.inputs["Gamma"].default_value = 0.8 + 0.05 * index
+        links.new(source.outputs["Color"], gamma.inputs["Image"])
+
+        balance = tree.nodes.new("CompositorNodeColorBalance")
+        links.new(gamma.outputs["Image"], balance.inputs["Image"])
+
+        hue_sat = tree.nodes.new("CompositorNodeHueSat")
+        links.new(balance.outputs["Image"], hue_sat.inputs["Image"])
+
+        curves = tree.nodes.new("CompositorNodeCurveRGB")
+        links.new(hue_sat.outputs["Image"], curves.inputs["Image"])
+
+        invert = tree.nodes.new("CompositorNodeInvert")
+        invert.inputs["Fac"].default_value = 0.1
+        links.new(curves.outputs["Image"], invert.inputs["Color"])
+
+        if result is None:
+            result = invert.outputs["Color"]
+        else:
+            mix = tree.nodes.new("CompositorNodeMixRGB")
+            mix.blend_type = blend_types[index % len(blend_types)]
+            mix.inputs["Fac"].default_value = 1.0 / (index + 1)
+            links.new(result, mix.inputs[1])
+            links.new(invert.outputs["Color"], mix.inputs[2])
+            result = mix.outputs["Image"]
+
+    composite_node(tree, result)
+
+
+TREES = (
+    ("blur_heavy", create_blur_heavy),
+    ("keying", create_keying),
+    ("many_passes", create_many_passes),
+)
+
+
+def main():
+    import argparse
+
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+
+    parser = argparse.ArgumentParser(description="Create and run the compositor benchmark reference trees")
+    parser.add_argument("--output-dir", required=True, help="directory to write the .blend and .json files to")
+    parser.add_argument("--resolution", type=int, nargs=2, default=(1920, 1080), help="resolution of the trees")
+    parser.add_argument("--runs", type=int, default=0, help="number of runs per tree, 0 only creates the trees")
+    parser.add_argument("--threads", type=int, default=0, help="number of threads, 0 for the processor count")
+    parser.add_argument("--chunk-size", type=int, default=0, help="chunk size, 0 keeps the default")
+    args = parser.parse_args(argv)
+
+    os.makedirs(args.output_dir, exist_ok=True)
+
+    for name, create in TREES:
+        bpy.ops.wm.read_factory_settings()
+        create(bpy.context.scene, args.resolution)
+
+        filepath = os.path.join(args.output_dir, name + ".blend")
+        bpy.ops.wm.save_as_mainfile(filepath=filepath)
+        print("Created %r" % filepath)
+
+    if args.runs <= 0:
+        return
+
+    for name, create in TREES:
+        filepath = os.path.join(args.output_dir, name + ".blend")
+        result_filepath = os.path.join(args.output_dir, name + ".json")
+
+        command = [bpy.app.binary_path, "--background", "--factory-startup", filepath, "-t", str(args.threads)]
+        if args.chunk_size:
+            command += ["--compositor-chunk-size", str(args.chunk_size)]
+        command += ["--compositor-benchmark", str(args.runs), result_filepath]
+
+        subprocess.check_call(command)
+        print("Benchmarked %r, results in %r" % (name, result_filepath))
+
+
+if __name__ == "__main__":
+    main()